@@ -0,0 +1,938 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#include <stdio.h>
+#include <time.h>
+
+// Include ExmapleBase.h before others as it includes Windows 'crtdbg.h'
+// which requires to be included before 'malloc.h'.
+#include "../../examples/C/Hash/ExampleBase.h"
+
+/**
+ * @file Benchmarks.c
+ * Continuous load benchmark for the Hash algorithm. Each preset configuration
+ * is loaded in turn and the evidence records are processed by 1, 2, 4... up
+ * to the maximum number of threads, every thread processing all the records.
+ *
+ * The time taken by each detection is split into three phases:
+ * - parse: creating the evidence collection from the key value pairs,
+ * - walk: evaluating the graph with fiftyoneDegreesResultsHashFromEvidence,
+ * - values: getting the values of every required property.
+ *
+ * The latency of each phase, and of the whole detection, is recorded in a
+ * histogram with a relative precision of about 3% from which the 50th, 99th
+ * and 99.9th percentiles are reported. The results can be written as JSON
+ * and CSV so that runs on the same hardware can be compared between
+ * releases.
+ *
+ * With the node search option, the in memory configuration is also run with
+ * the flat graph searching the records of ordered list nodes, and then with
+ * the hash codes of those nodes laid out to be searched. The evidence
+ * exercises the nodes in proportion to real traffic, so the walk phase
+ * compares the two searches over the node sizes found in the data file.
+ */
+
+// The default maximum number of threads.
+#define DEFAULT_MAX_THREADS 4
+// The default number of evidence records to read.
+#define DEFAULT_RECORDS 20000
+// The default number of timed passes over the records for each thread count.
+#define DEFAULT_PASSES 1
+
+// Parameters used for allocating memory when reading evidence.
+#define SIZE_OF_KEY 500
+#define SIZE_OF_VALUE 1000
+#define MAX_EVIDENCE 20
+
+// Each power of two of nanoseconds is divided into 2^SUB_BUCKET_BITS buckets.
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define HISTOGRAM_SIZE ((64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS)
+
+// The device detection data folder from the sub module with lite device data.
+static const char* dataDir = "device-detection-data";
+
+static const char* dataFileName = "51Degrees-LiteV4.1.hash";
+
+static const char* evidenceFileName = "20000 Evidence Records.yml";
+
+/**
+ * Preset configurations to benchmark.
+ */
+static ConfigHash *benchmarkConfigs[] = {
+	&HashInMemoryConfig,
+	&HashHighPerformanceConfig,
+	&HashBalancedConfig,
+	&HashLowMemoryConfig
+};
+
+/**
+ * Phases of a detection which are timed.
+ */
+typedef enum benchmark_phase_e {
+	PHASE_PARSE,
+	PHASE_WALK,
+	PHASE_VALUES,
+	PHASE_TOTAL,
+	PHASE_COUNT
+} benchmarkPhase;
+
+static const char *phaseNames[PHASE_COUNT] = {
+	"parse",
+	"walk",
+	"values",
+	"total"
+};
+
+/**
+ * Log linear histogram of latencies in nanoseconds.
+ */
+typedef struct histogram_t {
+	uint64_t counts[HISTOGRAM_SIZE]; // Number of latencies in each bucket
+	uint64_t count; // Total number of latencies
+	uint64_t sum; // Sum of all the latencies
+	uint64_t max; // Largest latency
+} histogram;
+
+/**
+ * Key value pairs of an evidence record read from the YAML file.
+ */
+typedef struct evidence_record_t {
+	uint16_t count; // Number of pairs
+	char **keys; // Keys including the prefix, e.g. header.user-agent
+	char **values; // Values for the keys
+} evidenceRecord;
+
+/**
+ * Early declaration of the benchmark state.
+ */
+typedef struct benchmark_state_t benchmarkState;
+
+/**
+ * State specific to a single thread.
+ */
+typedef struct thread_state_t {
+	benchmarkState *main; // The main state containing the manager
+	uint32_t first; // Index of the first record processed by the thread
+	histogram *phases; // Histogram for each phase
+	unsigned long long checkSum; // Prevents the value fetches being removed
+} threadState;
+
+/**
+ * State containing everything needed for running and reporting the
+ * benchmarks.
+ */
+typedef struct benchmark_state_t {
+	evidenceRecord *records; // Evidence records read from the file
+	uint32_t recordsCount; // Number of records read
+	uint32_t recordsCapacity; // Number of records the memory can hold
+	uint16_t maxThreads; // Largest number of threads to run
+	int passes; // Number of timed passes for each thread count
+	const char *properties; // Required properties, or NULL for all
+	const char *dataFilePath; // Location of the data file
+	ResourceManager manager; // Manager containing the data set
+	threadState *threadStates; // State for each thread
+	FILE *output; // Human readable output, usually stdout
+	FILE *jsonOutput; // JSON results, or NULL
+	FILE *csvOutput; // CSV results, or NULL
+	bool firstJsonRun; // True if no run has been written to the JSON
+} benchmarkState;
+
+/**
+ * Returns a monotonic time in nanoseconds.
+ */
+static uint64_t getNanoseconds() {
+#ifdef _MSC_VER
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((double)counter.QuadPart * 1.0e9 /
+		(double)frequency.QuadPart);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+/**
+ * Returns the index of the bucket for the latency. Latencies below
+ * SUB_BUCKETS have their own bucket, larger ones share a bucket with those
+ * which have the same leading SUB_BUCKET_BITS + 1 bits.
+ */
+static uint32_t getBucket(uint64_t nanoseconds) {
+	uint32_t power = 0;
+	uint64_t value = nanoseconds;
+	if (nanoseconds < SUB_BUCKETS) {
+		return (uint32_t)nanoseconds;
+	}
+	while (value > 1) {
+		value >>= 1;
+		power++;
+	}
+	return ((power - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) +
+		(uint32_t)((nanoseconds >> (power - SUB_BUCKET_BITS)) &
+		(SUB_BUCKETS - 1));
+}
+
+/**
+ * Returns the largest latency which would be placed in the bucket.
+ */
+static uint64_t getBucketUpper(uint32_t bucket) {
+	uint32_t power;
+	if (bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+	power = (bucket >> SUB_BUCKET_BITS) - 1 + SUB_BUCKET_BITS;
+	return (((uint64_t)SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1)) + 1) <<
+		(power - SUB_BUCKET_BITS)) - 1;
+}
+
+static void histogramAdd(histogram *h, uint64_t nanoseconds) {
+	h->counts[getBucket(nanoseconds)]++;
+	h->count++;
+	h->sum += nanoseconds;
+	if (nanoseconds > h->max) {
+		h->max = nanoseconds;
+	}
+}
+
+static void histogramMerge(histogram *target, const histogram *source) {
+	uint32_t i;
+	for (i = 0; i < HISTOGRAM_SIZE; i++) {
+		target->counts[i] += source->counts[i];
+	}
+	target->count += source->count;
+	target->sum += source->sum;
+	if (source->max > target->max) {
+		target->max = source->max;
+	}
+}
+
+/**
+ * Returns the latency below which the fraction of latencies fall. The upper
+ * bound of the bucket is used, limited to the largest latency recorded.
+ */
+static uint64_t histogramPercentile(const histogram *h, double fraction) {
+	uint32_t i;
+	uint64_t cumulative = 0, upper;
+	uint64_t target = (uint64_t)(fraction * (double)h->count + 0.999999);
+	if (target == 0) {
+		target = 1;
+	}
+	for (i = 0; i < HISTOGRAM_SIZE; i++) {
+		cumulative += h->counts[i];
+		if (cumulative >= target) {
+			upper = getBucketUpper(i);
+			return upper < h->max ? upper : h->max;
+		}
+	}
+	return h->max;
+}
+
+static char* copyString(const char *source) {
+	size_t length = strlen(source) + 1;
+	char *copy = (char*)Malloc(length);
+	if (copy != NULL) {
+		memcpy(copy, source, length);
+	}
+	return copy;
+}
+
+/**
+ * Callback from the YAML iterator which copies the pairs into a new record.
+ */
+static void storeEvidence(KeyValuePair *pairs, uint16_t size, void *state) {
+	uint16_t i;
+	evidenceRecord *records;
+	evidenceRecord *record;
+	benchmarkState *benchmark = (benchmarkState*)state;
+
+	// Double the capacity of the records if full.
+	if (benchmark->recordsCount == benchmark->recordsCapacity) {
+		records = (evidenceRecord*)Malloc(
+			sizeof(evidenceRecord) * benchmark->recordsCapacity * 2);
+		if (records == NULL) {
+			return;
+		}
+		memcpy(
+			records,
+			benchmark->records,
+			sizeof(evidenceRecord) * benchmark->recordsCount);
+		Free(benchmark->records);
+		benchmark->records = records;
+		benchmark->recordsCapacity *= 2;
+	}
+
+	record = &benchmark->records[benchmark->recordsCount];
+	record->keys = (char**)Malloc(sizeof(char*) * size);
+	record->values = (char**)Malloc(sizeof(char*) * size);
+	record->count = 0;
+	if (record->keys == NULL || record->values == NULL) {
+		return;
+	}
+	for (i = 0; i < size; i++) {
+		record->keys[i] = copyString(pairs[i].key);
+		record->values[i] = copyString(pairs[i].value);
+		if (record->keys[i] != NULL && record->values[i] != NULL) {
+			record->count++;
+		}
+	}
+	benchmark->recordsCount++;
+}
+
+static void freeEvidence(benchmarkState *state) {
+	uint32_t i;
+	uint16_t j;
+	for (i = 0; i < state->recordsCount; i++) {
+		for (j = 0; j < state->records[i].count; j++) {
+			Free(state->records[i].keys[j]);
+			Free(state->records[i].values[j]);
+		}
+		Free(state->records[i].keys);
+		Free(state->records[i].values);
+	}
+	Free(state->records);
+}
+
+/**
+ * Processes every record once, starting from the thread's first record so
+ * that the threads are not working on the same record at the same time.
+ * @param state pointer to the thread state
+ */
+static void runBenchmarkThread(void *state) {
+	EXCEPTION_CREATE;
+	uint32_t i, p;
+	uint16_t k;
+	uint64_t start, parsed, walked, fetched;
+	String *value;
+	evidenceRecord *record;
+	EvidencePrefixMap *prefix;
+	EvidenceKeyValuePairArray *evidence;
+	threadState *thread = (threadState*)state;
+	benchmarkState *benchmark = thread->main;
+	ResultsHash *results = ResultsHashCreate(&benchmark->manager, 0);
+	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
+
+	for (i = 0; i < benchmark->recordsCount; i++) {
+		record = &benchmark->records[
+			(thread->first + i) % benchmark->recordsCount];
+
+		// Create the evidence from the key value pairs.
+		start = getNanoseconds();
+		evidence = EvidenceCreate(record->count);
+		for (k = 0; k < record->count; k++) {
+			prefix = EvidenceMapPrefix(record->keys[k]);
+			if (prefix != NULL) {
+				EvidenceAddString(
+					evidence,
+					prefix->prefixEnum,
+					record->keys[k] + prefix->prefixLength,
+					record->values[k]);
+			}
+		}
+		parsed = getNanoseconds();
+
+		// Evaluate the graph.
+		ResultsHashFromEvidence(results, evidence, exception);
+		EXCEPTION_THROW;
+		walked = getNanoseconds();
+
+		// Get the values for all the required properties.
+		for (p = 0; p < dataSet->b.b.available->count; p++) {
+			if (ResultsHashGetValues(
+				results,
+				(int)p,
+				exception) != NULL &&
+				EXCEPTION_OKAY &&
+				results->values.count > 0) {
+				value = (String*)results->values.items[0].data.ptr;
+				if (value != NULL) {
+					thread->checkSum += (unsigned long long)value->size;
+				}
+			}
+		}
+		fetched = getNanoseconds();
+		EvidenceFree(evidence);
+
+		histogramAdd(&thread->phases[PHASE_PARSE], parsed - start);
+		histogramAdd(&thread->phases[PHASE_WALK], walked - parsed);
+		histogramAdd(&thread->phases[PHASE_VALUES], fetched - walked);
+		histogramAdd(&thread->phases[PHASE_TOTAL], fetched - start);
+	}
+
+	ResultsHashFree(results);
+
+	if (ThreadingGetIsThreadSafe()) {
+		THREAD_EXIT;
+	}
+}
+
+/**
+ * Runs the threads once over all the records.
+ * @return elapsed milliseconds
+ */
+static double runThreads(benchmarkState *state, uint16_t threadsCount) {
+	uint16_t t;
+	FIFTYONE_DEGREES_THREAD *threads;
+	TIMER_CREATE;
+	TIMER_START;
+	if (ThreadingGetIsThreadSafe()) {
+		threads = (FIFTYONE_DEGREES_THREAD*)Malloc(
+			sizeof(FIFTYONE_DEGREES_THREAD) * threadsCount);
+		for (t = 0; t < threadsCount; t++) {
+			THREAD_CREATE(
+				threads[t],
+				(THREAD_ROUTINE)&runBenchmarkThread,
+				&state->threadStates[t]);
+		}
+		for (t = 0; t < threadsCount; t++) {
+			THREAD_JOIN(threads[t]);
+			THREAD_CLOSE(threads[t]);
+		}
+		Free(threads);
+	}
+	else {
+		runBenchmarkThread(&state->threadStates[0]);
+	}
+	TIMER_END;
+	return TIMER_ELAPSED;
+}
+
+static void resetThreadStates(benchmarkState *state, uint16_t threadsCount) {
+	uint16_t t;
+	for (t = 0; t < threadsCount; t++) {
+		state->threadStates[t].main = state;
+		state->threadStates[t].first = (uint32_t)(
+			((uint64_t)state->recordsCount * t) / threadsCount);
+		state->threadStates[t].checkSum = 0;
+		memset(
+			state->threadStates[t].phases,
+			0,
+			sizeof(histogram) * PHASE_COUNT);
+	}
+}
+
+/**
+ * Writes the results of a run with the number of threads to each output.
+ */
+static void report(
+	benchmarkState *state,
+	const char *configName,
+	double startUpMillis,
+	uint16_t threadsCount,
+	double elapsedMillis,
+	histogram *phases) {
+	int p;
+	uint16_t t;
+	unsigned long long checkSum = 0;
+	double detectionsPerSecond = elapsedMillis > 0 ?
+		(double)phases[PHASE_TOTAL].count * 1000.0 / elapsedMillis : 0;
+	for (t = 0; t < threadsCount; t++) {
+		checkSum += state->threadStates[t].checkSum;
+	}
+
+	fprintf(state->output,
+		"%s, threads: %d, detections per second: %.0f, checksum: %llu\n",
+		configName,
+		threadsCount,
+		detectionsPerSecond,
+		checkSum);
+	for (p = 0; p < PHASE_COUNT; p++) {
+		fprintf(state->output,
+			"  %-7s mean: %9.0f ns, p50: %9llu ns, p99: %9llu ns, "
+			"p99.9: %9llu ns, max: %9llu ns\n",
+			phaseNames[p],
+			phases[p].count > 0 ?
+				(double)phases[p].sum / (double)phases[p].count : 0,
+			(unsigned long long)histogramPercentile(&phases[p], 0.5),
+			(unsigned long long)histogramPercentile(&phases[p], 0.99),
+			(unsigned long long)histogramPercentile(&phases[p], 0.999),
+			(unsigned long long)phases[p].max);
+	}
+
+	if (state->csvOutput != NULL) {
+		for (p = 0; p < PHASE_COUNT; p++) {
+			fprintf(state->csvOutput,
+				"%s,%d,%s,%llu,%.0f,%llu,%llu,%llu,%llu,%.0f,%.0f\n",
+				configName,
+				threadsCount,
+				phaseNames[p],
+				(unsigned long long)phases[p].count,
+				phases[p].count > 0 ?
+					(double)phases[p].sum / (double)phases[p].count : 0,
+				(unsigned long long)histogramPercentile(&phases[p], 0.5),
+				(unsigned long long)histogramPercentile(&phases[p], 0.99),
+				(unsigned long long)histogramPercentile(&phases[p], 0.999),
+				(unsigned long long)phases[p].max,
+				detectionsPerSecond,
+				startUpMillis);
+		}
+	}
+
+	if (state->jsonOutput != NULL) {
+		fprintf(state->jsonOutput,
+			"%s\n    {\"Config\": \"%s\", \"Threads\": %d, "
+			"\"StartupMs\": %.0f, \"ElapsedMs\": %.0f, "
+			"\"DetectionsPerSecond\": %.0f, \"Phases\": {",
+			state->firstJsonRun ? "" : ",",
+			configName,
+			threadsCount,
+			startUpMillis,
+			elapsedMillis,
+			detectionsPerSecond);
+		for (p = 0; p < PHASE_COUNT; p++) {
+			fprintf(state->jsonOutput,
+				"%s\n      \"%s\": {\"Count\": %llu, \"MeanNs\": %.0f, "
+				"\"P50Ns\": %llu, \"P99Ns\": %llu, \"P999Ns\": %llu, "
+				"\"MaxNs\": %llu}",
+				p > 0 ? "," : "",
+				phaseNames[p],
+				(unsigned long long)phases[p].count,
+				phases[p].count > 0 ?
+					(double)phases[p].sum / (double)phases[p].count : 0,
+				(unsigned long long)histogramPercentile(&phases[p], 0.5),
+				(unsigned long long)histogramPercentile(&phases[p], 0.99),
+				(unsigned long long)histogramPercentile(&phases[p], 0.999),
+				(unsigned long long)phases[p].max);
+		}
+		fprintf(state->jsonOutput, "}}");
+		state->firstJsonRun = false;
+	}
+}
+
+/**
+ * Loads the data set with the configuration and runs the records with each
+ * number of threads. The configuration is modified to remove processing which
+ * is not part of core device detection.
+ */
+static void benchmarkConfig(
+	benchmarkState *state,
+	const char *configName,
+	ConfigHash *config) {
+	EXCEPTION_CREATE;
+	int pass, p;
+	uint16_t t, threadsCount;
+	double elapsedMillis, startUpMillis;
+	histogram *phases;
+	PropertiesRequired properties = PropertiesDefault;
+	if (state->properties != NULL) {
+		properties.string = state->properties;
+	}
+
+	// Remove processing which is not part of core device detection.
+	config->b.updateMatchedUserAgent = false;
+	config->b.processSpecialEvidence = false;
+	config->strings.concurrency = state->maxThreads;
+	config->properties.concurrency = state->maxThreads;
+	config->values.concurrency = state->maxThreads;
+	config->profiles.concurrency = state->maxThreads;
+	config->nodes.concurrency = state->maxThreads;
+	config->profileOffsets.concurrency = state->maxThreads;
+	config->maps.concurrency = state->maxThreads;
+	config->components.concurrency = state->maxThreads;
+
+	fprintf(state->output, "Benchmarking %s\n", configName);
+	TIMER_CREATE;
+	TIMER_START;
+	StatusCode status = HashInitManagerFromFile(
+		&state->manager,
+		config,
+		&properties,
+		state->dataFilePath,
+		exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		const char *message = StatusGetMessage(status, state->dataFilePath);
+		fprintf(state->output, "%s\n", message);
+		Free((void*)message);
+		return;
+	}
+	TIMER_END;
+	startUpMillis = TIMER_ELAPSED;
+
+	phases = (histogram*)Malloc(sizeof(histogram) * PHASE_COUNT);
+	if (phases == NULL) {
+		ResourceManagerFree(&state->manager);
+		return;
+	}
+
+	threadsCount = 1;
+	while (threadsCount <= state->maxThreads) {
+
+		// Warm up any caches before the timed passes.
+		resetThreadStates(state, threadsCount);
+		runThreads(state, threadsCount);
+
+		memset(phases, 0, sizeof(histogram) * PHASE_COUNT);
+		elapsedMillis = 0;
+		for (pass = 0; pass < state->passes; pass++) {
+			resetThreadStates(state, threadsCount);
+			elapsedMillis += runThreads(state, threadsCount);
+			for (t = 0; t < threadsCount; t++) {
+				for (p = 0; p < PHASE_COUNT; p++) {
+					histogramMerge(
+						&phases[p],
+						&state->threadStates[t].phases[p]);
+				}
+			}
+		}
+		report(
+			state,
+			configName,
+			startUpMillis,
+			threadsCount,
+			elapsedMillis,
+			phases);
+
+		// Double the threads, finishing with the maximum.
+		if (threadsCount == state->maxThreads) {
+			break;
+		}
+		threadsCount = threadsCount * 2 < state->maxThreads ?
+			threadsCount * 2 : state->maxThreads;
+	}
+
+	Free(phases);
+	ResourceManagerFree(&state->manager);
+}
+
+/**
+ * Runs the benchmarks for each preset configuration.
+ * @param dataFilePath path to the 51Degrees device data file
+ * @param evidenceFilePath path to a YAML file of evidence records
+ * @param maxThreads largest number of concurrent threads
+ * @param records number of evidence records to read
+ * @param passes number of timed passes for each number of threads
+ * @param properties required properties, or NULL for all properties
+ * @param nodeSearch true if the search of ordered list nodes in the flat
+ * graph should be compared with and without the optimised node search
+ * @param output file pointer to print output to
+ * @param jsonOutput file pointer to write JSON results to, or NULL
+ * @param csvOutput file pointer to write CSV results to, or NULL
+ */
+void fiftyoneDegreesHashBenchmarks(
+	const char *dataFilePath,
+	const char *evidenceFilePath,
+	uint16_t maxThreads,
+	int records,
+	int passes,
+	const char *properties,
+	bool nodeSearch,
+	FILE *output,
+	FILE *jsonOutput,
+	FILE *csvOutput) {
+	int i;
+	uint16_t t;
+	benchmarkState state;
+	ConfigHash config;
+	char buffer[MAX_EVIDENCE * (SIZE_OF_KEY + SIZE_OF_VALUE)];
+	KeyValuePair pair[MAX_EVIDENCE];
+	char key[MAX_EVIDENCE][SIZE_OF_KEY];
+	char value[MAX_EVIDENCE][SIZE_OF_VALUE];
+
+	state.dataFilePath = dataFilePath;
+	state.maxThreads = ThreadingGetIsThreadSafe() && maxThreads > 0 ?
+		maxThreads : 1;
+	state.passes = passes > 0 ? passes : 1;
+	state.properties = properties;
+	state.output = output;
+	state.jsonOutput = jsonOutput;
+	state.csvOutput = csvOutput;
+	state.firstJsonRun = true;
+	state.recordsCount = 0;
+	state.recordsCapacity = 1024;
+	state.records = (evidenceRecord*)Malloc(
+		sizeof(evidenceRecord) * state.recordsCapacity);
+	state.threadStates = (threadState*)Malloc(
+		sizeof(threadState) * state.maxThreads);
+	if (state.records == NULL || state.threadStates == NULL) {
+		fprintf(output, "Insufficient memory for the benchmark state\n");
+		if (state.records != NULL) {
+			Free(state.records);
+		}
+		if (state.threadStates != NULL) {
+			Free(state.threadStates);
+		}
+		return;
+	}
+
+	// Limit the threads to those which histograms could be allocated for.
+	for (t = 0; t < state.maxThreads; t++) {
+		state.threadStates[t].phases = (histogram*)Malloc(
+			sizeof(histogram) * PHASE_COUNT);
+		if (state.threadStates[t].phases == NULL) {
+			state.maxThreads = t > 0 ? t : 1;
+			break;
+		}
+	}
+	if (state.threadStates[0].phases == NULL) {
+		fprintf(output, "Insufficient memory for the histograms\n");
+		Free(state.threadStates);
+		Free(state.records);
+		return;
+	}
+
+	// Read the evidence records into memory so that reading the file is not
+	// part of the benchmark.
+	for (i = 0; i < MAX_EVIDENCE; i++) {
+		pair[i].key = key[i];
+		pair[i].keyLength = SIZE_OF_KEY;
+		pair[i].value = value[i];
+		pair[i].valueLength = SIZE_OF_VALUE;
+	}
+	YamlFileIterateWithLimit(
+		evidenceFilePath,
+		buffer,
+		sizeof(buffer),
+		pair,
+		MAX_EVIDENCE,
+		records,
+		&state,
+		storeEvidence);
+	fprintf(
+		output,
+		"Read '%u' evidence records into memory, %s build\n",
+		state.recordsCount,
+		CollectionGetIsMemoryOnly() ? "memory only" : "standard");
+
+	if (csvOutput != NULL) {
+		fprintf(csvOutput,
+			"Config,Threads,Phase,Count,MeanNs,P50Ns,P99Ns,P999Ns,MaxNs,"
+			"DetectionsPerSecond,StartupMs\n");
+	}
+	if (jsonOutput != NULL) {
+		fprintf(jsonOutput,
+			"{\n  \"Records\": %u,\n  \"MaxThreads\": %d,\n"
+			"  \"MemoryOnly\": %s,\n  \"Runs\": [",
+			state.recordsCount,
+			state.maxThreads,
+			CollectionGetIsMemoryOnly() ? "true" : "false");
+	}
+
+	for (i = 0;
+		i < (int)(sizeof(benchmarkConfigs) / sizeof(benchmarkConfigs[0]));
+		i++) {
+		if (CollectionGetIsMemoryOnly() == false ||
+			benchmarkConfigs[i]->b.b.allInMemory == true) {
+			config = *benchmarkConfigs[i];
+			benchmarkConfig(
+				&state,
+				fiftyoneDegreesExampleGetConfigName(config),
+				&config);
+		}
+	}
+
+	// Compare the binary search of the records of ordered list nodes with the
+	// search of the hash codes laid out by the flat graph.
+	if (nodeSearch) {
+		config = HashInMemoryConfig;
+		config.flatGraph = true;
+		benchmarkConfig(&state, "InMemoryFlatGraph", &config);
+		config = HashInMemoryConfig;
+		config.flatGraph = true;
+		config.optimiseNodeSearch = true;
+		benchmarkConfig(&state, "InMemoryNodeSearch", &config);
+	}
+
+	if (jsonOutput != NULL) {
+		fprintf(jsonOutput, "\n  ]\n}\n");
+	}
+
+	for (t = 0; t < state.maxThreads; t++) {
+		if (state.threadStates[t].phases != NULL) {
+			Free(state.threadStates[t].phases);
+		}
+	}
+	Free(state.threadStates);
+	freeEvidence(&state);
+}
+
+#define DATA_OPTION "--data-file"
+#define DATA_OPTION_SHORT "-d"
+#define EVIDENCE_OPTION "--evidence-file"
+#define EVIDENCE_OPTION_SHORT "-e"
+#define THREAD_OPTION "--max-threads"
+#define THREAD_OPTION_SHORT "-t"
+#define RECORDS_OPTION "--records"
+#define RECORDS_OPTION_SHORT "-r"
+#define PASSES_OPTION "--passes"
+#define PASSES_OPTION_SHORT "-p"
+#define PROPERTIES_OPTION "--properties"
+#define PROPERTIES_OPTION_SHORT "-P"
+#define JSON_OPTION "--json-output"
+#define JSON_OPTION_SHORT "-j"
+#define CSV_OPTION "--csv-output"
+#define CSV_OPTION_SHORT "-c"
+#define NODE_SEARCH_OPTION "--node-search"
+#define NODE_SEARCH_OPTION_SHORT "-n"
+#define HELP_OPTION "--help"
+#define HELP_OPTION_SHORT "-h"
+#define OPTION_PADDING(o) ((int)(30 - strlen(o)))
+#define OPTION_MESSAGE(m, o, s) printf("  %s, %s%*s: %s\n", o, s, OPTION_PADDING(o), " ", m);
+
+/**
+ * Print the available options to the output.
+ */
+static void printHelp() {
+	printf("Available options are:\n");
+	OPTION_MESSAGE("Path to a 51Degrees Hash data file", DATA_OPTION, DATA_OPTION_SHORT);
+	OPTION_MESSAGE("Path to an evidence YAML file", EVIDENCE_OPTION, EVIDENCE_OPTION_SHORT);
+	OPTION_MESSAGE("Largest number of threads to run in parallel", THREAD_OPTION, THREAD_OPTION_SHORT);
+	OPTION_MESSAGE("Number of evidence records to read", RECORDS_OPTION, RECORDS_OPTION_SHORT);
+	OPTION_MESSAGE("Number of timed passes for each thread count", PASSES_OPTION, PASSES_OPTION_SHORT);
+	OPTION_MESSAGE("Comma separated required properties", PROPERTIES_OPTION, PROPERTIES_OPTION_SHORT);
+	OPTION_MESSAGE("Path to a file to output JSON format results to", JSON_OPTION, JSON_OPTION_SHORT);
+	OPTION_MESSAGE("Path to a file to output CSV format results to", CSV_OPTION, CSV_OPTION_SHORT);
+	OPTION_MESSAGE("Compare ordered list node searches (true/false)", NODE_SEARCH_OPTION, NODE_SEARCH_OPTION_SHORT);
+	OPTION_MESSAGE("Print this help", HELP_OPTION, HELP_OPTION_SHORT);
+}
+
+static bool isOption(const char *arg, const char *option, const char *shortOption) {
+	return strcmp(arg, option) == 0 || strcmp(arg, shortOption) == 0;
+}
+
+int main(int argc, char* argv[]) {
+	StatusCode status = SUCCESS;
+	char dataFilePath[FILE_MAX_PATH];
+	char evidenceFilePath[FILE_MAX_PATH];
+	uint16_t maxThreads = DEFAULT_MAX_THREADS;
+	int records = DEFAULT_RECORDS;
+	int passes = DEFAULT_PASSES;
+	const char *properties = NULL;
+	bool nodeSearch = false;
+	const char *jsonFile = NULL;
+	const char *csvFile = NULL;
+	FILE *jsonOutput = NULL;
+	FILE *csvOutput = NULL;
+	dataFilePath[0] = '\0';
+	evidenceFilePath[0] = '\0';
+
+	for (int i = 1; i < argc; i++) {
+		if (isOption(argv[i], HELP_OPTION, HELP_OPTION_SHORT)) {
+			printHelp();
+			return 0;
+		}
+		if (argv[i][0] != '-' || i + 1 >= argc) {
+			printf(
+				"The option '%s' is not recognized. Use %s (%s) to list options.\n",
+				argv[i],
+				HELP_OPTION,
+				HELP_OPTION_SHORT);
+			return 1;
+		}
+		if (isOption(argv[i], DATA_OPTION, DATA_OPTION_SHORT)) {
+			strncpy(dataFilePath, argv[i + 1], sizeof(dataFilePath) - 1);
+			dataFilePath[sizeof(dataFilePath) - 1] = '\0';
+		}
+		else if (isOption(argv[i], EVIDENCE_OPTION, EVIDENCE_OPTION_SHORT)) {
+			strncpy(evidenceFilePath, argv[i + 1], sizeof(evidenceFilePath) - 1);
+			evidenceFilePath[sizeof(evidenceFilePath) - 1] = '\0';
+		}
+		else if (isOption(argv[i], THREAD_OPTION, THREAD_OPTION_SHORT)) {
+			maxThreads = (uint16_t)atoi(argv[i + 1]);
+		}
+		else if (isOption(argv[i], RECORDS_OPTION, RECORDS_OPTION_SHORT)) {
+			records = atoi(argv[i + 1]);
+		}
+		else if (isOption(argv[i], PASSES_OPTION, PASSES_OPTION_SHORT)) {
+			passes = atoi(argv[i + 1]);
+		}
+		else if (isOption(argv[i], PROPERTIES_OPTION, PROPERTIES_OPTION_SHORT)) {
+			properties = argv[i + 1];
+		}
+		else if (isOption(argv[i], JSON_OPTION, JSON_OPTION_SHORT)) {
+			jsonFile = argv[i + 1];
+		}
+		else if (isOption(argv[i], CSV_OPTION, CSV_OPTION_SHORT)) {
+			csvFile = argv[i + 1];
+		}
+		else if (isOption(argv[i], NODE_SEARCH_OPTION, NODE_SEARCH_OPTION_SHORT)) {
+			nodeSearch = strcmp(argv[i + 1], "true") == 0;
+		}
+		else {
+			printf(
+				"The option '%s' is not recognized. Use %s (%s) to list options.\n",
+				argv[i],
+				HELP_OPTION,
+				HELP_OPTION_SHORT);
+			return 1;
+		}
+		i++;
+	}
+
+	if (strlen(dataFilePath) == 0) {
+		status = FileGetPath(
+			dataDir,
+			dataFileName,
+			dataFilePath,
+			sizeof(dataFilePath));
+		if (status != SUCCESS) {
+			printf("Failed to find a device detection data file. Make sure "
+				"the device-detection-data submodule has been updated by "
+				"running `git submodule update --recursive`\n");
+			return 1;
+		}
+	}
+	if (strlen(evidenceFilePath) == 0) {
+		status = FileGetPath(
+			dataDir,
+			evidenceFileName,
+			evidenceFilePath,
+			sizeof(evidenceFilePath));
+		if (status != SUCCESS) {
+			printf("Failed to find a device detection evidence file. Make "
+				"sure the device-detection-data submodule has been updated "
+				"by running `git submodule update --recursive`\n");
+			return 1;
+		}
+	}
+
+	if (jsonFile != NULL) {
+		jsonOutput = fopen(jsonFile, "w");
+	}
+	if (csvFile != NULL) {
+		csvOutput = fopen(csvFile, "w");
+	}
+
+	fiftyoneDegreesHashBenchmarks(
+		dataFilePath,
+		evidenceFilePath,
+		maxThreads,
+		records,
+		passes,
+		properties,
+		nodeSearch,
+		stdout,
+		jsonOutput,
+		csvOutput);
+
+	if (jsonOutput != NULL) {
+		fclose(jsonOutput);
+	}
+	if (csvOutput != NULL) {
+		fclose(csvOutput);
+	}
+	return 0;
+}
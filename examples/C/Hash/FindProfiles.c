@@ -60,7 +60,23 @@ fiftyoneDegreesHashIterateProfilesForPropertyAndValue(
 	exception);
 ```
 
-4. Finally release the memory used by the data set resource.
+4. Iterate over all the profiles in the data set which match every one of a
+set of property value pairs. Each profile relates to a single component, so
+if the properties belong to different components then the matching profiles
+of each component are found, and none are found unless every component has a
+match.
+```
+fiftyoneDegreesHashIterateProfilesForPropertiesAndValues(
+	manager,
+	propertyNames,
+	valueNames,
+	2,
+	&mobileSmartPhone,
+	count,
+	exception);
+```
+
+5. Finally release the memory used by the data set resource.
 ```
 fiftyoneDegreesResourceManagerFree(&manager);
 ```
@@ -101,6 +117,9 @@ void run(ResourceManager* manager) {
 	EXCEPTION_CREATE;
 	uint32_t isMobileTrue = 0;
 	uint32_t isMobileFalse = 0;
+	uint32_t mobileSmartPhone = 0;
+	const char *propertyNames[] = { "IsMobile", "DeviceType" };
+	const char *valueNames[] = { "True", "SmartPhone" };
 	
 	printf("Starting Find Profiles Example.\n\n");
 	
@@ -122,6 +141,17 @@ void run(ResourceManager* manager) {
 		exception);
 	printf("There are '%d' non-mobile profiles in the data set.\n", 
 		isMobileFalse);
+
+	HashIterateProfilesForPropertiesAndValues(
+		manager,
+		propertyNames,
+		valueNames,
+		2,
+		&mobileSmartPhone,
+		count,
+		exception);
+	printf("There are '%d' mobile smart phone profiles in the data set.\n",
+		mobileSmartPhone);
 }
 
 /**
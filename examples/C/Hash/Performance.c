@@ -91,6 +91,8 @@ typedef struct performanceConfig_t {
 	ConfigHash *config;
 	// True if all properties should be initialized and fetched
 	bool allProperties;
+	// True if the nodes should be placed breadth first from the root nodes
+	bool optimiseNodeLayout;
 } performanceConfig;
 
 /**
@@ -105,14 +107,20 @@ typedef struct performanceConfig_t {
  * Balanced - popular data is loaded into memory, other cached and loaded from 
  *   data file. Quite slow, but okay for web sites.
  * LowMemory - all data loaded from data file when needed. Slow.
+ *
+ * Each configuration can also be run with the optimised node layout, where
+ * the nodes are placed breadth first from the root nodes, to compare with
+ * the layout of the data file.
  */
 performanceConfig performanceConfigs[] = {
-	{ &HashInMemoryConfig, false },
-	{ &HashInMemoryConfig, true },
-	//{ &HashBalancedConfig, false },
-	//{ &HashBalancedConfig, true },
-	//{ &HashLowMemoryConfig, false },
-	//{ &HashLowMemoryConfig, true }
+	{ &HashInMemoryConfig, false, false },
+	{ &HashInMemoryConfig, true, false },
+	{ &HashInMemoryConfig, false, true },
+	{ &HashInMemoryConfig, true, true },
+	//{ &HashBalancedConfig, false, false },
+	//{ &HashBalancedConfig, true, false },
+	//{ &HashLowMemoryConfig, false, false },
+	//{ &HashLowMemoryConfig, true, false }
 };
 
 /**
@@ -571,9 +579,11 @@ void executeBenchmark(
 
 	// Output the name of the stock configuration before changing parameters.
 	fprintf(state->output, 
-		"Benchmarking with profile: %s AllProperties: %s\n",
+		"Benchmarking with profile: %s AllProperties: %s "
+		"OptimisedNodeLayout: %s\n",
 		fiftyoneDegreesExampleGetConfigName(dataSetConfig),
-		config.allProperties ? "True" : "False");
+		config.allProperties ? "True" : "False",
+		config.optimiseNodeLayout ? "True" : "False");
 
 	// Ensure that for performance tests the updating of the matched user-agent
 	// is disabled to reduce processing overhead.
@@ -590,6 +600,9 @@ void executeBenchmark(
 	dataSetConfig.usePerformanceGraph = false;
 	dataSetConfig.usePredictiveGraph = true;
 
+	// Place the nodes breadth first from the root nodes if required.
+	dataSetConfig.optimiseNodeLayout = config.optimiseNodeLayout;
+
 	dataSetConfig.strings.concurrency = state->numberOfThreads;
 	dataSetConfig.properties.concurrency = state->numberOfThreads;
 	dataSetConfig.values.concurrency = state->numberOfThreads;
@@ -817,10 +830,11 @@ void fiftyoneDegreesHashPerformance(
 			config.config->b.b.allInMemory == true) {
 			
 			if (state.resultsOutput != NULL) {
-				fprintf(state.resultsOutput, "%s\n\"%s%s\": {\n",
+				fprintf(state.resultsOutput, "%s\n\"%s%s%s\": {\n",
 					i > 0 ? "," : "",
 					fiftyoneDegreesExampleGetConfigName(*(config.config)),
-					config.allProperties ? "_All" : "");
+					config.allProperties ? "_All" : "",
+					config.optimiseNodeLayout ? "_OptimisedLayout" : "");
 			}
 
 			executeBenchmark(&state, config);
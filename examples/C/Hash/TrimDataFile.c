@@ -0,0 +1,127 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#include <stdio.h>
+#include <string.h>
+#include "../../../src/hash/hash.h"
+#include "../../../src/hash/fiftyone.h"
+
+static const char *dataDir = "device-detection-data";
+
+static const char *dataFileName = "51Degrees-LiteV4.1.hash";
+
+/**
+ * Reports the status of the data file initialization.
+ * @param status code to be displayed
+ * @param fileName to be used in any messages
+ */
+static void reportStatus(
+	fiftyoneDegreesStatusCode status,
+	const char* fileName) {
+	const char *message = StatusGetMessage(status, fileName);
+	printf("%s\n", message);
+	Free((void*)message);
+}
+
+/**
+ * Gets the size of the file in bytes, or -1 if it can't be opened.
+ */
+static long getFileSize(const char *fileName) {
+	FILE *file;
+	long size = -1;
+	if (FileOpen(fileName, &file) == SUCCESS) {
+		if (fseek(file, 0, SEEK_END) == 0) {
+			size = ftell(file);
+		}
+		fclose(file);
+	}
+	return size;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesTrimDataFileRun(
+	const char *dataFilePath,
+	const char *trimmedFilePath,
+	const char *requiredProperties,
+	fiftyoneDegreesConfigHash *config) {
+	EXCEPTION_CREATE;
+	PropertiesRequired properties = PropertiesDefault;
+	properties.string = requiredProperties;
+	StatusCode status = HashTrimNodes(
+		config,
+		&properties,
+		dataFilePath,
+		trimmedFilePath,
+		exception);
+	if (status != SUCCESS) {
+		reportStatus(status, dataFilePath);
+	}
+	else {
+		printf("Trimmed '%s' from %ld bytes to %ld bytes for '%s'.\n",
+			trimmedFilePath,
+			getFileSize(dataFilePath),
+			getFileSize(trimmedFilePath),
+			requiredProperties);
+	}
+	return status;
+}
+
+#ifndef TEST
+
+/**
+ * Only included if the example is being used from the console. Not included
+ * when part of a test framework where the main method is not required.
+ * @arg1 data file path
+ * @arg2 trimmed data file path
+ * @arg3 required properties
+ */
+
+int main(int argc, char* argv[]) {
+	char dataFilePath[FILE_MAX_PATH];
+	StatusCode status = SUCCESS;
+	ConfigHash config = fiftyoneDegreesHashDefaultConfig;
+	if (argc > 1) {
+		strcpy(dataFilePath, argv[1]);
+	}
+	else {
+		status = FileGetPath(
+			dataDir,
+			dataFileName,
+			dataFilePath,
+			sizeof(dataFilePath));
+	}
+	if (status != SUCCESS) {
+		reportStatus(status, dataFileName);
+		return 1;
+	}
+
+	// Write the trimmed data file with the graphs used by the default
+	// configuration.
+	status = fiftyoneDegreesTrimDataFileRun(
+		dataFilePath,
+		argc > 2 ? argv[2] : "51Degrees-Trimmed.hash",
+		argc > 3 ? argv[3] : "IsMobile,DeviceType,PriceBand",
+		&config);
+
+	return status == SUCCESS ? 0 : 1;
+}
+
+#endif
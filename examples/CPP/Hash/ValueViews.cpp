@@ -0,0 +1,467 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+// Include ExmapleBase.h before others as it includes Windows 'crtdbg.h'
+// which requires to be included before 'malloc.h'.
+#include "../../C/Hash/ExampleBase.h"
+#include "ExampleBase.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+#include <vector>
+
+using namespace FiftyoneDegrees::Examples::Hash;
+
+/**
+@example Hash/ValueViews.cpp
+Micro benchmark comparing the cost of fetching values as copied strings with
+fetching views of the strings held by the data set.
+
+The example shows how to:
+
+1. Process a User-Agent and get the values for a property as copied strings.
+```
+Common::Value<vector<string>> values = results->getValues(
+	requiredPropertyIndex);
+```
+
+2. Get views of the same values without copying them. The vector of views
+can be reused for each property and request, so no memory is allocated once
+it has sufficient capacity.
+```
+vector<string_view> views;
+results->getValueView(requiredPropertyIndex, views);
+```
+
+3. Create the data set with a value table so that the views are returned
+without accessing the values and strings collections.
+```
+config->setValueTable(true);
+```
+
+The number of heap allocations made while fetching the values is counted by
+replacing every form of the global new and delete operators, including the
+array, aligned and nothrow forms, and is reported per request along with the
+time spent fetching the values. The operators are only replaced when the
+example is built on its own. When it is included by its tests, TEST is defined
+and the allocator of the test process is left unchanged.
+*/
+
+#ifndef TEST
+
+/**
+ * Number of allocations made through the global new operators while counting
+ * is enabled.
+ */
+static std::atomic<long> allocations(0);
+
+/**
+ * True if allocations should be counted.
+ */
+static std::atomic<bool> counting(false);
+
+/**
+ * Allocates the memory for every form of the global new operator, counting
+ * the allocation if counting is enabled. Returns nullptr if the memory could
+ * not be allocated.
+ */
+static void* allocate(size_t size, size_t alignment) {
+	void *ptr;
+	if (counting) {
+		allocations++;
+	}
+	if (size == 0) {
+		size = 1;
+	}
+	if (alignment <= alignof(std::max_align_t)) {
+		return malloc(size);
+	}
+#ifdef _MSC_VER
+	ptr = _aligned_malloc(size, alignment);
+#else
+	if (posix_memalign(&ptr, alignment, size) != 0) {
+		ptr = nullptr;
+	}
+#endif
+	return ptr;
+}
+
+/**
+ * Frees memory allocated by allocate with the same alignment.
+ */
+static void release(void *ptr, size_t alignment) {
+#ifdef _MSC_VER
+	if (alignment > alignof(std::max_align_t)) {
+		_aligned_free(ptr);
+		return;
+	}
+#else
+	(void)alignment;
+#endif
+	free(ptr);
+}
+
+static void* allocateOrThrow(size_t size, size_t alignment) {
+	void *ptr = allocate(size, alignment);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new(size_t size) {
+	return allocateOrThrow(size, 0);
+}
+
+void* operator new[](size_t size) {
+	return allocateOrThrow(size, 0);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return allocate(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return allocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	return allocateOrThrow(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return allocateOrThrow(size, (size_t)alignment);
+}
+
+void* operator new(
+	size_t size,
+	std::align_val_t alignment,
+	const std::nothrow_t&) noexcept {
+	return allocate(size, (size_t)alignment);
+}
+
+void* operator new[](
+	size_t size,
+	std::align_val_t alignment,
+	const std::nothrow_t&) noexcept {
+	return allocate(size, (size_t)alignment);
+}
+
+void operator delete(void *ptr) noexcept {
+	release(ptr, 0);
+}
+
+void operator delete[](void *ptr) noexcept {
+	release(ptr, 0);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+	release(ptr, 0);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+	release(ptr, 0);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept {
+	release(ptr, 0);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept {
+	release(ptr, 0);
+}
+
+void operator delete(void *ptr, std::align_val_t alignment) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+void operator delete[](void *ptr, std::align_val_t alignment) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+void operator delete(
+	void *ptr,
+	size_t,
+	std::align_val_t alignment) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+void operator delete[](
+	void *ptr,
+	size_t,
+	std::align_val_t alignment) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+void operator delete(
+	void *ptr,
+	std::align_val_t alignment,
+	const std::nothrow_t&) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+void operator delete[](
+	void *ptr,
+	std::align_val_t alignment,
+	const std::nothrow_t&) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+#endif
+
+namespace FiftyoneDegrees {
+	namespace Examples {
+		namespace Hash {
+			/**
+			 * Value Views Hash Example.
+			 */
+			class ValueViews : public ExampleBase {
+			public:
+				/**
+				 * @copydoc ExampleBase::ExampleBase(string, DeviceDetection::Hash::ConfigHash*)
+				 * @param userAgentFilePath path to the CSV file containing the
+				 * User-Agents to process
+				 */
+				ValueViews(
+					string dataFilePath,
+					string userAgentFilePath,
+					DeviceDetection::Hash::ConfigHash *config)
+					: ExampleBase(dataFilePath, config) {
+					this->userAgentFilePath = userAgentFilePath;
+					this->viewsMatch = false;
+				};
+
+				/**
+				 * @copydoc ExampleBase::run
+				 */
+				void run() {
+					int p;
+					size_t i;
+					long copiedAllocations = 0, viewAllocations = 0;
+					unsigned long copiedHash = 0, viewHash = 0;
+					std::chrono::steady_clock::duration copiedTime(0);
+					std::chrono::steady_clock::duration viewTime(0);
+					std::chrono::steady_clock::time_point start;
+					vector<std::string_view> views;
+					vector<string> userAgents;
+					char userAgent[500] = "";
+
+					// Read the User-Agents before timing so that only the
+					// value fetches are measured.
+					fiftyoneDegreesTextFileIterate(
+						userAgentFilePath.c_str(),
+						userAgent,
+						sizeof(userAgent),
+						&userAgents,
+						addUserAgent);
+
+					for (i = 0; i < userAgents.size(); i++) {
+						DeviceDetection::Hash::ResultsHash *results =
+							engine->process(userAgents[i].c_str());
+						int count = results->getAvailableProperties();
+
+						// Get the values copied into strings.
+						start = std::chrono::steady_clock::now();
+						startCounting();
+						for (p = 0; p < count; p++) {
+							Common::Value<vector<string>> values =
+								results->getValues(p);
+							if (values.hasValue()) {
+								for (const string &value : *values) {
+									copiedHash ^= hashView(value);
+								}
+							}
+						}
+						copiedAllocations += stopCounting();
+						copiedTime += std::chrono::steady_clock::now() - start;
+
+						// Get views of the values.
+						start = std::chrono::steady_clock::now();
+						startCounting();
+						for (p = 0; p < count; p++) {
+							if (results->getValueView(p, views)) {
+								for (std::string_view value : views) {
+									viewHash ^= hashView(value);
+								}
+							}
+						}
+						viewAllocations += stopCounting();
+						viewTime += std::chrono::steady_clock::now() - start;
+
+						delete results;
+					}
+
+					printf("Value table: %s\r\n",
+						config->getValueTable() ? "true" : "false");
+					report("getValues", copiedAllocations, copiedTime,
+						copiedHash, userAgents.size());
+					report("getValueView", viewAllocations, viewTime,
+						viewHash, userAgents.size());
+					viewsMatch = copiedHash == viewHash;
+				}
+
+				/**
+				 * Returns true if the views of the values returned by the last
+				 * run had the same hash code as the copied values.
+				 * @return true if the views matched the values
+				 */
+				bool getViewsMatch() {
+					return viewsMatch;
+				}
+
+			private:
+				static void addUserAgent(const char *userAgent, void *state) {
+					((vector<string>*)state)->push_back(userAgent);
+				}
+
+				static unsigned long hashView(std::string_view value) {
+					unsigned long hashCode = 5381;
+					for (char c : value) {
+						hashCode = ((hashCode << 5) + hashCode) +
+							(unsigned char)c;
+					}
+					return hashCode;
+				}
+
+				static void startCounting() {
+#ifndef TEST
+					allocations = 0;
+					counting = true;
+#endif
+				}
+
+				static long stopCounting() {
+#ifndef TEST
+					counting = false;
+					return allocations;
+#else
+					return 0;
+#endif
+				}
+
+				static void report(
+					const char *method,
+					long allocationsCount,
+					std::chrono::steady_clock::duration time,
+					unsigned long hashCode,
+					size_t requests) {
+					double perRequest = requests > 0 ?
+						(double)allocationsCount / (double)requests : 0;
+					double nanoseconds = requests > 0 ?
+						(double)std::chrono::duration_cast<
+							std::chrono::nanoseconds>(time).count() /
+						(double)requests : 0;
+					printf("%-13s allocations per request: %8.2f, "
+						"ns per request: %10.2f, hash code: %lu\r\n",
+						method,
+						perRequest,
+						nanoseconds,
+						hashCode);
+				}
+
+				string userAgentFilePath;
+				bool viewsMatch;
+			};
+		}
+	}
+}
+
+/**
+ * Implementation of function fiftyoneDegreesExampleRunPtr.
+ * Need to wrapped with 'extern "C"' as this will be called in C.
+ */
+extern "C" void fiftyoneDegreesExampleCPPValueViewsRun(ExampleParameters *params) {
+	// Run once reading values from the collections and once from the value
+	// table.
+	for (int table = 0; table < 2; table++) {
+		fiftyoneDegreesConfigHash configHash = fiftyoneDegreesHashInMemoryConfig;
+		DeviceDetection::Hash::ConfigHash* cppConfig =
+			new DeviceDetection::Hash::ConfigHash(&configHash);
+		cppConfig->setValueTable(table == 1);
+		ValueViews *valueViews = new ValueViews(
+			params->dataFilePath,
+			params->evidenceFilePath,
+			cppConfig);
+		valueViews->run();
+		delete valueViews;
+	}
+}
+
+#ifndef TEST
+
+/**
+ * Main entry point.
+ */
+int main(int argc, char* argv[]) {
+	fiftyoneDegreesStatusCode status = FIFTYONE_DEGREES_STATUS_SUCCESS;
+	char dataFilePath[FIFTYONE_DEGREES_FILE_MAX_PATH];
+	char userAgentFilePath[FIFTYONE_DEGREES_FILE_MAX_PATH];
+	if (argc > 1) {
+		strcpy(dataFilePath, argv[1]);
+	}
+	else {
+		status = fiftyoneDegreesFileGetPath(
+			dataDir,
+			dataFileName,
+			dataFilePath,
+			sizeof(dataFilePath));
+	}
+	if (status != FIFTYONE_DEGREES_STATUS_SUCCESS) {
+		ExampleBase::reportStatus(status, dataFileName);
+		fgetc(stdin);
+		return 1;
+	}
+
+	if (argc > 2) {
+		strcpy(userAgentFilePath, argv[2]);
+	}
+	else {
+		status = fiftyoneDegreesFileGetPath(
+			dataDir,
+			userAgentFileName,
+			userAgentFilePath,
+			sizeof(userAgentFilePath));
+	}
+	if (status != FIFTYONE_DEGREES_STATUS_SUCCESS) {
+		ExampleBase::reportStatus(status, userAgentFileName);
+		fgetc(stdin);
+		return 1;
+	}
+
+	ExampleParameters params;
+	params.dataFilePath = dataFilePath;
+	params.evidenceFilePath = userAgentFilePath;
+	// run the example
+	fiftyoneDegreesExampleMemCheck(
+		&params,
+		fiftyoneDegreesExampleCPPValueViewsRun);
+
+	// Wait for a character to be pressed.
+	fgetc(stdin);
+
+	return 0;
+}
+
+#endif
@@ -91,6 +91,58 @@ void ConfigHash::setTraceRoute(bool shouldTrace) {
 	config.traceRoute = shouldTrace;
 }
 
+void ConfigHash::setFlatGraph(bool use) {
+	config.flatGraph = use;
+}
+
+void ConfigHash::setOptimiseNodeLayout(bool optimise) {
+	config.optimiseNodeLayout = optimise;
+}
+
+void ConfigHash::setOptimiseNodeSearch(bool optimise) {
+	config.optimiseNodeSearch = optimise;
+}
+
+void ConfigHash::setOptimiseNodeModulo(bool optimise) {
+	config.optimiseNodeModulo = optimise;
+}
+
+void ConfigHash::setResultCacheCapacity(uint32_t capacity) {
+	config.resultCacheCapacity = capacity;
+}
+
+void ConfigHash::setValueTable(bool use) {
+	config.valueTable = use;
+}
+
+void ConfigHash::setMappedFile(bool use) {
+	config.mappedFile = use;
+}
+
+void ConfigHash::setPrefaultMappedFile(bool prefault) {
+	config.prefaultMappedFile = prefault;
+}
+
+void ConfigHash::setHugePages(bool use) {
+	config.hugePages = use;
+}
+
+void ConfigHash::setNumaNode(int32_t node) {
+	config.numaNode = node;
+}
+
+void ConfigHash::setPruneGraph(bool prune) {
+	config.pruneGraph = prune;
+}
+
+void ConfigHash::setProfileIdTable(bool use) {
+	config.profileIdTable = use;
+}
+
+void ConfigHash::setProfileValueIndex(bool use) {
+	config.profileValueIndex = use;
+}
+
 bool ConfigHash::getUsePerformanceGraph() {
 	return config.usePerformanceGraph;
 }
@@ -103,6 +155,58 @@ bool ConfigHash::getTraceRoute() {
 	return config.traceRoute;
 }
 
+bool ConfigHash::getFlatGraph() {
+	return config.flatGraph;
+}
+
+bool ConfigHash::getOptimiseNodeLayout() {
+	return config.optimiseNodeLayout;
+}
+
+bool ConfigHash::getOptimiseNodeSearch() {
+	return config.optimiseNodeSearch;
+}
+
+bool ConfigHash::getOptimiseNodeModulo() {
+	return config.optimiseNodeModulo;
+}
+
+uint32_t ConfigHash::getResultCacheCapacity() {
+	return config.resultCacheCapacity;
+}
+
+bool ConfigHash::getValueTable() {
+	return config.valueTable;
+}
+
+bool ConfigHash::getMappedFile() {
+	return config.mappedFile;
+}
+
+bool ConfigHash::getPrefaultMappedFile() {
+	return config.prefaultMappedFile;
+}
+
+bool ConfigHash::getHugePages() {
+	return config.hugePages;
+}
+
+int32_t ConfigHash::getNumaNode() {
+	return config.numaNode;
+}
+
+bool ConfigHash::getPruneGraph() {
+	return config.pruneGraph;
+}
+
+bool ConfigHash::getProfileIdTable() {
+	return config.profileIdTable;
+}
+
+bool ConfigHash::getProfileValueIndex() {
+	return config.profileValueIndex;
+}
+
 int32_t ConfigHash::getDrift() {
 	return config.drift;
 }
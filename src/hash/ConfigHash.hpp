@@ -188,6 +188,125 @@ namespace FiftyoneDegrees {
 				 */
 				void setTraceRoute(bool shouldTrace);
 
+				/**
+				 * Sets whether the nodes should be compiled into a flat graph
+				 * when the data set is loaded. The flat graph is walked
+				 * without getting each node from the nodes collection, at the
+				 * cost of additional memory. The additional memory is
+				 * included in the size returned by
+				 * fiftyoneDegreesHashSizeManagerFromFile.
+				 * @param use true if the flat graph should be compiled
+				 */
+				void setFlatGraph(bool use);
+
+				/**
+				 * Sets whether the nodes should be placed in breadth first
+				 * order from the root nodes when the data set is loaded, so
+				 * that the nodes evaluated for most detections are close
+				 * together in memory. This compiles the nodes into a flat
+				 * graph in the same way as setFlatGraph.
+				 * @param optimise true if the node layout should be optimised
+				 */
+				void setOptimiseNodeLayout(bool optimise);
+
+				/**
+				 * Sets whether the hash codes of nodes whose records are an
+				 * ordered list should be copied into a layout which is faster
+				 * to search when the data set is loaded. This compiles the
+				 * nodes into a flat graph in the same way as setFlatGraph.
+				 * @param optimise true if the node search should be optimised
+				 */
+				void setOptimiseNodeSearch(bool optimise);
+
+				/**
+				 * Sets whether hash table nodes should find the slot of a
+				 * hash with a multiplication rather than a division. This
+				 * compiles the nodes into a flat graph in the same way as
+				 * setFlatGraph.
+				 * @param optimise true if the node modulo should be optimised
+				 */
+				void setOptimiseNodeModulo(bool optimise);
+
+				/**
+				 * Sets the number of detection results to cache keyed on the
+				 * evidence used to produce them. The cache belongs to the
+				 * data set, so is discarded when the data set is reloaded.
+				 * Results are not cached if the route is traced.
+				 * @param capacity number of results to cache, or 0 to disable
+				 * the cache
+				 */
+				void setResultCacheCapacity(uint32_t capacity);
+
+				/**
+				 * Sets whether the values of every required property for
+				 * every profile should be resolved to strings when the data
+				 * set is loaded. Values can then be returned without
+				 * accessing the profiles, values and strings collections.
+				 * Best used with a small set of required properties.
+				 * @param use true if the value table should be created
+				 */
+				void setValueTable(bool use);
+
+				/**
+				 * Sets whether the data file should be mapped into memory
+				 * read only, rather than read into allocated memory, when all
+				 * the data is in memory. The file is not copied, and its pages
+				 * are shared with other processes mapping the same file.
+				 * @param use true if the data file should be mapped
+				 */
+				void setMappedFile(bool use);
+
+				/**
+				 * Sets whether every page of a mapped data file should be
+				 * read when the data set is loaded rather than when each page
+				 * is first used.
+				 * @param prefault true if the pages should be read on load
+				 */
+				void setPrefaultMappedFile(bool prefault);
+
+				/**
+				 * Sets whether the memory the data file is read into, and the
+				 * flat graph, should be backed by huge pages to reduce TLB
+				 * misses. Reserved huge pages are used if available,
+				 * otherwise transparent huge pages are requested.
+				 * @param use true if huge pages should be used
+				 */
+				void setHugePages(bool use);
+
+				/**
+				 * Sets the NUMA node the memory holding the data set should
+				 * be bound to when all the data is in memory.
+				 * @param node to bind the memory to, or -1 for no binding
+				 */
+				void setNumaNode(int32_t node);
+
+				/**
+				 * Sets whether the flat graph should only include the nodes
+				 * which can be reached from the graphs and components used
+				 * for the required properties, freeing the nodes collection
+				 * once the graph is built. Only the nodes are pruned, not
+				 * the profiles or values.
+				 * @param prune true if the graph should be pruned
+				 */
+				void setPruneGraph(bool prune);
+
+				/**
+				 * Sets whether a table from each profile id to its profile
+				 * should be built when the data set is loaded, so that device
+				 * ids and profile id overrides are resolved without searching
+				 * the profile offsets. Disabled by default.
+				 * @param use true if the table should be built
+				 */
+				void setProfileIdTable(bool use);
+
+				/**
+				 * Sets whether an index from each value to the profiles
+				 * which have it should be built the first time profiles are
+				 * found for a property and value.
+				 * @param use true if the index should be used
+				 */
+				void setProfileValueIndex(bool use);
+
 				/**
 				 * @}
 				 * @name Getters
@@ -275,6 +394,95 @@ namespace FiftyoneDegrees {
 				 */
 				bool getTraceRoute();
 
+				/**
+				 * Gets whether the nodes will be compiled into a flat graph
+				 * when the data set is loaded.
+				 * @return true if the flat graph will be compiled
+				 */
+				bool getFlatGraph();
+
+				/**
+				 * Gets whether the nodes will be placed in breadth first order
+				 * from the root nodes when the data set is loaded.
+				 * @return true if the node layout will be optimised
+				 */
+				bool getOptimiseNodeLayout();
+
+				/**
+				 * Gets whether the hash codes of ordered list nodes will be
+				 * laid out to be searched when the data set is loaded.
+				 * @return true if the node search will be optimised
+				 */
+				bool getOptimiseNodeSearch();
+
+				/**
+				 * Gets whether hash table nodes will find the slot of a hash
+				 * with a multiplication rather than a division.
+				 * @return true if the node modulo will be optimised
+				 */
+				bool getOptimiseNodeModulo();
+
+				/**
+				 * Gets the number of detection results which will be cached.
+				 * @return number of results to cache, or 0 if disabled
+				 */
+				uint32_t getResultCacheCapacity();
+
+				/**
+				 * Gets whether the values of the required properties will be
+				 * resolved for every profile when the data set is loaded.
+				 * @return true if the value table will be created
+				 */
+				bool getValueTable();
+
+				/**
+				 * Gets whether the data file will be mapped into memory when
+				 * all the data is in memory.
+				 * @return true if the data file will be mapped
+				 */
+				bool getMappedFile();
+
+				/**
+				 * Gets whether every page of a mapped data file will be read
+				 * when the data set is loaded.
+				 * @return true if the pages will be read on load
+				 */
+				bool getPrefaultMappedFile();
+
+				/**
+				 * Gets whether the data set will be backed by huge pages.
+				 * @return true if huge pages will be used
+				 */
+				bool getHugePages();
+
+				/**
+				 * Gets the NUMA node the memory holding the data set will be
+				 * bound to.
+				 * @return the node, or -1 if there is no binding
+				 */
+				int32_t getNumaNode();
+
+				/**
+				 * Gets whether the flat graph will be pruned to the nodes
+				 * which can be reached from the graphs and components used.
+				 * @return true if the graph will be pruned
+				 */
+				bool getPruneGraph();
+
+				/**
+				 * Gets whether a table from each profile id to its profile
+				 * will be built when the data set is loaded.
+				 * @return true if the table will be built
+				 */
+				bool getProfileIdTable();
+
+				/**
+				 * Gets whether an index from each value to its profiles will
+				 * be built when profiles are first found for a value.
+				 * @return true if the index will be used
+				 */
+				bool getProfileValueIndex();
+
 				 /**
 				  * Gets the configuration data structure for use in C code.
 				  * Used internally.
@@ -41,6 +41,19 @@ public:
 	void setUsePerformanceGraph(bool use);
 	void setUsePredictiveGraph(bool use);
 	void setTraceRoute(bool trace);
+	void setFlatGraph(bool use);
+	void setOptimiseNodeLayout(bool optimise);
+	void setOptimiseNodeSearch(bool optimise);
+	void setOptimiseNodeModulo(bool optimise);
+	void setResultCacheCapacity(uint32_t capacity);
+	void setValueTable(bool use);
+	void setMappedFile(bool use);
+	void setPrefaultMappedFile(bool prefault);
+	void setHugePages(bool use);
+	void setNumaNode(int32_t node);
+	void setPruneGraph(bool prune);
+	void setProfileIdTable(bool use);
+	void setProfileValueIndex(bool use);
 	CollectionConfig getStrings();
 	CollectionConfig getProperties();
 	CollectionConfig getValues();
@@ -53,4 +66,17 @@ public:
 	bool getUsePredictiveGraph();
 	uint16_t getConcurrency();
 	bool getTraceRoute();
+	bool getFlatGraph();
+	bool getOptimiseNodeLayout();
+	bool getOptimiseNodeSearch();
+	bool getOptimiseNodeModulo();
+	uint32_t getResultCacheCapacity();
+	bool getValueTable();
+	bool getMappedFile();
+	bool getPrefaultMappedFile();
+	bool getHugePages();
+	int32_t getNumaNode();
+	bool getPruneGraph();
+	bool getProfileIdTable();
+	bool getProfileValueIndex();
 };
\ No newline at end of file
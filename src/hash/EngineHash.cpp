@@ -261,6 +261,74 @@ DeviceDetection::Hash::ResultsHash* EngineHash::process(
 	return new ResultsHash(results, manager);
 }
 
+std::vector<DeviceDetection::Hash::ResultsHash*> EngineHash::processBatch(
+	const std::vector<DeviceDetection::EvidenceDeviceDetection*> &evidence) 
+	const {
+	EXCEPTION_CREATE;
+	size_t i;
+	uint32_t evidenceSize;
+	std::vector<fiftyoneDegreesResultsHash*> results(evidence.size());
+	std::vector<fiftyoneDegreesEvidenceKeyValuePairArray*> arrays(
+		evidence.size());
+	std::vector<ResultsHash*> batch;
+
+	// Get the number of components.
+	DataSetHash* dataSet = (DataSetHash*)DataSetGet(manager.get());
+	uint32_t componentsSize = dataSet->componentsList.count;
+	DataSetRelease((DataSetBase*)dataSet);
+
+	// Create the results for each evidence instance with capacity for the
+	// larger of the components and the evidence array.
+	for (i = 0; i < evidence.size(); i++) {
+		evidenceSize = evidence[i] == nullptr ?
+			0 :
+			(uint32_t)evidence[i]->size();
+		results[i] = ResultsHashCreate(
+			manager.get(),
+			componentsSize > evidenceSize ? componentsSize : evidenceSize);
+		arrays[i] = evidence[i] == nullptr ? nullptr : evidence[i]->get();
+	}
+
+	ResultsHashFromEvidenceBatch(
+		results.data(),
+		arrays.data(),
+		(uint32_t)evidence.size(),
+		exception);
+	if (EXCEPTION_FAILED) {
+		for (i = 0; i < results.size(); i++) {
+			ResultsHashFree(results[i]);
+		}
+		EXCEPTION_THROW;
+	}
+
+	batch.reserve(results.size());
+	for (i = 0; i < results.size(); i++) {
+		batch.push_back(new ResultsHash(results[i], manager));
+	}
+	return batch;
+}
+
+std::vector<std::string> EngineHash::getHugePagesCollections() const {
+	std::vector<std::string> collections;
+	DataSetHash *dataSet = DataSetHashGet(manager.get());
+	const HashHugePages *pages = &dataSet->hugePages;
+#define ADD_HUGE_PAGES(n) if (pages->n != HUGE_PAGES_NONE) { \
+	collections.push_back(#n); }
+	ADD_HUGE_PAGES(strings)
+	ADD_HUGE_PAGES(components)
+	ADD_HUGE_PAGES(maps)
+	ADD_HUGE_PAGES(properties)
+	ADD_HUGE_PAGES(values)
+	ADD_HUGE_PAGES(profiles)
+	ADD_HUGE_PAGES(rootNodes)
+	ADD_HUGE_PAGES(nodes)
+	ADD_HUGE_PAGES(profileOffsets)
+	ADD_HUGE_PAGES(flatGraph)
+#undef ADD_HUGE_PAGES
+	DataSetHashRelease(dataSet);
+	return collections;
+}
+
 Common::ResultsBase* EngineHash::processBase(
 	Common::EvidenceBase *evidence) const {
 	EXCEPTION_CREATE;
@@ -24,6 +24,7 @@
 #define FIFTYONE_DEGREES_ENGINE_HASH_HPP
 
 #include <sstream>
+#include <vector>
 #include "../common-cxx/resource.h"
 #include "../EvidenceDeviceDetection.hpp"
 #include "../EngineDeviceDetection.hpp"
@@ -163,6 +164,30 @@ namespace FiftyoneDegrees {
 				 */
 				ResultsHash* process(const char *userAgent) const;
 
+				/**
+				 * Processes each of the evidence instances provided returning
+				 * a results instance for each in the same order. The outcome
+				 * is identical to calling process for each evidence instance,
+				 * but the work common to all the evidence is only performed
+				 * once and the graphs are evaluated for the evidence together.
+				 * The caller is responsible for deleting the results.
+				 * @param evidence the evidence instances to process
+				 * @return a results instance for each evidence instance
+				 */
+				std::vector<ResultsHash*> processBatch(
+					const std::vector<EvidenceDeviceDetection*> &evidence) const;
+
+				/**
+				 * Gets the names of the collections in the data set which are
+				 * backed by reserved huge pages, or advised to use transparent
+				 * huge pages which the operating system may not have provided.
+				 * Only populated when the hugePages option is enabled in the
+				 * configuration. The flat graph is reported as "flatGraph".
+				 * @return names of the collections using or advised to use
+				 * huge pages
+				 */
+				std::vector<std::string> getHugePagesCollections() const;
+
 				/**
 				 * @}
 				 * @name Common::EngineBase Implementation
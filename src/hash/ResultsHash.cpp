@@ -97,6 +97,59 @@ void DeviceDetection::Hash::ResultsHash::getValuesInternal(
 	}
 }
 
+bool DeviceDetection::Hash::ResultsHash::getValueView(
+	int requiredPropertyIndex,
+	vector<std::string_view> &values) {
+	EXCEPTION_CREATE;
+	uint32_t i, count;
+	const char * const *tableValues;
+	Item *valuesItems;
+	String *valueName;
+
+	values.clear();
+	if (requiredPropertyIndex < 0 ||
+		requiredPropertyIndex >= (int)available->count) {
+		return false;
+	}
+
+	// Use the value table if there is one as the strings are already
+	// resolved and owned by the data set.
+	if (ResultsHashGetValuesFromTable(
+		results,
+		requiredPropertyIndex,
+		&tableValues,
+		&count)) {
+		for (i = 0; i < count; i++) {
+			values.emplace_back(tableValues[i]);
+		}
+		return values.empty() == false;
+	}
+
+	// Otherwise point to the strings held by the results value items.
+	valuesItems = ResultsHashGetValues(
+		results,
+		requiredPropertyIndex,
+		exception);
+	EXCEPTION_THROW;
+	if (valuesItems != NULL) {
+		for (i = 0; i < results->values.count; i++) {
+			valueName = (String*)valuesItems[i].data.ptr;
+			if (valueName != nullptr) {
+				values.emplace_back(STRING(valueName));
+			}
+		}
+	}
+	return values.empty() == false;
+}
+
+bool DeviceDetection::Hash::ResultsHash::getValueView(
+	const char *propertyName,
+	vector<std::string_view> &values) {
+	return getValueView(
+		PropertiesGetRequiredPropertyIndexFromName(available, propertyName),
+		values);
+}
+
 bool DeviceDetection::Hash::ResultsHash::hasValuesInternal(
 	int requiredPropertyIndex) {
 	EXCEPTION_CREATE;
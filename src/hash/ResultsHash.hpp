@@ -24,6 +24,7 @@
 #define FIFTYONE_DEGREES_RESULTS_HASH_HPP
 
 #include <sstream>
+#include <string_view>
 #include "../ResultsDeviceDetection.hpp"
 #include "hash.h"
 
@@ -183,6 +184,49 @@ namespace FiftyoneDegrees {
 				 */
 				string getTrace(uint32_t resultIndex) const;
 
+				/**
+				 * @}
+				 * @name Value View Getters
+				 * @{
+				 */
+
+				/**
+				 * Sets the values vector to views of the value strings for
+				 * the property without copying them. Where the data set was
+				 * created with a value table the strings are read from the
+				 * table, otherwise from the strings collection.
+				 *
+				 * The views are valid while the results instance exists if
+				 * the data set is in memory or has a value table. Otherwise
+				 * they are only valid until the next call to get values from
+				 * this results instance. The JavaScriptHardwareProfile
+				 * property is returned as stored in the data set rather than
+				 * as the snippet returned by getValues.
+				 *
+				 * Unlike getValues no exception is thrown if there are no
+				 * values. The vector can be reused between calls to avoid
+				 * allocating memory once it has sufficient capacity.
+				 * @param requiredPropertyIndex index of the property in the
+				 * required properties
+				 * @param values vector to set to the views of the values
+				 * @return true if there is at least one value
+				 */
+				bool getValueView(
+					int requiredPropertyIndex,
+					vector<std::string_view> &values);
+
+				/**
+				 * Sets the values vector to views of the value strings for
+				 * the property without copying them. See
+				 * getValueView(int, vector<std::string_view>&).
+				 * @param propertyName name of the property
+				 * @param values vector to set to the views of the values
+				 * @return true if there is at least one value
+				 */
+				bool getValueView(
+					const char *propertyName,
+					vector<std::string_view> &values);
+
 				/**
 				 * @}
 				 * @name DeviceDetection::ResultsDeviceDetection Implementation
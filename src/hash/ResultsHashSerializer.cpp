@@ -22,40 +22,46 @@
 
 #include "../../src/common-cxx/Exceptions.hpp"
 #include "ResultsHashSerializer.hpp"
-#include <algorithm>
+#include <new>
 
 using namespace FiftyoneDegrees::DeviceDetection::Hash;
 ResultsHashSerializer::ResultsHashSerializer(size_t bufferSize): bufferSize(bufferSize) {
-    realloc();
 }
 
-void ResultsHashSerializer::realloc() {
-    // note even if bufferSize = 0 unique_ptr will hold a past-the-end object pointer
-    buffer = std::make_unique<char[]>(bufferSize);
+bool ResultsHashSerializer::append(
+    void *state,
+    const char *chars,
+    size_t length) {
+    try {
+        ((std::string*)state)->append(chars, length);
+    } catch (const std::bad_alloc &) {
+        // the string could not grow - stop writing
+        return false;
+    }
+    return true;
 }
 
 std::string ResultsHashSerializer::allValuesJson(ResultsHash *results) {
     FIFTYONE_DEGREES_EXCEPTION_CREATE;
-    // a loop is needed to ensure we reallocate the buffer if it was too small to hold the whole JSON output
     // a precondition check is needed to not dereference a null pointer
-    while(results && results->results && buffer) {
-        size_t written = fiftyoneDegreesResultsHashGetValuesJson(results->results, buffer.get(), bufferSize, exception);
-        // nothing has been written, something went wrong
-        if (written <= 0) break;
-        if (written <= bufferSize) {
-            // happy path
-            // remove the \0 in the end otherwise it will appear as an escaped character
-            return string(buffer.get(), written - 1);
-        } else {
-            // increase the buffer size and retry on the next iteration of the loop
-            bufferSize = std::max<size_t>(bufferSize * 2, written);
-            try {
-                realloc();
-            } catch (const std::bad_alloc &) { 
-                // reallocation failed - we just exit this loop
-                break;
-            }
-        }
+    if (results == nullptr || results->results == nullptr) {
+        return "";
+    }
+    // the values are streamed into the string which grows as needed, so the
+    // results are only written once whatever the size of the JSON output
+    std::string json;
+    try {
+        json.reserve(bufferSize);
+    } catch (const std::bad_alloc &) {
+        // the reserve is only a hint - carry on with an empty string
+    }
+    fiftyoneDegreesResultsHashWriteValuesJson(
+        results->results,
+        &json,
+        append,
+        exception);
+    if (FIFTYONE_DEGREES_EXCEPTION_FAILED) {
+        return "";
     }
-    return "";
+    return json;
 }
@@ -40,22 +40,25 @@ namespace FiftyoneDegrees {
                 /**
                  * Due to the default parameter value - it can be treated as optional and
                  * we can expose a generated default constructor through SWIG interface
-                 * @param bufferSize - the size of a working memory to write serialized string into
+                 * @param bufferSize - the number of characters to reserve in the string the JSON is written to
                  */
                 ResultsHashSerializer(size_t bufferSize = 40960);
                 /**
                  * The main method that serializes the ResultsHash object into property-value JSON dict. 
-                 * This method has a side effect that attempts to increase the size of the buffer if it is insufficient
-                 * to hold the serialized result.
+                 * The JSON is streamed into a string which grows as needed, so the results are
+                 * written once whatever the size of the output.
                  *
                  * @param results - a pointer to a ResultsHash instance to be serialized
-                 * @return std::string with a copy of the buffer portion with the JSON serialization
+                 * @return std::string with the JSON serialization
                  */
                 std::string allValuesJson(FiftyoneDegrees::DeviceDetection::Hash::ResultsHash  *results);
             private:
-                std::unique_ptr<char[]> buffer;
                 size_t bufferSize = 0;
-                void realloc();
+                /**
+                 * Write method passed to fiftyoneDegreesResultsHashWriteValuesJson
+                 * which appends the characters to the std::string state.
+                 */
+                static bool append(void *state, const char *chars, size_t length);
             };
         }
     }
@@ -55,6 +55,7 @@ MAP_TYPE(HashRootNodes)
 MAP_TYPE(HashMatchMethod)
 
 #define ResultsHashGetValues fiftyoneDegreesResultsHashGetValues /**< Synonym for #fiftyoneDegreesResultsHashGetValues function. */
+#define ResultsHashGetValuesFromTable fiftyoneDegreesResultsHashGetValuesFromTable /**< Synonym for #fiftyoneDegreesResultsHashGetValuesFromTable function. */
 #define ResultsHashGetHasValues fiftyoneDegreesResultsHashGetHasValues /**< Synonym for #fiftyoneDegreesResultsHashGetHasValues function. */
 #define ResultsHashGetNoValueReason fiftyoneDegreesResultsHashGetNoValueReason /**< Synonym for #fiftyoneDegreesResultsHashGetNoValueReason function. */
 #define ResultsHashGetNoValueReasonMessage fiftyoneDegreesResultsHashGetNoValueReasonMessage /**< Synonym for #fiftyoneDegreesResultsHashGetNoValueReasonMessage function. */
@@ -62,22 +63,35 @@ MAP_TYPE(HashMatchMethod)
 #define ResultsHashGetValuesStringByRequiredPropertyIndex fiftyoneDegreesResultsHashGetValuesStringByRequiredPropertyIndex /**< Synonym for #fiftyoneDegreesResultsHashGetValuesStringByRequiredPropertyIndex function. */
 #define HashGetDeviceIdFromResult fiftyoneDegreesHashGetDeviceIdFromResult /**< Synonym for #fiftyoneDegreesHashGetDeviceIdFromResult function. */
 #define HashGetDeviceIdFromResults fiftyoneDegreesHashGetDeviceIdFromResults /**< Synonym for #fiftyoneDegreesHashGetDeviceIdFromResults function. */
+#define HashGetDeviceIdBinaryFromResults fiftyoneDegreesHashGetDeviceIdBinaryFromResults /**< Synonym for #fiftyoneDegreesHashGetDeviceIdBinaryFromResults function. */
 #define ResultsHashCreate(manager, overridesCapacity) fiftyoneDegreesResultsHashCreate((manager), 0, (overridesCapacity)) /**< Two argument convenience form of #fiftyoneDegreesResultsHashCreate that injects the deprecated userAgentCapacity as 0, so internal callers need not pass it. */
 #define ResultsHashFree fiftyoneDegreesResultsHashFree /**< Synonym for #fiftyoneDegreesResultsHashFree function. */
 #define ResultsHashFromDeviceId fiftyoneDegreesResultsHashFromDeviceId /**< Synonym for #fiftyoneDegreesResultsHashFromDeviceId function. */
+#define ResultsHashFromDeviceIdBinary fiftyoneDegreesResultsHashFromDeviceIdBinary /**< Synonym for #fiftyoneDegreesResultsHashFromDeviceIdBinary function. */
 #define ResultsHashFromUserAgent fiftyoneDegreesResultsHashFromUserAgent /**< Synonym for #fiftyoneDegreesResultsHashFromUserAgent function. */
 #define ResultsHashFromEvidence fiftyoneDegreesResultsHashFromEvidence /**< Synonym for #fiftyoneDegreesResultsHashFromEvidence function. */
+#define ResultsHashFromEvidenceBatch fiftyoneDegreesResultsHashFromEvidenceBatch /**< Synonym for #fiftyoneDegreesResultsHashFromEvidenceBatch function. */
 #define DataSetHashGet fiftyoneDegreesDataSetHashGet /**< Synonym for #fiftyoneDegreesDataSetHashGet function. */
 #define DataSetHashRelease fiftyoneDegreesDataSetHashRelease /**< Synonym for #fiftyoneDegreesDataSetHashRelease function. */
 #define HashSizeManagerFromFile fiftyoneDegreesHashSizeManagerFromFile /**< Synonym for #fiftyoneDegreesHashSizeManagerFromFile function. */
 #define HashSizeManagerFromMemory fiftyoneDegreesHashSizeManagerFromMemory /**< Synonym for #fiftyoneDegreesHashSizeManagerFromMemory function. */
 #define HashInitManagerFromFile fiftyoneDegreesHashInitManagerFromFile /**< Synonym for #fiftyoneDegreesHashInitManagerFromFile function. */
+#define HashInitManagerFromMappedFile fiftyoneDegreesHashInitManagerFromMappedFile /**< Synonym for #fiftyoneDegreesHashInitManagerFromMappedFile function. */
 #define HashInitManagerFromMemory fiftyoneDegreesHashInitManagerFromMemory /**< Synonym for #fiftyoneDegreesHashInitManagerFromMemory function. */
+#define HashSaveSharedGraph fiftyoneDegreesHashSaveSharedGraph /**< Synonym for #fiftyoneDegreesHashSaveSharedGraph function. */
+#define HashSharedGraphChanged fiftyoneDegreesHashSharedGraphChanged /**< Synonym for #fiftyoneDegreesHashSharedGraphChanged function. */
+#define HashReplicasInit fiftyoneDegreesHashReplicasInit /**< Synonym for #fiftyoneDegreesHashReplicasInit function. */
+#define HashReplicasGet fiftyoneDegreesHashReplicasGet /**< Synonym for #fiftyoneDegreesHashReplicasGet function. */
+#define HashReplicasReload fiftyoneDegreesHashReplicasReload /**< Synonym for #fiftyoneDegreesHashReplicasReload function. */
+#define HashReplicasFree fiftyoneDegreesHashReplicasFree /**< Synonym for #fiftyoneDegreesHashReplicasFree function. */
+#define HashTrimNodes fiftyoneDegreesHashTrimNodes /**< Synonym for #fiftyoneDegreesHashTrimNodes function. */
 #define HashReloadManagerFromOriginalFile fiftyoneDegreesHashReloadManagerFromOriginalFile /**< Synonym for #fiftyoneDegreesHashReloadManagerFromOriginalFile function. */
 #define HashReloadManagerFromFile fiftyoneDegreesHashReloadManagerFromFile /**< Synonym for #fiftyoneDegreesHashReloadManagerFromFile function. */
 #define HashReloadManagerFromMemory fiftyoneDegreesHashReloadManagerFromMemory /**< Synonym for #fiftyoneDegreesHashReloadManagerFromMemory function. */
 #define HashIterateProfilesForPropertyAndValue fiftyoneDegreesHashIterateProfilesForPropertyAndValue /**< Synonym for #fiftyoneDegreesHashIterateProfilesForPropertyAndValue function. */
+#define HashIterateProfilesForPropertiesAndValues fiftyoneDegreesHashIterateProfilesForPropertiesAndValues /**< Synonym for #fiftyoneDegreesHashIterateProfilesForPropertiesAndValues function. */
 #define ResultsHashGetValuesJson fiftyoneDegreesResultsHashGetValuesJson /**< Synonym for #fiftyoneDegreesResultsHashGetValuesJson function. */
+#define ResultsHashWriteValuesJson fiftyoneDegreesResultsHashWriteValuesJson /**< Synonym for #fiftyoneDegreesResultsHashWriteValuesJson function. */
 
 #define HashInMemoryConfig fiftyoneDegreesHashInMemoryConfig /**< Synonym for #fiftyoneDegreesHashInMemoryConfig config. */
 #define HashHighPerformanceConfig fiftyoneDegreesHashHighPerformanceConfig /**< Synonym for #fiftyoneDegreesHashHighPerformanceConfig config. */
@@ -89,19 +103,97 @@ MAP_TYPE(HashMatchMethod)
 MAP_TYPE(GraphNode)
 MAP_TYPE(GraphNodeHash)
 MAP_TYPE(GraphTraceNode)
+MAP_TYPE(GraphHashKernel)
+MAP_TYPE(GraphFlat)
+MAP_TYPE(GraphFlatSegment)
+MAP_TYPE(GraphNodeOrdered)
+MAP_TYPE(GraphNodeSearch)
+MAP_TYPE(GraphNodeModulo)
+MAP_TYPE(ResultCache)
+MAP_TYPE(ResultCacheFingerprint)
+MAP_TYPE(ResultCacheCounter)
+MAP_TYPE(MappedFile)
+MAP_TYPE(HugePages)
+MAP_TYPE(HugePagesType)
+MAP_TYPE(HashHugePages)
+MAP_TYPE(HashReplicas)
+MAP_TYPE(HashValueCell)
+MAP_TYPE(HashValueTable)
+MAP_TYPE(HashProfileIdTable)
+MAP_TYPE(HashProfileValueIndex)
+MAP_TYPE(HashPropertyValues)
+MAP_TYPE(HashJsonProperty)
+MAP_TYPE(HashPrefixHashes)
+MAP_TYPE(HashJsonWriteMethod)
 
 #define GRAPH_NODE_IS_HASH_TABLE FIFTYONE_DEGREES_GRAPH_NODE_IS_HASH_TABLE /**< Synonym for #FIFTYONE_DEGREES_GRAPH_NODE_IS_HASH_TABLE macro. */
+#define GRAPH_NODE_FLAG_ORDERED FIFTYONE_DEGREES_GRAPH_NODE_FLAG_ORDERED /**< Synonym for #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_ORDERED macro. */
+#define GRAPH_NODE_ORDERED FIFTYONE_DEGREES_GRAPH_NODE_ORDERED /**< Synonym for #FIFTYONE_DEGREES_GRAPH_NODE_ORDERED macro. */
+#define GRAPH_NODE_FLAG_MODULO FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO /**< Synonym for #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO macro. */
+#define GRAPH_NODE_MODULO FIFTYONE_DEGREES_GRAPH_NODE_MODULO /**< Synonym for #FIFTYONE_DEGREES_GRAPH_NODE_MODULO macro. */
+#define GRAPH_NODE_FLAG_SEARCH FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH /**< Synonym for #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH macro. */
+#define GRAPH_NODE_SEARCH FIFTYONE_DEGREES_GRAPH_NODE_SEARCH /**< Synonym for #FIFTYONE_DEGREES_GRAPH_NODE_SEARCH macro. */
+#define GRAPH_SEARCH_LINEAR_MAX FIFTYONE_DEGREES_GRAPH_SEARCH_LINEAR_MAX /**< Synonym for #FIFTYONE_DEGREES_GRAPH_SEARCH_LINEAR_MAX macro. */
+#define GRAPH_NODE_PREFETCH FIFTYONE_DEGREES_GRAPH_NODE_PREFETCH /**< Synonym for #FIFTYONE_DEGREES_GRAPH_NODE_PREFETCH macro. */
+#define GRAPH_HASH_WINDOWS FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS /**< Synonym for #FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS macro. */
+#define GRAPH_HASH_WINDOWS_MIN FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS_MIN /**< Synonym for #FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS_MIN macro. */
+#define GRAPH_FLAT_LINE FIFTYONE_DEGREES_GRAPH_FLAT_LINE /**< Synonym for #FIFTYONE_DEGREES_GRAPH_FLAT_LINE macro. */
+#define GRAPH_FLAT_NODE FIFTYONE_DEGREES_GRAPH_FLAT_NODE /**< Synonym for #FIFTYONE_DEGREES_GRAPH_FLAT_NODE macro. */
+#define GRAPH_TRIM_MARKER FIFTYONE_DEGREES_GRAPH_TRIM_MARKER /**< Synonym for #FIFTYONE_DEGREES_GRAPH_TRIM_MARKER macro. */
+#define GRAPH_FLAT_SEGMENT_MAGIC FIFTYONE_DEGREES_GRAPH_FLAT_SEGMENT_MAGIC /**< Synonym for #FIFTYONE_DEGREES_GRAPH_FLAT_SEGMENT_MAGIC macro. */
+#define GRAPH_FLAT_SEGMENT_VERSION FIFTYONE_DEGREES_GRAPH_FLAT_SEGMENT_VERSION /**< Synonym for #FIFTYONE_DEGREES_GRAPH_FLAT_SEGMENT_VERSION macro. */
+#define HUGE_PAGE_SIZE FIFTYONE_DEGREES_HUGE_PAGE_SIZE /**< Synonym for #FIFTYONE_DEGREES_HUGE_PAGE_SIZE macro. */
+#define HUGE_PAGES_NONE FIFTYONE_DEGREES_HUGE_PAGES_NONE /**< Synonym for #FIFTYONE_DEGREES_HUGE_PAGES_NONE enum value. */
+#define HUGE_PAGES_ADVISED FIFTYONE_DEGREES_HUGE_PAGES_ADVISED /**< Synonym for #FIFTYONE_DEGREES_HUGE_PAGES_ADVISED enum value. */
+#define HUGE_PAGES_EXPLICIT FIFTYONE_DEGREES_HUGE_PAGES_EXPLICIT /**< Synonym for #FIFTYONE_DEGREES_HUGE_PAGES_EXPLICIT enum value. */
+#define NUMA_MAX_NODES FIFTYONE_DEGREES_NUMA_MAX_NODES /**< Synonym for #FIFTYONE_DEGREES_NUMA_MAX_NODES macro. */
 #define GraphNodeReadFromFile fiftyoneDegreesGraphNodeReadFromFile /**< Synonym for #fiftyoneDegreesGraphNodeReadFromFile function. */
 #define GraphGetNode fiftyoneDegreesGraphGetNode /**< Synonym for #fiftyoneDegreesGraphGetNode function. */
 #define GraphGetMatchingHashFromListNodeTable fiftyoneDegreesGraphGetMatchingHashFromListNodeTable /**< Synonym for #fiftyoneDegreesGraphGetMatchingHashFromListNodeTable function. */
+#define GraphGetMatchingHashFromListNodeTableModulo fiftyoneDegreesGraphGetMatchingHashFromListNodeTableModulo /**< Synonym for #fiftyoneDegreesGraphGetMatchingHashFromListNodeTableModulo function. */
 #define GraphGetMatchingHashFromListNodeSearch fiftyoneDegreesGraphGetMatchingHashFromListNodeSearch /**< Synonym for #fiftyoneDegreesGraphGetMatchingHashFromListNodeSearch function. */
+#define GraphGetMatchingHashFromListNodeLayout fiftyoneDegreesGraphGetMatchingHashFromListNodeLayout /**< Synonym for #fiftyoneDegreesGraphGetMatchingHashFromListNodeLayout function. */
 #define GraphGetMatchingHashFromListNode fiftyoneDegreesGraphGetMatchingHashFromListNode /**< Synonym for #fiftyoneDegreesGraphGetMatchingHashFromListNode function. */
+#define GraphGetNearestHashFromOrdered fiftyoneDegreesGraphGetNearestHashFromOrdered /**< Synonym for #fiftyoneDegreesGraphGetNearestHashFromOrdered function. */
 #define GraphGetMatchingHashFromBinaryNode fiftyoneDegreesGraphGetMatchingHashFromBinaryNode /**< Synonym for #fiftyoneDegreesGraphGetMatchingHashFromBinaryNode function. */
 #define GraphGetMatchingHashFromNode fiftyoneDegreesGraphGetMatchingHashFromNode /**< Synonym for #fiftyoneDegreesGraphGetMatchingHashFromNode function. */
+#define GraphHashKernelGetBest fiftyoneDegreesGraphHashKernelGetBest /**< Synonym for #fiftyoneDegreesGraphHashKernelGetBest function. */
+#define GraphHashWindows fiftyoneDegreesGraphHashWindows /**< Synonym for #fiftyoneDegreesGraphHashWindows function. */
+#define GraphHashFind fiftyoneDegreesGraphHashFind /**< Synonym for #fiftyoneDegreesGraphHashFind function. */
+#define GraphFlatCreate fiftyoneDegreesGraphFlatCreate /**< Synonym for #fiftyoneDegreesGraphFlatCreate function. */
+#define GraphFlatSave fiftyoneDegreesGraphFlatSave /**< Synonym for #fiftyoneDegreesGraphFlatSave function. */
+#define GraphFlatAttach fiftyoneDegreesGraphFlatAttach /**< Synonym for #fiftyoneDegreesGraphFlatAttach function. */
+#define GraphFlatGetGeneration fiftyoneDegreesGraphFlatGetGeneration /**< Synonym for #fiftyoneDegreesGraphFlatGetGeneration function. */
+#define GraphFlatGetRootOffset fiftyoneDegreesGraphFlatGetRootOffset /**< Synonym for #fiftyoneDegreesGraphFlatGetRootOffset function. */
+#define GraphFlatFree fiftyoneDegreesGraphFlatFree /**< Synonym for #fiftyoneDegreesGraphFlatFree function. */
+#define GraphTrim fiftyoneDegreesGraphTrim /**< Synonym for #fiftyoneDegreesGraphTrim function. */
+#define GraphGetTrimmedStart fiftyoneDegreesGraphGetTrimmedStart /**< Synonym for #fiftyoneDegreesGraphGetTrimmedStart function. */
 #define GraphTraceCreate fiftyoneDegreesGraphTraceCreate /**< Synonym for #fiftyoneDegreesGraphTraceCreate function. */
 #define GraphTraceFree fiftyoneDegreesGraphTraceFree /**< Synonym for #fiftyoneDegreesGraphTraceFree function. */
 #define GraphTraceAppend fiftyoneDegreesGraphTraceAppend /**< Synonym for #fiftyoneDegreesGraphTraceAppend function. */
 #define GraphTraceGet fiftyoneDegreesGraphTraceGet /**< Synonym for #fiftyoneDegreesGraphTraceGet function. */
+#define ResultCacheCreate fiftyoneDegreesResultCacheCreate /**< Synonym for #fiftyoneDegreesResultCacheCreate function. */
+#define ResultCacheFree fiftyoneDegreesResultCacheFree /**< Synonym for #fiftyoneDegreesResultCacheFree function. */
+#define ResultCacheFingerprintInit fiftyoneDegreesResultCacheFingerprintInit /**< Synonym for #fiftyoneDegreesResultCacheFingerprintInit function. */
+#define ResultCacheFingerprintAdd fiftyoneDegreesResultCacheFingerprintAdd /**< Synonym for #fiftyoneDegreesResultCacheFingerprintAdd function. */
+#define ResultCacheGet fiftyoneDegreesResultCacheGet /**< Synonym for #fiftyoneDegreesResultCacheGet function. */
+#define ResultCachePut fiftyoneDegreesResultCachePut /**< Synonym for #fiftyoneDegreesResultCachePut function. */
+#define ResultCacheGetHits fiftyoneDegreesResultCacheGetHits /**< Synonym for #fiftyoneDegreesResultCacheGetHits function. */
+#define ResultCacheGetMisses fiftyoneDegreesResultCacheGetMisses /**< Synonym for #fiftyoneDegreesResultCacheGetMisses function. */
+#define MappedFileReset fiftyoneDegreesMappedFileReset /**< Synonym for #fiftyoneDegreesMappedFileReset function. */
+#define MappedFileOpen fiftyoneDegreesMappedFileOpen /**< Synonym for #fiftyoneDegreesMappedFileOpen function. */
+#define MappedFileClose fiftyoneDegreesMappedFileClose /**< Synonym for #fiftyoneDegreesMappedFileClose function. */
+#define MappedFileDiscard fiftyoneDegreesMappedFileDiscard /**< Synonym for #fiftyoneDegreesMappedFileDiscard function. */
+#define HugePagesReset fiftyoneDegreesHugePagesReset /**< Synonym for #fiftyoneDegreesHugePagesReset function. */
+#define HugePagesAlloc fiftyoneDegreesHugePagesAlloc /**< Synonym for #fiftyoneDegreesHugePagesAlloc function. */
+#define HugePagesAllocNormal fiftyoneDegreesHugePagesAllocNormal /**< Synonym for #fiftyoneDegreesHugePagesAllocNormal function. */
+#define HugePagesAdvise fiftyoneDegreesHugePagesAdvise /**< Synonym for #fiftyoneDegreesHugePagesAdvise function. */
+#define HugePagesGetType fiftyoneDegreesHugePagesGetType /**< Synonym for #fiftyoneDegreesHugePagesGetType function. */
+#define HugePagesFree fiftyoneDegreesHugePagesFree /**< Synonym for #fiftyoneDegreesHugePagesFree function. */
+#define NumaGetNodeCount fiftyoneDegreesNumaGetNodeCount /**< Synonym for #fiftyoneDegreesNumaGetNodeCount function. */
+#define NumaGetNodes fiftyoneDegreesNumaGetNodes /**< Synonym for #fiftyoneDegreesNumaGetNodes function. */
+#define NumaGetCurrentNode fiftyoneDegreesNumaGetCurrentNode /**< Synonym for #fiftyoneDegreesNumaGetCurrentNode function. */
+#define NumaBind fiftyoneDegreesNumaBind /**< Synonym for #fiftyoneDegreesNumaBind function. */
 /**
  * @}
  */
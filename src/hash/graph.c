@@ -29,6 +29,8 @@
 #include "graph.h"
 #include "fiftyone.h"
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 
  /**
   * The prime number used by the Rabin-Karp rolling hash method.
@@ -135,26 +137,17 @@ fiftyoneDegreesGraphNode* fiftyoneDegreesGraphGetNode(
 		exception);
 }
 
-fiftyoneDegreesGraphNodeHash*
-fiftyoneDegreesGraphGetMatchingHashFromListNodeTable(
-	fiftyoneDegreesGraphNode *node,
-	uint32_t hash) {
-	fiftyoneDegreesGraphNodeHash *foundHash = NULL;
-	fiftyoneDegreesGraphNodeHash *nodeHashes, *nodeHash, *bucketEnd;
-	uint32_t index;
-	if (hash == 0) {
-		// A hash code of zero is reserved as a marker in this layout: it marks
-		// a slot as empty or as the head of a collision bucket, and terminates
-		// a bucket. Comparing a hash of zero against the records would match
-		// one of those markers rather than a stored hash code, so return no
-		// match before any comparison is made.
-		return NULL;
-	}
-	nodeHashes = (GraphNodeHash*)(node + 1);
-	// The modulo is a positive value no greater than the number of hashes, so
-	// the index is always that of a record of the node.
-	index = hash % (uint32_t)node->modulo;
-	nodeHash = &nodeHashes[index];
+/**
+ * Gets the matching hash record from the slot of a hash table node at the
+ * index, following the collision bucket if the slot is the head of one.
+ */
+static GraphNodeHash* getMatchingHashFromSlot(
+	GraphNode *node,
+	uint32_t hash,
+	uint32_t index) {
+	GraphNodeHash *foundHash = NULL;
+	GraphNodeHash *nodeHashes = (GraphNodeHash*)(node + 1);
+	GraphNodeHash *nodeHash = &nodeHashes[index], *bucketEnd;
 	if (hash == nodeHash->hashCode) {
 		// There is a single record at this index and it matched, so return it.
 		foundHash = nodeHash;
@@ -180,6 +173,56 @@ fiftyoneDegreesGraphGetMatchingHashFromListNodeTable(
 	return foundHash;
 }
 
+/**
+ * Calculates (hash % modulo) from the multiplier of the modulo without a
+ * division. The low 64 bits of hash * multiplier are the fractional part of
+ * hash / modulo, so the high 64 bits of multiplying that by the modulo are the
+ * remainder. The 96 bit product is formed from two 32 bit halves so no 128 bit
+ * arithmetic is needed. The result is less than the modulo for any multiplier.
+ */
+static uint32_t getFastModulo(
+	uint32_t hash,
+	uint64_t multiplier,
+	uint32_t modulo) {
+	const uint64_t fraction = multiplier * hash;
+	return (uint32_t)((((fraction >> 32) * modulo) +
+		(((fraction & 0xFFFFFFFF) * modulo) >> 32)) >> 32);
+}
+
+fiftyoneDegreesGraphNodeHash*
+fiftyoneDegreesGraphGetMatchingHashFromListNodeTable(
+	fiftyoneDegreesGraphNode *node,
+	uint32_t hash) {
+	if (hash == 0) {
+		// A hash code of zero is reserved as a marker in this layout: it marks
+		// a slot as empty or as the head of a collision bucket, and terminates
+		// a bucket. Comparing a hash of zero against the records would match
+		// one of those markers rather than a stored hash code, so return no
+		// match before any comparison is made.
+		return NULL;
+	}
+	// The modulo is a positive value no greater than the number of hashes, so
+	// the index is always that of a record of the node.
+	return getMatchingHashFromSlot(node, hash, hash % (uint32_t)node->modulo);
+}
+
+fiftyoneDegreesGraphNodeHash*
+fiftyoneDegreesGraphGetMatchingHashFromListNodeTableModulo(
+	fiftyoneDegreesGraphNode *node,
+	uint32_t hash) {
+	if (hash == 0) {
+		// Zero is a marker, as for the table without the modulo constant.
+		return NULL;
+	}
+	return getMatchingHashFromSlot(
+		node,
+		hash,
+		getFastModulo(
+			hash,
+			GRAPH_NODE_MODULO(node)->multiplier,
+			(uint32_t)node->modulo));
+}
+
 fiftyoneDegreesGraphNodeHash*
 fiftyoneDegreesGraphGetMatchingHashFromListNodeSearch(
 	fiftyoneDegreesGraphNode *node,
@@ -203,6 +246,44 @@ fiftyoneDegreesGraphGetMatchingHashFromListNodeSearch(
 	return foundHash;
 }
 
+fiftyoneDegreesGraphNodeHash*
+fiftyoneDegreesGraphGetMatchingHashFromListNodeLayout(
+	fiftyoneDegreesGraphNode *node,
+	uint32_t hash) {
+	int32_t index;
+	uint32_t k = 1;
+	GraphNodeHash* nodeHashes = (GraphNodeHash*)(node + 1);
+	const GraphNodeSearch *search = GRAPH_NODE_SEARCH(node);
+	const uint32_t *codes = (const uint32_t*)(search + 1);
+	const uint32_t *indexes;
+	if (search->eytzinger == 0) {
+		// Few enough hash codes to compare them all a lane at a time.
+		index = GraphHashFind(
+			GraphHashKernelGetBest(),
+			codes,
+			search->count,
+			hash);
+		return index < 0 ? NULL : &nodeHashes[index];
+	}
+	// Descend the implicit tree choosing the branch with arithmetic rather
+	// than a conditional jump. The hash codes compared first share the same
+	// cache lines.
+	while (k <= search->count) {
+		k = 2 * k + (codes[k] < hash);
+	}
+	// Undo the right turns after the last left turn, and the left turn
+	// itself, to get the smallest hash code which is not less than the hash.
+	while ((k & 1) != 0) {
+		k >>= 1;
+	}
+	k >>= 1;
+	if (k == 0 || codes[k] != hash) {
+		return NULL;
+	}
+	indexes = codes + search->count + 1;
+	return &nodeHashes[indexes[k]];
+}
+
 fiftyoneDegreesGraphNodeHash* 
 fiftyoneDegreesGraphGetMatchingHashFromListNode(
 	fiftyoneDegreesGraphNode *node,
@@ -228,6 +309,48 @@ fiftyoneDegreesGraphGetMatchingHashFromListNode(
 	return foundHash;
 }
 
+fiftyoneDegreesGraphNodeHash*
+fiftyoneDegreesGraphGetNearestHashFromOrdered(
+	fiftyoneDegreesGraphNodeHash *hashes,
+	uint32_t count,
+	uint32_t hash,
+	uint32_t maxDifference,
+	uint32_t *difference) {
+	uint32_t lower = 0, upper = count, middle, above, below;
+	GraphNodeHash *aboveHash, *belowHash;
+	if (count == 0) {
+		return NULL;
+	}
+
+	// Find the first record with a hash code not less than the hash.
+	while (lower < upper) {
+		middle = lower + ((upper - lower) / 2);
+		if (hashes[middle].hashCode < hash) {
+			lower = middle + 1;
+		}
+		else {
+			upper = middle;
+		}
+	}
+
+	// The nearest record above is the first not less than the hash, or the
+	// first record if adding to the hash wraps around. The nearest record
+	// below is the one before, or the last record if subtracting wraps.
+	aboveHash = lower < count ? &hashes[lower] : &hashes[0];
+	belowHash = lower > 0 ? &hashes[lower - 1] : &hashes[count - 1];
+	above = aboveHash->hashCode - hash;
+	below = hash - belowHash->hashCode;
+	if (above <= below && above <= maxDifference) {
+		*difference = above;
+		return aboveHash;
+	}
+	if (below < above && below <= maxDifference) {
+		*difference = below;
+		return belowHash;
+	}
+	return NULL;
+}
+
 fiftyoneDegreesGraphNodeHash*
 fiftyoneDegreesGraphGetMatchingHashFromBinaryNode(
 	fiftyoneDegreesGraphNode *node,
@@ -253,6 +376,276 @@ fiftyoneDegreesGraphGetMatchingHashFromNode(
 	}
 }
 
+/*
+ * Window hashing kernels. The hash of the window of length L starting at
+ * index m is derived from the prefix hashes P of the characters, where
+ * P[0] = 0 and P[k+1] = P[k]*p + c[k], as:
+ *   h[m] = P[m+L] - P[m]*p^(L)
+ * The prefix hashes are a single serial pass over the characters, after which
+ * every window is independent of the others and can be calculated, and
+ * compared, several lanes at a time. As all the arithmetic is modulo 2^32 the
+ * hash codes are identical to those of the rolling hash.
+ */
+
+#ifndef FIFTYONE_DEGREES_NO_SIMD
+#if (defined(__GNUC__) || defined(__clang__)) && \
+	(defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GRAPH_HASH_X86
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define GRAPH_HASH_X86
+#define TARGET_SSE41
+#define TARGET_AVX2
+#endif
+#endif
+
+static void hashWindowsScalar(
+	const uint32_t *prefix,
+	uint32_t count,
+	byte length,
+	uint32_t *hashes) {
+	const uint32_t power = POWERS[length];
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		hashes[i] = prefix[i + length] - (prefix[i] * power);
+	}
+}
+
+static int32_t hashFindScalar(
+	const uint32_t *hashes,
+	uint32_t count,
+	uint32_t hash) {
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		if (hashes[i] == hash) {
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+#ifdef GRAPH_HASH_X86
+
+/**
+ * Returns the index of the lowest set bit in a non zero mask.
+ */
+static uint32_t lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+TARGET_SSE41 static void hashWindowsSse41(
+	const uint32_t *prefix,
+	uint32_t count,
+	byte length,
+	uint32_t *hashes) {
+	const uint32_t power = POWERS[length];
+	const __m128i powers = _mm_set1_epi32((int)power);
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i start = _mm_loadu_si128((const __m128i*)(prefix + i));
+		const __m128i end = _mm_loadu_si128(
+			(const __m128i*)(prefix + i + length));
+		_mm_storeu_si128(
+			(__m128i*)(hashes + i),
+			_mm_sub_epi32(end, _mm_mullo_epi32(start, powers)));
+	}
+	for (; i < count; i++) {
+		hashes[i] = prefix[i + length] - (prefix[i] * power);
+	}
+}
+
+TARGET_SSE41 static int32_t hashFindSse41(
+	const uint32_t *hashes,
+	uint32_t count,
+	uint32_t hash) {
+	const __m128i target = _mm_set1_epi32((int)hash);
+	uint32_t i = 0, mask;
+	for (; i + 4 <= count; i += 4) {
+		mask = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(
+			_mm_loadu_si128((const __m128i*)(hashes + i)),
+			target)));
+		if (mask != 0) {
+			return (int32_t)(i + lowestBit(mask));
+		}
+	}
+	for (; i < count; i++) {
+		if (hashes[i] == hash) {
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+TARGET_AVX2 static void hashWindowsAvx2(
+	const uint32_t *prefix,
+	uint32_t count,
+	byte length,
+	uint32_t *hashes) {
+	const uint32_t power = POWERS[length];
+	const __m256i powers = _mm256_set1_epi32((int)power);
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i start = _mm256_loadu_si256(
+			(const __m256i*)(prefix + i));
+		const __m256i end = _mm256_loadu_si256(
+			(const __m256i*)(prefix + i + length));
+		_mm256_storeu_si256(
+			(__m256i*)(hashes + i),
+			_mm256_sub_epi32(end, _mm256_mullo_epi32(start, powers)));
+	}
+	for (; i < count; i++) {
+		hashes[i] = prefix[i + length] - (prefix[i] * power);
+	}
+}
+
+TARGET_AVX2 static int32_t hashFindAvx2(
+	const uint32_t *hashes,
+	uint32_t count,
+	uint32_t hash) {
+	const __m256i target = _mm256_set1_epi32((int)hash);
+	uint32_t i = 0, mask;
+	for (; i + 8 <= count; i += 8) {
+		mask = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(
+			_mm256_cmpeq_epi32(
+				_mm256_loadu_si256((const __m256i*)(hashes + i)),
+				target)));
+		if (mask != 0) {
+			return (int32_t)(i + lowestBit(mask));
+		}
+	}
+	for (; i < count; i++) {
+		if (hashes[i] == hash) {
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+static fiftyoneDegreesGraphHashKernel getSupportedKernel() {
+#ifdef _MSC_VER
+	int info[4];
+	bool avx = false;
+	__cpuid(info, 0);
+	if (info[0] < 1) {
+		return FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SCALAR;
+	}
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 19)) == 0) {
+		return FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SCALAR;
+	}
+	// AVX needs both the processor support and the operating system to save
+	// the YMM registers.
+	if ((info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0) {
+		avx = (_xgetbv(0) & 6) == 6;
+	}
+	if (avx) {
+		__cpuid(info, 0);
+		if (info[0] >= 7) {
+			__cpuidex(info, 7, 0);
+			if ((info[1] & (1 << 5)) != 0) {
+				return FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_AVX2;
+			}
+		}
+	}
+	return FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SSE41;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_AVX2;
+	}
+	if (__builtin_cpu_supports("sse4.1")) {
+		return FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SSE41;
+	}
+	return FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SCALAR;
+#endif
+}
+
+#endif
+
+fiftyoneDegreesGraphHashKernel fiftyoneDegreesGraphHashKernelGetBest() {
+#ifdef GRAPH_HASH_X86
+	// The processor is only queried once. Concurrent first calls all store
+	// the same value, so no locking is needed.
+	static volatile int best = -1;
+	if (best < 0) {
+		best = (int)getSupportedKernel();
+	}
+	return (GraphHashKernel)best;
+#else
+	return FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SCALAR;
+#endif
+}
+
+uint32_t fiftyoneDegreesGraphHashWindows(
+	fiftyoneDegreesGraphHashKernel kernel,
+	const char *target,
+	uint32_t firstIndex,
+	uint32_t count,
+	byte length,
+	uint32_t *hashes) {
+	uint32_t prefix[FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS + 129];
+	uint32_t hash = 0, i, characters;
+	const char *current = target + firstIndex;
+	if (count > FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS) {
+		count = FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS;
+	}
+	if (count == 0) {
+		return 0;
+	}
+	// The prefix hashes of every character covered by the windows. This is
+	// the only part which depends on the previous value.
+	characters = count - 1 + length;
+	prefix[0] = 0;
+	for (i = 0; i < characters; i++) {
+		hash *= RK_PRIME;
+		hash += current[i];
+		prefix[i + 1] = hash;
+	}
+	switch (kernel) {
+#ifdef GRAPH_HASH_X86
+	case FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_AVX2:
+		hashWindowsAvx2(prefix, count, length, hashes);
+		break;
+	case FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SSE41:
+		hashWindowsSse41(prefix, count, length, hashes);
+		break;
+#endif
+	case FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SCALAR:
+	default:
+		hashWindowsScalar(prefix, count, length, hashes);
+		break;
+	}
+	return count;
+}
+
+int32_t fiftyoneDegreesGraphHashFind(
+	fiftyoneDegreesGraphHashKernel kernel,
+	const uint32_t *hashes,
+	uint32_t count,
+	uint32_t hash) {
+	switch (kernel) {
+#ifdef GRAPH_HASH_X86
+	case FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_AVX2:
+		return hashFindAvx2(hashes, count, hash);
+	case FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SSE41:
+		return hashFindSse41(hashes, count, hash);
+#endif
+	case FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SCALAR:
+	default:
+		return hashFindScalar(hashes, count, hash);
+	}
+}
+
 fiftyoneDegreesGraphTraceNode* fiftyoneDegreesGraphTraceCreate(
 	const char* fmt,
 	...) {
@@ -396,3 +789,1092 @@ int fiftyoneDegreesGraphTraceGet(
 	}
 	return written;
 }
+
+/*
+ * Flat graph compilation. The nodes are read from the collection to find the
+ * offset of each one, optionally walked breadth first from the roots to decide
+ * the order to place them in, and then copied into the block. The offsets of
+ * the nodes in the collection and the block are recorded in two arrays in
+ * source order so that the node offsets held in the copied nodes can be
+ * rewritten.
+ */
+
+/**
+ * Padding after the start of a cache line needed for the hash records which
+ * follow a node header to be 8 byte aligned.
+ */
+#define FLAT_NODE_PADDING ((8 - (sizeof(GraphNode) % 8)) % 8)
+
+static uint32_t getNodeSize(const GraphNode *node) {
+	return (uint32_t)(sizeof(GraphNode) +
+		((uint32_t)node->hashesCount * sizeof(GraphNodeHash)));
+}
+
+/**
+ * Gets the offset in the block for a node which would otherwise be placed at
+ * the offset provided.
+ */
+static uint64_t getFlatNodeOffset(uint64_t offset) {
+	uint64_t lineOffset;
+	// Align the hash records which follow the node header to 8 bytes.
+	offset += (8 - ((offset + sizeof(GraphNode)) % 8)) % 8;
+	// If the header and the first hash record would span two cache lines then
+	// start the node in the next one.
+	lineOffset = offset % GRAPH_FLAT_LINE;
+	if (lineOffset + sizeof(GraphNode) + sizeof(GraphNodeHash) >
+		GRAPH_FLAT_LINE) {
+		offset += GRAPH_FLAT_LINE - lineOffset + FLAT_NODE_PADDING;
+	}
+	return offset;
+}
+
+/**
+ * Gets the node at the offset in the source collection, checking that its
+ * hash records are within the length of the nodes.
+ */
+static GraphNode* getSourceNode(
+	Collection *collection,
+	uint32_t offset,
+	uint32_t length,
+	Item *item,
+	Exception *exception) {
+	GraphNode *node = GraphGetNode(collection, offset, item, exception);
+	if (node == NULL || EXCEPTION_FAILED) {
+		if (EXCEPTION_OKAY) {
+			EXCEPTION_SET(COLLECTION_FAILURE);
+		}
+		node = NULL;
+	}
+	else if (node->hashesCount < 0 ||
+		(uint64_t)offset + getNodeSize(node) > length) {
+		COLLECTION_RELEASE(collection, item);
+		EXCEPTION_SET(CORRUPT_DATA);
+		node = NULL;
+	}
+	return node;
+}
+
+/**
+ * Gets the index of the source offset in the ordered array of source offsets,
+ * or count if the source offset is not present.
+ */
+static uint32_t findSourceIndex(
+	const uint32_t *sources,
+	uint32_t count,
+	uint32_t source) {
+	uint32_t lower = 0, upper = count, middle;
+	while (lower < upper) {
+		middle = lower + ((upper - lower) / 2);
+		if (sources[middle] < source) {
+			lower = middle + 1;
+		}
+		else {
+			upper = middle;
+		}
+	}
+	return lower < count && sources[lower] == source ? lower : count;
+}
+
+/**
+ * Finds the target offset for the source offset in the ordered arrays of
+ * offsets, returning zero if the source offset is not present.
+ */
+static uint32_t findFlatOffset(
+	const uint32_t *sources,
+	const uint32_t *targets,
+	uint32_t count,
+	uint32_t source) {
+	const uint32_t index = findSourceIndex(sources, count, source);
+	return index < count ? targets[index] : 0;
+}
+
+/**
+ * Returns the offset in the block for a node offset from the source, leaving
+ * leaf offsets unchanged. Sets valid to false if the offset is not that of a
+ * node.
+ */
+static int32_t getFlatNodeOffsetFromSource(
+	int32_t offset,
+	const uint32_t *sources,
+	const uint32_t *targets,
+	uint32_t count,
+	bool *valid) {
+	uint32_t target;
+	if (offset > 0) {
+		target = findFlatOffset(sources, targets, count, (uint32_t)offset);
+		if (target == 0) {
+			*valid = false;
+		}
+		offset = (int32_t)target;
+	}
+	return offset;
+}
+
+/**
+ * Rewrites the node offsets in the node as offsets in the block.
+ */
+static bool setFlatNodeOffsets(
+	GraphNode *node,
+	const uint32_t *sources,
+	const uint32_t *targets,
+	uint32_t count) {
+	int32_t i;
+	bool valid = true;
+	GraphNodeHash *hashes = (GraphNodeHash*)(node + 1);
+	// A single record is always evaluated as a binary node, whatever the
+	// modulo.
+	const bool isTable = node->hashesCount > 1 &&
+		GRAPH_NODE_IS_HASH_TABLE(node);
+	node->unmatchedNodeOffset = getFlatNodeOffsetFromSource(
+		node->unmatchedNodeOffset,
+		sources,
+		targets,
+		count,
+		&valid);
+	for (i = 0; i < node->hashesCount; i++) {
+		// A marker in a hash table holds an index into the records of this
+		// node rather than a node offset, so is left unchanged.
+		if (isTable == false || hashes[i].hashCode != 0) {
+			hashes[i].nodeOffset = getFlatNodeOffsetFromSource(
+				hashes[i].nodeOffset,
+				sources,
+				targets,
+				count,
+				&valid);
+		}
+	}
+	return valid;
+}
+
+/**
+ * Gets the number of bytes needed after the hash records of the node for the
+ * ordered copy of the records, or zero if the node is not a hash table or no
+ * difference is allowed so the copy is never searched.
+ */
+static uint32_t getOrderedSize(const GraphNode *node, int32_t difference) {
+	int32_t i;
+	uint32_t count = 0;
+	const GraphNodeHash *hashes = (const GraphNodeHash*)(node + 1);
+	if (difference <= 0 ||
+		node->hashesCount <= 1 ||
+		GRAPH_NODE_IS_HASH_TABLE(node) == false) {
+		return 0;
+	}
+	for (i = 0; i < node->hashesCount; i++) {
+		if (hashes[i].hashCode != 0) {
+			count++;
+		}
+	}
+	return (uint32_t)(sizeof(GraphNodeOrdered) +
+		(count * sizeof(GraphNodeHash)));
+}
+
+/**
+ * Gets the number of bytes needed after the hash records of the node for the
+ * hash codes laid out to be searched, or zero if the node is not an ordered
+ * list or the layout is not needed.
+ */
+static uint32_t getSearchSize(const GraphNode *node, bool searchLayout) {
+	uint32_t count = (uint32_t)node->hashesCount;
+	if (searchLayout == false || node->modulo != 0 || node->hashesCount <= 1) {
+		return 0;
+	}
+	if (count <= GRAPH_SEARCH_LINEAR_MAX) {
+		return (uint32_t)(sizeof(GraphNodeSearch) + count * sizeof(uint32_t));
+	}
+	return (uint32_t)(sizeof(GraphNodeSearch) +
+		2 * (count + 1) * sizeof(uint32_t));
+}
+
+/**
+ * Gets the number of bytes needed after the hash records of the node for the
+ * modulo constant, or zero if the node is not a hash table or the constant is
+ * not needed.
+ */
+static uint32_t getModuloSize(const GraphNode *node, bool fastModulo) {
+	if (fastModulo == false ||
+		node->hashesCount <= 1 ||
+		GRAPH_NODE_IS_HASH_TABLE(node) == false) {
+		return 0;
+	}
+	return (uint32_t)sizeof(GraphNodeModulo);
+}
+
+static int compareHashCodes(const void *a, const void *b) {
+	const GraphNodeHash *first = (const GraphNodeHash*)a;
+	const GraphNodeHash *second = (const GraphNodeHash*)b;
+	if (first->hashCode != second->hashCode) {
+		return first->hashCode < second->hashCode ? -1 : 1;
+	}
+	return first->nodeOffset < second->nodeOffset ? -1 :
+		(first->nodeOffset > second->nodeOffset ? 1 : 0);
+}
+
+/**
+ * Sets the modulo constant of the hash table node. Must be set before the
+ * ordered copy of the records, which follows it.
+ */
+static void setFlatNodeModulo(GraphNode *node) {
+	GRAPH_NODE_MODULO(node)->multiplier =
+		(UINT64_MAX / (uint32_t)node->modulo) + 1;
+	node->flags = (byte)(node->flags | GRAPH_NODE_FLAG_MODULO);
+}
+
+/**
+ * Copies the hash records of the hash table node, excluding markers, to the
+ * space after the records and orders them by hash code so that the nearest
+ * hash code to a hash can be found with a binary search. The node offsets
+ * must already have been rewritten.
+ */
+static void setFlatNodeOrdered(GraphNode *node) {
+	int32_t i;
+	const GraphNodeHash *hashes = (const GraphNodeHash*)(node + 1);
+	GraphNodeOrdered *ordered = GRAPH_NODE_ORDERED(node);
+	GraphNodeHash *orderedHashes = (GraphNodeHash*)(ordered + 1);
+	ordered->count = 0;
+	ordered->reserved = 0;
+	for (i = 0; i < node->hashesCount; i++) {
+		if (hashes[i].hashCode != 0) {
+			orderedHashes[ordered->count++] = hashes[i];
+		}
+	}
+	qsort(
+		orderedHashes,
+		ordered->count,
+		sizeof(GraphNodeHash),
+		compareHashCodes);
+	node->flags = (byte)(node->flags | GRAPH_NODE_FLAG_ORDERED);
+}
+
+/**
+ * Copies the hash codes of the sorted records to the Eytzinger positions of
+ * the subtree at index k, in order, recording the index of the record each
+ * came from. Returns the index of the next record to copy.
+ */
+static uint32_t setEytzinger(
+	const GraphNodeHash *hashes,
+	uint32_t count,
+	uint32_t *codes,
+	uint32_t *indexes,
+	uint32_t next,
+	uint32_t k) {
+	if (k <= count) {
+		next = setEytzinger(hashes, count, codes, indexes, next, 2 * k);
+		codes[k] = hashes[next].hashCode;
+		indexes[k] = next;
+		next = setEytzinger(hashes, count, codes, indexes, next + 1, 2 * k + 1);
+	}
+	return next;
+}
+
+/**
+ * Copies the hash codes of the ordered list node to the space after the
+ * records. Nodes with few records keep the order of the records, so the hash
+ * codes can be compared a lane at a time. Others use Eytzinger order, which
+ * keeps the hash codes a binary search compares first close together.
+ */
+static void setFlatNodeSearch(GraphNode *node) {
+	int32_t i;
+	const GraphNodeHash *hashes = (const GraphNodeHash*)(node + 1);
+	GraphNodeSearch *search = GRAPH_NODE_SEARCH(node);
+	uint32_t *codes = (uint32_t*)(search + 1);
+	search->count = (uint32_t)node->hashesCount;
+	search->eytzinger = search->count > GRAPH_SEARCH_LINEAR_MAX ? 1 : 0;
+	if (search->eytzinger == 0) {
+		for (i = 0; i < node->hashesCount; i++) {
+			codes[i] = hashes[i].hashCode;
+		}
+	}
+	else {
+		codes[0] = 0;
+		codes[search->count + 1] = 0;
+		setEytzinger(
+			hashes,
+			search->count,
+			codes,
+			codes + search->count + 1,
+			0,
+			1);
+	}
+	node->flags = (byte)(node->flags | GRAPH_NODE_FLAG_SEARCH);
+}
+
+static int compareOffsets(const void *a, const void *b) {
+	const uint32_t first = *(const uint32_t*)a, second = *(const uint32_t*)b;
+	return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+/**
+ * Records the ordered and distinct root node offsets, and their offsets in
+ * the block. Returns false if a root node offset is not that of a node.
+ */
+static bool setFlatRootOffsets(
+	GraphFlat *flat,
+	const uint32_t *rootOffsets,
+	uint32_t rootsCount,
+	const uint32_t *sources,
+	const uint32_t *targets,
+	uint32_t count) {
+	uint32_t i;
+	bool valid = true;
+	memcpy(flat->rootSourceOffsets, rootOffsets, rootsCount * sizeof(uint32_t));
+	qsort(flat->rootSourceOffsets, rootsCount, sizeof(uint32_t), compareOffsets);
+	for (i = 0; i < rootsCount && valid; i++) {
+		if (flat->rootsCount == 0 ||
+			flat->rootSourceOffsets[flat->rootsCount - 1] !=
+			flat->rootSourceOffsets[i]) {
+			flat->rootSourceOffsets[flat->rootsCount] =
+				flat->rootSourceOffsets[i];
+			flat->rootOffsets[flat->rootsCount] = findFlatOffset(
+				sources,
+				targets,
+				count,
+				flat->rootSourceOffsets[i]);
+			valid = flat->rootOffsets[flat->rootsCount] != 0;
+			flat->rootsCount++;
+		}
+	}
+	return valid;
+}
+
+/**
+ * Adds the node at the index to the end of the order if it has not already
+ * been added.
+ */
+static void addToOrder(
+	uint32_t index,
+	uint32_t count,
+	uint32_t *order,
+	uint32_t *ordered,
+	byte *added) {
+	if (index < count && added[index] == 0) {
+		added[index] = 1;
+		order[(*ordered)++] = index;
+	}
+}
+
+/**
+ * Sets the order to place the nodes in the block to breadth first from the
+ * root nodes. The nodes nearest the roots are evaluated for most detections,
+ * so are then close together in memory rather than spread across the whole
+ * block. Nodes which can't be reached from a root follow in source order, and
+ * the number of nodes which can be reached is set in reachable.
+ */
+static bool setBreadthFirstOrder(
+	Collection *collection,
+	uint32_t length,
+	const uint32_t *rootOffsets,
+	uint32_t rootsCount,
+	const uint32_t *sources,
+	uint32_t count,
+	uint32_t *order,
+	uint32_t *reachable,
+	Exception *exception) {
+	Item item;
+	GraphNode *node;
+	GraphNodeHash *hashes;
+	bool isTable, valid = true;
+	uint32_t i, next = 0, ordered = 0;
+	int32_t h;
+	byte *added = (byte*)Malloc(count);
+	if (added == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		return false;
+	}
+	memset(added, 0, count);
+	DataReset(&item.data);
+	for (i = 0; i < rootsCount; i++) {
+		addToOrder(
+			findSourceIndex(sources, count, rootOffsets[i]),
+			count,
+			order,
+			&ordered,
+			added);
+	}
+	while (valid && next < ordered) {
+		node = getSourceNode(
+			collection,
+			sources[order[next]],
+			length,
+			&item,
+			exception);
+		valid = node != NULL;
+		if (valid) {
+			hashes = (GraphNodeHash*)(node + 1);
+			// A marker in a hash table holds an index into the records of
+			// the node rather than a node offset.
+			isTable = node->hashesCount > 1 && GRAPH_NODE_IS_HASH_TABLE(node);
+			for (h = 0; h < node->hashesCount; h++) {
+				if ((isTable == false || hashes[h].hashCode != 0) &&
+					hashes[h].nodeOffset > 0) {
+					addToOrder(
+						findSourceIndex(
+							sources,
+							count,
+							(uint32_t)hashes[h].nodeOffset),
+						count,
+						order,
+						&ordered,
+						added);
+				}
+			}
+			if (node->unmatchedNodeOffset > 0) {
+				addToOrder(
+					findSourceIndex(
+						sources,
+						count,
+						(uint32_t)node->unmatchedNodeOffset),
+					count,
+					order,
+					&ordered,
+					added);
+			}
+			COLLECTION_RELEASE(collection, &item);
+			next++;
+		}
+	}
+	*reachable = ordered;
+	for (i = 0; i < count; i++) {
+		addToOrder(i, count, order, &ordered, added);
+	}
+	Free(added);
+	return valid;
+}
+
+fiftyoneDegreesGraphFlat* fiftyoneDegreesGraphFlatCreate(
+	fiftyoneDegreesCollection *collection,
+	uint32_t length,
+	const uint32_t *rootOffsets,
+	uint32_t rootsCount,
+	bool breadthFirst,
+	bool searchLayout,
+	bool fastModulo,
+	bool prune,
+	int32_t difference,
+	fiftyoneDegreesException *exception) {
+	Item item;
+	GraphNode *node;
+	GraphFlat *flat;
+	uint32_t *sources, *targets, *order, *appendedSizes;
+	uint32_t i, count = 0, sourceOffset = 0, placed = 0;
+	bool valid;
+	// Offset zero indicates a leaf, so is never used for a node.
+	uint64_t flatOffset = 1;
+	DataReset(&item.data);
+
+	if (length == 0) {
+		EXCEPTION_SET(CORRUPT_DATA);
+		return NULL;
+	}
+
+	// Count the nodes.
+	do {
+		node = getSourceNode(collection, sourceOffset, length, &item, exception);
+		if (node != NULL) {
+			sourceOffset += getNodeSize(node);
+			count++;
+			COLLECTION_RELEASE(collection, &item);
+		}
+	} while (node != NULL && sourceOffset < length);
+	if (node == NULL) {
+		return NULL;
+	}
+
+	// Allocate the flat graph and the temporary arrays.
+	flat = (GraphFlat*)Malloc(sizeof(GraphFlat));
+	if (flat == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		return NULL;
+	}
+	flat->nodes = NULL;
+	flat->size = 0;
+	flat->count = count;
+	flat->rootsCount = 0;
+	flat->rootSourceOffsets = NULL;
+	flat->rootOffsets = NULL;
+	flat->generation = 0;
+	MappedFileReset(&flat->segment);
+	if (rootsCount > 0) {
+		flat->rootSourceOffsets = (uint32_t*)Malloc(
+			rootsCount * sizeof(uint32_t));
+		flat->rootOffsets = (uint32_t*)Malloc(rootsCount * sizeof(uint32_t));
+	}
+	sources = (uint32_t*)Malloc(count * sizeof(uint32_t));
+	targets = (uint32_t*)Malloc(count * sizeof(uint32_t));
+	order = (uint32_t*)Malloc(count * sizeof(uint32_t));
+	appendedSizes = (uint32_t*)Malloc(count * sizeof(uint32_t));
+	valid = (rootsCount == 0 || (
+			flat->rootSourceOffsets != NULL &&
+			flat->rootOffsets != NULL)) &&
+		sources != NULL &&
+		targets != NULL &&
+		order != NULL &&
+		appendedSizes != NULL;
+	if (valid == false) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+	}
+
+	// Record the offset of each node in the source, and the space needed for
+	// the modulo constant and ordered copy of the records of hash table nodes
+	// or the hash codes of ordered list nodes.
+	sourceOffset = 0;
+	for (i = 0; i < count && valid; i++) {
+		node = getSourceNode(collection, sourceOffset, length, &item, exception);
+		valid = node != NULL;
+		if (valid) {
+			sources[i] = sourceOffset;
+			appendedSizes[i] = node->modulo == 0 ?
+				getSearchSize(node, searchLayout) :
+				getModuloSize(node, fastModulo) +
+				getOrderedSize(node, difference);
+			sourceOffset += getNodeSize(node);
+			COLLECTION_RELEASE(collection, &item);
+		}
+	}
+
+	// Work out the order to place the nodes in the block.
+	if (valid) {
+		if (breadthFirst || prune) {
+			valid = setBreadthFirstOrder(
+				collection,
+				length,
+				rootOffsets,
+				rootsCount,
+				sources,
+				count,
+				order,
+				&placed,
+				exception);
+		}
+		else {
+			for (i = 0; i < count; i++) {
+				order[i] = i;
+			}
+		}
+		if (prune == false) {
+			placed = count;
+		}
+	}
+
+	// Place the nodes in order working out the size of the block. The size of
+	// a node is the distance to the next one in the source, plus the space
+	// for anything appended to the records. Nodes which are not placed keep
+	// a target of zero.
+	if (valid) {
+		flat->count = placed;
+		memset(targets, 0, count * sizeof(uint32_t));
+		for (i = 0; i < placed && flatOffset <= INT32_MAX; i++) {
+			flatOffset = getFlatNodeOffset(flatOffset);
+			targets[order[i]] = (uint32_t)flatOffset;
+			flatOffset += (order[i] + 1 < count ?
+				sources[order[i] + 1] :
+				length) - sources[order[i]];
+			flatOffset += appendedSizes[order[i]];
+		}
+		if (flatOffset > INT32_MAX) {
+			// Node offsets are signed 32 bit integers so could not address
+			// the whole block.
+			EXCEPTION_SET(INSUFFICIENT_MEMORY);
+			valid = false;
+		}
+	}
+
+	// Allocate the block and copy the nodes into their places.
+	if (valid) {
+		flat->size = (uint32_t)flatOffset;
+		flat->nodes = (byte*)MallocAligned(GRAPH_FLAT_LINE, flat->size);
+		if (flat->nodes == NULL) {
+			EXCEPTION_SET(INSUFFICIENT_MEMORY);
+			valid = false;
+		}
+		else {
+			memset(flat->nodes, 0, flat->size);
+		}
+	}
+	for (i = 0; i < count && valid; i++) {
+		if (targets[i] == 0) {
+			continue;
+		}
+		node = getSourceNode(collection, sources[i], length, &item, exception);
+		valid = node != NULL;
+		if (valid) {
+			memcpy(flat->nodes + targets[i], node, getNodeSize(node));
+			COLLECTION_RELEASE(collection, &item);
+
+			// Only nodes with something appended to the records have a flag.
+			node = GRAPH_FLAT_NODE(flat, targets[i]);
+			node->flags = (byte)(node->flags &
+				~(GRAPH_NODE_FLAG_ORDERED |
+				GRAPH_NODE_FLAG_SEARCH |
+				GRAPH_NODE_FLAG_MODULO));
+		}
+	}
+
+	// Rewrite the node offsets now every node has a place in the block.
+	for (i = 0; i < count && valid; i++) {
+		if (targets[i] == 0) {
+			continue;
+		}
+		valid = setFlatNodeOffsets(
+			GRAPH_FLAT_NODE(flat, targets[i]),
+			sources,
+			targets,
+			count);
+		if (valid == false) {
+			EXCEPTION_SET(CORRUPT_DATA);
+		}
+	}
+	for (i = 0; i < count && valid; i++) {
+		if (appendedSizes[i] > 0 && targets[i] != 0) {
+			node = GRAPH_FLAT_NODE(flat, targets[i]);
+			if (node->modulo == 0) {
+				setFlatNodeSearch(node);
+			}
+			else {
+				if (getModuloSize(node, fastModulo) > 0) {
+					setFlatNodeModulo(node);
+				}
+				if (getOrderedSize(node, difference) > 0) {
+					setFlatNodeOrdered(node);
+				}
+			}
+		}
+	}
+	if (valid) {
+		valid = setFlatRootOffsets(
+			flat,
+			rootOffsets,
+			rootsCount,
+			sources,
+			targets,
+			count);
+		if (valid == false) {
+			EXCEPTION_SET(CORRUPT_DATA);
+		}
+	}
+
+	if (sources != NULL) {
+		Free(sources);
+	}
+	if (targets != NULL) {
+		Free(targets);
+	}
+	if (order != NULL) {
+		Free(order);
+	}
+	if (appendedSizes != NULL) {
+		Free(appendedSizes);
+	}
+	if (valid == false) {
+		GraphFlatFree(flat);
+		flat = NULL;
+	}
+	return flat;
+}
+
+uint32_t fiftyoneDegreesGraphFlatGetRootOffset(
+	const fiftyoneDegreesGraphFlat *flat,
+	uint32_t sourceOffset) {
+	return findFlatOffset(
+		flat->rootSourceOffsets,
+		flat->rootOffsets,
+		flat->rootsCount,
+		sourceOffset);
+}
+
+/**
+ * Opens the file for writing in binary mode.
+ */
+static FILE* openForWrite(const char *fileName) {
+#ifdef _MSC_VER
+	FILE *file = NULL;
+	if (fopen_s(&file, fileName, "wb") != 0) {
+		return NULL;
+	}
+	return file;
+#else
+	return fopen(fileName, "wb");
+#endif
+}
+
+/**
+ * Writes zeros to the file until it is the length provided.
+ */
+static bool writePadding(FILE *file, long length) {
+	static const byte zeros[GRAPH_FLAT_LINE] = { 0 };
+	long current = ftell(file);
+	size_t padding;
+	if (current < 0 || current > length ||
+		length - current > (long)sizeof(zeros)) {
+		return false;
+	}
+	padding = (size_t)(length - current);
+	return padding == 0 || fwrite(zeros, 1, padding, file) == padding;
+}
+
+/**
+ * Replaces the file at the path with the temporary file.
+ */
+static bool replaceFile(const char *tempName, const char *fileName) {
+#ifdef _MSC_VER
+	return MoveFileExA(tempName, fileName, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(tempName, fileName) == 0;
+#endif
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesGraphFlatSave(
+	const fiftyoneDegreesGraphFlat *flat,
+	const char *fileName,
+	uint32_t options,
+	uint64_t source) {
+	char tempName[FILE_MAX_PATH];
+	GraphFlatSegment segment;
+	FILE *file;
+	bool written;
+	if (flat->segment.startByte != NULL) {
+		// An attached graph is already in a segment.
+		return INVALID_INPUT;
+	}
+	if (snprintf(tempName, sizeof(tempName), "%s.tmp", fileName) >=
+		(int)sizeof(tempName)) {
+		return INVALID_INPUT;
+	}
+	memset(&segment, 0, sizeof(GraphFlatSegment));
+	segment.magic = GRAPH_FLAT_SEGMENT_MAGIC;
+	segment.version = GRAPH_FLAT_SEGMENT_VERSION;
+	segment.generation = GraphFlatGetGeneration(fileName) + 1;
+	if (segment.generation == 0) {
+		// Zero means there is no segment, so is never used.
+		segment.generation = 1;
+	}
+	segment.options = options;
+	segment.source = source;
+	segment.size = flat->size;
+	segment.count = flat->count;
+	segment.rootsCount = flat->rootsCount;
+	segment.nodesOffset = GRAPH_FLAT_LINE;
+	segment.rootsOffset = (segment.nodesOffset + flat->size + 3) & ~3U;
+	if (segment.rootsOffset < flat->size) {
+		// The segment would be too large to describe with 32 bit offsets.
+		return INSUFFICIENT_MEMORY;
+	}
+
+	file = openForWrite(tempName);
+	if (file == NULL) {
+		return FILE_WRITE_ERROR;
+	}
+	written =
+		fwrite(&segment, sizeof(GraphFlatSegment), 1, file) == 1 &&
+		writePadding(file, (long)segment.nodesOffset) &&
+		fwrite(flat->nodes, 1, flat->size, file) == flat->size &&
+		writePadding(file, (long)segment.rootsOffset) &&
+		fwrite(
+			flat->rootSourceOffsets,
+			sizeof(uint32_t),
+			flat->rootsCount,
+			file) == flat->rootsCount &&
+		fwrite(
+			flat->rootOffsets,
+			sizeof(uint32_t),
+			flat->rootsCount,
+			file) == flat->rootsCount;
+	written = fclose(file) == 0 && written;
+	if (written == false || replaceFile(tempName, fileName) == false) {
+		remove(tempName);
+		return FILE_WRITE_ERROR;
+	}
+	return SUCCESS;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesGraphFlatAttach(
+	const char *fileName,
+	uint32_t options,
+	uint64_t source,
+	fiftyoneDegreesGraphFlat **flat) {
+	const GraphFlatSegment *segment;
+	GraphFlat *attached;
+	StatusCode status;
+	*flat = NULL;
+	attached = (GraphFlat*)Malloc(sizeof(GraphFlat));
+	if (attached == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+	status = MappedFileOpen(&attached->segment, fileName, false);
+	if (status != SUCCESS) {
+		Free(attached);
+		return status;
+	}
+
+	// Check the segment is for the same graph, and that everything it
+	// describes is within the mapping.
+	segment = (const GraphFlatSegment*)attached->segment.startByte;
+	if (attached->segment.length < sizeof(GraphFlatSegment) ||
+		segment->magic != GRAPH_FLAT_SEGMENT_MAGIC ||
+		segment->version != GRAPH_FLAT_SEGMENT_VERSION) {
+		status = CORRUPT_DATA;
+	}
+	else if (segment->options != options || segment->source != source) {
+		status = INCORRECT_VERSION;
+	}
+	else if (segment->nodesOffset % GRAPH_FLAT_LINE != 0 ||
+		(uint64_t)segment->nodesOffset + segment->size >
+			attached->segment.length ||
+		segment->rootsOffset % sizeof(uint32_t) != 0 ||
+		(uint64_t)segment->rootsOffset +
+			(2 * (uint64_t)segment->rootsCount * sizeof(uint32_t)) >
+			attached->segment.length) {
+		status = CORRUPT_DATA;
+	}
+	if (status != SUCCESS) {
+		MappedFileClose(&attached->segment);
+		Free(attached);
+		return status;
+	}
+
+	attached->nodes = attached->segment.startByte + segment->nodesOffset;
+	attached->size = segment->size;
+	attached->count = segment->count;
+	attached->rootsCount = segment->rootsCount;
+	attached->rootSourceOffsets = (uint32_t*)(
+		attached->segment.startByte + segment->rootsOffset);
+	attached->rootOffsets = attached->rootSourceOffsets + segment->rootsCount;
+	attached->generation = segment->generation;
+	*flat = attached;
+	return SUCCESS;
+}
+
+uint32_t fiftyoneDegreesGraphFlatGetGeneration(const char *fileName) {
+	GraphFlatSegment segment;
+	uint32_t generation = 0;
+	FILE *file;
+	if (FileOpen(fileName, &file) == SUCCESS) {
+		if (fread(&segment, sizeof(GraphFlatSegment), 1, file) == 1 &&
+			segment.magic == GRAPH_FLAT_SEGMENT_MAGIC &&
+			segment.version == GRAPH_FLAT_SEGMENT_VERSION) {
+			generation = segment.generation;
+		}
+		fclose(file);
+	}
+	return generation;
+}
+
+void fiftyoneDegreesGraphFlatFree(fiftyoneDegreesGraphFlat *flat) {
+	if (flat->segment.startByte != NULL) {
+		// The nodes and root offsets are in the mapping of the segment.
+		MappedFileClose(&flat->segment);
+		Free(flat);
+		return;
+	}
+	if (flat->nodes != NULL) {
+		FreeAligned(flat->nodes);
+	}
+	if (flat->rootSourceOffsets != NULL) {
+		Free(flat->rootSourceOffsets);
+	}
+	if (flat->rootOffsets != NULL) {
+		Free(flat->rootOffsets);
+	}
+	Free(flat);
+}
+
+byte* fiftyoneDegreesGraphTrim(
+	fiftyoneDegreesCollection *collection,
+	uint32_t length,
+	uint32_t *rootOffsets,
+	uint32_t rootsCount,
+	int32_t *unmatchedOffsets,
+	uint32_t unmatchedCount,
+	uint32_t *trimmedLength,
+	uint32_t *trimmedCount,
+	fiftyoneDegreesException *exception) {
+	Item item;
+	GraphNode *node;
+	uint32_t *sources, *targets, *order;
+	uint32_t i, count = 0, sourceOffset = 0, placed = 0;
+	uint64_t trimmedOffset;
+	byte *nodes = NULL;
+	bool valid;
+	// Any other reference to offset zero is a leaf, so the marker node is
+	// placed there followed by the nodes which never match, ahead of the
+	// nodes copied. Only root nodes reference the nodes which never match.
+	const uint32_t emptySize = (uint32_t)(
+		sizeof(GraphNode) + sizeof(GraphNodeHash));
+	const uint32_t emptyCount = unmatchedCount + 1;
+	DataReset(&item.data);
+
+	if (length == 0 || unmatchedCount == 0) {
+		EXCEPTION_SET(CORRUPT_DATA);
+		return NULL;
+	}
+
+	// Count the nodes.
+	do {
+		node = getSourceNode(collection, sourceOffset, length, &item, exception);
+		if (node != NULL) {
+			sourceOffset += getNodeSize(node);
+			count++;
+			COLLECTION_RELEASE(collection, &item);
+		}
+	} while (node != NULL && sourceOffset < length);
+	if (node == NULL) {
+		return NULL;
+	}
+
+	// Record the offset of each node in the source.
+	sources = (uint32_t*)Malloc(count * sizeof(uint32_t));
+	targets = (uint32_t*)Malloc(count * sizeof(uint32_t));
+	order = (uint32_t*)Malloc(count * sizeof(uint32_t));
+	valid = sources != NULL && targets != NULL && order != NULL;
+	if (valid == false) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+	}
+	sourceOffset = 0;
+	for (i = 0; i < count && valid; i++) {
+		node = getSourceNode(collection, sourceOffset, length, &item, exception);
+		valid = node != NULL;
+		if (valid) {
+			sources[i] = sourceOffset;
+			sourceOffset += getNodeSize(node);
+			COLLECTION_RELEASE(collection, &item);
+		}
+	}
+
+	// Find the nodes which can be reached from the root nodes.
+	if (valid) {
+		valid = setBreadthFirstOrder(
+			collection,
+			length,
+			rootOffsets,
+			rootsCount,
+			sources,
+			count,
+			order,
+			&placed,
+			exception);
+	}
+
+	// Keep the reached nodes in the same order as in the source, after the
+	// marker and the nodes which never match. Nodes which are not kept have a
+	// target of zero.
+	if (valid) {
+		memset(targets, 0, count * sizeof(uint32_t));
+		for (i = 0; i < placed; i++) {
+			targets[order[i]] = 1;
+		}
+		trimmedOffset = (uint64_t)emptySize * emptyCount;
+		for (i = 0; i < count && trimmedOffset <= INT32_MAX; i++) {
+			if (targets[i] != 0) {
+				targets[i] = (uint32_t)trimmedOffset;
+				trimmedOffset += (i + 1 < count ? sources[i + 1] : length) -
+					sources[i];
+			}
+		}
+		if (trimmedOffset > INT32_MAX) {
+			EXCEPTION_SET(INSUFFICIENT_MEMORY);
+			valid = false;
+		}
+	}
+
+	// Copy the nodes into their places and rewrite the node offsets.
+	if (valid) {
+		nodes = (byte*)Malloc((size_t)trimmedOffset);
+		valid = nodes != NULL;
+		if (valid == false) {
+			EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		}
+	}
+	if (valid) {
+		// Binary nodes with a first character index no evidence reaches, so
+		// that they never match and always move on to their leaf. The first
+		// is the marker, whose leaf is the number of nodes which follow it.
+		memset(nodes, 0, (size_t)emptySize * emptyCount);
+		for (i = 0; i < emptyCount; i++) {
+			node = (GraphNode*)(nodes + (size_t)emptySize * i);
+			node->firstIndex = INT16_MAX;
+			node->lastIndex = INT16_MAX;
+			node->length = 1;
+			node->hashesCount = 1;
+			if (i == 0) {
+				node->unmatchedNodeOffset = -(int32_t)unmatchedCount;
+				((GraphNodeHash*)(node + 1))->hashCode = GRAPH_TRIM_MARKER;
+			}
+			else {
+				node->unmatchedNodeOffset = unmatchedOffsets[i - 1];
+				unmatchedOffsets[i - 1] = (int32_t)(emptySize * i);
+			}
+		}
+		*trimmedLength = (uint32_t)trimmedOffset;
+		*trimmedCount = placed + emptyCount;
+	}
+	for (i = 0; i < count && valid; i++) {
+		if (targets[i] == 0) {
+			continue;
+		}
+		node = getSourceNode(collection, sources[i], length, &item, exception);
+		valid = node != NULL;
+		if (valid) {
+			memcpy(nodes + targets[i], node, getNodeSize(node));
+			COLLECTION_RELEASE(collection, &item);
+			valid = setFlatNodeOffsets(
+				(GraphNode*)(nodes + targets[i]),
+				sources,
+				targets,
+				count);
+			if (valid == false) {
+				EXCEPTION_SET(CORRUPT_DATA);
+			}
+		}
+	}
+	for (i = 0; i < rootsCount && valid; i++) {
+		rootOffsets[i] = findFlatOffset(sources, targets, count, rootOffsets[i]);
+		if (rootOffsets[i] == 0) {
+			EXCEPTION_SET(CORRUPT_DATA);
+			valid = false;
+		}
+	}
+
+	if (sources != NULL) {
+		Free(sources);
+	}
+	if (targets != NULL) {
+		Free(targets);
+	}
+	if (order != NULL) {
+		Free(order);
+	}
+	if (valid == false && nodes != NULL) {
+		Free(nodes);
+		nodes = NULL;
+	}
+	return nodes;
+}
+
+uint32_t fiftyoneDegreesGraphGetTrimmedStart(
+	fiftyoneDegreesCollection *collection,
+	uint32_t length,
+	fiftyoneDegreesException *exception) {
+	Item item;
+	GraphNode *node;
+	uint64_t start = 0;
+	const uint32_t emptySize = (uint32_t)(
+		sizeof(GraphNode) + sizeof(GraphNodeHash));
+	if (length < emptySize) {
+		return 0;
+	}
+	DataReset(&item.data);
+	node = getSourceNode(collection, 0, length, &item, exception);
+	if (node == NULL) {
+		return 0;
+	}
+	if (node->hashesCount == 1 &&
+		node->firstIndex == INT16_MAX &&
+		node->lastIndex == INT16_MAX &&
+		node->unmatchedNodeOffset <= 0 &&
+		((GraphNodeHash*)(node + 1))->hashCode == GRAPH_TRIM_MARKER) {
+		start = (uint64_t)emptySize *
+			((uint64_t)-(int64_t)node->unmatchedNodeOffset + 1);
+	}
+	COLLECTION_RELEASE(collection, &item);
+	return start <= length ? (uint32_t)start : 0;
+}
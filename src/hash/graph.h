@@ -122,6 +122,8 @@
 #include "../common-cxx/data.h"
 #include "../common-cxx/collection.h"
 #include "../common-cxx/exceptions.h"
+#include "../common-cxx/file.h"
+#include "mappedfile.h"
 
 /**
  * Hash record structure to compare to a substring hash.
@@ -208,6 +210,249 @@ typedef struct fiftyoneDegrees_graph_node_t {
 #define FIFTYONE_DEGREES_GRAPH_NODE_IS_HASH_TABLE(n) \
 	((n)->modulo > 0 && (n)->modulo <= (n)->hashesCount)
 
+/**
+ * Set in the flags of a hash table node in a flat graph when the hash records
+ * are followed by a #fiftyoneDegreesGraphNodeOrdered structure and a copy of
+ * the records, excluding markers, in hash code order. The flag is only set
+ * by fiftyoneDegreesGraphFlatCreate when a difference is allowed, so is only
+ * meaningful for the nodes of a flat graph.
+ */
+#define FIFTYONE_DEGREES_GRAPH_NODE_FLAG_ORDERED 0x01
+
+/**
+ * Header of the ordered copy of the hash records of a hash table node in a
+ * flat graph. The records immediately follow.
+ */
+#pragma pack(push, 4)
+typedef struct fiftyone_degrees_graph_node_ordered_t {
+	uint32_t count; /**< Number of hash records which follow */
+	uint32_t reserved; /**< Keeps the hash records which follow 8 byte
+					   aligned */
+} fiftyoneDegreesGraphNodeOrdered;
+#pragma pack(pop)
+
+/**
+ * Set in the flags of a hash table node in a flat graph when the hash records
+ * are immediately followed by a #fiftyoneDegreesGraphNodeModulo structure, so
+ * that (hash % modulo) can be calculated with multiplication rather than
+ * division. The flag is only set by fiftyoneDegreesGraphFlatCreate, so is only
+ * meaningful for the nodes of a flat graph.
+ */
+#define FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO 0x04
+
+/**
+ * Constant used to calculate the remainder of dividing a hash code by the
+ * modulo of a hash table node without a division instruction.
+ */
+#pragma pack(push, 4)
+typedef struct fiftyone_degrees_graph_node_modulo_t {
+	uint64_t multiplier; /**< (2^64 / modulo) rounded up, wrapping to zero
+						 when the modulo is 1 */
+} fiftyoneDegreesGraphNodeModulo;
+#pragma pack(pop)
+
+/**
+ * Gets the modulo constant which follows the hash records of a node with the
+ * #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO flag set.
+ * @param n pointer to the fiftyoneDegreesGraphNode
+ * @return pointer to the fiftyoneDegreesGraphNodeModulo
+ */
+#define FIFTYONE_DEGREES_GRAPH_NODE_MODULO(n) \
+	((fiftyoneDegreesGraphNodeModulo*)( \
+		(fiftyoneDegreesGraphNodeHash*)((n) + 1) + (n)->hashesCount))
+
+/**
+ * Gets the ordered copy of the hash records which follows the hash records of
+ * a node with the #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_ORDERED flag set, and the
+ * modulo constant if the node also has the
+ * #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO flag set.
+ * @param n pointer to the fiftyoneDegreesGraphNode
+ * @return pointer to the fiftyoneDegreesGraphNodeOrdered
+ */
+#define FIFTYONE_DEGREES_GRAPH_NODE_ORDERED(n) \
+	((fiftyoneDegreesGraphNodeOrdered*)( \
+		(byte*)((fiftyoneDegreesGraphNodeHash*)((n) + 1) + (n)->hashesCount) + \
+		(((n)->flags & FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO) != 0 ? \
+			sizeof(fiftyoneDegreesGraphNodeModulo) : 0)))
+
+/**
+ * Set in the flags of an ordered list node in a flat graph when the hash
+ * records are followed by a #fiftyoneDegreesGraphNodeSearch structure and the
+ * hash codes of the records in a layout which is faster to search than the
+ * records themselves. The flag is only set by fiftyoneDegreesGraphFlatCreate,
+ * so is only meaningful for the nodes of a flat graph.
+ */
+#define FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH 0x02
+
+/**
+ * The largest number of hash records an ordered list node can have for its
+ * hash codes to be scanned in order with fiftyoneDegreesGraphHashFind. Nodes
+ * with more records have their hash codes in Eytzinger order, which places
+ * the hash codes compared by the first steps of a binary search together.
+ */
+#ifndef FIFTYONE_DEGREES_GRAPH_SEARCH_LINEAR_MAX
+#define FIFTYONE_DEGREES_GRAPH_SEARCH_LINEAR_MAX 16
+#endif
+
+/**
+ * Header of the hash codes which follow the hash records of an ordered list
+ * node in a flat graph. When eytzinger is zero, count hash codes follow in the
+ * same order as the records. Otherwise count + 1 hash codes follow in
+ * Eytzinger order starting from index 1, and then count + 1 indexes of the
+ * record each hash code was copied from.
+ */
+#pragma pack(push, 4)
+typedef struct fiftyone_degrees_graph_node_search_t {
+	uint32_t count; /**< Number of hash records of the node */
+	uint32_t eytzinger; /**< Non zero if the hash codes are in Eytzinger
+						order */
+} fiftyoneDegreesGraphNodeSearch;
+#pragma pack(pop)
+
+/**
+ * Gets the hash codes which follow the hash records of a node with the
+ * #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH flag set.
+ * @param n pointer to the fiftyoneDegreesGraphNode
+ * @return pointer to the fiftyoneDegreesGraphNodeSearch
+ */
+#define FIFTYONE_DEGREES_GRAPH_NODE_SEARCH(n) \
+	((fiftyoneDegreesGraphNodeSearch*)( \
+		(fiftyoneDegreesGraphNodeHash*)((n) + 1) + (n)->hashesCount))
+
+/**
+ * Hints to the processor that the graph node, and the hash records which
+ * immediately follow it, will be read soon. Used to overlap the memory access
+ * for one node with the evaluation of another. Has no effect on compilers
+ * which do not support a prefetch intrinsic.
+ * @param n pointer to the fiftyoneDegreesGraphNode to prefetch
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define FIFTYONE_DEGREES_GRAPH_NODE_PREFETCH(n) \
+	(__builtin_prefetch((const void*)(n)), \
+	__builtin_prefetch((const void*)((const byte*)(n) + 64)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define FIFTYONE_DEGREES_GRAPH_NODE_PREFETCH(n) \
+	(_mm_prefetch((const char*)(n), _MM_HINT_T0), \
+	_mm_prefetch((const char*)(n) + 64, _MM_HINT_T0))
+#else
+#define FIFTYONE_DEGREES_GRAPH_NODE_PREFETCH(n) ((void)(n))
+#endif
+
+/**
+ * The maximum number of windows for which the hash codes are calculated in a
+ * single call to fiftyoneDegreesGraphHashWindows. Callers scanning a longer
+ * range calculate the hashes a block at a time.
+ */
+#define FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS 64
+
+/**
+ * The minimum number of windows in the range of a node for which the hash
+ * codes are calculated as a block rather than by rolling the hash one
+ * character at a time. Below this the cost of the block outweighs the saving.
+ */
+#ifndef FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS_MIN
+#define FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS_MIN 8
+#endif
+
+/**
+ * Instruction sets which the hash codes of a block of windows can be
+ * calculated and compared with. The best one supported by the processor is
+ * returned from fiftyoneDegreesGraphHashKernelGetBest. Defining
+ * FIFTYONE_DEGREES_NO_SIMD at compile time limits this to the scalar kernel.
+ */
+typedef enum e_fiftyone_degrees_graph_hash_kernel {
+	FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SCALAR = 0, /**< Portable C */
+	FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_SSE41 = 1, /**< 4 lanes using SSE4.1 */
+	FIFTYONE_DEGREES_GRAPH_HASH_KERNEL_AVX2 = 2 /**< 8 lanes using AVX2 */
+} fiftyoneDegreesGraphHashKernel;
+
+/**
+ * Size in bytes of the cache line which nodes of a flat graph are placed
+ * within.
+ */
+#ifndef FIFTYONE_DEGREES_GRAPH_FLAT_LINE
+#define FIFTYONE_DEGREES_GRAPH_FLAT_LINE 64
+#endif
+
+/**
+ * The nodes of a graph compiled into a single aligned block of memory. A node
+ * is found by adding its offset to the start of the block, rather than by
+ * getting it from a collection, so no item needs to be held or released while
+ * the node is evaluated.
+ *
+ * Each node keeps the layout of #fiftyoneDegreesGraphNode so it can be used
+ * with the same methods. However, nodes are placed so that their hash records
+ * are 8 byte aligned and the node header and first hash record never span two
+ * cache lines. The node offsets held in the nodes are rewritten to be offsets
+ * in the block. Leaf offsets are unchanged.
+ */
+typedef struct fiftyone_degrees_graph_flat_t {
+	byte *nodes; /**< Block of memory containing all the nodes */
+	uint32_t size; /**< Number of bytes used in the nodes block */
+	uint32_t count; /**< Number of nodes in the block */
+	uint32_t *rootSourceOffsets; /**< Ordered offsets of the root nodes in the
+								 source collection */
+	uint32_t *rootOffsets; /**< Offset in the block of the root node with the
+						   source offset at the same index */
+	uint32_t rootsCount; /**< Number of root nodes */
+	fiftyoneDegreesMappedFile segment; /**< Mapping of the segment which the
+									   nodes and root offsets point into if
+									   the graph was attached with
+									   fiftyoneDegreesGraphFlatAttach */
+	uint32_t generation; /**< Generation of the segment the graph was
+						 attached from, or 0 if the graph was compiled */
+} fiftyoneDegreesGraphFlat;
+
+/**
+ * Value at the start of a file holding a flat graph saved with
+ * fiftyoneDegreesGraphFlatSave.
+ */
+#define FIFTYONE_DEGREES_GRAPH_FLAT_SEGMENT_MAGIC 0x46473135
+
+/**
+ * Version of the layout of a file holding a flat graph. Files with any other
+ * version are not attached.
+ */
+#define FIFTYONE_DEGREES_GRAPH_FLAT_SEGMENT_VERSION 1
+
+/**
+ * Header of a file holding a flat graph, known as a segment, so that the
+ * graph compiled by one process can be mapped read only by others. Every
+ * reference within the graph is an offset, so the segment can be mapped at
+ * any address. The nodes start at nodesOffset, which is a multiple of
+ * #FIFTYONE_DEGREES_GRAPH_FLAT_LINE, and are followed at rootsOffset by the
+ * source offsets of the root nodes and then their offsets in the graph.
+ */
+#pragma pack(push, 4)
+typedef struct fiftyone_degrees_graph_flat_segment_t {
+	uint32_t magic; /**< #FIFTYONE_DEGREES_GRAPH_FLAT_SEGMENT_MAGIC */
+	uint32_t version; /**< #FIFTYONE_DEGREES_GRAPH_FLAT_SEGMENT_VERSION */
+	uint32_t generation; /**< One more than the generation of the segment
+						 this replaced, so processes can tell the segment
+						 has changed */
+	uint32_t options; /**< Options the graph was compiled with, set by the
+					  caller */
+	uint64_t source; /**< Identifies the data the graph was compiled from,
+					 set by the caller */
+	uint32_t size; /**< Number of bytes in the nodes block */
+	uint32_t count; /**< Number of nodes */
+	uint32_t rootsCount; /**< Number of root nodes */
+	uint32_t nodesOffset; /**< Offset in the segment of the nodes block */
+	uint32_t rootsOffset; /**< Offset in the segment of the root offsets */
+	uint32_t reserved; /**< Unused, always zero */
+} fiftyoneDegreesGraphFlatSegment;
+#pragma pack(pop)
+
+/**
+ * Gets the node at the offset in a flat graph.
+ * @param f pointer to the fiftyoneDegreesGraphFlat
+ * @param o offset of the node in the block, which must be positive
+ * @return pointer to the fiftyoneDegreesGraphNode
+ */
+#define FIFTYONE_DEGREES_GRAPH_FLAT_NODE(f, o) \
+	((fiftyoneDegreesGraphNode*)((f)->nodes + (o)))
+
 #ifndef FIFTYONE_DEGREES_MEMORY_ONLY
 
 /**
@@ -264,6 +509,22 @@ fiftyoneDegreesGraphGetMatchingHashFromListNodeTable(
 	fiftyoneDegreesGraphNode *node,
 	uint32_t hash);
 
+/**
+ * Gets a matching hash record from a hash table node in a flat graph with the
+ * #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO flag set. The slot is found by
+ * multiplying the hash by the modulo constant of the node rather than by
+ * dividing by the modulo. Returns the same record as
+ * fiftyoneDegreesGraphGetMatchingHashFromListNodeTable.
+ * @param node the node to search
+ * @param hash the hash code to search for
+ * @return fiftyoneDegreesGraphNodeHash* data.ptr to a matching hash record,
+ *                                       or null if none match.
+ */
+EXTERNAL fiftyoneDegreesGraphNodeHash*
+fiftyoneDegreesGraphGetMatchingHashFromListNodeTableModulo(
+	fiftyoneDegreesGraphNode *node,
+	uint32_t hash);
+
 /**
  * Gets a matching hash record from a node where the hash records are stored
  * as an ordered list by performing a binary search.
@@ -277,6 +538,22 @@ fiftyoneDegreesGraphGetMatchingHashFromListNodeSearch(
 	fiftyoneDegreesGraphNode *node,
 	uint32_t hash);
 
+/**
+ * Gets a matching hash record from an ordered list node in a flat graph with
+ * the #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH flag set, by searching the
+ * hash codes which follow the records rather than the records themselves.
+ * Returns the same record as
+ * fiftyoneDegreesGraphGetMatchingHashFromListNodeSearch.
+ * @param node the node to search
+ * @param hash the hash code to search for
+ * @return fiftyoneDegreesGraphNodeHash* data.ptr to a matching hash record,
+ *                                       or null if none match.
+ */
+EXTERNAL fiftyoneDegreesGraphNodeHash*
+fiftyoneDegreesGraphGetMatchingHashFromListNodeLayout(
+	fiftyoneDegreesGraphNode *node,
+	uint32_t hash);
+
 /**
  * Gets a matching hash record from a node where the node has multiple hash
  * records, using the layout indicated by the modulo of the node. Nodes which
@@ -292,6 +569,30 @@ fiftyoneDegreesGraphGetMatchingHashFromListNode(
 	fiftyoneDegreesGraphNode *node,
 	uint32_t hash);
 
+/**
+ * Gets the hash record whose hash code is nearest to the hash provided from
+ * records ordered by hash code, using a single binary search rather than
+ * searching for each hash code within the difference in turn. Differences
+ * are calculated with unsigned 32 bit arithmetic, so wrap around in the same
+ * way as adding to or subtracting from the hash. Where a record above and a
+ * record below the hash are the same distance away, the one above is
+ * returned.
+ * @param hashes ordered by hash code to search
+ * @param count number of hash records
+ * @param hash the hash code to search for
+ * @param maxDifference the largest difference from the hash allowed
+ * @param difference set to the difference of the record returned
+ * @return the nearest hash record, or NULL if there is none within the
+ * maximum difference
+ */
+EXTERNAL fiftyoneDegreesGraphNodeHash*
+fiftyoneDegreesGraphGetNearestHashFromOrdered(
+	fiftyoneDegreesGraphNodeHash *hashes,
+	uint32_t count,
+	uint32_t hash,
+	uint32_t maxDifference,
+	uint32_t *difference);
+
 /**
  * Gets a matching hash record from a node where the node a single hash
  * record.
@@ -318,6 +619,231 @@ fiftyoneDegreesGraphGetMatchingHashFromNode(
 	fiftyoneDegreesGraphNode *node,
 	uint32_t hash);
 
+/**
+ * Gets the best kernel supported by the processor the code is running on. The
+ * processor is only queried the first time this is called.
+ * @return the kernel to use with fiftyoneDegreesGraphHashWindows and
+ * fiftyoneDegreesGraphHashFind
+ */
+EXTERNAL fiftyoneDegreesGraphHashKernel
+fiftyoneDegreesGraphHashKernelGetBest();
+
+/**
+ * Calculates the hash code of every window of length characters which starts
+ * between firstIndex and firstIndex + count - 1 of the target. The hash codes
+ * are identical to those produced by rolling the hash one character at a time
+ * from the first window, so can be compared with the hash records of a node.
+ * The caller must ensure that the last window is within the target i.e.
+ * firstIndex + count - 1 + length is not greater than the target length.
+ * @param kernel to calculate the hash codes with, which must not be better
+ * than that returned by fiftyoneDegreesGraphHashKernelGetBest
+ * @param target characters to hash
+ * @param firstIndex index of the first character of the first window
+ * @param count number of windows to calculate the hash codes of
+ * @param length number of characters in each window, no greater than 128
+ * @param hashes to store the hash codes in, with space for at least
+ * FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS values
+ * @return the number of hash codes calculated, which is the smaller of count
+ * and FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS
+ */
+EXTERNAL uint32_t fiftyoneDegreesGraphHashWindows(
+	fiftyoneDegreesGraphHashKernel kernel,
+	const char *target,
+	uint32_t firstIndex,
+	uint32_t count,
+	byte length,
+	uint32_t *hashes);
+
+/**
+ * Finds the first of the hash codes which is equal to the hash provided,
+ * comparing one hash code per lane of the kernel.
+ * @param kernel to compare the hash codes with, which must not be better
+ * than that returned by fiftyoneDegreesGraphHashKernelGetBest
+ * @param hashes to search
+ * @param count number of hash codes to search
+ * @param hash the hash code to search for
+ * @return the index of the first matching hash code, or -1 if none match
+ */
+EXTERNAL int32_t fiftyoneDegreesGraphHashFind(
+	fiftyoneDegreesGraphHashKernel kernel,
+	const uint32_t *hashes,
+	uint32_t count,
+	uint32_t hash);
+
+/**
+ * Compiles the nodes in the collection into a flat graph. Every node is read
+ * once from the collection, so this works with any type of collection, and
+ * the collection is not used by the flat graph once it has been created.
+ * @param collection containing the nodes
+ * @param length number of bytes occupied by the nodes in the collection
+ * @param rootOffsets offsets in the collection of the root nodes, which are
+ * the only nodes which can be looked up once the graph is compiled
+ * @param rootsCount number of root node offsets
+ * @param breadthFirst true if the nodes should be placed in the order they
+ * are found by a breadth first search from the root nodes, so that the nodes
+ * evaluated for most detections are close together. Otherwise the nodes are
+ * placed in the same order as in the collection.
+ * @param searchLayout true if the hash codes of ordered list nodes should be
+ * copied into a layout which is faster to search, see
+ * #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH
+ * @param fastModulo true if hash table nodes should have the constant to
+ * find the slot of a hash without division appended, see
+ * #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO
+ * @param prune true if only the nodes which can be reached from the root
+ * nodes should be included. The nodes are then placed in breadth first order
+ * whatever the value of breadthFirst.
+ * @param difference the difference in hash code allowed when the graph is
+ * evaluated. Hash table nodes only have an ordered copy of their records
+ * appended when this is greater than zero, see
+ * #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_ORDERED
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return a new flat graph to be freed with fiftyoneDegreesGraphFlatFree, or
+ * NULL if the nodes could not be compiled
+ */
+EXTERNAL fiftyoneDegreesGraphFlat* fiftyoneDegreesGraphFlatCreate(
+	fiftyoneDegreesCollection *collection,
+	uint32_t length,
+	const uint32_t *rootOffsets,
+	uint32_t rootsCount,
+	bool breadthFirst,
+	bool searchLayout,
+	bool fastModulo,
+	bool prune,
+	int32_t difference,
+	fiftyoneDegreesException *exception);
+
+/**
+ * Gets the offset in the flat graph of the root node at the offset provided
+ * in the source collection.
+ * @param flat graph to get the root node offset from
+ * @param sourceOffset offset of the root node in the source collection
+ * @return offset of the root node in the flat graph, or zero if the source
+ * offset was not provided as a root node when the graph was created
+ */
+EXTERNAL uint32_t fiftyoneDegreesGraphFlatGetRootOffset(
+	const fiftyoneDegreesGraphFlat *flat,
+	uint32_t sourceOffset);
+
+/**
+ * Saves the flat graph to a file, known as a segment, which other processes
+ * can attach with fiftyoneDegreesGraphFlatAttach rather than compiling the
+ * graph themselves. The segment is written to a temporary file which then
+ * replaces any existing file atomically, so processes never see a partial
+ * segment. The generation of the new segment is one more than that of the
+ * segment it replaces. Placing the file on a memory backed file system, such
+ * as /dev/shm, keeps the segment in shared memory.
+ * @param flat graph to save
+ * @param fileName path to the segment
+ * @param options the graph was compiled with, which must be the same for the
+ * segment to be attached
+ * @param source identifier of the data the graph was compiled from, which
+ * must be the same for the segment to be attached
+ * @return the status of the save. Any value other than
+ * #FIFTYONE_DEGREES_STATUS_SUCCESS means the segment was not replaced
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesGraphFlatSave(
+	const fiftyoneDegreesGraphFlat *flat,
+	const char *fileName,
+	uint32_t options,
+	uint64_t source);
+
+/**
+ * Attaches a flat graph saved by fiftyoneDegreesGraphFlatSave by mapping the
+ * segment read only. The nodes are read from the mapping, so the memory is
+ * shared with every process attached to the same segment.
+ * @param fileName path to the segment
+ * @param options the graph must have been compiled with
+ * @param source identifier of the data the graph must have been compiled from
+ * @param flat set to the attached graph, to be freed with
+ * fiftyoneDegreesGraphFlatFree, or NULL if the segment could not be attached
+ * @return the status of the attach. #FIFTYONE_DEGREES_STATUS_INCORRECT_VERSION
+ * is returned if the segment is not for the same options and source
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesGraphFlatAttach(
+	const char *fileName,
+	uint32_t options,
+	uint64_t source,
+	fiftyoneDegreesGraphFlat **flat);
+
+/**
+ * Gets the generation of the segment currently at the path, without
+ * attaching it. A process attached to an earlier generation can use this to
+ * tell when the segment has been replaced.
+ * @param fileName path to the segment
+ * @return the generation, or 0 if there is no valid segment at the path
+ */
+EXTERNAL uint32_t fiftyoneDegreesGraphFlatGetGeneration(const char *fileName);
+
+/**
+ * Frees a flat graph created with fiftyoneDegreesGraphFlatCreate or attached
+ * with fiftyoneDegreesGraphFlatAttach.
+ * @param flat graph to free
+ */
+EXTERNAL void fiftyoneDegreesGraphFlatFree(fiftyoneDegreesGraphFlat *flat);
+
+/**
+ * Hash code of the marker node which fiftyoneDegreesGraphTrim places at the
+ * start of the nodes it copies, so that trimmed nodes can be recognised.
+ */
+#define FIFTYONE_DEGREES_GRAPH_TRIM_MARKER 0x4D495254
+
+/**
+ * Copies the nodes which can be reached from the root nodes into a new block
+ * of nodes in the same format as the nodes of a data file. A binary node
+ * which never matches any evidence is placed ahead of the nodes copied for
+ * each of the unmatched offsets, so that root nodes which are no longer
+ * needed can reference one of them. The nodes copied keep the order they have
+ * in the collection, and their node offsets are rewritten as offsets in the
+ * new block.
+ *
+ * The block starts with a marker node which is never referenced. It is a
+ * binary node which never matches, with the hash code
+ * #FIFTYONE_DEGREES_GRAPH_TRIM_MARKER, and an unmatched node offset of the
+ * number of nodes which never match negated, so it is read as a leaf. See
+ * #fiftyoneDegreesGraphGetTrimmedStart.
+ * @param collection containing the nodes
+ * @param length number of bytes occupied by the nodes in the collection
+ * @param rootOffsets offsets in the collection of the root nodes to copy the
+ * nodes from, which are rewritten as the offsets in the new block
+ * @param rootsCount number of root node offsets
+ * @param unmatchedOffsets leaf offsets, i.e. the negated profile offsets, the
+ * nodes which never match move on to, which are rewritten as the offsets in
+ * the new block of those nodes
+ * @param unmatchedCount number of unmatched offsets, which must be at least 1
+ * @param trimmedLength set to the number of bytes occupied by the new block
+ * @param trimmedCount set to the number of nodes in the new block
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return a new block of nodes to be freed with fiftyoneDegreesFree, or NULL
+ * if the nodes could not be copied
+ */
+EXTERNAL byte* fiftyoneDegreesGraphTrim(
+	fiftyoneDegreesCollection *collection,
+	uint32_t length,
+	uint32_t *rootOffsets,
+	uint32_t rootsCount,
+	int32_t *unmatchedOffsets,
+	uint32_t unmatchedCount,
+	uint32_t *trimmedLength,
+	uint32_t *trimmedCount,
+	fiftyoneDegreesException *exception);
+
+/**
+ * Gets the offset of the first node copied by fiftyoneDegreesGraphTrim if the
+ * nodes start with its marker node. Root nodes with an offset less than this
+ * reference a node which never matches, so their graph was not retained.
+ * @param collection containing the nodes
+ * @param length number of bytes occupied by the nodes in the collection
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return offset of the first node copied, or 0 if the nodes were not trimmed
+ */
+EXTERNAL uint32_t fiftyoneDegreesGraphGetTrimmedStart(
+	fiftyoneDegreesCollection *collection,
+	uint32_t length,
+	fiftyoneDegreesException *exception);
+
 /**
  * Creates a new graph trace node. Importantly, this is not a graph node, but a
  * graph trace node, used to trace the route taken through a graph. The node
@@ -39,6 +39,9 @@ MAP_TYPE(Collection)
 /** Offset used for a null profile. */
 #define NULL_PROFILE_OFFSET UINT32_MAX
 
+/** Offset used for the root nodes of a component without a graph. */
+#define NULL_ROOT_NODE_OFFSET UINT32_MAX
+
 #ifndef MAX
 #ifdef max
 #define MAX(a,b) max(a,b)
@@ -66,6 +69,13 @@ d->componentsList.items[i].data.ptr : NULL))
  */
 #define RK_PRIME 997
 
+/**
+ * The profile id table is only built if it would have no more than this many
+ * entries for every profile, as the profile ids are otherwise too sparse. Each
+ * entry is 5 bytes, which is small compared to the profile it refers to.
+ */
+#define PROFILE_ID_TABLE_SPARSITY 16
+
 /**
  * Array of powers for the RK_PRIME.
  */
@@ -152,6 +162,17 @@ typedef struct state_with_exception_t {
 	Exception *exception; /* Pointer to the exception structure */
 } stateWithException;
 
+/**
+ * A node evaluated without difference or drift, and the range of the target
+ * it was evaluated against.
+ */
+typedef struct path_node_t {
+	uint32_t offset; /* Offset of the node in the nodes collection or flat
+					 graph */
+	int firstIndex; /* First index to consider at the node */
+	int lastIndex; /* Last index to consider at the node */
+} pathNode;
+
 typedef struct detection_state_t {
 	ResultHash *result; /* The detection result structure to return */
 	DataSetHash *dataSet; /* Data set used for the match operation */
@@ -163,6 +184,8 @@ typedef struct detection_state_t {
 	Item node; /* Handle to the current node being inspected */
 	uint32_t power; /* Current power being used */
 	uint32_t hash; /* Current hash value */
+	const uint32_t *prefixHashes; /* Hash codes of each prefix of the target,
+								  or NULL if not available */
 	int currentIndex; /* Current index */
 	int firstIndex; /* First index to consider */
 	int lastIndex; /* Last index to consider */
@@ -172,8 +195,17 @@ typedef struct detection_state_t {
 					  evaluated */
 	int breakDepth; /* The depth at which to start applying drift and
 					difference */
+	pathNode path[FIFTYONE_DEGREES_HASH_RESUME_DEPTH]; /* Nodes from the root
+													  evaluated without
+													  difference or drift */
+	int pathLength; /* Number of nodes in the path */
 	bool complete; /* True if a leaf node has been found and a profile offset
 				   set */
+	bool deferNode; /* True if moving to the next node should not read it, so
+					that it can be prefetched before it is entered */
+	bool nodePending; /* True if the state has moved to the current node but
+					  not yet read its indexes. See enterNode */
+	uint32_t pendingOffset; /* Offset of the node which is pending */
 	int matchedNodes; /* Total number of nodes that matched in all graphs */
 	int performanceMatches; /* Number of nodes that matched in the performance 
 							   graph */
@@ -182,6 +214,14 @@ typedef struct detection_state_t {
 	Exception *exception; /* Exception pointer */
 } detectionState;
 
+typedef struct value_table_state_t {
+	Collection *values; /* Collection the value items are from */
+	uint32_t *nameOffsets; /* Offsets of the value strings added */
+	uint32_t count; /* Number of offsets added */
+	uint32_t capacity; /* Number of offsets the memory can hold */
+	bool valid; /* False if the memory could not be increased */
+} valueTableState;
+
 typedef struct deviceId_lookup_state_t {
 	ResultsHash* results; /* The detection results to modify */
 	int profilesFoundFromDeviceId; /* The number of deviceIds found */
@@ -201,8 +241,72 @@ typedef struct detection_component_state_t {
 	HeaderID headerUniqueId; /* Unique id in the data set for the header */
 	int headerIndex; /* Current header index. See macro HTTP_HEADER */
 	Exception* exception; /* Pointer to the exception structure */
+	uint32_t evaluatedPairs; /* Number of the first evidence pairs for the
+							 component which have already been evaluated
+							 and are skipped */
 } detectionComponentState;
 
+/**
+ * The first evidence value for a component which is evaluated when processing
+ * a block of inputs from a batch.
+ */
+typedef struct batch_component_evidence_t {
+	const char* value; /* Parsed value of the evidence */
+	size_t valueLength; /* Length of the parsed value */
+	Header* header; /* Unique header the evidence relates to */
+	bool found; /* True if evidence for the component was found */
+} batchComponentEvidence;
+
+/**
+ * A single result held in the result cache. The profile offsets for each
+ * component follow, and then the matched User-Agent if enabled.
+ */
+typedef struct cached_result_t {
+	int32_t uniqueHttpHeaderIndex; /* Index of the header for the result */
+	int32_t method; /* The method used to provide the match result */
+	int32_t iterations; /* Number of iterations required */
+	int32_t difference; /* The total difference in hash code values */
+	int32_t drift; /* The maximum drift for a matched substring */
+	int32_t matchedNodes; /* The number of hashes matched */
+	uint32_t targetUserAgentLength; /* Number of characters in the target */
+	uint32_t matchedUserAgentLength; /* Number of characters in the matched
+									 User-Agent */
+	int32_t targetIndex; /* Position of the target among the evidence values
+						 for headers, or one of the CACHED_TARGET values */
+} cachedResult;
+
+/**
+ * Target index of a cached result without a target.
+ */
+#define CACHED_TARGET_NONE -1
+
+/**
+ * Target index of a cached result whose target is not one of the first
+ * CACHE_KEY_VALUES evidence values for headers, for example a pseudo header
+ * constructed from several pieces of evidence. The target is found again from
+ * the evidence.
+ */
+#define CACHED_TARGET_FIND -2
+
+/**
+ * Number of evidence values for headers recorded with the fingerprint.
+ */
+#define CACHE_KEY_VALUES 16
+
+/**
+ * Key for the result cache. The parsed values of the evidence for headers are
+ * recorded in the order they are added to the fingerprint. Evidence with the
+ * same fingerprint has the same values in the same order, so the target of a
+ * cached result is found from its position rather than by iterating the
+ * evidence for each component again.
+ */
+typedef struct cache_key_t {
+	ResultCacheFingerprint fingerprint; /* Fingerprint of the evidence */
+	const char* values[CACHE_KEY_VALUES]; /* Parsed values of the first
+										  evidence for headers */
+	uint32_t count; /* Number of evidence values for headers added */
+} cacheKey;
+
 /**
  * Used to find an existing evidence pair for the header.
  */
@@ -236,7 +340,21 @@ fiftyoneDegreesConfigHash fiftyoneDegreesHashInMemoryConfig = {
 	0,
 	false, // Performance graph
 	true, // Predictive graph
-	false // Trace
+	false, // Trace
+	false, // Flat graph
+	false, // Optimise node layout
+	false, // Optimise node search
+	false, // Optimise node modulo
+	0, // Result cache capacity
+	false, // Value table
+	false, // Mapped file
+	false, // Prefault mapped file
+	NULL, // Shared graph file
+	false, // Huge pages
+	-1, // NUMA node
+	false, // Prune graph
+	false, // Profile id table
+	false // Profile value index
 };
 #undef FIFTYONE_DEGREES_CONFIG_ALL_IN_MEMORY
 #define FIFTYONE_DEGREES_CONFIG_ALL_IN_MEMORY \
@@ -257,7 +375,21 @@ fiftyoneDegreesConfigHash fiftyoneDegreesHashHighPerformanceConfig = {
 	0,
 	false, // Performance graph
 	true, // Predictive graph
-	false // Trace
+	false, // Trace
+	false, // Flat graph
+	false, // Optimise node layout
+	false, // Optimise node search
+	false, // Optimise node modulo
+	0, // Result cache capacity
+	false, // Value table
+	false, // Mapped file
+	false, // Prefault mapped file
+	NULL, // Shared graph file
+	false, // Huge pages
+	-1, // NUMA node
+	false, // Prune graph
+	false, // Profile id table
+	false // Profile value index
 };
 
 fiftyoneDegreesConfigHash fiftyoneDegreesHashLowMemoryConfig = {
@@ -275,7 +407,21 @@ fiftyoneDegreesConfigHash fiftyoneDegreesHashLowMemoryConfig = {
 	0,
 	false, // Performance graph
 	true, // Predictive graph
-	false // Trace
+	false, // Trace
+	false, // Flat graph
+	false, // Optimise node layout
+	false, // Optimise node search
+	false, // Optimise node modulo
+	0, // Result cache capacity
+	false, // Value table
+	false, // Mapped file
+	false, // Prefault mapped file
+	NULL, // Shared graph file
+	false, // Huge pages
+	-1, // NUMA node
+	false, // Prune graph
+	false, // Profile id table
+	false // Profile value index
 };
 
 #define FIFTYONE_DEGREES_HASH_CONFIG_BALANCED \
@@ -293,7 +439,21 @@ FIFTYONE_DEGREES_DEVICE_DETECTION_CONFIG_DEFAULT_NO_INDEX, \
 0, \
 false, /* Performance graph */ \
 true,  /* Predictive graph */ \
-false /* Trace */
+false, /* Trace */ \
+false, /* Flat graph */ \
+false, /* Optimise node layout */ \
+false, /* Optimise node search */ \
+false, /* Optimise node modulo */ \
+0, /* Result cache capacity */ \
+false, /* Value table */ \
+false, /* Mapped file */ \
+false, /* Prefault mapped file */ \
+NULL, /* Shared graph file */ \
+false, /* Huge pages */ \
+-1, /* NUMA node */ \
+false, /* Prune graph */ \
+false, /* Profile id table */ \
+false /* Profile value index */
 
 fiftyoneDegreesConfigHash fiftyoneDegreesHashBalancedConfig = {
 	FIFTYONE_DEGREES_HASH_CONFIG_BALANCED
@@ -395,6 +555,7 @@ static void detectionStateInit(
 	detectionState *state,
 	ResultHash *result,
 	DataSetHash *dataSet,
+	const uint32_t *prefixHashes,
 	Exception *exception) {
 	// Reset the data structure in the item.
 	DataReset(&state->node.data);
@@ -403,10 +564,14 @@ static void detectionStateInit(
 	state->exception = exception;
 	state->dataSet = dataSet;
 	state->result = result;
+	state->prefixHashes = prefixHashes;
 	state->allowedDifference = 0;
 	state->allowedDrift = 0;
 	state->currentDepth = 0;
 	state->breakDepth = INT_MAX;
+	state->pathLength = 0;
+	state->deferNode = false;
+	state->nodePending = false;
 
 	// Reset the metric values.
 	state->difference = 0;
@@ -430,8 +595,41 @@ GraphNodeHash* getMatchingHashFromListNodeWithinDifference(
 	detectionState *state) {
 	uint32_t difference;
 	GraphNodeHash *nodeHash = NULL;
+	GraphNodeOrdered *ordered;
+	GraphNode *node = NODE(state);
 	uint32_t originalHashCode = state->hash;
 
+	// Where the records are ordered by hash code find the nearest one to the
+	// hash with a single search. This returns the same record as searching
+	// for each hash within the difference in turn.
+	if (node->modulo == 0) {
+		nodeHash = GraphGetNearestHashFromOrdered(
+			(GraphNodeHash*)(node + 1),
+			(uint32_t)node->hashesCount,
+			originalHashCode,
+			(uint32_t)state->allowedDifference,
+			&difference);
+		if (nodeHash != NULL) {
+			state->difference += difference;
+		}
+		return nodeHash;
+	}
+	if (state->dataSet->flatGraph != NULL &&
+		GRAPH_NODE_IS_HASH_TABLE(node) &&
+		(node->flags & GRAPH_NODE_FLAG_ORDERED) != 0) {
+		ordered = GRAPH_NODE_ORDERED(node);
+		nodeHash = GraphGetNearestHashFromOrdered(
+			(GraphNodeHash*)(ordered + 1),
+			ordered->count,
+			originalHashCode,
+			(uint32_t)state->allowedDifference,
+			&difference);
+		if (nodeHash != NULL) {
+			state->difference += difference;
+		}
+		return nodeHash;
+	}
+
 	for (difference = 0;
 		(int)difference <= state->allowedDifference && nodeHash == NULL;
 		difference++) {
@@ -490,31 +688,85 @@ static void traceRoute(detectionState *state, GraphNodeHash* hash) {
 }
 #endif
 
+/**
+ * Records the node at the depth if the graph is being evaluated without
+ * difference or drift so that any retries can resume from the node. The
+ * current first and last indexes must be those of the node.
+ * @param state containing the path
+ * @param depth of the node from the root
+ * @param offset of the node in the nodes collection or flat graph
+ */
+static void addPathNode(detectionState *state, int depth, uint32_t offset) {
+	pathNode *node;
+	if (state->allowedDifference == 0 &&
+		state->allowedDrift == 0 &&
+		depth < FIFTYONE_DEGREES_HASH_RESUME_DEPTH) {
+		node = &state->path[depth];
+		node->offset = offset;
+		node->firstIndex = state->firstIndex;
+		node->lastIndex = state->lastIndex;
+		state->pathLength = depth + 1;
+	}
+}
+
+/**
+ * Reads the first and last indexes of the current node, which the state has
+ * already moved to, and records it in the path.
+ * @param state moved to the node
+ * @param depth of the node from the root
+ * @param offset of the node in the nodes collection or flat graph
+ */
+static void enterNode(detectionState *state, int depth, uint32_t offset) {
+	const GraphNode * const node = NODE(state);
+	state->firstIndex += node->firstIndex;
+	state->lastIndex += node->lastIndex;
+	addPathNode(state, depth, offset);
+	state->nodePending = false;
+}
+
 /**
  * Checks to see if the offset represents a node or a device index.
  * If the offset is positive then it is a an offset from the root node in the
  * data array. If it's negative or zero then it's a device index.
+ * If the state defers nodes, then the node is not read here. Its indexes are
+ * read by enterNode before it is evaluated, which gives time for the node to
+ * be prefetched.
  * @param match
  * @param offset
  */
 static void setNextNode(detectionState *state, int32_t offset) {
 	fiftyoneDegreesGraphNode *node;
 	Exception *exception = state->exception;
-	// Release the previous nodes resources if necessary.
-	COLLECTION_RELEASE(state->dataSet->nodes, &state->node);
+	GraphFlat * const flatGraph = state->dataSet->flatGraph;
+	// Release the previous nodes resources if necessary. The nodes of a flat
+	// graph are not collection items so there is nothing to release.
+	if (flatGraph == NULL) {
+		COLLECTION_RELEASE(state->dataSet->nodes, &state->node);
+	}
 
 	if (offset > 0) {
 		// There is another node to look at, so move on.
-		node = GraphGetNode(
-			state->dataSet->nodes,
-			(uint32_t)offset,
-			&state->node,
-			state->exception);
+		if (flatGraph != NULL) {
+			node = GRAPH_FLAT_NODE(flatGraph, offset);
+			state->node.data.ptr = (byte*)node;
+		}
+		else {
+			node = GraphGetNode(
+				state->dataSet->nodes,
+				(uint32_t)offset,
+				&state->node,
+				state->exception);
+		}
 
-		// Set the first and last indexes.
+		// Set the first and last indexes now, or when the node is entered.
 		if (node != NULL && EXCEPTION_OKAY) {
-			state->firstIndex += node->firstIndex;
-			state->lastIndex += node->lastIndex;
+			if (state->deferNode) {
+				state->pendingOffset = (uint32_t)offset;
+				state->nodePending = true;
+			}
+			else {
+				enterNode(state, state->currentDepth + 1, (uint32_t)offset);
+			}
 		}
 	}
 	else if (offset <= 0) {
@@ -561,7 +813,18 @@ static bool setInitialHash(detectionState *state) {
 	state->hash = 0;
 	// Hash over the whole length using:
 	// h[i] = (c[i]*p^(L-1)) + (c[i+1]*p^(L-2)) ... + (c[i+L]*p^(0))
-	if (length <= state->result->b.targetUserAgentLength) {
+	if (length <= state->result->b.targetUserAgentLength &&
+		state->prefixHashes != NULL) {
+		// The hash of the window is the difference between the hashes of the
+		// prefixes which end at either side of it using:
+		// h[i] = H[i+L] - (H[i]*p^L)
+		state->power = POWERS[node->length];
+		state->hash = state->prefixHashes[length] -
+			(state->prefixHashes[state->firstIndex] * state->power);
+		state->currentIndex = state->firstIndex;
+		result = true;
+	}
+	else if (length <= state->result->b.targetUserAgentLength) {
 		// Cache the loop-invariant base pointer and accumulate in a local so
 		// the per-character work stays in registers rather than re-walking the
 		// state->result->b.targetUserAgent pointer chain on every iteration.
@@ -654,6 +917,185 @@ static void applyDrift(detectionState *state) {
 		(int)state->result->b.targetUserAgentLength - 1;
 }
 
+/**
+ * Gets the number of windows of the node's length which start between the
+ * first and last index of the state and are within the target. These are the
+ * windows visited by setInitialHash followed by advanceHash.
+ * @param state to get the window count for
+ * @return number of windows, or zero if the first window is not within the
+ * target
+ */
+static uint32_t getWindowCount(detectionState *state) {
+	const int length = NODE(state)->length;
+	const int targetLength = (int)state->result->b.targetUserAgentLength;
+	int last;
+	uint32_t count = 0;
+	if (state->firstIndex + length <= targetLength) {
+		last = MIN(state->lastIndex, targetLength - length);
+		count = last > state->firstIndex ?
+			(uint32_t)(last - state->firstIndex) + 1 :
+			1;
+	}
+	return count;
+}
+
+/**
+ * Calculates the hash codes of the windows of the length which start from the
+ * index. Where the prefix hash codes of the target are available each hash
+ * code is two lookups, otherwise the kernel calculates the hash codes from the
+ * characters of the windows.
+ * @param state containing the target and any prefix hash codes
+ * @param kernel to calculate the hash codes with if there are no prefixes
+ * @param firstIndex index of the first character of the first window
+ * @param count number of windows to calculate the hash codes of
+ * @param length number of characters in each window
+ * @param hashes to store the hash codes in
+ * @return the number of hash codes calculated, which is the smaller of count
+ * and GRAPH_HASH_WINDOWS
+ */
+static uint32_t getWindowHashes(
+	detectionState *state,
+	GraphHashKernel kernel,
+	uint32_t firstIndex,
+	uint32_t count,
+	byte length,
+	uint32_t *hashes) {
+	uint32_t i;
+	const uint32_t *prefixHashes = state->prefixHashes;
+	const uint32_t power = POWERS[length];
+	if (prefixHashes == NULL) {
+		return GraphHashWindows(
+			kernel,
+			state->result->b.targetUserAgent,
+			firstIndex,
+			count,
+			length,
+			hashes);
+	}
+	if (count > GRAPH_HASH_WINDOWS) {
+		count = GRAPH_HASH_WINDOWS;
+	}
+	for (i = 0; i < count; i++) {
+		hashes[i] = prefixHashes[firstIndex + i + length] -
+			(prefixHashes[firstIndex + i] * power);
+	}
+	return count;
+}
+
+/**
+ * Finds the first window in the range of the state whose hash code is that of
+ * the node's single hash record. Rather than rolling the hash one character at
+ * a time, the hash codes of a block of windows are calculated and compared
+ * together using the best kernel available to the processor. The current
+ * index and hash are left as setInitialHash and advanceHash would leave them.
+ * @param state containing the node and range to search
+ * @param count number of windows in the range from getWindowCount
+ * @param hashCode of the node's hash record
+ * @return true if a window has the hash code
+ */
+static bool findHashInWindows(
+	detectionState *state,
+	uint32_t count,
+	uint32_t hashCode) {
+	uint32_t hashes[GRAPH_HASH_WINDOWS];
+	const GraphHashKernel kernel = GraphHashKernelGetBest();
+	const byte length = NODE(state)->length;
+	uint32_t done = 0, calculated = 0;
+	int32_t index = -1;
+	state->power = POWERS[length];
+	while (index < 0 && done < count) {
+		calculated = getWindowHashes(
+			state,
+			kernel,
+			(uint32_t)state->firstIndex + done,
+			count - done,
+			length,
+			hashes);
+		index = GraphHashFind(kernel, hashes, calculated, hashCode);
+		done += calculated;
+	}
+	if (index >= 0) {
+		state->currentIndex =
+			state->firstIndex + (int)(done - calculated) + index;
+		state->hash = hashCode;
+	}
+	else {
+		state->currentIndex = state->firstIndex + (int)count - 1;
+		state->hash = hashes[calculated - 1];
+	}
+	return index >= 0;
+}
+
+/**
+ * Determines whether the node is from a flat graph and has the flag set. The
+ * flags of nodes from the collection are not set by the flat graph, so are not
+ * checked.
+ * @param state containing the data set the node is from
+ * @param node to check
+ * @param flag to check for, e.g. #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH
+ * @return true if the flat graph appended the data indicated by the flag to
+ * the node
+ */
+static bool hasFlatNodeFlag(detectionState *state, GraphNode *node, byte flag) {
+	return state->dataSet->flatGraph != NULL && (node->flags & flag) != 0;
+}
+
+/**
+ * Finds the first window in the range of the state whose hash code is one of
+ * the node's hash records. The hash codes of a block of windows are calculated
+ * together using the best kernel available to the processor, and then looked
+ * up in the node in order. The current index and hash are left as
+ * setInitialHash and advanceHash would leave them.
+ * @param state containing the node and range to search
+ * @param count number of windows in the range from getWindowCount
+ * @return the matching hash record or NULL if none match
+ */
+static GraphNodeHash* getMatchingHashFromListNodeWindows(
+	detectionState *state,
+	uint32_t count) {
+	uint32_t hashes[GRAPH_HASH_WINDOWS];
+	const GraphHashKernel kernel = GraphHashKernelGetBest();
+	GraphNode * const node = NODE(state);
+	GraphNodeHash *nodeHash = NULL;
+	GraphNodeHash *(*getMatchingHash)(GraphNode*, uint32_t);
+	uint32_t done = 0, calculated = 0, i = 0;
+	if (node->modulo == 0) {
+		getMatchingHash =
+			hasFlatNodeFlag(state, node, GRAPH_NODE_FLAG_SEARCH) ?
+			GraphGetMatchingHashFromListNodeLayout :
+			GraphGetMatchingHashFromListNodeSearch;
+	}
+	else if (GRAPH_NODE_IS_HASH_TABLE(node)) {
+		getMatchingHash =
+			hasFlatNodeFlag(state, node, GRAPH_NODE_FLAG_MODULO) ?
+			GraphGetMatchingHashFromListNodeTableModulo :
+			GraphGetMatchingHashFromListNodeTable;
+	}
+	else {
+		// Any other modulo cannot index the records of the node safely, so no
+		// hash is looked for and the unmatched branch is taken.
+		return NULL;
+	}
+	state->power = POWERS[node->length];
+	while (nodeHash == NULL && done < count) {
+		calculated = getWindowHashes(
+			state,
+			kernel,
+			(uint32_t)state->firstIndex + done,
+			count - done,
+			node->length,
+			hashes);
+		for (i = 0; nodeHash == NULL && i < calculated; i++) {
+			nodeHash = getMatchingHash(node, hashes[i]);
+		}
+		done += calculated;
+	}
+	// The loop increments past the window which was last looked up.
+	state->currentIndex = state->firstIndex + (int)(done - calculated + i) - 1;
+	state->hash = hashes[i - 1];
+	return nodeHash;
+}
+
 /**
  * Get the next node to evaluate from a node with multiple hash records, or
  * the device index if a leaf node has been reached. The current node and
@@ -662,6 +1104,7 @@ static void applyDrift(detectionState *state) {
  */
 static void evaluateListNode(detectionState *state) {
 	GraphNodeHash *nodeHash = NULL;
+	uint32_t windowCount;
 	int initialFirstIndex = state->firstIndex;
 	int initialLastIndex = state->lastIndex;
 
@@ -708,31 +1151,49 @@ static void evaluateListNode(detectionState *state) {
 		// A match was not found, and the drift feature is enabled, so
 		// search again in the extended range defined by the drift.
 		applyDrift(state);
-		if (setInitialHash(state)) {
+		windowCount = getWindowCount(state);
+		if (windowCount >= GRAPH_HASH_WINDOWS_MIN) {
+			nodeHash = getMatchingHashFromListNodeWindows(state, windowCount);
+		}
+		else if (setInitialHash(state)) {
 			do {
 				nodeHash = GraphGetMatchingHashFromListNode(
 					NODE(state),
 					state->hash);
 			} while (nodeHash == NULL && advanceHash(state));
-			if (nodeHash != NULL) {
-				// A match was found within the drift tolerance, so update
-				// the drift.
-				state->drift = MAX(
-					state->drift,
-					state->currentIndex < initialFirstIndex ?
-					initialFirstIndex - state->currentIndex :
-					state->currentIndex - initialLastIndex);
-			}
+		}
+		if (nodeHash != NULL) {
+			// A match was found within the drift tolerance, so update the
+			// drift.
+			state->drift = MAX(
+				state->drift,
+				state->currentIndex < initialFirstIndex ?
+				initialFirstIndex - state->currentIndex :
+				state->currentIndex - initialLastIndex);
 		}
 	}
 	else {
+		windowCount = getWindowCount(state);
+		if (windowCount >= GRAPH_HASH_WINDOWS_MIN) {
+			// Enough windows to calculate and look up the hash codes in
+			// blocks rather than rolling the hash.
+			nodeHash = getMatchingHashFromListNodeWindows(state, windowCount);
+		}
 		// Set the match structure with the initial hash value.
-		if (setInitialHash(state)) {
+		else if (setInitialHash(state)) {
 			// The table vs binary-search decision depends only on the node's
 			// modulo, which is constant for the duration of this scan. Resolve
 			// it once here rather than re-testing it for every rolled hash.
 			GraphNode * const node = NODE(state);
-			if (node->modulo == 0) {
+			if (node->modulo == 0 &&
+				hasFlatNodeFlag(state, node, GRAPH_NODE_FLAG_SEARCH)) {
+				do {
+					nodeHash = GraphGetMatchingHashFromListNodeLayout(
+						node,
+						state->hash);
+				} while (nodeHash == NULL && advanceHash(state));
+			}
+			else if (node->modulo == 0) {
 				// Loop between the first and last indexes checking the hash
 				// values.
 				do {
@@ -741,6 +1202,14 @@ static void evaluateListNode(detectionState *state) {
 						state->hash);
 				} while (nodeHash == NULL && advanceHash(state));
 			}
+			else if (GRAPH_NODE_IS_HASH_TABLE(node) &&
+				hasFlatNodeFlag(state, node, GRAPH_NODE_FLAG_MODULO)) {
+				do {
+					nodeHash = GraphGetMatchingHashFromListNodeTableModulo(
+						node,
+						state->hash);
+				} while (nodeHash == NULL && advanceHash(state));
+			}
 			else if (GRAPH_NODE_IS_HASH_TABLE(node)) {
 				do {
 					nodeHash = GraphGetMatchingHashFromListNodeTable(
@@ -785,7 +1254,7 @@ static void evaluateListNode(detectionState *state) {
  * @param match
  */
 static void evaluateBinaryNode(detectionState *state) {
-	uint32_t difference, currentDifference;
+	uint32_t difference, currentDifference, windowCount;
 	GraphNodeHash *hashes = HASHES(state);
 	int initialFirstIndex = state->firstIndex;
 	int initialLastIndex = state->lastIndex;
@@ -851,29 +1320,43 @@ static void evaluateBinaryNode(detectionState *state) {
 		// A match was not found, and the drift feature is enabled, so
 		// search again in the extended range defined by the drift.
 		applyDrift(state);
-		if (setInitialHash(state)) {
+		windowCount = getWindowCount(state);
+		if (windowCount >= GRAPH_HASH_WINDOWS_MIN) {
+			found = findHashInWindows(state, windowCount, hashes->hashCode);
+		}
+		else if (setInitialHash(state)) {
 			while (state->hash != hashes->hashCode && advanceHash(state)) {
 			}
-			if (state->hash == hashes->hashCode) {
-				// A match was found within the drift tolerance, so update the
-				// drift and set the found flag.
-				state->drift = MAX(
-					state->drift,
-					state->currentIndex < initialFirstIndex ?
-					initialFirstIndex - state->currentIndex :
-					state->currentIndex - initialLastIndex);
-				found = true;
-			}
+			found = state->hash == hashes->hashCode;
+		}
+		if (found) {
+			// A match was found within the drift tolerance, so update the
+			// drift.
+			state->drift = MAX(
+				state->drift,
+				state->currentIndex < initialFirstIndex ?
+				initialFirstIndex - state->currentIndex :
+				state->currentIndex - initialLastIndex);
 		}
 	}
 	else {
-		if (setInitialHash(state)) {
-			// Keep rolling the hash until the hash is found or the last index is
-			// reached and there is no possibility of finding the hash value.
-			while (state->hash != hashes->hashCode && advanceHash(state)) {
+		windowCount = getWindowCount(state);
+		if (windowCount >= GRAPH_HASH_WINDOWS_MIN) {
+			// Enough windows to calculate and compare the hash codes in
+			// blocks rather than rolling the hash.
+			found = findHashInWindows(state, windowCount, hashes->hashCode);
+		}
+		else {
+			if (setInitialHash(state)) {
+				// Keep rolling the hash until the hash is found or the last
+				// index is reached and there is no possibility of finding the
+				// hash value.
+				while (state->hash != hashes->hashCode &&
+					advanceHash(state)) {
+				}
 			}
+			found = state->hash == hashes->hashCode;
 		}
-		found = state->hash == hashes->hashCode;
 	}
 	
 	
@@ -903,15 +1386,28 @@ static void evaluateBinaryNode(detectionState *state) {
 	}
 }
 
-static bool processFromRoot(
+// Sets the state to the root node at the offset ready to evaluate the graph.
+// Returns false if the root node could not be fetched.
+static bool processFromRootStart(
 	DataSetHash *dataSet,
 	uint32_t rootNodeOffset,
 	detectionState *state) {
 	Exception *exception = state->exception;
-	int previouslyMatchedNodes = state->matchedNodes;
+	uint32_t flatOffset = 0;
 	state->currentDepth = 0;
+	if (dataSet->flatGraph != NULL) {
+		// Set the state to the root node in the flat graph.
+		flatOffset = GraphFlatGetRootOffset(dataSet->flatGraph, rootNodeOffset);
+		if (flatOffset == 0) {
+			EXCEPTION_SET(COLLECTION_FAILURE);
+			return false;
+		}
+		state->node.data.ptr = (byte*)GRAPH_FLAT_NODE(
+			dataSet->flatGraph,
+			flatOffset);
+	}
 	// Set the state to the current root node.
-	if (GraphGetNode(
+	else if (GraphGetNode(
 		dataSet->nodes,
 		rootNodeOffset,
 		&state->node,
@@ -925,24 +1421,110 @@ static bool processFromRoot(
 		// will check the exception.
 		return false;
 	}
+	
+	// Set the default flags and indexes.
+	state->firstIndex = NODE(state)->firstIndex;
+	state->lastIndex = NODE(state)->lastIndex;
+	state->complete = false;
+	addPathNode(
+		state,
+		0,
+		dataSet->flatGraph != NULL ? flatOffset : rootNodeOffset);
+	return true;
+}
+
+// Sets the state to the node in the path which is evaluated at the break
+// depth ready to retry evaluating the graph with difference or drift. The
+// nodes before the break depth are evaluated without difference or drift so
+// are those already recorded in the path. As the evaluation without
+// tolerances did not match any nodes, the nodes before the break depth would
+// only add to the iterations if evaluated again. Where the path is shorter
+// than the break depth the state is set to the last node in the path and the
+// nodes up to the break depth are evaluated again without tolerances. Returns
+// false if the node could not be fetched.
+static bool processFromBreakStart(
+	DataSetHash *dataSet,
+	detectionState *state) {
+	Exception *exception = state->exception;
+	const int depth = MIN(state->breakDepth, state->pathLength - 1);
+	const pathNode *node = &state->path[depth];
+	if (dataSet->flatGraph != NULL) {
+		state->node.data.ptr = (byte*)GRAPH_FLAT_NODE(
+			dataSet->flatGraph,
+			node->offset);
+	}
+	else if (GraphGetNode(
+		dataSet->nodes,
+		node->offset,
+		&state->node,
+		exception) == NULL) {
+		if (EXCEPTION_OKAY) {
+			EXCEPTION_SET(COLLECTION_FAILURE);
+		}
+		return false;
+	}
+	state->currentDepth = depth;
+	state->iterations += depth;
+	state->firstIndex = node->firstIndex;
+	state->lastIndex = node->lastIndex;
+	state->complete = false;
+	return true;
+}
+
+// Evaluates the current node of the state, moving the state to the next node
+// or setting the profile offset if a leaf has been reached.
+static void processNode(detectionState *state) {
+	if (NODE(state)->hashesCount == 1) {
+		// If there is only 1 hash then it's a binary node.
+		evaluateBinaryNode(state);
+	}
 	else {
-		// Set the default flags and indexes.
-		state->firstIndex = NODE(state)->firstIndex;
-		state->lastIndex = NODE(state)->lastIndex;
-		state->complete = false;
+		// More than 1 hash indicates a list node with multiple children.
+		evaluateListNode(state);
 	}
+	state->iterations++;
+	state->currentDepth++;
+}
 
+static bool processFromRoot(
+	DataSetHash *dataSet,
+	uint32_t rootNodeOffset,
+	detectionState *state) {
+	Exception *exception = state->exception;
+	int previouslyMatchedNodes = state->matchedNodes;
+	if (processFromRootStart(dataSet, rootNodeOffset, state) == false) {
+		return false;
+	}
 	do {
-		if (NODE(state)->hashesCount == 1) {
-			// If there is only 1 hash then it's a binary node.
-			evaluateBinaryNode(state);
-		}
-		else {
-			// More than 1 hash indicates a list node with multiple children.
-			evaluateListNode(state);
-		}
-		state->iterations++;
-		state->currentDepth++;
+		processNode(state);
+	} while (state->complete == false && EXCEPTION_OKAY);
+	if (EXCEPTION_OKAY == false) {
+		return false;
+	}
+	return state->matchedNodes > previouslyMatchedNodes;
+}
+
+// Retries evaluating the graph with the difference or drift tolerances from
+// the break depth, resuming from the node recorded in the path when the graph
+// was evaluated from the root node without tolerances. The outcome is the
+// same as processFromRoot.
+static bool processFromBreak(
+	DataSetHash *dataSet,
+	uint32_t rootNodeOffset,
+	detectionState *state) {
+	Exception *exception = state->exception;
+	int previouslyMatchedNodes = state->matchedNodes;
+
+	// Route tracing records every node evaluated so the graph is evaluated
+	// from the root node for the trace to be complete.
+	if (state->pathLength == 0 || dataSet->config.traceRoute) {
+		return processFromRoot(dataSet, rootNodeOffset, state);
+	}
+	if (processFromBreakStart(dataSet, state) == false) {
+		return false;
+	}
+	do {
+		processNode(state);
 	} while (state->complete == false && EXCEPTION_OKAY);
 	if (EXCEPTION_OKAY == false) {
 		return false;
@@ -950,6 +1532,85 @@ static bool processFromRoot(
 	return state->matchedNodes > previouslyMatchedNodes;
 }
 
+/**
+ * Evaluates the graph from the root node offset for each of the states. This
+ * produces the same outcome for each state as processFromRoot, but the states
+ * are advanced one node at a time in turn. When a state moves to its next
+ * node the node is prefetched but not read until the state's next turn, so
+ * that the memory access overlaps with the evaluation of the other states,
+ * rather than each state waiting for the node it needs. The number of states
+ * must not exceed FIFTYONE_DEGREES_HASH_BATCH_SIZE.
+ * @param dataSet containing the nodes
+ * @param rootNodeOffsets offset of the root node to start from for each state
+ * @param states to evaluate
+ * @param matched set to the result of processFromRoot for each state
+ * @param count number of states
+ */
+static void processFromRootInterleaved(
+	DataSetHash *dataSet,
+	const uint32_t *rootNodeOffsets,
+	detectionState **states,
+	bool *matched,
+	uint32_t count) {
+	uint32_t i, remaining = 0;
+	detectionState *state;
+	Exception *exception;
+	bool active[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	int previouslyMatchedNodes[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+
+	// Set all the states to their root nodes, deferring reading the nodes
+	// they move to.
+	for (i = 0; i < count; i++) {
+		previouslyMatchedNodes[i] = states[i]->matchedNodes;
+		states[i]->deferNode = true;
+		active[i] = processFromRootStart(
+			dataSet,
+			rootNodeOffsets[i],
+			states[i]);
+		if (active[i]) {
+			remaining++;
+		}
+	}
+
+	// Advance each of the states that have not completed by one node until
+	// all are complete. Each turn first enters the node the state moved to on
+	// its previous turn, which has been prefetched while the other states
+	// were evaluated, and then evaluates it. The next node is only found and
+	// prefetched, and not read until the state's next turn.
+	while (remaining > 0) {
+		for (i = 0; i < count; i++) {
+			if (active[i]) {
+				state = states[i];
+				exception = state->exception;
+				if (state->nodePending) {
+					enterNode(state, state->currentDepth, state->pendingOffset);
+				}
+				processNode(state);
+				if (state->complete == true || EXCEPTION_FAILED) {
+					active[i] = false;
+					remaining--;
+				}
+				else {
+					GRAPH_NODE_PREFETCH(NODE(state));
+				}
+			}
+		}
+	}
+
+	// Any retries read each node as they move to it.
+	for (i = 0; i < count; i++) {
+		states[i]->deferNode = false;
+		states[i]->nodePending = false;
+	}
+
+	// Set the matched flag in the same way as processFromRoot.
+	for (i = 0; i < count; i++) {
+		exception = states[i]->exception;
+		matched[i] = EXCEPTION_OKAY &&
+			states[i]->matchedNodes > previouslyMatchedNodes[i];
+	}
+}
+
 #ifdef DEBUG
 static void addTraceRootName(
 	detectionState *state,
@@ -978,14 +1639,13 @@ static void addTraceRootName(
 }
 #endif
 
-static bool processRoot(
+// Where processing from the root node did not result in a match then retry
+// allowing for the difference and drift configured.
+static bool processRootRetries(
 	detectionState* state,
 	DataSetHash* dataSet,
 	uint32_t rootNodeOffset) {
-	
-	// Initial result without drift or difference being applied.
-	bool matched = processFromRoot(dataSet, rootNodeOffset, state);
-	if (matched) return true;
+	bool matched = false;
 
 	// Record the depth in case more attempts are needed.
 	int depth = state->currentDepth;
@@ -995,7 +1655,7 @@ static bool processRoot(
 		state->allowedDifference = dataSet->config.difference;
 		state->breakDepth = depth;
 		while (matched == false && state->breakDepth > 0) {
-			matched = processFromRoot(dataSet, rootNodeOffset, state);
+			matched = processFromBreak(dataSet, rootNodeOffset, state);
 			state->breakDepth--;
 		}
 		state->allowedDifference = 0;
@@ -1008,7 +1668,7 @@ static bool processRoot(
 		state->breakDepth = depth;
 		while (matched == false && state->breakDepth > 0) {
 
-			matched = processFromRoot(dataSet, rootNodeOffset, state);
+			matched = processFromBreak(dataSet, rootNodeOffset, state);
 			state->breakDepth--;
 		}
 		state->allowedDrift = 0;
@@ -1022,7 +1682,7 @@ static bool processRoot(
 		state->allowedDrift = dataSet->config.drift;
 		state->breakDepth = depth;
 		while (matched == false && state->breakDepth > 0) {
-			matched = processFromRoot(dataSet, rootNodeOffset, state);
+			matched = processFromBreak(dataSet, rootNodeOffset, state);
 			state->breakDepth--;
 		}
 		state->allowedDifference = 0;
@@ -1031,6 +1691,19 @@ static bool processRoot(
 	return matched;
 }
 
+static bool processRoot(
+	detectionState* state,
+	DataSetHash* dataSet,
+	uint32_t rootNodeOffset) {
+	
+	// Initial result without drift or difference being applied.
+	bool matched = processFromRoot(dataSet, rootNodeOffset, state);
+	if (matched) return true;
+
+	// Try again with any difference and drift configured.
+	return processRootRetries(state, dataSet, rootNodeOffset);
+}
+
 static bool processRoots(
 	detectionState *state,
 	DataSetHash *dataSet,
@@ -1100,36 +1773,209 @@ static bool processRoots(
 }
 
 /**
- * DATA INITIALISE AND RESET METHODS
+ * Performs the same evaluation as processRoots for each of the states where the
+ * states relate to the same component. The initial evaluation of each graph is
+ * performed for all the states together using processFromRootInterleaved. Any
+ * retries with difference or drift are rare and are performed for each state
+ * in turn. Route tracing is not supported.
+ * @param states to evaluate
+ * @param dataSet containing the graphs
+ * @param componentIndex index of the component all the states relate to
+ * @param component all the states relate to
+ * @param rootNodes for each of the states
+ * @param matched set to the result of processRoots for each state
+ * @param count number of states
  */
+static void processRootsInterleaved(
+	detectionState **states,
+	DataSetHash *dataSet,
+	uint32_t componentIndex,
+	Component *component,
+	HashRootNodes **rootNodes,
+	bool *matched,
+	uint32_t count) {
+	uint32_t i, remaining = 0;
+	detectionState *remainingStates[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	uint32_t remainingIndexes[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	uint32_t offsets[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	bool remainingMatched[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	Exception *exception;
 
-static void resetDataSet(DataSetHash *dataSet) {
-	DataSetDeviceDetectionReset(&dataSet->b);
-	ListReset(&dataSet->componentsList);
-	dataSet->componentsAvailable = NULL;
-	dataSet->componentHeaders = NULL;
-	dataSet->components = NULL;
-	dataSet->maps = NULL;
-	dataSet->rootNodes = NULL;
-	dataSet->nodes = NULL;
-	dataSet->profileOffsets = NULL;
-	dataSet->profiles = NULL;
-	dataSet->properties = NULL;
-	dataSet->strings = NULL;
-	dataSet->values = NULL;
-}
-
-static void freeDataSet(void *dataSetPtr) {
-	DataSetHash *dataSet = (DataSetHash*)dataSetPtr;
+	for (i = 0; i < count; i++) {
+		matched[i] = false;
+	}
 
-	// Free the component headers.
-	if (dataSet->componentHeaders != NULL) {
-		for (uint32_t i = 0; i < dataSet->componentsList.count; i++) {
-			Free(dataSet->componentHeaders[i]);
+	// First try searching in the performance graph if it is enabled.
+	if (dataSet->config.usePerformanceGraph == true) {
+		for (i = 0; i < count; i++) {
+			offsets[i] = rootNodes[i]->performanceNodeOffset;
+		}
+		processFromRootInterleaved(dataSet, offsets, states, matched, count);
+		for (i = 0; i < count; i++) {
+			exception = states[i]->exception;
+			if (matched[i] == false && EXCEPTION_OKAY) {
+				matched[i] = processRootRetries(
+					states[i],
+					dataSet,
+					offsets[i]);
+			}
+			if (matched[i]) {
+				states[i]->performanceMatches++;
+			}
+		}
+	}
+
+	// Now try searching in the predictive graph if it is enabled for the
+	// states where there was no match found in the performance graph.
+	if (dataSet->config.usePredictiveGraph == true) {
+		for (i = 0; i < count; i++) {
+			if (matched[i] == false) {
+				remainingStates[remaining] = states[i];
+				remainingIndexes[remaining] = i;
+				offsets[remaining] = rootNodes[i]->predictiveNodeOffset;
+				remaining++;
+			}
+		}
+		processFromRootInterleaved(
+			dataSet,
+			offsets,
+			remainingStates,
+			remainingMatched,
+			remaining);
+		for (i = 0; i < remaining; i++) {
+			exception = remainingStates[i]->exception;
+			if (remainingMatched[i] == false && EXCEPTION_OKAY) {
+				remainingMatched[i] = processRootRetries(
+					remainingStates[i],
+					dataSet,
+					offsets[i]);
+			}
+			if (remainingMatched[i]) {
+				remainingStates[i]->predictiveMatches++;
+			}
+			matched[remainingIndexes[i]] = remainingMatched[i];
+		}
+	}
+
+	// If there is still no matched node and the unmatched (or default) not and
+	// profile should be returned then set the profile offset for the component
+	// to the default.
+	if (dataSet->config.b.allowUnmatched) {
+		for (i = 0; i < count; i++) {
+			if (matched[i] == false) {
+				states[i]->result->profileOffsets[componentIndex] =
+					component->defaultProfileOffset;
+			}
+		}
+	}
+}
+
+/**
+ * DATA INITIALISE AND RESET METHODS
+ */
+
+static void freeValueTable(HashValueTable *table) {
+	if (table->slotOffsets != NULL) {
+		Free(table->slotOffsets);
+	}
+	if (table->slotRows != NULL) {
+		Free(table->slotRows);
+	}
+	if (table->propertyCells != NULL) {
+		Free(table->propertyCells);
+	}
+	if (table->propertyComponents != NULL) {
+		Free(table->propertyComponents);
+	}
+	if (table->cells != NULL) {
+		Free(table->cells);
+	}
+	if (table->values != NULL) {
+		Free((void*)table->values);
+	}
+	if (table->strings != NULL) {
+		Free(table->strings);
+	}
+	Free(table);
+}
+
+static void freeProfileIdTable(HashProfileIdTable *table) {
+	if (table->offsets != NULL) {
+		Free(table->offsets);
+	}
+	if (table->componentIndexes != NULL) {
+		Free(table->componentIndexes);
+	}
+	if (table->slotOffsets != NULL) {
+		Free(table->slotOffsets);
+	}
+	if (table->slotProfileIds != NULL) {
+		Free(table->slotProfileIds);
+	}
+	Free(table);
+}
+
+static void freeProfileValueIndex(HashProfileValueIndex *index) {
+	if (index->firstOffsets != NULL) {
+		Free(index->firstOffsets);
+	}
+	if (index->offsets != NULL) {
+		Free(index->offsets);
+	}
+	Free(index);
+}
+
+static void resetDataSet(DataSetHash *dataSet) {
+	DataSetDeviceDetectionReset(&dataSet->b);
+	ListReset(&dataSet->componentsList);
+	dataSet->componentsAvailable = NULL;
+	dataSet->componentHeaders = NULL;
+	dataSet->componentRootNodes = NULL;
+	dataSet->components = NULL;
+	dataSet->maps = NULL;
+	dataSet->rootNodes = NULL;
+	dataSet->nodes = NULL;
+	dataSet->flatGraph = NULL;
+	dataSet->sharedGraphGeneration = 0;
+	dataSet->resultCache = NULL;
+	dataSet->valueTable = NULL;
+	dataSet->profileIdTable = NULL;
+	dataSet->profileValueIndex = NULL;
+	dataSet->requiredPropertyIndexes = NULL;
+	dataSet->jsonProperties = NULL;
+	dataSet->profileOffsets = NULL;
+	dataSet->profiles = NULL;
+	dataSet->properties = NULL;
+	dataSet->strings = NULL;
+	dataSet->values = NULL;
+	MappedFileReset(&dataSet->mappedFile);
+	HugePagesReset(&dataSet->hugePagesMemory);
+	memset(&dataSet->hugePages, 0, sizeof(HashHugePages));
+	dataSet->fileStartByte = NULL;
+}
+
+static void freeDataSet(void *dataSetPtr) {
+	DataSetHash *dataSet = (DataSetHash*)dataSetPtr;
+
+	// Free the component headers.
+	if (dataSet->componentHeaders != NULL) {
+		for (uint32_t i = 0; i < dataSet->componentsList.count; i++) {
+			Free(dataSet->componentHeaders[i]);
 		}
 		Free(dataSet->componentHeaders);
 	}
 
+	// Free the root nodes for each component and header.
+	if (dataSet->componentRootNodes != NULL) {
+		Free(dataSet->componentRootNodes);
+	}
+
+	// Remove any mapping of the data file before the common data set fields
+	// are freed, as a temporary file can't be deleted on all platforms while
+	// it is mapped. Nothing reads from the collections once freeing starts.
+	MappedFileClose(&dataSet->mappedFile);
+	HugePagesFree(&dataSet->hugePagesMemory);
+
 	// Free the common data set fields.
 	DataSetDeviceDetectionFree(&dataSet->b);
 
@@ -1147,6 +1993,34 @@ static void freeDataSet(void *dataSetPtr) {
 	FIFTYONE_DEGREES_COLLECTION_FREE(dataSet->profiles);
 	FIFTYONE_DEGREES_COLLECTION_FREE(dataSet->rootNodes);
 	FIFTYONE_DEGREES_COLLECTION_FREE(dataSet->nodes);
+	if (dataSet->flatGraph != NULL) {
+		GraphFlatFree(dataSet->flatGraph);
+		dataSet->flatGraph = NULL;
+	}
+	if (dataSet->resultCache != NULL) {
+		ResultCacheFree(dataSet->resultCache);
+		dataSet->resultCache = NULL;
+	}
+	if (dataSet->valueTable != NULL) {
+		freeValueTable(dataSet->valueTable);
+		dataSet->valueTable = NULL;
+	}
+	if (dataSet->profileIdTable != NULL) {
+		freeProfileIdTable(dataSet->profileIdTable);
+		dataSet->profileIdTable = NULL;
+	}
+	if (dataSet->profileValueIndex != NULL) {
+		freeProfileValueIndex(dataSet->profileValueIndex);
+		dataSet->profileValueIndex = NULL;
+	}
+	if (dataSet->requiredPropertyIndexes != NULL) {
+		Free(dataSet->requiredPropertyIndexes);
+		dataSet->requiredPropertyIndexes = NULL;
+	}
+	if (dataSet->jsonProperties != NULL) {
+		Free(dataSet->jsonProperties);
+		dataSet->jsonProperties = NULL;
+	}
 	FIFTYONE_DEGREES_COLLECTION_FREE(dataSet->profileOffsets);
 
 	// Finally free the memory used by the resource itself as this is always
@@ -1559,6 +2433,61 @@ static bool initComponentHeaders(
 	return true;
 }
 
+/**
+ * Copies the root nodes for every component and unique header into a table
+ * indexed by component index and then header index, so that detection finds
+ * the root nodes without searching the component's key value pairs or
+ * getting the root nodes from the collection. Where the component has no
+ * graph for the header the offsets are NULL_ROOT_NODE_OFFSET.
+ */
+static StatusCode initComponentRootNodes(
+	DataSetHash *dataSet,
+	Exception *exception) {
+	Item item;
+	Component *component;
+	HashRootNodes *rootNodes, *entry;
+	const ComponentKeyValuePair *graphKey;
+	uint32_t c, h;
+	int i;
+	const uint32_t headersCount = dataSet->b.b.uniqueHeaders->count;
+	const uint32_t count = dataSet->componentsList.count * headersCount;
+	dataSet->componentRootNodes = (HashRootNodes*)Malloc(
+		sizeof(HashRootNodes) * (count + 1));
+	if (dataSet->componentRootNodes == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+	DataReset(&item.data);
+	for (c = 0; c < dataSet->componentsList.count; c++) {
+		component = COMPONENT(dataSet, c);
+		for (h = 0; h < headersCount; h++) {
+			entry = &dataSet->componentRootNodes[c * headersCount + h];
+			entry->performanceNodeOffset = NULL_ROOT_NODE_OFFSET;
+			entry->predictiveNodeOffset = NULL_ROOT_NODE_OFFSET;
+			graphKey = &component->firstKeyValuePair;
+			for (i = 0; i < component->keyValuesCount; i++) {
+				if (dataSet->b.b.uniqueHeaders->items[h].headerId ==
+					graphKey[i].key) {
+					rootNodes = getRootNodes(
+						dataSet,
+						graphKey[i].value,
+						&item,
+						exception);
+					if (rootNodes == NULL || EXCEPTION_FAILED) {
+						if (rootNodes != NULL) {
+							COLLECTION_RELEASE(dataSet->rootNodes, &item);
+						}
+						return COLLECTION_FAILURE;
+					}
+					*entry = *rootNodes;
+					COLLECTION_RELEASE(dataSet->rootNodes, &item);
+					break;
+				}
+			}
+		}
+	}
+	return SUCCESS;
+}
+
 // Initialize the gethighentropyvalues check feature that prevents the GHEV
 // javascript being returned as a value if all the required headers are already
 // present.
@@ -1708,11 +2637,125 @@ static StatusCode initWithMemory(
 	return status;
 }
 
+/**
+ * Binds the memory to the NUMA node in the configuration if there is one.
+ * Returns INVALID_CONFIG if the memory could not be bound to the node.
+ */
+static StatusCode bindToNumaNode(
+	DataSetHash *dataSet,
+	byte *startByte,
+	size_t length) {
+	if (dataSet->config.numaNode >= 0 &&
+		NumaBind(
+			startByte,
+			length,
+			(uint32_t)dataSet->config.numaNode) == false) {
+		return INVALID_CONFIG;
+	}
+	return SUCCESS;
+}
+
+/**
+ * Sets the type of pages backing each collection which points into the memory
+ * starting at the byte provided.
+ */
+static void setHugePages(
+	DataSetHash *dataSet,
+	const byte *startByte,
+	HugePagesType type) {
+	const DataSetHashHeader *header = &dataSet->header;
+	HashHugePages *pages = &dataSet->hugePages;
+#define SET_HUGE_PAGES(n) pages->n = HugePagesGetType( \
+	type, \
+	startByte + header->n.startPosition, \
+	header->n.length);
+	SET_HUGE_PAGES(strings)
+	SET_HUGE_PAGES(components)
+	SET_HUGE_PAGES(maps)
+	SET_HUGE_PAGES(properties)
+	SET_HUGE_PAGES(values)
+	SET_HUGE_PAGES(profiles)
+	SET_HUGE_PAGES(rootNodes)
+	SET_HUGE_PAGES(nodes)
+	SET_HUGE_PAGES(profileOffsets)
+#undef SET_HUGE_PAGES
+}
+
+/**
+ * Reads the data file into memory from the operating system, backed by huge
+ * pages if enabled, and initialises the collections to point into it.
+ */
+static StatusCode initPages(
+	DataSetHash *dataSet,
+	Exception *exception) {
+	MemoryReader reader;
+	FILE *file;
+	long length;
+	StatusCode status = FileOpen(dataSet->b.b.fileName, &file);
+	if (status != SUCCESS) {
+		return status;
+	}
+	if (fseek(file, 0, SEEK_END) != 0 ||
+		(length = ftell(file)) <= 0 ||
+		fseek(file, 0, SEEK_SET) != 0) {
+		fclose(file);
+		return FILE_FAILURE;
+	}
+	if (dataSet->config.hugePages == true) {
+		status = HugePagesAlloc(&dataSet->hugePagesMemory, (size_t)length);
+	}
+	else {
+		status = HugePagesAllocNormal(
+			&dataSet->hugePagesMemory,
+			(size_t)length);
+	}
+	if (status == SUCCESS) {
+		// Bind before the pages are first written so they are allocated on
+		// the node rather than moved to it.
+		status = bindToNumaNode(
+			dataSet,
+			dataSet->hugePagesMemory.startByte,
+			(size_t)length);
+	}
+	if (status == SUCCESS &&
+		fread(dataSet->hugePagesMemory.startByte,
+			(size_t)length,
+			1,
+			file) != 1) {
+		status = FILE_FAILURE;
+	}
+	fclose(file);
+	if (status != SUCCESS) {
+		return status;
+	}
+
+	// Use the memory reader to initialize the Hash data set.
+	reader.startByte = reader.current = dataSet->hugePagesMemory.startByte;
+	dataSet->fileStartByte = reader.startByte;
+	reader.length = length;
+	reader.lastByte = reader.current + length;
+	status = initWithMemory(dataSet, &reader, exception);
+	if (status == SUCCESS) {
+		setHugePages(
+			dataSet,
+			dataSet->hugePagesMemory.startByte,
+			dataSet->hugePagesMemory.type);
+	}
+	return status;
+}
+
 static StatusCode initInMemory(
 	DataSetHash *dataSet,
 	Exception *exception) {
 	MemoryReader reader;
 
+	// Read the data file into memory from the operating system instead if
+	// it is to be backed by huge pages, or bound to a NUMA node before it is
+	// read.
+	if (dataSet->config.hugePages == true || dataSet->config.numaNode >= 0) {
+		return initPages(dataSet, exception);
+	}
+
 	// Read the data from the source file into memory using the reader to
 	// store the pointer to the first and last bytes.
 	StatusCode status = DataSetInitInMemory(
@@ -1721,6 +2764,7 @@ static StatusCode initInMemory(
 	if (status != SUCCESS) {
 		return status;
 	}
+	dataSet->fileStartByte = reader.startByte;
 
 	// Use the memory reader to initialize the Hash data set.
 	status = initWithMemory(dataSet, &reader, exception);
@@ -1728,6 +2772,42 @@ static StatusCode initInMemory(
 	return status;
 }
 
+/**
+ * Maps the data file and initialises the collections to point into the
+ * mapping, rather than into a copy of the file read into memory.
+ */
+static StatusCode initMappedFile(
+	DataSetHash *dataSet,
+	Exception *exception) {
+	MemoryReader reader;
+	StatusCode status = MappedFileOpen(
+		&dataSet->mappedFile,
+		dataSet->b.b.fileName,
+		dataSet->config.prefaultMappedFile);
+	if (status != SUCCESS) {
+		return status;
+	}
+
+	// Use the memory reader to initialize the Hash data set.
+	reader.startByte = reader.current = dataSet->mappedFile.startByte;
+	dataSet->fileStartByte = reader.startByte;
+	reader.length = (long)dataSet->mappedFile.length;
+	reader.lastByte = reader.current + dataSet->mappedFile.length;
+	status = initWithMemory(dataSet, &reader, exception);
+	if (status == SUCCESS && dataSet->config.hugePages == true) {
+		// Transparent huge pages will only be used for the mapping if the
+		// operating system supports them for files, so the collections are
+		// only reported as advised.
+		setHugePages(
+			dataSet,
+			dataSet->mappedFile.startByte,
+			HugePagesAdvise(
+				dataSet->mappedFile.startByte,
+				dataSet->mappedFile.length));
+	}
+	return status;
+}
+
 static void initDataSet(DataSetHash *dataSet, ConfigHash **config) {
 	EXCEPTION_CREATE
 
@@ -1895,381 +2975,646 @@ static StatusCode initWithFile(DataSetHash *dataSet, Exception *exception) {
 
 #endif
 
-static StatusCode initDataSetFromFile(
-	void *dataSetBase,
-	const void *configBase,
-	PropertiesRequired *properties,
-	const char *fileName,
-	Exception *exception) {
-	DataSetHash *dataSet = (DataSetHash*)dataSetBase;
-	ConfigHash *config = (ConfigHash*)configBase;
-	StatusCode status = NOT_SET;
+/**
+ * Returns the options which change the flat graph, as recorded in a shared
+ * graph file.
+ */
+static uint32_t getSharedGraphOptions(const DataSetHash *dataSet) {
+	return (dataSet->config.optimiseNodeLayout ? 1 : 0) |
+		(dataSet->config.optimiseNodeSearch ? 2 : 0) |
+		(dataSet->config.optimiseNodeModulo ? 4 : 0) |
+		(dataSet->config.difference > 0 ? 8 : 0) |
+		(dataSet->config.pruneGraph ? 16 : 0);
+}
 
-	// Common data set initialisation actions.
-	initDataSet(dataSet, &config);
+/**
+ * Adds the bytes to the FNV-1a hash.
+ */
+static uint64_t addToSharedGraphSource(
+	uint64_t hash,
+	const void *bytes,
+	size_t length) {
+	const byte *current = (const byte*)bytes;
+	const byte *end = current + length;
+	while (current < end) {
+		hash = (hash ^ *current++) * 1099511628211ULL;
+	}
+	return hash;
+}
 
-	// Initialise the super data set with the filename and configuration
-	// provided.
-	status = DataSetInitFromFile(
-		&dataSet->b.b,
-		fileName,
+/**
+ * Returns a FNV-1a hash of the data set header which identifies the data file
+ * a shared graph file was built from. A pruned graph only has the roots of
+ * the graphs and components in use, so these are included as well.
+ */
+static uint64_t getSharedGraphSource(const DataSetHash *dataSet) {
+	uint64_t hash = addToSharedGraphSource(
+		14695981039346656037ULL,
+		&dataSet->header,
 		sizeof(DataSetHashHeader));
-	if (status != SUCCESS) {
-		freeDataSet(dataSet);
-		return status;
-	}
-
-	// If there is no collection configuration then the entire data file should
-	// be loaded into memory. Otherwise use the collection configuration to
-	// partially load data into memory and cache the rest.
-	if (config->b.b.allInMemory == true) {
-		status = initInMemory(dataSet, exception);
-	}
-	else {
-#ifndef FIFTYONE_DEGREES_MEMORY_ONLY
-		status = initWithFile(dataSet, exception);
-#else
-		status = INVALID_CONFIG;
-#endif
-	}
+	if (dataSet->config.pruneGraph == true) {
+		hash = addToSharedGraphSource(
+			hash,
+			dataSet->componentsAvailable,
+			sizeof(bool) * dataSet->componentsList.count);
+		hash = addToSharedGraphSource(
+			hash,
+			&dataSet->config.usePerformanceGraph,
+			sizeof(bool));
+		hash = addToSharedGraphSource(
+			hash,
+			&dataSet->config.usePredictiveGraph,
+			sizeof(bool));
+	}
+	return hash;
+}
 
-	// Return the status code if something has gone wrong.
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		freeDataSet(dataSet);
-		// Delete the temp file if one has been created.
-		if (config->b.b.useTempFile == true) {
-			FileDelete(dataSet->b.b.fileName);
+/**
+ * Returns true if the root nodes at the index are evaluated for any of the
+ * components with available properties.
+ */
+static bool isRootNodesUsed(const DataSetHash *dataSet, uint32_t index) {
+	uint32_t c;
+	int i;
+	Component *component;
+	const ComponentKeyValuePair *graphKey;
+	for (c = 0; c < dataSet->componentsList.count; c++) {
+		component = COMPONENT(dataSet, c);
+		if (component != NULL && dataSet->componentsAvailable[c] == true) {
+			graphKey = &component->firstKeyValuePair;
+			for (i = 0; i < component->keyValuesCount; i++) {
+				if (graphKey[i].value == index) {
+					return true;
+				}
+			}
 		}
-		return status;
 	}
+	return false;
+}
 
-	// Initialise the required properties and headers and check the
-	// initialisation was successful.
-	status = initPropertiesAndHeaders(dataSet, properties, exception);
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		freeDataSet(dataSet);
-		// Delete the temp file if one has been created.
-		if (config->b.b.useTempFile == true) {
-			FileDelete(dataSet->b.b.fileName);
+/**
+ * Returns the index of the component which evaluates the root nodes at the
+ * index, or zero if no component evaluates them.
+ */
+static uint32_t getRootNodesComponentIndex(
+	const DataSetHash *dataSet,
+	uint32_t index) {
+	uint32_t c;
+	int i;
+	Component *component;
+	const ComponentKeyValuePair *graphKey;
+	for (c = 0; c < dataSet->componentsList.count; c++) {
+		component = COMPONENT(dataSet, c);
+		if (component != NULL) {
+			graphKey = &component->firstKeyValuePair;
+			for (i = 0; i < component->keyValuesCount; i++) {
+				if (graphKey[i].value == index) {
+					return c;
+				}
+			}
 		}
-		return status;
 	}
+	return 0;
+}
 
-	// Initialise the components available to flag which components have
-	// properties which are to be returned (i.e. available properties).
-	status = initComponentsAvailable(dataSet, exception);
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		freeDataSet(dataSet);
-		if (config->b.b.useTempFile == true) {
-			FileDelete(dataSet->b.b.fileName);
+/**
+ * Frees the nodes collection once the flat graph has been compiled and the
+ * pruneGraph option is enabled, as detection then only uses the flat graph.
+ * Freeing the collection releases the memory it allocated, whether that is
+ * all the nodes, a cache of them, or nothing when they are read from the
+ * file. When the collection points into the data file held by the data set
+ * the pages holding the nodes are also discarded.
+ */
+static void releaseNodes(DataSetHash *dataSet) {
+	if (dataSet->config.pruneGraph == true && dataSet->flatGraph != NULL) {
+		if (dataSet->fileStartByte != NULL) {
+			MappedFileDiscard(
+				dataSet->fileStartByte + dataSet->header.nodes.startPosition,
+				dataSet->header.nodes.length);
 		}
-		return status;
+		FIFTYONE_DEGREES_COLLECTION_FREE(dataSet->nodes);
+		dataSet->nodes = NULL;
 	}
+}
 
-	// Check there are properties available for retrieval.
-	if (dataSet->b.b.available->count == 0) {
-		freeDataSet(dataSet);
-		// Delete the temp file if one has been created.
-		if (config->b.b.useTempFile == true) {
-			FileDelete(dataSet->b.b.fileName);
-		}
-		return REQ_PROP_NOT_PRESENT;
+/**
+ * Advises the operating system to use huge pages for the nodes of the flat
+ * graph if the hugePages option is enabled.
+ */
+static void adviseFlatGraph(DataSetHash *dataSet) {
+	if (dataSet->config.hugePages == true) {
+		dataSet->hugePages.flatGraph = HugePagesAdvise(
+			dataSet->flatGraph->nodes,
+			dataSet->flatGraph->size);
 	}
+}
 
-	// Initialise the index for properties and profiles to values.
-	initIndicesPropertyProfile(dataSet, exception);
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		freeDataSet(dataSet);
-		if (config->b.b.useTempFile == true) {
-			FileDelete(dataSet->b.b.fileName);
-		}
-		return status;
+/**
+ * Checks that the root nodes of the components with required properties were
+ * retained if the data file was written by fiftyoneDegreesHashTrimNodes,
+ * which marks the nodes it writes. Root nodes which were not retained
+ * reference one of the nodes which never match, which are ahead of the nodes
+ * retained. If neither graph of a component was retained then none of its
+ * properties were required when the file was trimmed, so the properties
+ * requested are not present. If only a graph in use was not retained then the
+ * configuration does not match the file.
+ */
+static StatusCode checkRootNodesRetained(
+	DataSetHash *dataSet,
+	Exception *exception) {
+	StatusCode status = SUCCESS;
+	uint32_t c, trimmedStart;
+	int i;
+	bool performance, predictive;
+	Item item;
+	HashRootNodes *rootNodes;
+	Component *component;
+	const ComponentKeyValuePair *graphKey;
+	trimmedStart = GraphGetTrimmedStart(
+		dataSet->nodes,
+		dataSet->header.nodes.length,
+		exception);
+	if (EXCEPTION_FAILED) {
+		return COLLECTION_FAILURE;
 	}
-
-	// Initialise the headers for each component.
-	if (!initComponentHeaders(dataSet, exception) || EXCEPTION_FAILED) {
-		freeDataSet(dataSet);
-		if (config->b.b.useTempFile == true) {
-			FileDelete(dataSet->b.b.fileName);
+	if (trimmedStart == 0) {
+		return SUCCESS;
+	}
+	for (c = 0; c < dataSet->componentsList.count && status == SUCCESS; c++) {
+		component = COMPONENT(dataSet, c);
+		if (component == NULL || dataSet->componentsAvailable[c] == false) {
+			continue;
+		}
+		graphKey = &component->firstKeyValuePair;
+		for (i = 0; i < component->keyValuesCount && status == SUCCESS; i++) {
+			DataReset(&item.data);
+			rootNodes = getRootNodes(
+				dataSet,
+				graphKey[i].value,
+				&item,
+				exception);
+			if (rootNodes == NULL || EXCEPTION_FAILED) {
+				return COLLECTION_FAILURE;
+			}
+			performance = rootNodes->performanceNodeOffset < trimmedStart;
+			predictive = rootNodes->predictiveNodeOffset < trimmedStart;
+			COLLECTION_RELEASE(dataSet->rootNodes, &item);
+			if (performance && predictive) {
+				status = REQ_PROP_NOT_PRESENT;
+			}
+			else if ((performance && dataSet->config.usePerformanceGraph) ||
+				(predictive && dataSet->config.usePredictiveGraph)) {
+				status = INVALID_CONFIG;
+			}
 		}
-		return status;
 	}
-
-	initGetHighEntropyValues(dataSet, exception);
-
 	return status;
 }
 
-fiftyoneDegreesStatusCode fiftyoneDegreesHashInitManagerFromFile(
-	fiftyoneDegreesResourceManager *manager,
-	fiftyoneDegreesConfigHash *config,
-	fiftyoneDegreesPropertiesRequired *properties,
-	const char *fileName,
-	fiftyoneDegreesException *exception) {
-
-	if (config->usePerformanceGraph == false &&
-		config->usePredictiveGraph == false) {
-		return INVALID_CONFIG;
-	}
-
-	DataSetHash *dataSet = (DataSetHash*)Malloc(sizeof(DataSetHash));
-	if (dataSet == NULL) {
+/**
+ * Compiles the nodes collection into a flat graph if the option is enabled,
+ * or if the node layout, search or modulo is to be optimised which needs the
+ * nodes to be moved.
+ * The root nodes are the only nodes which are found by offset from outside
+ * the graph, so their offsets are provided to the flat graph to translate.
+ * When the graph is pruned only the roots of the graphs and components in
+ * use are provided, so the nodes which can't be reached from them are not
+ * included.
+ */
+static StatusCode initFlatGraph(DataSetHash *dataSet, Exception *exception) {
+	StatusCode status = SUCCESS;
+	HashRootNodes *rootNodes;
+	Item item;
+	uint32_t i, rootsCount = 0, count = dataSet->header.rootNodes.count;
+	uint32_t *rootOffsets;
+	const bool prune = dataSet->config.pruneGraph;
+	if (dataSet->config.flatGraph == false &&
+		dataSet->config.optimiseNodeLayout == false &&
+		dataSet->config.optimiseNodeSearch == false &&
+		dataSet->config.optimiseNodeModulo == false &&
+		dataSet->config.sharedGraphFile == NULL &&
+		prune == false) {
+		return SUCCESS;
+	}
+
+	// Use the graph already built by another process if there is one for
+	// the same data file and options. Otherwise build it as normal. The
+	// generation of the file is recorded either way, so a file which could
+	// not be used is not reported as changed until it is saved again.
+	if (dataSet->config.sharedGraphFile != NULL) {
+		dataSet->sharedGraphGeneration = GraphFlatGetGeneration(
+			dataSet->config.sharedGraphFile);
+	}
+	if (dataSet->config.sharedGraphFile != NULL &&
+		GraphFlatAttach(
+			dataSet->config.sharedGraphFile,
+			getSharedGraphOptions(dataSet),
+			getSharedGraphSource(dataSet),
+			&dataSet->flatGraph) == SUCCESS) {
+		dataSet->sharedGraphGeneration = dataSet->flatGraph->generation;
+		adviseFlatGraph(dataSet);
+		releaseNodes(dataSet);
+		return SUCCESS;
+	}
+
+	// A data file without root nodes has no graph to compile. The nodes
+	// collection is used as normal.
+	if (count == 0) {
+		return SUCCESS;
+	}
+	rootOffsets = (uint32_t*)Malloc(count * 2 * sizeof(uint32_t));
+	if (rootOffsets == NULL) {
 		return INSUFFICIENT_MEMORY;
 	}
-
-	StatusCode status = initDataSetFromFile(
-		dataSet,
-		config,
-		properties,
-		fileName,
-		exception);
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		return status;
+	DataReset(&item.data);
+	for (i = 0; i < count && status == SUCCESS; i++) {
+		if (prune && isRootNodesUsed(dataSet, i) == false) {
+			continue;
+		}
+		rootNodes = getRootNodes(dataSet, i, &item, exception);
+		if (rootNodes == NULL || EXCEPTION_FAILED) {
+			status = COLLECTION_FAILURE;
+		}
+		else {
+			if (prune == false || dataSet->config.usePerformanceGraph) {
+				rootOffsets[rootsCount++] = rootNodes->performanceNodeOffset;
+			}
+			if (prune == false || dataSet->config.usePredictiveGraph) {
+				rootOffsets[rootsCount++] = rootNodes->predictiveNodeOffset;
+			}
+			COLLECTION_RELEASE(dataSet->rootNodes, &item);
+		}
 	}
-	ResourceManagerInit(manager, dataSet, &dataSet->b.b.handle, freeDataSet);
-	if (dataSet->b.b.handle == NULL) {
-		freeDataSet(dataSet);
-		status = INSUFFICIENT_MEMORY;
+	if (status == SUCCESS) {
+		dataSet->flatGraph = GraphFlatCreate(
+			dataSet->nodes,
+			dataSet->header.nodes.length,
+			rootOffsets,
+			rootsCount,
+			dataSet->config.optimiseNodeLayout,
+			dataSet->config.optimiseNodeSearch,
+			dataSet->config.optimiseNodeModulo,
+			prune,
+			dataSet->config.difference,
+			exception);
+		if (dataSet->flatGraph == NULL) {
+			status = CORRUPT_DATA;
+#ifndef FIFTYONE_DEGREES_EXCEPTIONS_DISABLED
+			// The exception will only be available if not disabled.
+			if (EXCEPTION_FAILED) {
+				status = exception->status;
+			}
+#endif
+		}
+	}
+	Free(rootOffsets);
+	if (status == SUCCESS) {
+		status = bindToNumaNode(
+			dataSet,
+			dataSet->flatGraph->nodes,
+			dataSet->flatGraph->size);
+	}
+	if (status == SUCCESS) {
+		adviseFlatGraph(dataSet);
+		releaseNodes(dataSet);
 	}
 	return status;
 }
 
-size_t fiftyoneDegreesHashSizeManagerFromFile(
-	fiftyoneDegreesConfigHash *config,
-	fiftyoneDegreesPropertiesRequired *properties,
-	const char *fileName,
-	fiftyoneDegreesException *exception) {
-	size_t allocated;
-	ResourceManager manager;
-	StatusCode status;
+/**
+ * Moves the section of the data file if it starts at or after the position
+ * provided.
+ */
+static void moveSection(
+	const CollectionHeader *section,
+	uint32_t position,
+	int64_t difference) {
+	if (section->startPosition >= position) {
+		*(uint32_t*)(&section->startPosition) =
+			(uint32_t)((int64_t)section->startPosition + difference);
+	}
+}
 
-	// Set the memory allocation and free methods for tracking.
-	MemoryTrackingReset();
-	Malloc = MemoryTrackingMalloc;
-	MallocAligned = MemoryTrackingMallocAligned;
-	Free = MemoryTrackingFree;
-	FreeAligned = MemoryTrackingFreeAligned;
+/**
+ * Writes the bytes of the data file in memory between the positions provided
+ * to the file.
+ */
+static bool writeSection(
+	FILE *file,
+	DataSetHash *dataSet,
+	uint32_t startPosition,
+	uint32_t endPosition) {
+	const size_t length = (size_t)(endPosition - startPosition);
+	return length == 0 || fwrite(
+		dataSet->fileStartByte + startPosition,
+		1,
+		length,
+		file) == length;
+}
 
-	// Initialise the manager with the tracking methods in use to determine
-	// the amount of memory that is allocated. Then if successful free all the
-	// memory having tracked the total amount of memory allocated. If not 
-	// successful then update the status of the exception.
-	status = HashInitManagerFromFile(
-		&manager,
-		config,
-		properties,
-		fileName,
-		exception);
-	if (status == SUCCESS) {
-		ResourceManagerFree(&manager);
+/**
+ * Writes the header, root nodes and nodes provided to the file, copying the
+ * rest of the data file from memory. The sections of the data file follow the
+ * header in the same order as the collection headers, so only the sections
+ * after the nodes need to be moved.
+ */
+static StatusCode writeTrimmedFile(
+	DataSetHash *dataSet,
+	const char *fileName,
+	const HashRootNodes *rootNodes,
+	const byte *nodes,
+	uint32_t length,
+	uint32_t count) {
+	DataSetHashHeader header;
+	FILE *file;
+	bool written;
+	const uint32_t nodesEnd =
+		dataSet->header.nodes.startPosition + dataSet->header.nodes.length;
+	const int64_t difference =
+		(int64_t)length - (int64_t)dataSet->header.nodes.length;
+
+	// Rewrite the header for the new length of the nodes.
+	memcpy(&header, &dataSet->header, sizeof(DataSetHashHeader));
+	*(uint32_t*)(&header.nodes.length) = length;
+	*(uint32_t*)(&header.nodes.count) = count;
+	moveSection(&header.strings, nodesEnd, difference);
+	moveSection(&header.components, nodesEnd, difference);
+	moveSection(&header.maps, nodesEnd, difference);
+	moveSection(&header.properties, nodesEnd, difference);
+	moveSection(&header.values, nodesEnd, difference);
+	moveSection(&header.profiles, nodesEnd, difference);
+	moveSection(&header.rootNodes, nodesEnd, difference);
+	moveSection(&header.profileOffsets, nodesEnd, difference);
+
+#ifdef _MSC_VER
+	if (fopen_s(&file, fileName, "wb") != 0) {
+		return FILE_WRITE_ERROR;
 	}
-#ifndef FIFTYONE_DEGREES_EXCEPTIONS_DISABLED
-	// Only set the exception status if enabled. 
-	else {
-		exception->status = status;
+#else
+	file = fopen(fileName, "wb");
+	if (file == NULL) {
+		return FILE_WRITE_ERROR;
 	}
 #endif
-
-	// Get the total maximum amount of allocated memory
-	// needed for the manager and associated resources.
-	allocated = MemoryTrackingGetMax();
-
-	// Check that all the memory has been freed.
-	assert(MemoryTrackingGetAllocated() == 0);
-
-	// Return the malloc and free methods to standard operation.
-	Malloc = MemoryStandardMalloc;
-	MallocAligned = MemoryStandardMallocAligned;
-	Free = MemoryStandardFree;
-	FreeAligned = MemoryStandardFreeAligned;
-	MemoryTrackingReset();
-
-	return allocated;
+	written =
+		fwrite(&header, sizeof(DataSetHashHeader), 1, file) == 1 &&
+		writeSection(
+			file,
+			dataSet,
+			(uint32_t)sizeof(DataSetHashHeader),
+			dataSet->header.rootNodes.startPosition) &&
+		fwrite(
+			rootNodes,
+			1,
+			dataSet->header.rootNodes.length,
+			file) == dataSet->header.rootNodes.length &&
+		writeSection(
+			file,
+			dataSet,
+			dataSet->header.rootNodes.startPosition +
+				dataSet->header.rootNodes.length,
+			dataSet->header.nodes.startPosition) &&
+		fwrite(nodes, 1, length, file) == length &&
+		writeSection(
+			file,
+			dataSet,
+			nodesEnd,
+			dataSet->header.profileOffsets.startPosition +
+				dataSet->header.profileOffsets.length);
+	written = fclose(file) == 0 && written;
+	if (written == false) {
+		remove(fileName);
+		return FILE_WRITE_ERROR;
+	}
+	return SUCCESS;
 }
 
-static StatusCode initDataSetFromMemory(
-	void *dataSetBase,
-	const void *configBase,
-	PropertiesRequired *properties,
-	void *memory,
-	long size,
+/**
+ * Copies the nodes of the data set which are evaluated for the available
+ * properties and the graphs in use, and writes them to the file with the
+ * rest of the data file. Root nodes which are never evaluated reference a
+ * node which never matches and moves on to the default profile of the
+ * component the root nodes belong to.
+ */
+static StatusCode trimDataSet(
+	DataSetHash *dataSet,
+	const char *fileName,
 	Exception *exception) {
 	StatusCode status = SUCCESS;
-	MemoryReader reader;
-	DataSetHash *dataSet = (DataSetHash*)dataSetBase;
-	ConfigHash *config = (ConfigHash*)configBase;
-
-	// Common data set initialisation actions.
-	initDataSet(dataSet, &config);
-
-	// If memory is to be freed when the data set is freed then record the 
-	// pointer to the memory location for future reference.
-	if (dataSet->config.b.b.freeData == true) {
-		dataSet->b.b.memoryToFree = memory;
+	HashRootNodes *rootNodes;
+	byte *nodes = NULL;
+	uint32_t i, rootsCount = 0, length = 0, nodesCount = 0;
+	uint32_t *rootOffsets;
+	int32_t *unmatchedOffsets;
+	Component *component;
+	const uint32_t count = dataSet->header.rootNodes.count;
+	const uint32_t componentsCount = dataSet->componentsList.count;
+	if (count == 0 ||
+		dataSet->header.rootNodes.length != count * sizeof(HashRootNodes) ||
+		componentsCount == 0) {
+		return CORRUPT_DATA;
 	}
-
-	// Set up the reader.
-	reader.startByte = reader.current = (byte*)memory;
-	reader.length = size;
-	reader.lastByte = reader.current + size;
-
-	// Initialise the data set from the memory reader.
-	status = initWithMemory(dataSet, &reader, exception);
-
-	// Return the status code if something has gone wrong.
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		return status;
+	rootNodes = (HashRootNodes*)Malloc(dataSet->header.rootNodes.length);
+	rootOffsets = (uint32_t*)Malloc(count * 2 * sizeof(uint32_t));
+	unmatchedOffsets = (int32_t*)Malloc(componentsCount * sizeof(int32_t));
+	if (rootNodes == NULL || rootOffsets == NULL || unmatchedOffsets == NULL) {
+		status = INSUFFICIENT_MEMORY;
 	}
-
-	// Initialise the required properties and headers.
-	status = initPropertiesAndHeaders(dataSet, properties, exception);
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		return status;
+	else {
+		// Each component has a node which never matches and moves on to the
+		// default profile of the component.
+		for (i = 0; i < componentsCount && status == SUCCESS; i++) {
+			component = COMPONENT(dataSet, i);
+			if (component == NULL ||
+				component->defaultProfileOffset > INT32_MAX) {
+				status = CORRUPT_DATA;
+			}
+			else {
+				unmatchedOffsets[i] =
+					-(int32_t)component->defaultProfileOffset;
+			}
+		}
 	}
-
-	// Initialise the components available to flag which components have
-	// properties which are to be returned (i.e. available properties).
-	status = initComponentsAvailable(dataSet, exception);
-	
-	// Initialise the index for properties and profiles to values.
-	initIndicesPropertyProfile(dataSet, exception);
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		freeDataSet(dataSet);
-		if (config->b.b.useTempFile == true) {
-			FileDelete(dataSet->b.b.fileName);
+	if (status == SUCCESS) {
+		memcpy(
+			rootNodes,
+			dataSet->fileStartByte + dataSet->header.rootNodes.startPosition,
+			dataSet->header.rootNodes.length);
+		for (i = 0; i < count; i++) {
+			if (isRootNodesUsed(dataSet, i)) {
+				if (dataSet->config.usePerformanceGraph) {
+					rootOffsets[rootsCount++] =
+						rootNodes[i].performanceNodeOffset;
+				}
+				if (dataSet->config.usePredictiveGraph) {
+					rootOffsets[rootsCount++] =
+						rootNodes[i].predictiveNodeOffset;
+				}
+			}
+		}
+		nodes = GraphTrim(
+			dataSet->nodes,
+			dataSet->header.nodes.length,
+			rootOffsets,
+			rootsCount,
+			unmatchedOffsets,
+			componentsCount,
+			&length,
+			&nodesCount,
+			exception);
+		if (nodes == NULL) {
+			status = CORRUPT_DATA;
+#ifndef FIFTYONE_DEGREES_EXCEPTIONS_DISABLED
+			// The exception will only be available if not disabled.
+			if (EXCEPTION_FAILED) {
+				status = exception->status;
+			}
+#endif
 		}
-		return status;
 	}
 
-	// Initialise the headers for each component.
-	if (!initComponentHeaders(dataSet, exception) || EXCEPTION_FAILED) {
-		freeDataSet(dataSet);
-		if (config->b.b.useTempFile == true) {
-			FileDelete(dataSet->b.b.fileName);
+	// Set the root nodes to the offsets of the trimmed nodes, in the same
+	// order the offsets were added, or to the node which never matches for
+	// the component.
+	if (status == SUCCESS) {
+		rootsCount = 0;
+		for (i = 0; i < count; i++) {
+			const bool used = isRootNodesUsed(dataSet, i);
+			const uint32_t unmatched = (uint32_t)unmatchedOffsets[
+				getRootNodesComponentIndex(dataSet, i)];
+			rootNodes[i].performanceNodeOffset =
+				used && dataSet->config.usePerformanceGraph ?
+				rootOffsets[rootsCount++] : unmatched;
+			rootNodes[i].predictiveNodeOffset =
+				used && dataSet->config.usePredictiveGraph ?
+				rootOffsets[rootsCount++] : unmatched;
 		}
-		return status;
+		status = writeTrimmedFile(
+			dataSet,
+			fileName,
+			rootNodes,
+			nodes,
+			length,
+			nodesCount);
 	}
 
-	initGetHighEntropyValues(dataSet, exception);
-
+	if (nodes != NULL) {
+		Free(nodes);
+	}
+	if (unmatchedOffsets != NULL) {
+		Free(unmatchedOffsets);
+	}
+	if (rootOffsets != NULL) {
+		Free(rootOffsets);
+	}
+	if (rootNodes != NULL) {
+		Free(rootNodes);
+	}
 	return status;
 }
 
-fiftyoneDegreesStatusCode fiftyoneDegreesHashInitManagerFromMemory(
-	fiftyoneDegreesResourceManager *manager,
-	fiftyoneDegreesConfigHash *config,
-	fiftyoneDegreesPropertiesRequired *properties,
-	void *memory,
-	long size,
-	fiftyoneDegreesException *exception) {
+/**
+ * Returns the number of bytes used by each result in the result cache.
+ */
+static uint32_t getCachedResultSize(const DataSetHash *dataSet) {
+	size_t size = sizeof(cachedResult) +
+		(sizeof(uint32_t) * dataSet->componentsList.count);
+	if (dataSet->config.b.updateMatchedUserAgent == true) {
+		size += dataSet->config.b.maxMatchedUserAgentLength + 1;
+	}
+	// Keep the next result aligned for the integers it contains.
+	return (uint32_t)((size + 3) & ~((size_t)3));
+}
 
-	if (config->usePerformanceGraph == false &&
-		config->usePredictiveGraph == false) {
-		return INVALID_CONFIG;
-	}
+/**
+ * Returns the number of bytes used by each entry in the result cache. This
+ * is the number of results followed by space for as many results as the
+ * results structure can hold.
+ */
+static uint32_t getResultCacheDataSize(const DataSetHash *dataSet) {
+	return (uint32_t)sizeof(uint32_t) +
+		(getCachedResultSize(dataSet) * dataSet->componentsAvailableCount);
+}
 
-	DataSetHash *dataSet = (DataSetHash*)Malloc(sizeof(DataSetHash));
-	if (dataSet == NULL) {
-		return INSUFFICIENT_MEMORY;
-	}
+/**
+ * Returns the first slot to look in for the profile offset in the value table.
+ */
+static uint32_t getValueTableSlot(
+	const HashValueTable *table,
+	uint32_t profileOffset) {
+	return (uint32_t)(((uint64_t)profileOffset * 0x9e3779b97f4a7c15ULL) >>
+		32) & table->slotsMask;
+}
 
-	StatusCode status = initDataSetFromMemory(
-		dataSet,
-		config,
-		properties,
-		memory,
-		size,
-		exception);
-	if (status != SUCCESS || EXCEPTION_FAILED) {
-		Free(dataSet);
-		return status;
-	}
-	ResourceManagerInit(manager, dataSet, &dataSet->b.b.handle, freeDataSet);
-	if (dataSet->b.b.handle == NULL)
-	{
-		freeDataSet(dataSet);
-		status = INSUFFICIENT_MEMORY;
+/**
+ * Sets the row to the row of the profile within its component. Returns false
+ * if the profile is not in the value table.
+ */
+static bool getValueTableRow(
+	const HashValueTable *table,
+	uint32_t profileOffset,
+	uint32_t *row) {
+	uint32_t slot = getValueTableSlot(table, profileOffset);
+	while (table->slotOffsets[slot] != 0) {
+		if (table->slotOffsets[slot] == profileOffset + 1) {
+			*row = table->slotRows[slot];
+			return true;
+		}
+		slot = (slot + 1) & table->slotsMask;
 	}
-	return status;
+	return false;
 }
 
-size_t fiftyoneDegreesHashSizeManagerFromMemory(
-	fiftyoneDegreesConfigHash *config,
-	fiftyoneDegreesPropertiesRequired *properties,
-	void *memory,
-	long size,
-	fiftyoneDegreesException *exception) {
-	size_t allocated;
-	ResourceManager manager;
-#ifdef _DEBUG
-	StatusCode status;
-#endif
-	// Set the memory allocation and free methods for tracking.
-	MemoryTrackingReset();
-	Malloc = MemoryTrackingMalloc;
-	MallocAligned = MemoryTrackingMallocAligned;
-	Free = MemoryTrackingFree;
-	FreeAligned = MemoryTrackingFreeAligned;
-
-	// Ensure that the memory used is not freed with the data set.
-	ConfigHash sizeConfig = *config;
-	sizeConfig.b.b.freeData = false;
-
-	// Initialise the manager with the tracking methods in use to determine
-	// the amount of memory that is allocated.
-#ifdef _DEBUG
-	status =
-#endif
-	HashInitManagerFromMemory(
-		&manager,
-		&sizeConfig,
-		properties,
-		memory,
-		size,
-		exception);
-#ifdef _DEBUG
-	assert(status == SUCCESS);
-#endif
-	assert(EXCEPTION_OKAY);
-
-	// Free the manager and get the total maximum amount of allocated memory
-	// needed for the manager and associated resources.
-	ResourceManagerFree(&manager);
-	allocated = MemoryTrackingGetMax();
-
-	// Check that all the memory has been freed.
-	assert(MemoryTrackingGetAllocated() == 0);
-
-	// Return the malloc and free methods to standard operation.
-	Malloc = MemoryStandardMalloc;
-	MallocAligned = MemoryStandardMallocAligned;
-	Free = MemoryStandardFree;
-	FreeAligned = MemoryStandardFreeAligned;
-	MemoryTrackingReset();
-
-	return allocated;
+/**
+ * Adds the offset of the string for the value to the state, doubling the
+ * memory available if there is insufficient space.
+ */
+static bool addValueToTable(void *state, Item *item) {
+	uint32_t *nameOffsets;
+	valueTableState *tableState = (valueTableState*)state;
+	Value *value = (Value*)item->data.ptr;
+	if (value != NULL && tableState->valid) {
+		if (tableState->count == tableState->capacity) {
+			nameOffsets = (uint32_t*)Malloc(
+				sizeof(uint32_t) * tableState->capacity * 2);
+			if (nameOffsets == NULL) {
+				tableState->valid = false;
+			}
+			else {
+				memcpy(
+					nameOffsets,
+					tableState->nameOffsets,
+					sizeof(uint32_t) * tableState->count);
+				Free(tableState->nameOffsets);
+				tableState->nameOffsets = nameOffsets;
+				tableState->capacity *= 2;
+			}
+		}
+		if (tableState->valid) {
+			tableState->nameOffsets[tableState->count++] =
+				(uint32_t)value->nameOffset;
+		}
+	}
+	COLLECTION_RELEASE(tableState->values, item);
+	return tableState->valid;
 }
 
-// Adds the profile associated with the integer profile id provided to the 
-// results. Returns true if the profile could be found, otherwise false.
-static bool addProfileById(
-	ResultsHash *results,
-	const uint32_t profileId,
-	bool isOverride,
+/**
+ * Walks the profiles collection recording the offset of each profile and
+ * adding it to the slots with its row in its component. The number of rows in
+ * each component is counted.
+ */
+static bool setValueTableRows(
+	DataSetHash *dataSet,
+	HashValueTable *table,
+	uint32_t *profileOffsets,
+	uint32_t *rowsCount,
 	Exception *exception) {
-	uint32_t profileOffset;
-	Item profileItem;
+	Item item;
 	Profile *profile;
-	ResultHash *result;
-	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
-	uint32_t i;
-	if (profileId != 0 &&
-		ProfileGetOffsetForProfileId(
-			dataSet->profileOffsets,
-			profileId,
-			&profileOffset,
-			exception) != NULL && EXCEPTION_OKAY) {
-		DataReset(&profileItem.data);
+	uint32_t i, slot, profileOffset = 0;
+	DataReset(&item.data);
+	for (i = 0; i < dataSet->header.profiles.count; i++) {
 		const CollectionKey profileKey = {
 			{profileOffset},
 			CollectionKeyType_Profile,
@@ -2277,463 +3622,1901 @@ static bool addProfileById(
 		profile = (Profile*)dataSet->profiles->get(
 			dataSet->profiles,
 			&profileKey,
-			&profileItem,
+			&item,
 			exception);
-		if (profile != NULL && EXCEPTION_OKAY) {
-
-			// Ensure the results structure has sufficient items to store the 
-			// profile offsets.
-			if (results->count == 0) {
-				results->count = 1;
-				result = results->items;
-				hashResultReset(dataSet, result);
-				result->b.uniqueHttpHeaderIndex = -1;
-			}
-
-			// For each of the results update them to use the profile offset
-			// rather than their current profile for the component.
-			for (i = 0; i < results->count; i++) {
-				addProfile(
-					&results->items[i], 
-					profile->componentIndex, 
-					profileOffset,
-					isOverride);
+		if (profile == NULL || EXCEPTION_FAILED ||
+			profile->componentIndex >= dataSet->componentsList.count) {
+			if (profile != NULL) {
+				COLLECTION_RELEASE(dataSet->profiles, &item);
 			}
-			COLLECTION_RELEASE(dataSet->profiles, &profileItem);
-
-			// A profile was found and added.
-			return true;
+			return false;
+		}
+		profileOffsets[i] = profileOffset;
+		slot = getValueTableSlot(table, profileOffset);
+		while (table->slotOffsets[slot] != 0) {
+			slot = (slot + 1) & table->slotsMask;
 		}
+		table->slotOffsets[slot] = profileOffset + 1;
+		table->slotRows[slot] = rowsCount[profile->componentIndex]++;
+		profileOffset += (uint32_t)(sizeof(Profile) +
+			(sizeof(uint32_t) * profile->valueCount));
+		COLLECTION_RELEASE(dataSet->profiles, &item);
 	}
-
-	// There is no corresponding profile for the profile id.
-	return false;
+	return true;
 }
 
-// Returns the root node for the header id from the component if one exists.
-static HashRootNodes* getRootNodesForComponentHeaderId(
-	DataSetHash* dataSet,
-	Component* component,
-	HeaderID* headerId,
-	Item* item,
-	Exception* exception) {
-	ComponentKeyValuePair* graphKey;
-	for (int i = 0; i < component->keyValuesCount; i++) {
-		graphKey = (ComponentKeyValuePair*)&component->firstKeyValuePair + i;
-		if (*headerId == graphKey->key) {
-			return getRootNodes(
-				dataSet,
-				graphKey->value,
-				item,
-				exception);
+/**
+ * Sets the cell for each profile and required property of the profile's
+ * component, adding the offsets of the value strings to the state.
+ */
+static bool setValueTableCells(
+	DataSetHash *dataSet,
+	HashValueTable *table,
+	const uint32_t *profileOffsets,
+	Property **properties,
+	valueTableState *state,
+	Exception *exception) {
+	Item item;
+	Profile *profile;
+	HashValueCell *cell;
+	uint32_t i, p, row;
+	DataReset(&item.data);
+	for (i = 0; i < dataSet->header.profiles.count && state->valid; i++) {
+		const CollectionKey profileKey = {
+			{profileOffsets[i]},
+			CollectionKeyType_Profile,
+		};
+		profile = (Profile*)dataSet->profiles->get(
+			dataSet->profiles,
+			&profileKey,
+			&item,
+			exception);
+		if (profile == NULL || EXCEPTION_FAILED) {
+			return false;
+		}
+		if (getValueTableRow(table, profileOffsets[i], &row)) {
+			for (p = 0; p < table->propertiesCount && state->valid; p++) {
+				if (table->propertyComponents[p] == profile->componentIndex) {
+					cell = &table->cells[table->propertyCells[p] + row];
+					cell->first = state->count;
+					ProfileIterateValuesForProperty(
+						dataSet->values,
+						profile,
+						properties[p],
+						state,
+						addValueToTable,
+						exception);
+					cell->count = state->count - cell->first;
+				}
+			}
+		}
+		COLLECTION_RELEASE(dataSet->profiles, &item);
+		if (EXCEPTION_FAILED) {
+			return false;
 		}
 	}
-	return NULL;
+	return state->valid;
 }
 
-
-// Set the members of the result and rest the result.
-static ResultHash* hashResultSet(
-	DataSetHash* dataSet, 
-	ResultHash* result, 
-	const char* value, 
-	size_t valueLength, 
-	int headerIndex) {
-	hashResultReset(dataSet, result);
-	result->b.targetUserAgent = value;
-	result->b.targetUserAgentLength = valueLength;
-	result->b.uniqueHttpHeaderIndex = headerIndex;
-	return result;
+static int compareNameOffsets(const void *a, const void *b) {
+	const uint32_t first = *(const uint32_t*)a;
+	const uint32_t second = *(const uint32_t*)b;
+	return first < second ? -1 : (first > second ? 1 : 0);
 }
 
-// Returns the next result in the results if there is capacity available, 
-// otherwise null.
-static ResultHash* getNextResult(
-	const char* value, 
-	size_t length,
-	ResultsHash* results,
-	int headerIndex) {
-	ResultHash* result = NULL;
-	if (results->count < results->capacity) {
-		result = hashResultSet(
-			(DataSetHash*)results->b.b.dataSet, 
-			&((ResultHash*)results->items)[results->count++],
-			value, 
-			length, 
-			headerIndex);
+/**
+ * Copies each unique value string into the table once, and sets the values
+ * to point to the copies.
+ */
+static bool setValueTableStrings(
+	DataSetHash *dataSet,
+	HashValueTable *table,
+	const valueTableState *state,
+	Exception *exception) {
+	Item item;
+	String *string;
+	uint32_t *unique, *positions;
+	uint32_t i, lower, upper, middle, uniqueCount = 0, length = 0;
+	bool valid;
+
+	unique = (uint32_t*)Malloc(sizeof(uint32_t) * (state->count + 1));
+	positions = (uint32_t*)Malloc(sizeof(uint32_t) * (state->count + 1));
+	table->values = (const char**)Malloc(
+		sizeof(const char*) * (state->count + 1));
+	valid = unique != NULL && positions != NULL && table->values != NULL;
+	if (valid == false) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
 	}
-	return result;
-}
 
-static void completeResult(
-	ResultHash* result, 
-	detectionState* state, 
-	byte componentIndex) {
-	result->iterations = state->iterations;
-	result->drift = state->drift;
-	result->difference = state->difference;
-	result->matchedNodes = state->matchedNodes;
-	if (result->b.matchedUserAgent != NULL) {
-		result->b.matchedUserAgent[
-			MIN(state->result->b.targetUserAgentLength,
-				state->result->b.matchedUserAgentLength)] = '\0';
+	// Find the unique strings and the position of each in the table.
+	if (valid) {
+		memcpy(unique, state->nameOffsets, sizeof(uint32_t) * state->count);
+		qsort(unique, state->count, sizeof(uint32_t), compareNameOffsets);
+		for (i = 0; i < state->count; i++) {
+			if (uniqueCount == 0 || unique[uniqueCount - 1] != unique[i]) {
+				unique[uniqueCount++] = unique[i];
+			}
+		}
 	}
-	if (state->matchedNodes == 0) {
-		result->method = FIFTYONE_DEGREES_HASH_MATCH_METHOD_NONE;
+	DataReset(&item.data);
+	for (i = 0; i < uniqueCount && valid; i++) {
+		string = (String*)StringGet(
+			dataSet->strings,
+			unique[i],
+			&item,
+			exception);
+		valid = string != NULL && EXCEPTION_OKAY;
+		if (valid) {
+			positions[i] = length;
+			length += (uint32_t)strlen(&string->value) + 1;
+			COLLECTION_RELEASE(dataSet->strings, &item);
+		}
 	}
-	else if (state->performanceMatches > 0 &&
-		state->predictiveMatches > 0) {
-		result->method = FIFTYONE_DEGREES_HASH_MATCH_METHOD_COMBINED;
+
+	// Copy the unique strings into the table.
+	if (valid) {
+		table->strings = (char*)Malloc(length + 1);
+		valid = table->strings != NULL;
+		if (valid == false) {
+			EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		}
 	}
-	else if (state->performanceMatches > 0) {
-		result->method = FIFTYONE_DEGREES_HASH_MATCH_METHOD_PERFORMANCE;
+	for (i = 0; i < uniqueCount && valid; i++) {
+		string = (String*)StringGet(
+			dataSet->strings,
+			unique[i],
+			&item,
+			exception);
+		valid = string != NULL && EXCEPTION_OKAY;
+		if (valid) {
+			strcpy(table->strings + positions[i], &string->value);
+			COLLECTION_RELEASE(dataSet->strings, &item);
+		}
 	}
-	else if (state->predictiveMatches > 0) {
-		result->method = FIFTYONE_DEGREES_HASH_MATCH_METHOD_PREDICTIVE;
+
+	// Point each value at the copy of its string.
+	for (i = 0; i < state->count && valid; i++) {
+		lower = 0;
+		upper = uniqueCount;
+		while (lower < upper) {
+			middle = lower + ((upper - lower) / 2);
+			if (unique[middle] < state->nameOffsets[i]) {
+				lower = middle + 1;
+			}
+			else {
+				upper = middle;
+			}
+		}
+		table->values[i] = table->strings + positions[lower];
 	}
 
-	// Add the profile to the result for the component index and set all other
-	// profile offsets to null indicating that the result does not relate to
-	// those components.
-	for (uint32_t i = 0; i < state->dataSet->componentsList.count; i++) {
-		result->profileOffsets[i] = 
-			componentIndex == i ? 
-			state->profileOffset : 
-			NULL_PROFILE_OFFSET;
+	if (unique != NULL) {
+		Free(unique);
 	}
+	if (positions != NULL) {
+		Free(positions);
+	}
+	return valid;
 }
 
-// For the value, component, and header performs device detection using the 
-// associated root nodes. Returns true if the process completed, otherwise
-// false.
-static bool setResultForComponentHeader(
-	DataSetHash* dataSet,
-	byte componentIndex,
-	Header* header,
-	ResultHash* result,
-	Exception* exception) {
-	detectionState ddState;
-	bool complete = false;
-	Component* component = COMPONENT(dataSet, componentIndex);
-
-	// Get the root nodes for the component and header.
-	Item rootNodesItem;
-	DataReset(&rootNodesItem.data);
-	HashRootNodes* rootNodes = getRootNodesForComponentHeaderId(
-		dataSet,
-		component,
-		&header->headerId,
-		&rootNodesItem,
-		exception);
-	if (rootNodes != NULL && EXCEPTION_OKAY) {
-
-		// Initialise the device detection state.
-		detectionStateInit(&ddState, result, dataSet, exception);
-
-		// Perform the device detection using the root nodes.
-		if (processRoots(
-			&ddState,
-			dataSet,
-			componentIndex,
-			component,
-			rootNodes) == true) {
+/**
+ * Sets the required property index for each property in the properties
+ * collection, or -1 if the property is not required, so that the values of a
+ * profile can be assigned to the required properties as they are read.
+ */
+static StatusCode initRequiredPropertyIndexes(DataSetHash *dataSet) {
+	uint32_t i;
+	int propertyIndex;
+	const uint32_t propertiesCount = dataSet->header.properties.count;
+	int *indexes = (int*)Malloc(sizeof(int) * propertiesCount);
+	if (indexes == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+	for (i = 0; i < propertiesCount; i++) {
+		indexes[i] = -1;
+	}
+	for (i = 0; i < dataSet->b.b.available->count; i++) {
+		propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
+			dataSet->b.b.available,
+			(int)i);
+		if (propertyIndex >= 0 && (uint32_t)propertyIndex < propertiesCount) {
+			indexes[propertyIndex] = (int)i;
+		}
+	}
+	dataSet->requiredPropertyIndexes = indexes;
+	return SUCCESS;
+}
 
-			// Complete the result copying the metrics from the device 
-			// detection state.
-			completeResult(result, &ddState, componentIndex);
+/**
+ * Formats the JSON key of each required property with the common Json
+ * methods, so that the escaping is the same as when the results are written,
+ * in a single block of memory which follows the array of properties. The keys
+ * are formatted twice, first to work out the size of the block and then to
+ * copy them.
+ */
+static StatusCode initJsonProperties(
+	DataSetHash *dataSet,
+	Exception *exception) {
+	StatusCode status = SUCCESS;
+	uint32_t i, pass;
+	size_t length = 0;
+	int propertyIndex;
+	char measure[64];
+	char *key = NULL, *end = NULL;
+	Item propertyItem;
+	Property *property;
+	HashJsonProperty *jsonProperty;
+	const uint32_t count = dataSet->b.b.available->count;
+	HashJsonProperty *jsonProperties = NULL;
+	Json s = { NULL, 0 };
+	s.exception = exception;
+	s.strings = dataSet->strings;
+	s.property = NULL;
+	s.values = NULL;
+	s.storedPropertyType = FIFTYONE_DEGREES_PROPERTY_VALUE_TYPE_STRING; // only strings in device-detection
 
-			complete = true;
+	for (pass = 0; pass < 2 && status == SUCCESS; pass++) {
+		if (pass == 1) {
+			// Leave space for the null terminator the builder keeps free
+			// after the last key.
+			jsonProperties = (HashJsonProperty*)Malloc(
+				sizeof(HashJsonProperty) * count + length + 1);
+			if (jsonProperties == NULL) {
+				return INSUFFICIENT_MEMORY;
+			}
+			key = (char*)(jsonProperties + count);
+			end = key + length + 1;
+		}
+		for (i = 0; i < count && status == SUCCESS; i++) {
+			propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
+				dataSet->b.b.available,
+				(int)i);
+			DataReset(&propertyItem.data);
+			property = (Property*)PropertyGet(
+				dataSet->properties,
+				propertyIndex,
+				&propertyItem,
+				exception);
+			if (property == NULL || EXCEPTION_FAILED) {
+				status = COLLECTION_FAILURE;
+				break;
+			}
+			s.property = property;
+			if (pass == 0) {
+				// Only the number of characters is needed.
+				s.builder.ptr = measure;
+				s.builder.length = sizeof(measure);
+				StringBuilderInit(&s.builder);
+				JsonPropertyStart(&s);
+				length += s.builder.added;
+			}
+			else {
+				s.builder.ptr = key;
+				s.builder.length = (size_t)(end - key);
+				StringBuilderInit(&s.builder);
+				JsonPropertyStart(&s);
+				jsonProperty = &jsonProperties[i];
+				memcpy(&jsonProperty->property, property, sizeof(Property));
+				jsonProperty->key = key;
+				jsonProperty->keyLength = (uint32_t)s.builder.added;
+				key += s.builder.added;
+			}
+			COLLECTION_RELEASE(dataSet->properties, &propertyItem);
+			if (EXCEPTION_FAILED) {
+				status = COLLECTION_FAILURE;
+			}
 		}
-
-		COLLECTION_RELEASE(dataSet->rootNodes, &rootNodesItem);
 	}
 
-	return complete;
+	if (status != SUCCESS) {
+		if (jsonProperties != NULL) {
+			Free(jsonProperties);
+		}
+		return status;
+	}
+	dataSet->jsonProperties = jsonProperties;
+	return SUCCESS;
 }
 
-// Determines if there is a header index related to the component for the pair
-// provided and if there is tries to complete device detection. Returns false
-// if the pair resulted in a match or there are no results available to prevent
-// further processing. Returns true if more headers should be checked.
-static bool setResultFromEvidenceForComponentCallback(
-	void* state, EvidenceKeyValuePair *pair) {
-	ResultHash* result;
-	bool complete = false;
-	detectionComponentState* s = (detectionComponentState*)state;
-	Exception* exception = s->exception;
-	if (pair->header != NULL && pair->header->isDataSet) {
+/**
+ * Resolves the values of every required property for every profile if the
+ * value table option is enabled.
+ */
+static StatusCode initValueTable(DataSetHash *dataSet, Exception *exception) {
+	StatusCode status = SUCCESS;
+	HashValueTable *table;
+	valueTableState state;
+	Item *propertyItems = NULL;
+	Property **properties = NULL;
+	uint32_t *profileOffsets = NULL, *rowsCount = NULL;
+	uint32_t i, slotsCount = 1, cellsCount = 0;
+	const uint32_t profilesCount = dataSet->header.profiles.count;
+	const uint32_t propertiesCount = dataSet->b.b.available->count;
+	bool valid;
+	int propertyIndex;
 
-		// Get the next result instance in the array of results or if there
-		// is already a result instance assigned to this iteration then use
-		// that one as it indicates that a prior evaluation did not result in
-		// any matched nodes.
-		result = s->lastResult == NULL ?
-			getNextResult(
-				(const char*)pair->parsedValue, 
-				pair->parsedLength, 
-				s->results, 
-				pair->header->index) :
-			hashResultSet(
-				s->dataSet, 
-				s->lastResult, 
-				(const char*)pair->parsedValue,
-				pair->parsedLength,
-				pair->header->index);
-		if (result != NULL) {
+	if (dataSet->config.valueTable == false) {
+		return SUCCESS;
+	}
 
-			// Set the last result instance in case this iteration doesn't 
-			// produce and outcome that concludes the iterations.
-			s->lastResult = result;
+	// Use at least twice as many slots as profiles to keep the runs of
+	// occupied slots short.
+	while (slotsCount < profilesCount * 2) {
+		slotsCount <<= 1;
+	}
+	table = (HashValueTable*)Malloc(sizeof(HashValueTable));
+	if (table == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+	table->slotsMask = slotsCount - 1;
+	table->propertiesCount = propertiesCount;
+	table->slotOffsets = (uint32_t*)Malloc(sizeof(uint32_t) * slotsCount);
+	table->slotRows = (uint32_t*)Malloc(sizeof(uint32_t) * slotsCount);
+	table->propertyCells = (uint32_t*)Malloc(
+		sizeof(uint32_t) * (propertiesCount + 1));
+	table->propertyComponents = (byte*)Malloc(propertiesCount + 1);
+	table->cells = NULL;
+	table->values = NULL;
+	table->strings = NULL;
+	state.values = dataSet->values;
+	state.count = 0;
+	state.capacity = 256;
+	state.nameOffsets = (uint32_t*)Malloc(sizeof(uint32_t) * state.capacity);
+	state.valid = true;
+	profileOffsets = (uint32_t*)Malloc(sizeof(uint32_t) * (profilesCount + 1));
+	rowsCount = (uint32_t*)Malloc(
+		sizeof(uint32_t) * dataSet->componentsList.count);
+	propertyItems = (Item*)Malloc(sizeof(Item) * (propertiesCount + 1));
+	properties = (Property**)Malloc(sizeof(Property*) * (propertiesCount + 1));
+	valid = table->slotOffsets != NULL &&
+		table->slotRows != NULL &&
+		table->propertyCells != NULL &&
+		table->propertyComponents != NULL &&
+		state.nameOffsets != NULL &&
+		profileOffsets != NULL &&
+		rowsCount != NULL &&
+		propertyItems != NULL &&
+		properties != NULL;
+	if (valid) {
+		memset(table->slotOffsets, 0, sizeof(uint32_t) * slotsCount);
+		memset(rowsCount, 0, sizeof(uint32_t) * dataSet->componentsList.count);
+		for (i = 0; i < propertiesCount; i++) {
+			DataReset(&propertyItems[i].data);
+			properties[i] = NULL;
+		}
+	}
+	else {
+		status = INSUFFICIENT_MEMORY;
+	}
 
-			// Perform the device detection and set the result.
-			complete = setResultForComponentHeader(
-				s->dataSet,
-				s->componentIndex,
-				pair->header,
-				result,
-				exception);
-			if (EXCEPTION_FAILED) return false;
+	// Find the row of each profile within its component.
+	if (valid) {
+		valid = setValueTableRows(
+			dataSet,
+			table,
+			profileOffsets,
+			rowsCount,
+			exception);
+		if (valid == false) {
+			status = COLLECTION_FAILURE;
+		}
+	}
 
+	// Get the required properties and give each a cell for every row of the
+	// property's component.
+	for (i = 0; i < propertiesCount && valid; i++) {
+		propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
+			dataSet->b.b.available,
+			(int)i);
+		properties[i] = (Property*)PropertyGet(
+			dataSet->properties,
+			propertyIndex,
+			&propertyItems[i],
+			exception);
+		valid = properties[i] != NULL && EXCEPTION_OKAY;
+		if (valid) {
+			table->propertyComponents[i] = properties[i]->componentIndex;
+			table->propertyCells[i] = cellsCount;
+			cellsCount += rowsCount[properties[i]->componentIndex];
+		}
+		else {
+			status = COLLECTION_FAILURE;
+		}
+	}
+	if (valid) {
+		table->cells = (HashValueCell*)Malloc(
+			sizeof(HashValueCell) * (cellsCount + 1));
+		valid = table->cells != NULL;
+		if (valid) {
+			memset(table->cells, 0, sizeof(HashValueCell) * (cellsCount + 1));
 		}
 		else {
+			status = INSUFFICIENT_MEMORY;
+		}
+	}
 
-			// There is no result instance available so stop iterating.
-			complete = true;
+	// Resolve the values for each cell and then the strings for each value.
+	if (valid) {
+		valid = setValueTableCells(
+			dataSet,
+			table,
+			profileOffsets,
+			properties,
+			&state,
+			exception);
+		if (valid == false) {
+			status = state.valid ? COLLECTION_FAILURE : INSUFFICIENT_MEMORY;
 		}
 	}
-	return !complete;
+	if (valid) {
+		valid = setValueTableStrings(dataSet, table, &state, exception);
+		if (valid == false) {
+			status = COLLECTION_FAILURE;
+		}
+	}
+
+	if (propertyItems != NULL && properties != NULL) {
+		for (i = 0; i < propertiesCount; i++) {
+			if (properties[i] != NULL) {
+				COLLECTION_RELEASE(dataSet->properties, &propertyItems[i]);
+			}
+		}
+	}
+	if (propertyItems != NULL) {
+		Free(propertyItems);
+	}
+	if (properties != NULL) {
+		Free((void*)properties);
+	}
+	if (profileOffsets != NULL) {
+		Free(profileOffsets);
+	}
+	if (rowsCount != NULL) {
+		Free(rowsCount);
+	}
+	if (state.nameOffsets != NULL) {
+		Free(state.nameOffsets);
+	}
+	if (valid) {
+		dataSet->valueTable = table;
+	}
+	else {
+		freeValueTable(table);
+#ifndef FIFTYONE_DEGREES_EXCEPTIONS_DISABLED
+		// The exception will only be available if not disabled.
+		if (EXCEPTION_FAILED) {
+			status = exception->status;
+		}
+#endif
+	}
+	return status;
 }
 
-// If the pair matches the header being sought then stop and record the pair,
-// otherwise continue iterating.
-static bool setSpecialHeadersFindCallback(
-	void* state,
-	EvidenceKeyValuePair* pair) {
-	setSpecialHeadersFindState* findState = (setSpecialHeadersFindState*)state;
-	if (findState->header->keyLength == pair->item.keyLength &&
-		StringCompareLength(
-			findState->header->key,
-			pair->item.key,
-			pair->item.keyLength) == 0) {
-		findState->pair = pair;
+/**
+ * Returns the first slot to look for the profile offset in.
+ */
+static uint32_t getProfileIdSlot(
+	const HashProfileIdTable *table,
+	uint32_t profileOffset) {
+	return (uint32_t)(((uint64_t)profileOffset * 0x9e3779b97f4a7c15ULL) >>
+		32) & table->slotsMask;
+}
+
+/**
+ * Adds the profile id of the profile at the offset to the slots.
+ */
+static void addProfileIdSlot(
+	HashProfileIdTable *table,
+	uint32_t profileOffset,
+	uint32_t profileId) {
+	uint32_t slot = getProfileIdSlot(table, profileOffset);
+	while (table->slotOffsets[slot] != 0) {
+		slot = (slot + 1) & table->slotsMask;
+	}
+	table->slotOffsets[slot] = profileOffset + 1;
+	table->slotProfileIds[slot] = profileId;
+}
+
+/**
+ * Allocates the entries of the profile id table for profile ids up to the
+ * highest one provided, with every entry empty.
+ */
+static bool setProfileIdTableCount(
+	HashProfileIdTable *table,
+	uint32_t maxProfileId) {
+	table->count = maxProfileId + 1;
+	table->offsets = (uint32_t*)Malloc(sizeof(uint32_t) * table->count);
+	table->componentIndexes = (byte*)Malloc(table->count);
+	if (table->offsets == NULL || table->componentIndexes == NULL) {
 		return false;
 	}
+	memset(table->offsets, 0xFF, sizeof(uint32_t) * table->count);
+	memset(table->componentIndexes, 0, table->count);
 	return true;
 }
 
-// Adds the header to the evidence. If the header already exists then the 
-// current value is replaced.
-static bool setSpecialHeadersCallback(void *state, KeyValuePair header) {
-	int uniqueHeaderIndex;
-	detectionComponentState* componentState = (detectionComponentState*)state;
-
-	// Get the existing pair for the header with any prefix.
-	setSpecialHeadersFindState findState = { &header, NULL };
-	EvidenceIterate(
-		componentState->evidence,
-		INT_MAX,
-		&findState,
-		setSpecialHeadersFindCallback);
+/**
+ * Builds the tables between profile ids and profiles if the option is
+ * enabled. The profiles are walked twice, first to add each profile to the
+ * slots and find the highest profile id, and then to set the entries for each
+ * profile id. If the profile ids are too sparse then there are no entries and
+ * profiles are found from the profile offsets collection instead.
+ */
+static StatusCode initProfileIdTable(
+	DataSetHash *dataSet,
+	Exception *exception) {
+	StatusCode status = SUCCESS;
+	HashProfileIdTable *table;
+	Item item;
+	Profile *profile;
+	uint32_t i, pass, profileOffset, maxProfileId = 0, slotsCount = 1;
+	const uint32_t profilesCount = dataSet->header.profiles.count;
 
-	if (findState.pair == NULL) {
-		// No pair was found so add a new string.
-		findState.pair = EvidenceAddPair(
-			componentState->evidence,
-			FIFTYONE_DEGREES_EVIDENCE_HTTP_HEADER_STRING,
-			header);
+	if (dataSet->config.profileIdTable == false || profilesCount == 0) {
+		return SUCCESS;
 	}
 
-	// Update the parsed value and length.
-	findState.pair->parsedValue = header.value;
-	findState.pair->parsedLength = header.valueLength;
-	
-	// Ensure a unique header is associated with the pair. Perhaps the original
-	// pair was added without a known header.
-	if (findState.pair->header == NULL) {
-
-		// Get the unique header index for the header.
-		uniqueHeaderIndex = HeaderGetIndex(
-			componentState->dataSet->b.b.uniqueHeaders,
-			header.key,
-			header.keyLength);
-		if (uniqueHeaderIndex >= 0) {
-			findState.pair->header =
-				&componentState->dataSet->b.b.uniqueHeaders->items[
-					uniqueHeaderIndex];
+	// Use at least twice as many slots as profiles to keep the runs of
+	// occupied slots short.
+	while (slotsCount < profilesCount * 2) {
+		slotsCount <<= 1;
+	}
+	table = (HashProfileIdTable*)Malloc(sizeof(HashProfileIdTable));
+	if (table == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+	table->offsets = NULL;
+	table->componentIndexes = NULL;
+	table->count = 0;
+	table->slotsMask = slotsCount - 1;
+	table->slotOffsets = (uint32_t*)Malloc(sizeof(uint32_t) * slotsCount);
+	table->slotProfileIds = (uint32_t*)Malloc(sizeof(uint32_t) * slotsCount);
+	if (table->slotOffsets == NULL || table->slotProfileIds == NULL) {
+		status = INSUFFICIENT_MEMORY;
+	}
+	else {
+		memset(table->slotOffsets, 0, sizeof(uint32_t) * slotsCount);
+	}
+	DataReset(&item.data);
+	for (pass = 0; pass < 2 && status == SUCCESS; pass++) {
+		profileOffset = 0;
+		for (i = 0; i < profilesCount && status == SUCCESS; i++) {
+			const CollectionKey profileKey = {
+				{profileOffset},
+				CollectionKeyType_Profile,
+			};
+			profile = (Profile*)dataSet->profiles->get(
+				dataSet->profiles,
+				&profileKey,
+				&item,
+				exception);
+			if (profile == NULL || EXCEPTION_FAILED) {
+				status = COLLECTION_FAILURE;
+				continue;
+			}
+			if (pass == 0) {
+				addProfileIdSlot(table, profileOffset, profile->profileId);
+				maxProfileId = MAX(maxProfileId, profile->profileId);
+			}
+			else {
+				table->offsets[profile->profileId] = profileOffset;
+				table->componentIndexes[profile->profileId] =
+					profile->componentIndex;
+			}
+			profileOffset += (uint32_t)(sizeof(Profile) +
+				(sizeof(uint32_t) * profile->valueCount));
+			COLLECTION_RELEASE(dataSet->profiles, &item);
+		}
+		if (pass == 0 && status == SUCCESS) {
+			if (maxProfileId / PROFILE_ID_TABLE_SPARSITY >= profilesCount) {
+				break;
+			}
+			if (setProfileIdTableCount(table, maxProfileId) == false) {
+				status = INSUFFICIENT_MEMORY;
+			}
 		}
 	}
-
-	return true;
+	if (status == SUCCESS) {
+		dataSet->profileIdTable = table;
+	}
+	else {
+		freeProfileIdTable(table);
+#ifndef FIFTYONE_DEGREES_EXCEPTIONS_DISABLED
+		// The exception will only be available if not disabled.
+		if (EXCEPTION_FAILED) {
+			status = exception->status;
+		}
+#endif
+	}
+	return status;
 }
 
-// True if the header is GHEV, the transform results in at least one additional 
-// header, and there is no exception. Otherwise false.
-static bool setGetHighEntropyValuesHeader(
-	detectionComponentState* state,
-	EvidenceKeyValuePair* pair) {
-	EXCEPTION_CREATE
-    if (IS_HASH_HEADER_MATCH(
-        FIFTYONE_DEGREES_EVIDENCE_HIGH_ENTROPY_VALUES,
-        pair)) {
-        TransformIterateResult result = TransformIterateGhevFromBase64(
-            pair->parsedValue,
-            state->results->b.bufferTransform,
-            state->results->b.bufferTransformLength,
-            setSpecialHeadersCallback,
-            state,
-            exception);
-        return result.iterations > 0 && (EXCEPTION_OKAY || EXCEPTION_CHECK(SUCCESS));
-    }
-    return false;
+/**
+ * Creates the result cache if the option is enabled. Route tracing records the
+ * nodes evaluated for each result, so results are not cached when it is
+ * enabled.
+ */
+static StatusCode initResultCache(DataSetHash *dataSet, Exception *exception) {
+	if (dataSet->config.resultCacheCapacity == 0 ||
+		dataSet->config.traceRoute == true) {
+		return SUCCESS;
+	}
+	dataSet->resultCache = ResultCacheCreate(
+		dataSet->config.resultCacheCapacity,
+		getResultCacheDataSize(dataSet),
+		exception);
+	if (dataSet->resultCache == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+	return SUCCESS;
 }
 
-// True if the header is SUA, the transform results in at least one additional 
-// header, and there is no exception. Otherwise false.
-static bool setStructuredUserAgentHeader(
-	detectionComponentState* state,
-	EvidenceKeyValuePair* pair) {
-	EXCEPTION_CREATE
-    if (IS_HASH_HEADER_MATCH(
-                        FIFTYONE_DEGREES_EVIDENCE_STRUCTURED_USER_AGENT,
-                        pair)) 
-    {
-        TransformIterateResult result = TransformIterateSua
-        (pair->parsedValue,
-         state->results->b.bufferTransform,
-         state->results->b.bufferTransformLength,
-         setSpecialHeadersCallback,
-         state,
-         exception);
+static StatusCode initDataSetFromFile(
+	void *dataSetBase,
+	const void *configBase,
+	PropertiesRequired *properties,
+	const char *fileName,
+	Exception *exception) {
+	DataSetHash *dataSet = (DataSetHash*)dataSetBase;
+	ConfigHash *config = (ConfigHash*)configBase;
+	StatusCode status = NOT_SET;
 
-        return result.iterations > 0 &&
-        (EXCEPTION_OKAY || EXCEPTION_CHECK(SUCCESS));
-    }
-    return false;
-}
+	// Common data set initialisation actions.
+	initDataSet(dataSet, &config);
 
-// Checks for special evidence headers and tries to add additional headers to
-// the headers array.
-static bool setSpecialHeaders(
-	void* state,
-	EvidenceKeyValuePair* pair) {
-	detectionComponentState* s = (detectionComponentState*)state;
-	if(setGetHighEntropyValuesHeader(s, pair) || 
-		setStructuredUserAgentHeader(s, pair)) {
-		return false; // stop iterating
+	// Initialise the super data set with the filename and configuration
+	// provided.
+	status = DataSetInitFromFile(
+		&dataSet->b.b,
+		fileName,
+		sizeof(DataSetHashHeader));
+	if (status != SUCCESS) {
+		freeDataSet(dataSet);
+		return status;
 	}
-	return true; // continue iterating
-}
-
-// If the device id is a valid string uses it to try and find profiles to add
-// to the results in state. Returns true to keep iterating because there might
-// always be another device id to be processed.
-static bool setResultFromDeviceId(
-	void* state,
-	EvidenceKeyValuePair* pair) {
 
-	// Only consider the device id header.
-	if (!IS_HASH_HEADER_MATCH(FIFTYONE_DEGREES_EVIDENCE_DEVICE_ID, pair)) {
-		return true; // not a match, skip
+	// If there is no collection configuration then the entire data file should
+	// be loaded into memory, or mapped if enabled. Otherwise use the
+	// collection configuration to partially load data into memory and cache
+	// the rest.
+	if (config->b.b.allInMemory == true && config->mappedFile == true) {
+		status = initMappedFile(dataSet, exception);
 	}
-
-	// Ignore null device id values.
-	const char* const deviceId = (const char*)pair->parsedValue;
-	if (deviceId == NULL) {
-		return true; // unexpected nullptr value, skip
+	else if (config->b.b.allInMemory == true) {
+		status = initInMemory(dataSet, exception);
+	}
+	else {
+#ifndef FIFTYONE_DEGREES_MEMORY_ONLY
+		status = initWithFile(dataSet, exception);
+#else
+		status = INVALID_CONFIG;
+#endif
 	}
 
-	deviceIdLookupState* const lookupState = (deviceIdLookupState*)state;
-	ResultsHash* const results = lookupState->results;
-	Exception* const exception = lookupState->exception;
-
-	// Increment the number of profiles found.
-	lookupState->profilesFoundFromDeviceId += ResultsHashFromDeviceId(
-		results,
-		deviceId,
-		strlen(deviceId) + 1,
-		exception);
+	// Return the status code if something has gone wrong.
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		// Delete the temp file if one has been created.
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
 
-	// Keep going if not exception.
-	return EXCEPTION_OKAY;
-}
+	// Initialise the required properties and headers and check the
+	// initialisation was successful.
+	status = initPropertiesAndHeaders(dataSet, properties, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		// Delete the temp file if one has been created.
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
 
-// Sets all result in the results collection to the profile associated with the
-// profile id if valid. Returns true if the profile id relates to a profile,
-// otherwise false.
-static void overrideProfileId(void *state, const uint32_t profileId) {
-	detectionComponentState* s = (detectionComponentState*)state;
-	Exception* exception = s->exception;
-	ResultsHash *results = (ResultsHash*)s->results;
-	if (profileId > 0) {
-		addProfileById(results, profileId, true, exception);
+	// Initialise the components available to flag which components have
+	// properties which are to be returned (i.e. available properties).
+	status = initComponentsAvailable(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
 	}
-}
 
-/**
- * Where there are more than one result for the component identifies the result
- * to use for property value get, and device id operations.
- */
-static ResultHash* getResultFromResults(
-	ResultsHash* results,
-	byte componentIndex) {
-	uint32_t i;
-	ResultHash* r;
-	ResultHash* result = NULL;
+	// Check the graphs of the components in use are in the data file if it
+	// has been trimmed.
+	status = checkRootNodesRetained(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
 
-	if (results->count == 1 &&
-		results->items[0].b.uniqueHttpHeaderIndex == -1) {
+	// Compile the nodes into a flat graph if enabled. This follows the
+	// components available so that a pruned graph only has the nodes of the
+	// components in use.
+	status = initFlatGraph(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
 
-		// If there is only one result and uniqueHttpHeaderIndex was not set 
-		// then use the only result that exists.
-		result = results->items;
+	// Check there are properties available for retrieval.
+	if (dataSet->b.b.available->count == 0) {
+		freeDataSet(dataSet);
+		// Delete the temp file if one has been created.
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return REQ_PROP_NOT_PRESENT;
 	}
-	else {
 
-		// Return the first result that has a profile for this component.
-		for (i = 0; i < results->count; i++) {
-			r = &results->items[i];
-			if (r->profileOffsets[componentIndex] != NULL_PROFILE_OFFSET) {
-				result = r;
-				break;
-			}
+	// Initialise the index for properties and profiles to values.
+	initIndicesPropertyProfile(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
 		}
+		return status;
 	}
-	return result;
-}
 
-/**
- * Loop through the HTTP headers that matter to this component index until a
- * matching result for an HTTP header is found in the results.
- */
-static ResultHash* getResultFromResultsForComponentIndex(
-	DataSetHash* dataSet,
-	ResultsHash* results,
-	byte componentIndex) {
-	uint32_t i;
-	ResultHash* result = NULL;
+	// Initialise the headers for each component.
+	if (!initComponentHeaders(dataSet, exception) || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
 
-	// Check if there are any results with on overridden profile. This takes
-	// precedence.
-	for (i = 0; i < results->count; i++) {
-		if (results->items[i].profileIsOverriden[componentIndex]) {
-			return &results->items[i];
+	// Copy the root nodes for each component and header into a table.
+	status = initComponentRootNodes(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
 		}
+		return status;
 	}
 
-	// Now look for the best result based on the order of preference for HTTP
-	// headers.
-	result = getResultFromResults(results, componentIndex);
+	// Create the result cache if enabled.
+	status = initResultCache(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
 
-	// Return the first result if an unmatched result is allowed, otherwise
-	// null.
-	if (result == NULL &&
-		dataSet->config.b.allowUnmatched &&
-		results->count > 0) {
-		result = results->items;
+	// Resolve the values for each profile and property if enabled.
+	status = initValueTable(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
 	}
 
-	return result;
-}
+	// Index the profiles by profile id if enabled.
+	status = initProfileIdTable(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Map the properties to their required property indexes.
+	status = initRequiredPropertyIndexes(dataSet);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Format the JSON key of each required property.
+	status = initJsonProperties(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	initGetHighEntropyValues(dataSet, exception);
+
+	return status;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHashInitManagerFromFile(
+	fiftyoneDegreesResourceManager *manager,
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	const char *fileName,
+	fiftyoneDegreesException *exception) {
+
+	if (config->usePerformanceGraph == false &&
+		config->usePredictiveGraph == false) {
+		return INVALID_CONFIG;
+	}
+
+	DataSetHash *dataSet = (DataSetHash*)Malloc(sizeof(DataSetHash));
+	if (dataSet == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+
+	StatusCode status = initDataSetFromFile(
+		dataSet,
+		config,
+		properties,
+		fileName,
+		exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		return status;
+	}
+	ResourceManagerInit(manager, dataSet, &dataSet->b.b.handle, freeDataSet);
+	if (dataSet->b.b.handle == NULL) {
+		freeDataSet(dataSet);
+		status = INSUFFICIENT_MEMORY;
+	}
+	return status;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHashInitManagerFromMappedFile(
+	fiftyoneDegreesResourceManager *manager,
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	const char *fileName,
+	fiftyoneDegreesException *exception) {
+	// The data set keeps its own copy of the configuration, so the options
+	// can be set on a copy which only needs to last for the initialisation.
+	ConfigHash mappedConfig = config != NULL ? *config : HashInMemoryConfig;
+	mappedConfig.b.b.allInMemory = true;
+	mappedConfig.mappedFile = true;
+	return HashInitManagerFromFile(
+		manager,
+		&mappedConfig,
+		properties,
+		fileName,
+		exception);
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHashSaveSharedGraph(
+	fiftyoneDegreesResourceManager *manager,
+	const char *fileName,
+	fiftyoneDegreesException *exception) {
+	StatusCode status;
+	DataSetHash *dataSet = DataSetHashGet(manager);
+	if (dataSet->flatGraph == NULL) {
+		status = INVALID_CONFIG;
+	}
+	else {
+		status = GraphFlatSave(
+			dataSet->flatGraph,
+			fileName,
+			getSharedGraphOptions(dataSet),
+			getSharedGraphSource(dataSet));
+	}
+	DataSetHashRelease(dataSet);
+	if (status != SUCCESS) {
+		EXCEPTION_SET(status);
+	}
+	return status;
+}
+
+bool fiftyoneDegreesHashSharedGraphChanged(
+	fiftyoneDegreesResourceManager *manager) {
+	bool changed = false;
+	DataSetHash *dataSet = DataSetHashGet(manager);
+	if (dataSet->config.sharedGraphFile != NULL) {
+		changed = GraphFlatGetGeneration(dataSet->config.sharedGraphFile) !=
+			dataSet->sharedGraphGeneration;
+	}
+	DataSetHashRelease(dataSet);
+	return changed;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHashReplicasInit(
+	fiftyoneDegreesHashReplicas *replicas,
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	const char *fileName,
+	fiftyoneDegreesException *exception) {
+	StatusCode status = SUCCESS;
+	uint32_t nodes[NUMA_MAX_NODES];
+	uint32_t i, count = NumaGetNodes(nodes);
+	ConfigHash replicaConfig = config != NULL ? *config : HashInMemoryConfig;
+	replicas->count = 0;
+	for (i = 0; i < NUMA_MAX_NODES; i++) {
+		replicas->nodeReplicas[i] = 0;
+	}
+	replicas->managers = (ResourceManager*)Malloc(
+		sizeof(ResourceManager) * count);
+	if (replicas->managers == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+
+	// Each replica must have its own copy of the data file in memory to bind
+	// to its node. A mapped file would be shared by all of them.
+	if (count > 1) {
+		replicaConfig.b.b.allInMemory = true;
+		replicaConfig.mappedFile = false;
+	}
+	for (i = 0; i < count && status == SUCCESS; i++) {
+		if (count > 1) {
+			replicaConfig.numaNode = (int32_t)nodes[i];
+		}
+		status = HashInitManagerFromFile(
+			&replicas->managers[i],
+			&replicaConfig,
+			properties,
+			fileName,
+			exception);
+		if (status == SUCCESS) {
+			replicas->nodeReplicas[nodes[i]] = i;
+			replicas->count++;
+		}
+	}
+	if (status != SUCCESS) {
+		HashReplicasFree(replicas);
+	}
+	return status;
+}
+
+fiftyoneDegreesResourceManager* fiftyoneDegreesHashReplicasGet(
+	fiftyoneDegreesHashReplicas *replicas) {
+	uint32_t node = replicas->count > 1 ? NumaGetCurrentNode() : 0;
+	return &replicas->managers[replicas->nodeReplicas[node]];
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHashReplicasReload(
+	fiftyoneDegreesHashReplicas *replicas,
+	fiftyoneDegreesException *exception) {
+	StatusCode status = SUCCESS;
+	uint32_t i;
+	for (i = 0; i < replicas->count && status == SUCCESS; i++) {
+		status = HashReloadManagerFromOriginalFile(
+			&replicas->managers[i],
+			exception);
+	}
+	return status;
+}
+
+void fiftyoneDegreesHashReplicasFree(fiftyoneDegreesHashReplicas *replicas) {
+	uint32_t i;
+	for (i = 0; i < replicas->count; i++) {
+		ResourceManagerFree(&replicas->managers[i]);
+	}
+	if (replicas->managers != NULL) {
+		Free(replicas->managers);
+		replicas->managers = NULL;
+	}
+	replicas->count = 0;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHashTrimNodes(
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	const char *sourceFileName,
+	const char *destinationFileName,
+	fiftyoneDegreesException *exception) {
+	StatusCode status;
+	ResourceManager manager;
+	DataSetHash *dataSet;
+	ConfigHash trimConfig = HashInMemoryConfig;
+
+	// Read the data file into memory so that the sections which are not
+	// trimmed can be copied from it. Only the graphs to retain are used from
+	// the configuration provided.
+	trimConfig.usePerformanceGraph =
+		config == NULL || config->usePerformanceGraph;
+	trimConfig.usePredictiveGraph =
+		config == NULL || config->usePredictiveGraph;
+	status = HashInitManagerFromFile(
+		&manager,
+		&trimConfig,
+		properties,
+		sourceFileName,
+		exception);
+	if (status != SUCCESS) {
+		return status;
+	}
+	dataSet = DataSetHashGet(&manager);
+	status = trimDataSet(dataSet, destinationFileName, exception);
+	DataSetHashRelease(dataSet);
+	ResourceManagerFree(&manager);
+	if (status != SUCCESS && EXCEPTION_OKAY) {
+		EXCEPTION_SET(status);
+	}
+	return status;
+}
+
+size_t fiftyoneDegreesHashSizeManagerFromFile(
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	const char *fileName,
+	fiftyoneDegreesException *exception) {
+	size_t allocated;
+	ResourceManager manager;
+	StatusCode status;
+	ConfigHash sizeConfig;
+
+	// Huge pages, and memory bound to a NUMA node, are not allocated with
+	// Malloc so can't be tracked. Measure the same data set in normal memory,
+	// which is the same size.
+	if (config != NULL &&
+		(config->hugePages == true || config->numaNode >= 0)) {
+		sizeConfig = *config;
+		sizeConfig.hugePages = false;
+		sizeConfig.numaNode = -1;
+		config = &sizeConfig;
+	}
+
+	// Set the memory allocation and free methods for tracking.
+	MemoryTrackingReset();
+	Malloc = MemoryTrackingMalloc;
+	MallocAligned = MemoryTrackingMallocAligned;
+	Free = MemoryTrackingFree;
+	FreeAligned = MemoryTrackingFreeAligned;
+
+	// Initialise the manager with the tracking methods in use to determine
+	// the amount of memory that is allocated. Then if successful free all the
+	// memory having tracked the total amount of memory allocated. If not 
+	// successful then update the status of the exception.
+	status = HashInitManagerFromFile(
+		&manager,
+		config,
+		properties,
+		fileName,
+		exception);
+	if (status == SUCCESS) {
+		ResourceManagerFree(&manager);
+	}
+#ifndef FIFTYONE_DEGREES_EXCEPTIONS_DISABLED
+	// Only set the exception status if enabled. 
+	else {
+		exception->status = status;
+	}
+#endif
+
+	// Get the total maximum amount of allocated memory
+	// needed for the manager and associated resources.
+	allocated = MemoryTrackingGetMax();
+
+	// Check that all the memory has been freed.
+	assert(MemoryTrackingGetAllocated() == 0);
+
+	// Return the malloc and free methods to standard operation.
+	Malloc = MemoryStandardMalloc;
+	MallocAligned = MemoryStandardMallocAligned;
+	Free = MemoryStandardFree;
+	FreeAligned = MemoryStandardFreeAligned;
+	MemoryTrackingReset();
+
+	return allocated;
+}
+
+static StatusCode initDataSetFromMemory(
+	void *dataSetBase,
+	const void *configBase,
+	PropertiesRequired *properties,
+	void *memory,
+	long size,
+	Exception *exception) {
+	StatusCode status = SUCCESS;
+	MemoryReader reader;
+	DataSetHash *dataSet = (DataSetHash*)dataSetBase;
+	ConfigHash *config = (ConfigHash*)configBase;
+
+	// Common data set initialisation actions.
+	initDataSet(dataSet, &config);
+
+	// If memory is to be freed when the data set is freed then record the 
+	// pointer to the memory location for future reference.
+	if (dataSet->config.b.b.freeData == true) {
+		dataSet->b.b.memoryToFree = memory;
+	}
+
+	// Set up the reader.
+	reader.startByte = reader.current = (byte*)memory;
+	reader.length = size;
+	reader.lastByte = reader.current + size;
+
+	// Initialise the data set from the memory reader.
+	status = initWithMemory(dataSet, &reader, exception);
+
+	// Return the status code if something has gone wrong.
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		return status;
+	}
+
+	// Initialise the required properties and headers.
+	status = initPropertiesAndHeaders(dataSet, properties, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		return status;
+	}
+
+	// Initialise the components available to flag which components have
+	// properties which are to be returned (i.e. available properties).
+	status = initComponentsAvailable(dataSet, exception);
+
+	// Check the graphs of the components in use are in the data file if it
+	// has been trimmed.
+	if (status == SUCCESS && EXCEPTION_OKAY) {
+		status = checkRootNodesRetained(dataSet, exception);
+	}
+
+	// Compile the nodes into a flat graph if enabled, after the components
+	// available so that a pruned graph only has the components in use.
+	if (status == SUCCESS && EXCEPTION_OKAY) {
+		status = initFlatGraph(dataSet, exception);
+	}
+	
+	// Initialise the index for properties and profiles to values.
+	initIndicesPropertyProfile(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Initialise the headers for each component.
+	if (!initComponentHeaders(dataSet, exception) || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Copy the root nodes for each component and header into a table.
+	status = initComponentRootNodes(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Create the result cache if enabled.
+	status = initResultCache(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Resolve the values for each profile and property if enabled.
+	status = initValueTable(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Index the profiles by profile id if enabled.
+	status = initProfileIdTable(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Map the properties to their required property indexes.
+	status = initRequiredPropertyIndexes(dataSet);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	// Format the JSON key of each required property.
+	status = initJsonProperties(dataSet, exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		freeDataSet(dataSet);
+		if (config->b.b.useTempFile == true) {
+			FileDelete(dataSet->b.b.fileName);
+		}
+		return status;
+	}
+
+	initGetHighEntropyValues(dataSet, exception);
+
+	return status;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHashInitManagerFromMemory(
+	fiftyoneDegreesResourceManager *manager,
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	void *memory,
+	long size,
+	fiftyoneDegreesException *exception) {
+
+	if (config->usePerformanceGraph == false &&
+		config->usePredictiveGraph == false) {
+		return INVALID_CONFIG;
+	}
+
+	DataSetHash *dataSet = (DataSetHash*)Malloc(sizeof(DataSetHash));
+	if (dataSet == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+
+	StatusCode status = initDataSetFromMemory(
+		dataSet,
+		config,
+		properties,
+		memory,
+		size,
+		exception);
+	if (status != SUCCESS || EXCEPTION_FAILED) {
+		Free(dataSet);
+		return status;
+	}
+	ResourceManagerInit(manager, dataSet, &dataSet->b.b.handle, freeDataSet);
+	if (dataSet->b.b.handle == NULL)
+	{
+		freeDataSet(dataSet);
+		status = INSUFFICIENT_MEMORY;
+	}
+	return status;
+}
+
+size_t fiftyoneDegreesHashSizeManagerFromMemory(
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	void *memory,
+	long size,
+	fiftyoneDegreesException *exception) {
+	size_t allocated;
+	ResourceManager manager;
+#ifdef _DEBUG
+	StatusCode status;
+#endif
+	// Set the memory allocation and free methods for tracking.
+	MemoryTrackingReset();
+	Malloc = MemoryTrackingMalloc;
+	MallocAligned = MemoryTrackingMallocAligned;
+	Free = MemoryTrackingFree;
+	FreeAligned = MemoryTrackingFreeAligned;
+
+	// Ensure that the memory used is not freed with the data set.
+	ConfigHash sizeConfig = *config;
+	sizeConfig.b.b.freeData = false;
+
+	// Initialise the manager with the tracking methods in use to determine
+	// the amount of memory that is allocated.
+#ifdef _DEBUG
+	status =
+#endif
+	HashInitManagerFromMemory(
+		&manager,
+		&sizeConfig,
+		properties,
+		memory,
+		size,
+		exception);
+#ifdef _DEBUG
+	assert(status == SUCCESS);
+#endif
+	assert(EXCEPTION_OKAY);
+
+	// Free the manager and get the total maximum amount of allocated memory
+	// needed for the manager and associated resources.
+	ResourceManagerFree(&manager);
+	allocated = MemoryTrackingGetMax();
+
+	// Check that all the memory has been freed.
+	assert(MemoryTrackingGetAllocated() == 0);
+
+	// Return the malloc and free methods to standard operation.
+	Malloc = MemoryStandardMalloc;
+	MallocAligned = MemoryStandardMallocAligned;
+	Free = MemoryStandardFree;
+	FreeAligned = MemoryStandardFreeAligned;
+	MemoryTrackingReset();
+
+	return allocated;
+}
+
+// Gets the offset and component index of the profile with the profile id
+// from the profile id table if it has entries, otherwise from the profile
+// offsets and profiles collections. Returns true if the profile was found,
+// otherwise false.
+static bool getProfileById(
+	DataSetHash *dataSet,
+	const uint32_t profileId,
+	uint32_t *profileOffset,
+	byte *componentIndex,
+	Exception *exception) {
+	Item profileItem;
+	Profile *profile;
+	const HashProfileIdTable *table = dataSet->profileIdTable;
+	if (table != NULL && table->offsets != NULL) {
+		if (profileId < table->count &&
+			table->offsets[profileId] != NULL_PROFILE_OFFSET) {
+			*profileOffset = table->offsets[profileId];
+			*componentIndex = table->componentIndexes[profileId];
+			return true;
+		}
+		return false;
+	}
+	if (ProfileGetOffsetForProfileId(
+			dataSet->profileOffsets,
+			profileId,
+			profileOffset,
+			exception) != NULL && EXCEPTION_OKAY) {
+		DataReset(&profileItem.data);
+		const CollectionKey profileKey = {
+			{*profileOffset},
+			CollectionKeyType_Profile,
+		};
+		profile = (Profile*)dataSet->profiles->get(
+			dataSet->profiles,
+			&profileKey,
+			&profileItem,
+			exception);
+		if (profile != NULL && EXCEPTION_OKAY) {
+			*componentIndex = profile->componentIndex;
+			COLLECTION_RELEASE(dataSet->profiles, &profileItem);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Adds the profile associated with the integer profile id provided to the 
+// results. Returns true if the profile could be found, otherwise false.
+static bool addProfileById(
+	ResultsHash *results,
+	const uint32_t profileId,
+	bool isOverride,
+	Exception *exception) {
+	uint32_t profileOffset;
+	byte componentIndex;
+	ResultHash *result;
+	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
+	uint32_t i;
+	if (profileId != 0 &&
+		getProfileById(
+			dataSet,
+			profileId,
+			&profileOffset,
+			&componentIndex,
+			exception)) {
+
+		// Ensure the results structure has sufficient items to store the 
+		// profile offsets.
+		if (results->count == 0) {
+			results->count = 1;
+			result = results->items;
+			hashResultReset(dataSet, result);
+			result->b.uniqueHttpHeaderIndex = -1;
+		}
+
+		// For each of the results update them to use the profile offset
+		// rather than their current profile for the component.
+		for (i = 0; i < results->count; i++) {
+			addProfile(
+				&results->items[i], 
+				componentIndex, 
+				profileOffset,
+				isOverride);
+		}
+
+		// A profile was found and added.
+		return true;
+	}
+
+	// There is no corresponding profile for the profile id.
+	return false;
+}
+
+// Returns the root nodes for the header from the component if the component
+// has a graph for the header, otherwise NULL.
+static HashRootNodes* getRootNodesForComponentHeader(
+	DataSetHash* dataSet,
+	byte componentIndex,
+	Header* header) {
+	HashRootNodes* rootNodes;
+	const uint32_t headersCount = dataSet->b.b.uniqueHeaders->count;
+	if (header->index >= headersCount) {
+		return NULL;
+	}
+	rootNodes = &dataSet->componentRootNodes[
+		componentIndex * headersCount + header->index];
+	return rootNodes->performanceNodeOffset == NULL_ROOT_NODE_OFFSET ?
+		NULL : rootNodes;
+}
+
+
+// Set the members of the result and rest the result.
+static ResultHash* hashResultSet(
+	DataSetHash* dataSet, 
+	ResultHash* result, 
+	const char* value, 
+	size_t valueLength, 
+	int headerIndex) {
+	hashResultReset(dataSet, result);
+	result->b.targetUserAgent = value;
+	result->b.targetUserAgentLength = valueLength;
+	result->b.uniqueHttpHeaderIndex = headerIndex;
+	return result;
+}
+
+// Returns the next result in the results if there is capacity available, 
+// otherwise null.
+static ResultHash* getNextResult(
+	const char* value, 
+	size_t length,
+	ResultsHash* results,
+	int headerIndex) {
+	ResultHash* result = NULL;
+	if (results->count < results->capacity) {
+		result = hashResultSet(
+			(DataSetHash*)results->b.b.dataSet, 
+			&((ResultHash*)results->items)[results->count++],
+			value, 
+			length, 
+			headerIndex);
+	}
+	return result;
+}
+
+// Returns the hash codes of every prefix of the result's target, calculating
+// them if they have not already been calculated for the current evidence. The
+// same evidence value is evaluated by every component, both graphs and any
+// retries, which all share the hash codes. Returns NULL if the memory for the
+// hash codes could not be allocated.
+static const uint32_t* getPrefixHashes(
+	ResultsHash* results,
+	ResultHash* result) {
+	uint32_t* hashes;
+	HashPrefixHashes* prefix;
+	const char* target = result->b.targetUserAgent;
+	const size_t length = result->b.targetUserAgentLength;
+	DataSetHash* dataSet = (DataSetHash*)results->b.b.dataSet;
+	if (results->prefixHashes == NULL ||
+		target == NULL ||
+		result->b.uniqueHttpHeaderIndex < 0 ||
+		(uint32_t)result->b.uniqueHttpHeaderIndex >=
+			dataSet->b.b.uniqueHeaders->count) {
+		return NULL;
+	}
+	prefix = &results->prefixHashes[result->b.uniqueHttpHeaderIndex];
+	if (prefix->value == target && prefix->length == length) {
+		return prefix->hashes;
+	}
+
+	// Increase the memory if the value is longer than any seen before.
+	if (prefix->capacity < length + 1) {
+		hashes = (uint32_t*)Malloc(sizeof(uint32_t) * (length + 1));
+		if (hashes == NULL) {
+			return NULL;
+		}
+		if (prefix->hashes != NULL) {
+			Free(prefix->hashes);
+		}
+		prefix->hashes = hashes;
+		prefix->capacity = length + 1;
+	}
+
+	// Hash each prefix using:
+	// H[i+1] = (H[i]*p) + c[i]
+	hashes = prefix->hashes;
+	hashes[0] = 0;
+	for (size_t i = 0; i < length; i++) {
+		hashes[i + 1] = (hashes[i] * RK_PRIME) + target[i];
+	}
+	prefix->value = target;
+	prefix->length = length;
+	return hashes;
+}
+
+static void completeResult(
+	ResultHash* result, 
+	detectionState* state, 
+	byte componentIndex) {
+	result->iterations = state->iterations;
+	result->drift = state->drift;
+	result->difference = state->difference;
+	result->matchedNodes = state->matchedNodes;
+	if (result->b.matchedUserAgent != NULL) {
+		result->b.matchedUserAgent[
+			MIN(state->result->b.targetUserAgentLength,
+				state->result->b.matchedUserAgentLength)] = '\0';
+	}
+	if (state->matchedNodes == 0) {
+		result->method = FIFTYONE_DEGREES_HASH_MATCH_METHOD_NONE;
+	}
+	else if (state->performanceMatches > 0 &&
+		state->predictiveMatches > 0) {
+		result->method = FIFTYONE_DEGREES_HASH_MATCH_METHOD_COMBINED;
+	}
+	else if (state->performanceMatches > 0) {
+		result->method = FIFTYONE_DEGREES_HASH_MATCH_METHOD_PERFORMANCE;
+	}
+	else if (state->predictiveMatches > 0) {
+		result->method = FIFTYONE_DEGREES_HASH_MATCH_METHOD_PREDICTIVE;
+	}
+
+	// Add the profile to the result for the component index and set all other
+	// profile offsets to null indicating that the result does not relate to
+	// those components.
+	for (uint32_t i = 0; i < state->dataSet->componentsList.count; i++) {
+		result->profileOffsets[i] = 
+			componentIndex == i ? 
+			state->profileOffset : 
+			NULL_PROFILE_OFFSET;
+	}
+}
+
+// For the value, component, and header performs device detection using the 
+// associated root nodes. Returns true if the process completed, otherwise
+// false.
+static bool setResultForComponentHeader(
+	DataSetHash* dataSet,
+	ResultsHash* results,
+	byte componentIndex,
+	Header* header,
+	ResultHash* result,
+	Exception* exception) {
+	detectionState ddState;
+	bool complete = false;
+	Component* component = COMPONENT(dataSet, componentIndex);
+
+	// Get the root nodes for the component and header.
+	HashRootNodes* rootNodes = getRootNodesForComponentHeader(
+		dataSet,
+		componentIndex,
+		header);
+	if (rootNodes != NULL) {
+
+		// Initialise the device detection state.
+		detectionStateInit(
+			&ddState,
+			result,
+			dataSet,
+			getPrefixHashes(results, result),
+			exception);
+
+		// Perform the device detection using the root nodes.
+		if (processRoots(
+			&ddState,
+			dataSet,
+			componentIndex,
+			component,
+			rootNodes) == true) {
+
+			// Complete the result copying the metrics from the device 
+			// detection state.
+			completeResult(result, &ddState, componentIndex);
+
+			complete = true;
+		}
+	}
+
+	return complete;
+}
+
+// Determines if there is a header index related to the component for the pair
+// provided and if there is tries to complete device detection. Returns false
+// if the pair resulted in a match or there are no results available to prevent
+// further processing. Returns true if more headers should be checked.
+static bool setResultFromEvidenceForComponentCallback(
+	void* state, EvidenceKeyValuePair *pair) {
+	ResultHash* result;
+	bool complete = false;
+	detectionComponentState* s = (detectionComponentState*)state;
+	Exception* exception = s->exception;
+	if (pair->header != NULL && pair->header->isDataSet) {
+
+		// Skip the evidence if it has already been evaluated, leaving the
+		// last result to be reused for the next evidence.
+		if (s->evaluatedPairs > 0) {
+			s->evaluatedPairs--;
+			return true;
+		}
+
+		// Get the next result instance in the array of results or if there
+		// is already a result instance assigned to this iteration then use
+		// that one as it indicates that a prior evaluation did not result in
+		// any matched nodes.
+		result = s->lastResult == NULL ?
+			getNextResult(
+				(const char*)pair->parsedValue, 
+				pair->parsedLength, 
+				s->results, 
+				pair->header->index) :
+			hashResultSet(
+				s->dataSet, 
+				s->lastResult, 
+				(const char*)pair->parsedValue,
+				pair->parsedLength,
+				pair->header->index);
+		if (result != NULL) {
+
+			// Set the last result instance in case this iteration doesn't 
+			// produce and outcome that concludes the iterations.
+			s->lastResult = result;
+
+			// Perform the device detection and set the result.
+			complete = setResultForComponentHeader(
+				s->dataSet,
+				s->results,
+				s->componentIndex,
+				pair->header,
+				result,
+				exception);
+			if (EXCEPTION_FAILED) return false;
+
+		}
+		else {
+
+			// There is no result instance available so stop iterating.
+			complete = true;
+		}
+	}
+	return !complete;
+}
+
+// If the pair matches the header being sought then stop and record the pair,
+// otherwise continue iterating.
+static bool setSpecialHeadersFindCallback(
+	void* state,
+	EvidenceKeyValuePair* pair) {
+	setSpecialHeadersFindState* findState = (setSpecialHeadersFindState*)state;
+	if (findState->header->keyLength == pair->item.keyLength &&
+		StringCompareLength(
+			findState->header->key,
+			pair->item.key,
+			pair->item.keyLength) == 0) {
+		findState->pair = pair;
+		return false;
+	}
+	return true;
+}
+
+// Adds the header to the evidence. If the header already exists then the 
+// current value is replaced.
+static bool setSpecialHeadersCallback(void *state, KeyValuePair header) {
+	int uniqueHeaderIndex;
+	detectionComponentState* componentState = (detectionComponentState*)state;
+
+	// Get the existing pair for the header with any prefix.
+	setSpecialHeadersFindState findState = { &header, NULL };
+	EvidenceIterate(
+		componentState->evidence,
+		INT_MAX,
+		&findState,
+		setSpecialHeadersFindCallback);
+
+	if (findState.pair == NULL) {
+		// No pair was found so add a new string.
+		findState.pair = EvidenceAddPair(
+			componentState->evidence,
+			FIFTYONE_DEGREES_EVIDENCE_HTTP_HEADER_STRING,
+			header);
+	}
+
+	// Update the parsed value and length.
+	findState.pair->parsedValue = header.value;
+	findState.pair->parsedLength = header.valueLength;
+	
+	// Ensure a unique header is associated with the pair. Perhaps the original
+	// pair was added without a known header.
+	if (findState.pair->header == NULL) {
+
+		// Get the unique header index for the header.
+		uniqueHeaderIndex = HeaderGetIndex(
+			componentState->dataSet->b.b.uniqueHeaders,
+			header.key,
+			header.keyLength);
+		if (uniqueHeaderIndex >= 0) {
+			findState.pair->header =
+				&componentState->dataSet->b.b.uniqueHeaders->items[
+					uniqueHeaderIndex];
+		}
+	}
+
+	return true;
+}
+
+// True if the header is GHEV, the transform results in at least one additional 
+// header, and there is no exception. Otherwise false.
+static bool setGetHighEntropyValuesHeader(
+	detectionComponentState* state,
+	EvidenceKeyValuePair* pair) {
+	EXCEPTION_CREATE
+    if (IS_HASH_HEADER_MATCH(
+        FIFTYONE_DEGREES_EVIDENCE_HIGH_ENTROPY_VALUES,
+        pair)) {
+        TransformIterateResult result = TransformIterateGhevFromBase64(
+            pair->parsedValue,
+            state->results->b.bufferTransform,
+            state->results->b.bufferTransformLength,
+            setSpecialHeadersCallback,
+            state,
+            exception);
+        return result.iterations > 0 && (EXCEPTION_OKAY || EXCEPTION_CHECK(SUCCESS));
+    }
+    return false;
+}
+
+// True if the header is SUA, the transform results in at least one additional 
+// header, and there is no exception. Otherwise false.
+static bool setStructuredUserAgentHeader(
+	detectionComponentState* state,
+	EvidenceKeyValuePair* pair) {
+	EXCEPTION_CREATE
+    if (IS_HASH_HEADER_MATCH(
+                        FIFTYONE_DEGREES_EVIDENCE_STRUCTURED_USER_AGENT,
+                        pair)) 
+    {
+        TransformIterateResult result = TransformIterateSua
+        (pair->parsedValue,
+         state->results->b.bufferTransform,
+         state->results->b.bufferTransformLength,
+         setSpecialHeadersCallback,
+         state,
+         exception);
+
+        return result.iterations > 0 &&
+        (EXCEPTION_OKAY || EXCEPTION_CHECK(SUCCESS));
+    }
+    return false;
+}
+
+// Checks for special evidence headers and tries to add additional headers to
+// the headers array.
+static bool setSpecialHeaders(
+	void* state,
+	EvidenceKeyValuePair* pair) {
+	detectionComponentState* s = (detectionComponentState*)state;
+	if(setGetHighEntropyValuesHeader(s, pair) || 
+		setStructuredUserAgentHeader(s, pair)) {
+		return false; // stop iterating
+	}
+	return true; // continue iterating
+}
+
+// If the device id is a valid string uses it to try and find profiles to add
+// to the results in state. Returns true to keep iterating because there might
+// always be another device id to be processed.
+static bool setResultFromDeviceId(
+	void* state,
+	EvidenceKeyValuePair* pair) {
+
+	// Only consider the device id header.
+	if (!IS_HASH_HEADER_MATCH(FIFTYONE_DEGREES_EVIDENCE_DEVICE_ID, pair)) {
+		return true; // not a match, skip
+	}
+
+	// Ignore null device id values.
+	const char* const deviceId = (const char*)pair->parsedValue;
+	if (deviceId == NULL) {
+		return true; // unexpected nullptr value, skip
+	}
+
+	deviceIdLookupState* const lookupState = (deviceIdLookupState*)state;
+	ResultsHash* const results = lookupState->results;
+	Exception* const exception = lookupState->exception;
+
+	// Increment the number of profiles found.
+	lookupState->profilesFoundFromDeviceId += ResultsHashFromDeviceId(
+		results,
+		deviceId,
+		strlen(deviceId) + 1,
+		exception);
+
+	// Keep going if not exception.
+	return EXCEPTION_OKAY;
+}
+
+// Sets all result in the results collection to the profile associated with the
+// profile id if valid. Returns true if the profile id relates to a profile,
+// otherwise false.
+static void overrideProfileId(void *state, const uint32_t profileId) {
+	detectionComponentState* s = (detectionComponentState*)state;
+	Exception* exception = s->exception;
+	ResultsHash *results = (ResultsHash*)s->results;
+	if (profileId > 0) {
+		addProfileById(results, profileId, true, exception);
+	}
+}
+
+/**
+ * Where there are more than one result for the component identifies the result
+ * to use for property value get, and device id operations.
+ */
+static ResultHash* getResultFromResults(
+	ResultsHash* results,
+	byte componentIndex) {
+	uint32_t i;
+	ResultHash* r;
+	ResultHash* result = NULL;
+
+	if (results->count == 1 &&
+		results->items[0].b.uniqueHttpHeaderIndex == -1) {
+
+		// If there is only one result and uniqueHttpHeaderIndex was not set 
+		// then use the only result that exists.
+		result = results->items;
+	}
+	else {
+
+		// Return the first result that has a profile for this component.
+		for (i = 0; i < results->count; i++) {
+			r = &results->items[i];
+			if (r->profileOffsets[componentIndex] != NULL_PROFILE_OFFSET) {
+				result = r;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+/**
+ * Loop through the HTTP headers that matter to this component index until a
+ * matching result for an HTTP header is found in the results.
+ */
+static ResultHash* getResultFromResultsForComponentIndex(
+	DataSetHash* dataSet,
+	ResultsHash* results,
+	byte componentIndex) {
+	uint32_t i;
+	ResultHash* result = NULL;
+
+	// Check if there are any results with on overridden profile. This takes
+	// precedence.
+	for (i = 0; i < results->count; i++) {
+		if (results->items[i].profileIsOverriden[componentIndex]) {
+			return &results->items[i];
+		}
+	}
+
+	// Now look for the best result based on the order of preference for HTTP
+	// headers.
+	result = getResultFromResults(results, componentIndex);
+
+	// Return the first result if an unmatched result is allowed, otherwise
+	// null.
+	if (result == NULL &&
+		dataSet->config.b.allowUnmatched &&
+		results->count > 0) {
+		result = results->items;
+	}
+
+	return result;
+}
 
 static void resultsHashFromEvidence_extractOverrides(
 	detectionComponentState* state,
@@ -2886,6 +5669,154 @@ static void resultsHashFromEvidence_handleComponentEvidence(
 	}
 }
 
+// Records the first pair which would be evaluated by 
+// setResultFromEvidenceForComponentCallback and stops iterating.
+static bool findComponentEvidenceCallback(
+	void* state, 
+	EvidenceKeyValuePair* pair) {
+	batchComponentEvidence* evidence = (batchComponentEvidence*)state;
+	if (pair->header != NULL && pair->header->isDataSet) {
+		evidence->value = (const char*)pair->parsedValue;
+		evidence->valueLength = pair->parsedLength;
+		evidence->header = pair->header;
+		evidence->found = true;
+		return false;
+	}
+	return true;
+}
+
+// Finds the first evidence value for the component in the state using the
+// same order of precedence as resultsHashFromEvidence_handleComponentEvidence.
+static void resultsHashFromEvidence_findComponentEvidence(
+	detectionComponentState* state,
+	batchComponentEvidence* evidence) {
+	evidence->found = false;
+	for (int i = 0;
+		i < FIFTYONE_DEGREES_ORDER_OF_PRECEDENCE_SIZE &&
+		evidence->found == false;
+		i++) {
+		EvidenceIterateForHeaders(
+			state->evidence,
+			prefixOrderOfPrecedence[i],
+			state->dataSet->componentHeaders[state->componentIndex],
+			state->results->b.bufferPseudo,
+			state->results->b.bufferPseudoLength,
+			evidence,
+			findComponentEvidenceCallback);
+	}
+}
+
+// For the component index performs device detection for each of the states
+// where detect is true. The first evidence value for the component is evaluated
+// for all the states together using the interleaved graph walk. Where that
+// value does not complete detection the state continues from the next
+// evidence value with resultsHashFromEvidence_handleComponentEvidence, so no
+// evidence is evaluated twice. The outcome is identical to
+// calling resultsHashFromEvidence_handleComponentEvidence for each state.
+static void resultsHashFromEvidence_handleComponentEvidenceBlock(
+	DataSetHash* dataSet,
+	byte componentIndex,
+	detectionComponentState* states,
+	const bool* detect,
+	uint32_t count,
+	Exception* const exception) {
+	uint32_t i, walking = 0;
+	batchComponentEvidence evidence;
+	ResultHash* result;
+	Component* component = COMPONENT(dataSet, componentIndex);
+	detectionState ddStates[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	detectionState* ddStatePtrs[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	HashRootNodes* rootNodes[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	uint32_t walkingIndexes[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	bool matched[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	bool retry[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+
+	// Find the first evidence for the component and the root nodes for each
+	// state.
+	for (i = 0; i < count && EXCEPTION_OKAY; i++) {
+		retry[i] = false;
+		if (detect[i] == false) {
+			continue;
+		}
+		states[i].componentIndex = componentIndex;
+		states[i].lastResult = NULL;
+		resultsHashFromEvidence_findComponentEvidence(&states[i], &evidence);
+		if (evidence.found == false) {
+			continue;
+		}
+		result = getNextResult(
+			evidence.value,
+			evidence.valueLength,
+			states[i].results,
+			evidence.header->index);
+		if (result == NULL) {
+			continue;
+		}
+		rootNodes[walking] = getRootNodesForComponentHeader(
+			dataSet,
+			componentIndex,
+			evidence.header);
+		if (rootNodes[walking] != NULL) {
+			detectionStateInit(
+				&ddStates[walking],
+				result,
+				dataSet,
+				getPrefixHashes(states[i].results, result),
+				exception);
+			ddStatePtrs[walking] = &ddStates[walking];
+			walkingIndexes[walking] = i;
+			matched[walking] = false;
+			walking++;
+		}
+		else {
+
+			// There is no graph for the header, so continue from the next
+			// evidence as setResultFromEvidenceForComponentCallback does.
+			states[i].lastResult = result;
+			retry[i] = true;
+		}
+	}
+
+	// Evaluate the graphs for all the states together.
+	if (walking > 0 && EXCEPTION_OKAY) {
+		processRootsInterleaved(
+			ddStatePtrs,
+			dataSet,
+			componentIndex,
+			component,
+			rootNodes,
+			matched,
+			walking);
+	}
+
+	// Complete the results that matched. The others keep the result, which
+	// is reused for the next evidence in the same way as
+	// setResultFromEvidenceForComponentCallback.
+	for (i = 0; i < walking; i++) {
+		if (matched[i] && EXCEPTION_OKAY) {
+			completeResult(
+				ddStates[i].result,
+				&ddStates[i],
+				componentIndex);
+		}
+		else {
+			states[walkingIndexes[i]].lastResult = ddStates[i].result;
+			retry[walkingIndexes[i]] = true;
+		}
+	}
+
+	// Continue the states where the first evidence did not complete detection
+	// from the evidence after the first, which has already been evaluated
+	// including any retries with difference and drift.
+	for (i = 0; i < count && EXCEPTION_OKAY; i++) {
+		if (retry[i]) {
+			states[i].evaluatedPairs = 1;
+			resultsHashFromEvidence_handleComponentEvidence(&states[i]);
+			states[i].evaluatedPairs = 0;
+		}
+	}
+}
+
 // If there are GHEV or SUA headers then these need to be transformed into 
 // additional headers in the evidence array.
 static void resultsHashFromEvidence_setSpecialHeaders(
@@ -2969,45 +5900,39 @@ static void resultsHashReset(ResultsHash* results) {
 		hashResultReset(dataSet, &results->items[i]);
 	}
 	results->count = 0;
-}
 
-void fiftyoneDegreesResultsHashFromEvidence(
-	fiftyoneDegreesResultsHash *results,
-	fiftyoneDegreesEvidenceKeyValuePairArray *evidence,
-	fiftyoneDegreesException *exception) {
-	DataSetHash* dataSet = (DataSetHash*)results->b.b.dataSet;
-
-	// Check for null evidence and set an exception if not present.
-	if (evidence == (EvidenceKeyValuePairArray*)NULL) {
-		EXCEPTION_SET(NULL_POINTER);
-		return;
+	// The evidence values may have changed so the prefix hash codes must be
+	// calculated again.
+	if (results->prefixHashes != NULL) {
+		for (uint32_t i = 0; i < dataSet->b.b.uniqueHeaders->count; i++) {
+			results->prefixHashes[i].value = NULL;
+		}
 	}
+}
 
-	// Initialise the state.
-	detectionComponentState state = {
-		dataSet,
-		results,
-		NULL,
-		evidence,
-		0,
-		0,
-		0,
-		exception };
+// Performs the steps that precede the graph evaluation for the evidence in the
+// state. Returns true if the graphs need to be evaluated, or false if device
+// ids in the evidence have already provided the profiles.
+static bool resultsHashFromEvidence_prepare(
+	detectionComponentState* state,
+	Exception* const exception) {
+	DataSetHash* dataSet = state->dataSet;
+	int deviceIdsFound = 0;
 
 	// Reset the results data before iterating the evidence.
-	resultsHashReset(results);
-	
+	resultsHashReset(state->results);
+
 	do {
 
 		// If enabled, extract any overridden values.
 		if (dataSet->config.b.processSpecialEvidence) {
-			resultsHashFromEvidence_extractOverrides(&state, exception);
+			resultsHashFromEvidence_extractOverrides(state, exception);
 			if (EXCEPTION_FAILED) { break; };
 		}
 
 		// If enabled, try and find device ids in the evidence provided.
-		const int deviceIdsFound = dataSet->config.b.processSpecialEvidence ?
-			resultsHashFromEvidence_findAndApplyDeviceIDs(&state, exception) :
+		deviceIdsFound = dataSet->config.b.processSpecialEvidence ?
+			resultsHashFromEvidence_findAndApplyDeviceIDs(state, exception) :
 			0;
 		if (EXCEPTION_FAILED) { break; };
 
@@ -3016,43 +5941,436 @@ void fiftyoneDegreesResultsHashFromEvidence(
 			// If enabled, check for the presence of special evidence and
 			// transform these if present into additional headers.
 			if (dataSet->config.b.processSpecialEvidence) {
-				resultsHashFromEvidence_setSpecialHeaders(&state);
+				resultsHashFromEvidence_setSpecialHeaders(state);
 			}
 
 			// Sets the index of the header in the data set to improve 
 			// efficiency of subsequent processing.
-			resultsHashFromEvidence_setEvidenceHeader(&state);
+			resultsHashFromEvidence_setEvidenceHeader(state);
+		}
 
-			// Evaluate all the available evidence for the components that
-			// relate to available properties.
-			resultsHashFromEvidence_handleAllEvidence(&state);
+	} while (false); // once
+
+	return deviceIdsFound == 0;
+}
+
+// Adds the evidence which relates to a header in the data set to the
+// fingerprint, and records the parsed value. Other evidence has no bearing on
+// the results of the graphs.
+static bool addEvidenceToFingerprint(
+	void* state,
+	EvidenceKeyValuePair* pair) {
+	uint32_t key[3];
+	cacheKey* cache = (cacheKey*)state;
+	if (pair->header != NULL) {
+		key[0] = (uint32_t)pair->prefix;
+		key[1] = (uint32_t)pair->header->index;
+		key[2] = (uint32_t)pair->parsedLength;
+		ResultCacheFingerprintAdd(&cache->fingerprint, key, sizeof(key));
+		ResultCacheFingerprintAdd(
+			&cache->fingerprint,
+			pair->parsedValue,
+			pair->parsedLength);
+		if (cache->count < CACHE_KEY_VALUES) {
+			cache->values[cache->count] = (const char*)pair->parsedValue;
+		}
+		cache->count++;
+	}
+	return true;
+}
+
+// Returns the position of the target among the evidence values recorded in
+// the key, or one of the CACHED_TARGET values.
+static int32_t getCachedTargetIndex(
+	const cacheKey* key,
+	const ResultHash* result) {
+	uint32_t i;
+	if (result->b.targetUserAgent == NULL) {
+		return CACHED_TARGET_NONE;
+	}
+	for (i = 0; i < key->count && i < CACHE_KEY_VALUES; i++) {
+		if (key->values[i] == result->b.targetUserAgent) {
+			return (int32_t)i;
+		}
+	}
+	return CACHED_TARGET_FIND;
+}
+
+// Sets the target of the result to the evidence for the header of the result,
+// which may be a pseudo header constructed from several pieces of evidence.
+static bool setTargetFromEvidence(
+	void* state,
+	EvidenceKeyValuePair* pair) {
+	ResultHash* result = (ResultHash*)state;
+	if (pair->header != NULL &&
+		(int)pair->header->index == result->b.uniqueHttpHeaderIndex) {
+		result->b.targetUserAgent = (const char*)pair->parsedValue;
+		return false;
+	}
+	return true;
+}
+
+// If there is a result cache then sets the key for the evidence in the state
+// and copies the results from the cache if present. Returns true if the
+// graphs need to be evaluated, or false if the results came from the cache.
+// The difference and drift are part of the fingerprint as they can be changed
+// after the data set is loaded.
+static bool resultsHashFromEvidence_getFromCache(
+	detectionComponentState* state,
+	cacheKey* key) {
+	DataSetHash* dataSet = state->dataSet;
+	ResultsHash* results = state->results;
+	const uint32_t size = getCachedResultSize(dataSet);
+	const byte* current;
+	const cachedResult* cached;
+	ResultHash* result;
+	int32_t options[2];
+	uint32_t i, c, p, count;
+
+	if (dataSet->resultCache == NULL || results->resultCacheData == NULL) {
+		return true;
+	}
+	options[0] = dataSet->config.difference;
+	options[1] = dataSet->config.drift;
+	key->count = 0;
+	ResultCacheFingerprintInit(&key->fingerprint);
+	ResultCacheFingerprintAdd(&key->fingerprint, options, sizeof(options));
+	EvidenceIterate(
+		state->evidence,
+		INT_MAX,
+		key,
+		addEvidenceToFingerprint);
+	if (ResultCacheGet(
+		dataSet->resultCache,
+		&key->fingerprint,
+		results->resultCacheData) == false) {
+		return true;
+	}
+
+	memcpy(&count, results->resultCacheData, sizeof(uint32_t));
+	current = results->resultCacheData + sizeof(uint32_t);
+	for (i = 0; i < count; i++) {
+		cached = (const cachedResult*)current;
+		result = &results->items[i];
+		result->b.uniqueHttpHeaderIndex = cached->uniqueHttpHeaderIndex;
+		result->b.targetUserAgentLength = cached->targetUserAgentLength;
+		result->b.matchedUserAgentLength = cached->matchedUserAgentLength;
+		result->method = (HashMatchMethod)cached->method;
+		result->iterations = cached->iterations;
+		result->difference = cached->difference;
+		result->drift = cached->drift;
+		result->matchedNodes = cached->matchedNodes;
+		memcpy(
+			result->profileOffsets,
+			cached + 1,
+			sizeof(uint32_t) * dataSet->componentsList.count);
+		for (c = 0; c < dataSet->componentsList.count; c++) {
+			result->profileIsOverriden[c] = false;
+		}
+		if (result->b.matchedUserAgent != NULL) {
+			memcpy(
+				result->b.matchedUserAgent,
+				(const byte*)(cached + 1) +
+				(sizeof(uint32_t) * dataSet->componentsList.count),
+				dataSet->config.b.maxMatchedUserAgentLength + 1);
 		}
 
+		// The target is usually one of the evidence values recorded in the
+		// key. Otherwise it is found in the evidence provided in the same way
+		// as when the graphs are evaluated, so that the value of a pseudo
+		// header is constructed in the results' pseudo header buffer.
+		result->b.targetUserAgent = NULL;
+		if (cached->targetIndex >= 0 &&
+			(uint32_t)cached->targetIndex < key->count &&
+			cached->targetIndex < CACHE_KEY_VALUES) {
+			result->b.targetUserAgent = key->values[cached->targetIndex];
+		}
+		for (c = 0;
+			cached->targetIndex == CACHED_TARGET_FIND &&
+			c < dataSet->componentsList.count &&
+			result->b.targetUserAgent == NULL;
+			c++) {
+			for (p = 0;
+				p < FIFTYONE_DEGREES_ORDER_OF_PRECEDENCE_SIZE &&
+				result->b.targetUserAgent == NULL;
+				p++) {
+				EvidenceIterateForHeaders(
+					state->evidence,
+					prefixOrderOfPrecedence[p],
+					dataSet->componentHeaders[c],
+					results->b.bufferPseudo,
+					results->b.bufferPseudoLength,
+					result,
+					setTargetFromEvidence);
+			}
+		}
+		if (result->b.targetUserAgent == NULL) {
+			result->b.targetUserAgentLength = 0;
+		}
+		current += size;
+	}
+	results->count = count;
+	return false;
+}
+
+// Adds the results for the key to the result cache if there is one.
+static void resultsHashFromEvidence_addToCache(
+	detectionComponentState* state,
+	const cacheKey* key) {
+	DataSetHash* dataSet = state->dataSet;
+	ResultsHash* results = state->results;
+	const uint32_t size = getCachedResultSize(dataSet);
+	byte* current;
+	cachedResult* cached;
+	ResultHash* result;
+	uint32_t i;
+
+	if (dataSet->resultCache == NULL || results->resultCacheData == NULL) {
+		return;
+	}
+	memcpy(results->resultCacheData, &results->count, sizeof(uint32_t));
+	current = results->resultCacheData + sizeof(uint32_t);
+	for (i = 0; i < results->count; i++) {
+		cached = (cachedResult*)current;
+		result = &results->items[i];
+		cached->uniqueHttpHeaderIndex = result->b.uniqueHttpHeaderIndex;
+		cached->targetUserAgentLength =
+			(uint32_t)result->b.targetUserAgentLength;
+		cached->matchedUserAgentLength =
+			(uint32_t)result->b.matchedUserAgentLength;
+		cached->method = (int32_t)result->method;
+		cached->iterations = result->iterations;
+		cached->difference = result->difference;
+		cached->drift = result->drift;
+		cached->matchedNodes = result->matchedNodes;
+		cached->targetIndex = getCachedTargetIndex(key, result);
+		memcpy(
+			cached + 1,
+			result->profileOffsets,
+			sizeof(uint32_t) * dataSet->componentsList.count);
+		if (result->b.matchedUserAgent != NULL) {
+			memcpy(
+				(byte*)(cached + 1) +
+				(sizeof(uint32_t) * dataSet->componentsList.count),
+				result->b.matchedUserAgent,
+				dataSet->config.b.maxMatchedUserAgentLength + 1);
+		}
+		current += size;
+	}
+	ResultCachePut(
+		dataSet->resultCache,
+		&key->fingerprint,
+		results->resultCacheData);
+}
+
+// Performs the steps that follow the graph evaluation for the evidence in the
+// state.
+static void resultsHashFromEvidence_complete(
+	detectionComponentState* state,
+	Exception* const exception) {
+	DataSetHash* dataSet = state->dataSet;
+	ResultsHash* results = state->results;
+
+	do {
+
 		// Check for and process any profile Id overrides. If the caller can
 		// expect defaults to be returned for missing components then also set
 		// these.
 		if (dataSet->config.b.processSpecialEvidence) {
-			OverrideProfileIds(evidence, &state, overrideProfileId);
+			OverrideProfileIds(state->evidence, state, overrideProfileId);
 			if (EXCEPTION_FAILED) { break; };
 			resultsHashFromEvidence_SetMissingComponentDefaultProfiles(
 				dataSet,
 				results);
 		}
 
-		// Check to see if all the UACH evidence is present and if so then 
-		// override the JavascriptGetHighEntropyValues value to an empty value
-		// to ensure unneeded JavaScript isn't returned.
-		if (dataSet->config.b.processSpecialEvidence &&
-			results->b.overrides->capacity > 0 &&
-			GhevDeviceDetectionAllPresent(
-				&dataSet->b,
-				evidence,
-				exception) &&
-			EXCEPTION_OKAY) {
-			GhevDeviceDetectionOverride(&dataSet->b, &results->b, exception);
+		// Check to see if all the UACH evidence is present and if so then 
+		// override the JavascriptGetHighEntropyValues value to an empty value
+		// to ensure unneeded JavaScript isn't returned.
+		if (dataSet->config.b.processSpecialEvidence &&
+			results->b.overrides->capacity > 0 &&
+			GhevDeviceDetectionAllPresent(
+				&dataSet->b,
+				state->evidence,
+				exception) &&
+			EXCEPTION_OKAY) {
+			GhevDeviceDetectionOverride(&dataSet->b, &results->b, exception);
+		}
+
+	} while (false); // once
+}
+
+void fiftyoneDegreesResultsHashFromEvidence(
+	fiftyoneDegreesResultsHash *results,
+	fiftyoneDegreesEvidenceKeyValuePairArray *evidence,
+	fiftyoneDegreesException *exception) {
+	DataSetHash* dataSet = (DataSetHash*)results->b.b.dataSet;
+	cacheKey key;
+
+	// Check for null evidence and set an exception if not present.
+	if (evidence == (EvidenceKeyValuePairArray*)NULL) {
+		EXCEPTION_SET(NULL_POINTER);
+		return;
+	}
+
+	// Initialise the state.
+	detectionComponentState state = {
+		dataSet,
+		results,
+		NULL,
+		evidence,
+		0,
+		0,
+		0,
+		exception,
+		0 };
+
+	do {
+
+		// Prepare the evidence and results, and determine if the graphs need
+		// to be evaluated.
+		const bool detect = resultsHashFromEvidence_prepare(&state, exception);
+		if (EXCEPTION_FAILED) { break; };
+
+		if (detect &&
+			resultsHashFromEvidence_getFromCache(&state, &key)) {
+
+			// Evaluate all the available evidence for the components that
+			// relate to available properties.
+			resultsHashFromEvidence_handleAllEvidence(&state);
+
+			// Add the results to the cache for the next time the evidence is
+			// seen.
+			if (EXCEPTION_OKAY) {
+				resultsHashFromEvidence_addToCache(&state, &key);
+			}
+		}
+
+		// Apply any overrides and default profiles.
+		resultsHashFromEvidence_complete(&state, exception);
+
+	} while (false); // once
+}
+
+void fiftyoneDegreesResultsHashFromEvidenceBatch(
+	fiftyoneDegreesResultsHash **results,
+	fiftyoneDegreesEvidenceKeyValuePairArray **evidence,
+	uint32_t count,
+	fiftyoneDegreesException *exception) {
+	uint32_t i, c, start, end;
+	DataSetHash* dataSet;
+	detectionComponentState states[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	cacheKey keys[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+	bool detect[FIFTYONE_DEGREES_HASH_BATCH_SIZE];
+
+	// Check for null arrays and set an exception if not present.
+	if (results == NULL || (evidence == NULL && count > 0)) {
+		EXCEPTION_SET(NULL_POINTER);
+		return;
+	}
+	if (count == 0) {
+		return;
+	}
+
+	// Validate every entry before any are prepared so that a failure never
+	// leaves some of the results prepared but not completed.
+	for (i = 0; i < count; i++) {
+		if (results[i] == NULL ||
+			evidence[i] == (EvidenceKeyValuePairArray*)NULL) {
+			EXCEPTION_SET(NULL_POINTER);
+			return;
+		}
+	}
+
+	// All the results in the batch are expected to share the data set of the
+	// first result. Those that do not, perhaps because the data set was
+	// reloaded while the results were being created, are processed singly.
+	dataSet = (DataSetHash*)results[0]->b.b.dataSet;
+
+	// Process the inputs in blocks so that the state needed for the block
+	// remains on the stack.
+	for (start = 0; start < count && EXCEPTION_OKAY; start = end) {
+		end = MIN(count, start + FIFTYONE_DEGREES_HASH_BATCH_SIZE);
+
+		// Prepare every input in the block and record those that require
+		// the graphs to be evaluated because the results are not cached.
+		for (i = start; i < end; i++) {
+			detect[i - start] = false;
+			if ((DataSetHash*)results[i]->b.b.dataSet != dataSet) {
+				ResultsHashFromEvidence(results[i], evidence[i], exception);
+			}
+			else {
+				detectionComponentState state = {
+					dataSet,
+					results[i],
+					NULL,
+					evidence[i],
+					0,
+					0,
+					0,
+					exception,
+					0 };
+				memcpy(&states[i - start], &state, sizeof(state));
+				detect[i - start] = resultsHashFromEvidence_prepare(
+					&states[i - start],
+					exception) &&
+					EXCEPTION_OKAY &&
+					resultsHashFromEvidence_getFromCache(
+						&states[i - start],
+						&keys[i - start]);
+			}
+			if (EXCEPTION_FAILED) return;
+		}
+
+		// Evaluate the graphs for one component across all the inputs in the
+		// block before moving to the next component. The root nodes and the
+		// nodes nearest to them are shared by many inputs and remain in the
+		// cache between inputs. The graph walks for the inputs are interleaved
+		// so that fetching the next node for one input overlaps with the
+		// evaluation of the others. Route tracing records the nodes evaluated
+		// and so is only supported when the inputs are processed singly.
+		for (c = 0; c < dataSet->componentsList.count; c++) {
+			if (dataSet->componentsAvailable[c] == true) {
+				if (dataSet->config.traceRoute == false) {
+					resultsHashFromEvidence_handleComponentEvidenceBlock(
+						dataSet,
+						(byte)c,
+						states,
+						detect,
+						end - start,
+						exception);
+					if (EXCEPTION_FAILED) return;
+				}
+				else {
+					for (i = start; i < end; i++) {
+						if (detect[i - start]) {
+							states[i - start].componentIndex = (byte)c;
+							states[i - start].lastResult = NULL;
+							resultsHashFromEvidence_handleComponentEvidence(
+								&states[i - start]);
+							if (EXCEPTION_FAILED) return;
+						}
+					}
+				}
+			}
 		}
 
-	} while (false); // once
+		// Complete every input in the block.
+		for (i = start; i < end; i++) {
+			if (detect[i - start] && results[i]->count == 0) {
+				states[i - start].headerUniqueId = 0;
+			}
+			if (detect[i - start]) {
+				resultsHashFromEvidence_addToCache(
+					&states[i - start],
+					&keys[i - start]);
+			}
+			if ((DataSetHash*)results[i]->b.b.dataSet == dataSet) {
+				resultsHashFromEvidence_complete(&states[i - start], exception);
+				if (EXCEPTION_FAILED) return;
+			}
+		}
+	}
 }
 
 void fiftyoneDegreesResultsHashFromUserAgent(
@@ -3107,14 +6425,31 @@ void fiftyoneDegreesResultsHashFromUserAgent(
 	assert(evidence.next == NULL);
 }
 
+// Parses the decimal digits at the start of the characters provided as a
+// profile id, stopping at the first character which is not a digit. Returns
+// zero, which is never a profile id, if there are no digits or the number is
+// too large to be a profile id.
+static uint32_t parseProfileId(const char *value, size_t length) {
+	uint64_t profileId = 0;
+	size_t i;
+	for (i = 0; i < length && value[i] >= '0' && value[i] <= '9'; i++) {
+		profileId = (profileId * 10) + (uint64_t)(value[i] - '0');
+		if (profileId > UINT32_MAX) {
+			return 0;
+		}
+	}
+	return (uint32_t)profileId;
+}
+
 // Adds the profile associated with the string version of the profile id 
 // provided to the results. Returns true if the profile could be found, 
 // otherwise false.
 static bool setProfileFromProfileId(
 	ResultsHash *results,
-	char *value,
+	const char *value,
+	size_t length,
 	Exception *exception) {
-	const uint32_t profileId = (const uint32_t)atoi(value);
+	const uint32_t profileId = parseProfileId(value, length);
 	return addProfileById(results, profileId, true, exception);
 }
 
@@ -3124,12 +6459,16 @@ int fiftyoneDegreesResultsHashFromDeviceId(
 	size_t deviceIdLength,
 	fiftyoneDegreesException *exception) {
 	int count = 0;
-	char *current = (char*)deviceId, *previous = (char*)deviceId;
+	const char *current = deviceId, *previous = deviceId;
 	while (*current != '\0' &&
 		(size_t)(current - deviceId) < deviceIdLength &&
 		EXCEPTION_OKAY) {
 		if (*current == '-') {
-			if (setProfileFromProfileId(results, previous, exception) &&
+			if (setProfileFromProfileId(
+					results,
+					previous,
+					(size_t)(current - previous),
+					exception) &&
 				EXCEPTION_OKAY) {
 				count++;
 			}
@@ -3138,13 +6477,33 @@ int fiftyoneDegreesResultsHashFromDeviceId(
 		current++;
 	}
 	if (EXCEPTION_OKAY &&
-		setProfileFromProfileId(results, previous, exception) &&
+		setProfileFromProfileId(
+			results,
+			previous,
+			(size_t)(current - previous),
+			exception) &&
 		EXCEPTION_OKAY) {
 		count++;
 	}
 	return count;
 }
 
+int fiftyoneDegreesResultsHashFromDeviceIdBinary(
+	fiftyoneDegreesResultsHash *results,
+	const uint32_t *profileIds,
+	uint32_t count,
+	fiftyoneDegreesException *exception) {
+	int found = 0;
+	uint32_t i;
+	for (i = 0; i < count && EXCEPTION_OKAY; i++) {
+		if (addProfileById(results, profileIds[i], true, exception) &&
+			EXCEPTION_OKAY) {
+			found++;
+		}
+	}
+	return found;
+}
+
 static void resultsHashRelease(ResultsHash *results) {
 	if (results->propertyItem.data.ptr != NULL &&
 		results->propertyItem.collection != NULL) {
@@ -3158,6 +6517,7 @@ static void resultsHashRelease(ResultsHash *results) {
 void fiftyoneDegreesResultsHashFree(
 	fiftyoneDegreesResultsHash* results) {
 	uint32_t i;
+	DataSetHash* dataSet;
 	resultsHashRelease(results);
 	ListFree(&results->values);
 	for (i = 0; i < results->capacity; i++) {
@@ -3168,6 +6528,21 @@ void fiftyoneDegreesResultsHashFree(
 			GraphTraceFree(results->items[i].trace);
 		}
 	}
+	if (results->resultCacheData != NULL) {
+		Free(results->resultCacheData);
+	}
+	if (results->propertyValues != NULL) {
+		Free(results->propertyValues);
+	}
+	if (results->prefixHashes != NULL) {
+		dataSet = (DataSetHash*)results->b.b.dataSet;
+		for (i = 0; i < dataSet->b.b.uniqueHeaders->count; i++) {
+			if (results->prefixHashes[i].hashes != NULL) {
+				Free(results->prefixHashes[i].hashes);
+			}
+		}
+		Free(results->prefixHashes);
+	}
 	ResultsDeviceDetectionFree(&results->b);
 	DataSetRelease((DataSetBase*)results->b.b.dataSet);
 	Free(results);
@@ -3229,6 +6604,30 @@ fiftyoneDegreesResultsHash* fiftyoneDegreesResultsHashCreate(
 		ListInit(&results->values, 1);
 		DataReset(&results->propertyItem.data);
 
+		// Allocate the memory used to copy results to and from the result
+		// cache if there is one.
+		results->resultCacheData = dataSet->resultCache != NULL ?
+			(byte*)Malloc(getResultCacheDataSize(dataSet)) :
+			NULL;
+
+		// Allocate the position and number of the values of each required
+		// property used when writing JSON.
+		results->propertyValues = (HashPropertyValues*)Malloc(
+			sizeof(HashPropertyValues) * dataSet->b.b.available->count);
+
+		// Allocate the prefix hash codes for each unique header. The memory
+		// for the hash codes themselves is allocated when first needed. If
+		// there is insufficient memory the hash codes are calculated from
+		// the characters of the evidence.
+		results->prefixHashes = (HashPrefixHashes*)Malloc(
+			sizeof(HashPrefixHashes) * dataSet->b.b.uniqueHeaders->count);
+		if (results->prefixHashes != NULL) {
+			memset(
+				results->prefixHashes,
+				0,
+				sizeof(HashPrefixHashes) * dataSet->b.b.uniqueHeaders->count);
+		}
+
 		// Set the default profile offsets and override flags. Set the count to
 		// capacity to ensure all the result instances are reset.
 		results->count = results->capacity;
@@ -3564,302 +6963,1042 @@ ResultHash* getResultForPropertyIndex(
 	// Ensure any previous uses of the results to get values are released.
 	resultsHashRelease(results);
 
-	dataSet = (DataSetHash*)results->b.b.dataSet;
+	dataSet = (DataSetHash*)results->b.b.dataSet;
+
+	// Set the property that will be available in the results structure. 
+	// This may also be needed to work out which of a selection of results 
+	// are used to obtain the values.
+	property = PropertyGet(
+		dataSet->properties,
+		propertyIndex,
+		&results->propertyItem,
+		exception);
+
+	if (property != NULL && EXCEPTION_OKAY) {
+
+		if (results->count == 1) {
+
+			// Use the only result available to return the property value.
+			result = results->items;
+		}
+		else if (results->count > 1) {
+
+			// Multiple headers could contain the best result for the 
+			// property. Find the best one available before retrieving the 
+			// property value.
+			result = getResultFromResultsForComponentIndex(
+				dataSet,
+				results,
+				property->componentIndex);
+		}
+	}
+	return result;
+}
+
+
+ResultHash* getResultForRequiredPropertyIndex(
+	ResultsHash* results,
+	int requiredPropertyIndex,
+	Exception *exception) {
+	DataSetHash *dataSet;
+	ResultHash *result = NULL;
+
+	dataSet = (DataSetHash*)results->b.b.dataSet;
+
+	// Work out the property index from the required property index.
+	uint32_t propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
+		dataSet->b.b.available,
+		requiredPropertyIndex);
+
+	if (requiredPropertyIndex >= 0 &&
+		requiredPropertyIndex < (int)dataSet->b.b.available->count) {
+		result = getResultForPropertyIndex(results, propertyIndex, exception);
+	}
+	return result;
+}
+
+bool fiftyoneDegreesResultsHashGetHasValues(
+	fiftyoneDegreesResultsHash* results,
+	int requiredPropertyIndex,
+	fiftyoneDegreesException *exception) {
+	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
+	// Ensure any previous uses of the results to get values are released.
+	resultsHashRelease(results);
+
+	if (requiredPropertyIndex < 0 ||
+		requiredPropertyIndex >= (int)dataSet->b.b.available->count) {
+		// The property index is not valid.
+		return false;
+	}
+	if (OverrideHasValueForRequiredPropertyIndex(
+		results->b.overrides,
+		requiredPropertyIndex)) {
+		// There is an override value for the property.
+		return true;
+	}
+
+	// Work out the property index from the required property index.
+	uint32_t propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
+		dataSet->b.b.available,
+		requiredPropertyIndex);
+
+	// Set the property that will be available in the results structure. 
+	// This may also be needed to work out which of a selection of results 
+	// are used to obtain the values.
+	Property *property = PropertyGet(
+		dataSet->properties,
+		propertyIndex,
+		&results->propertyItem,
+		exception);
+
+	ResultHash *result = getResultFromResultsForComponentIndex(
+		dataSet,
+		results,
+		property->componentIndex);
+
+	if (result == NULL) {
+		// There is no result which contains values for the property.
+		return false;
+	}
+
+	if (result->profileOffsets[property->componentIndex] == NULL_PROFILE_OFFSET) {
+		// There is a null profile.
+		return false;
+	}
+
+	if (result->profileIsOverriden[property->componentIndex] == false) {
+		if (ISUNMATCHED(dataSet, result)) {
+			// The evidence could not be matched.
+			return false;
+		}
+	}
+
+	// None of the checks have returned false, so there must be valid values.
+	return true;
+}
+
+fiftyoneDegreesResultsNoValueReason fiftyoneDegreesResultsHashGetNoValueReason(
+	fiftyoneDegreesResultsHash *results,
+	int requiredPropertyIndex,
+	fiftyoneDegreesException *exception) {
+	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
+	// Ensure any previous uses of the results to get values are released.
+	resultsHashRelease(results);
+
+	if (requiredPropertyIndex < 0 ||
+		requiredPropertyIndex >= (int)dataSet->b.b.available->count) {
+		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_INVALID_PROPERTY;
+	}
+
+	if (results->count == 0) {
+		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_RESULTS;
+	}
+
+	ResultHash *result = getResultForRequiredPropertyIndex(
+		results,
+		requiredPropertyIndex,
+		exception);
+
+	// Work out the property index from the required property index.
+	uint32_t propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
+		dataSet->b.b.available,
+		requiredPropertyIndex);
+
+	// Set the property that will be available in the results structure. 
+	// This may also be needed to work out which of a selection of results 
+	// are used to obtain the values.
+	Property *property = PropertyGet(
+		dataSet->properties,
+		propertyIndex,
+		&results->propertyItem,
+		exception);
+
+	if (result == NULL) {
+		// In the unified result shape (issue #362) value selection returns no
+		// result for the property's component when none of the result items
+		// carries a matched profile for it and unmatched results are disabled
+		// (allowUnmatched == false). A result item still exists for the
+		// component (count > 0 is guaranteed by the NO_RESULTS check above) - it
+		// simply has a null profile - so report NULL_PROFILE, whose message
+		// points the caller at lenient matching, rather than the generic
+		// NO_RESULT_FOR_PROPERTY. Before #362 removed the single User-Agent fast
+		// path, this same case produced one coalesced result and correctly
+		// reported NULL_PROFILE.
+		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NULL_PROFILE;
+	}
+	else if (result->profileOffsets[property->componentIndex] == NULL_PROFILE_OFFSET) {
+		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NULL_PROFILE;
+	}
+	else if (ISUNMATCHED(dataSet, result)) {
+		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_MATCHED_NODES;
+	}
+	return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_UNKNOWN;
+}
+
+const char* fiftyoneDegreesResultsHashGetNoValueReasonMessage(
+	fiftyoneDegreesResultsNoValueReason reason) {
+	switch (reason) {
+	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_INVALID_PROPERTY:
+		return "The property index provided is invalid, either the property "
+			"does not exist, or the data set has been initialized without it.";
+	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_RESULTS:
+		return "The evidence required to determine this property was not "
+		    "supplied. The most common evidence passed to this engine is "
+		    "'header.user-agent'.";
+	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_RESULT_FOR_PROPERTY:
+		return "None of the results contain a value for the requested property.";
+	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_DIFFERENCE:
+		return "There were no values because the difference limit was "
+			"exceeded so the results are invalid.";
+	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_MATCHED_NODES:
+		return "There were no values because no hash nodes were matched in "
+			"the evidence.";
+	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NULL_PROFILE:
+	    return "No matching profiles could be found for the supplied evidence. "
+	        "A 'best guess' can be returned by configuring more lenient "
+	        "matching rules. See https://51degrees.com/documentation/_device_detection__features__false_positive_control.html?utm_source=code&utm_medium=comment&utm_campaign=device-detection-cxx&utm_content=hash.c&utm_term=fiftyone_degrees_results_no_value_reason_null_profile";
+	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_UNKNOWN:
+	default:
+		return "The reason for missing values is unknown.";
+	}
+}
+
+fiftyoneDegreesCollectionItem* fiftyoneDegreesResultsHashGetValues(
+	fiftyoneDegreesResultsHash* results,
+	int requiredPropertyIndex,
+	fiftyoneDegreesException *exception) {
+	ResultHash *result;
+	Property *property;
+	DataSetHash *dataSet;
+	Item *firstValue = NULL;
+	
+	// Ensure any previous uses of the results to get values are released.
+	resultsHashRelease(results);
+
+	// Check the overrides first.
+	firstValue = getValuesFromOverrides(results, requiredPropertyIndex);
 
-	// Set the property that will be available in the results structure. 
-	// This may also be needed to work out which of a selection of results 
-	// are used to obtain the values.
-	property = PropertyGet(
-		dataSet->properties,
-		propertyIndex,
-		&results->propertyItem,
-		exception);
+	if (firstValue == NULL) {
 
-	if (property != NULL && EXCEPTION_OKAY) {
+		dataSet = (DataSetHash*)results->b.b.dataSet;
 
-		if (results->count == 1) {
+		// Work out the property index from the required property index.
+		uint32_t propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
+			dataSet->b.b.available,
+			requiredPropertyIndex);
 
-			// Use the only result available to return the property value.
-			result = results->items;
+		if (((int32_t)propertyIndex) < 0) {
+			EXCEPTION_SET(COLLECTION_INDEX_OUT_OF_RANGE);
 		}
-		else if (results->count > 1) {
 
-			// Multiple headers could contain the best result for the 
-			// property. Find the best one available before retrieving the 
-			// property value.
-			result = getResultFromResultsForComponentIndex(
-				dataSet,
-				results,
-				property->componentIndex);
+		if (EXCEPTION_OKAY) {
+			// Set the property that will be available in the results structure. 
+			// This may also be needed to work out which of a selection of 
+			// results are used to obtain the values.
+			property = PropertyGet(
+				dataSet->properties,
+				propertyIndex,
+				&results->propertyItem,
+				exception);
+
+			if (property != NULL && EXCEPTION_OKAY) {
+				result = getResultFromResultsForComponentIndex(
+					dataSet,
+					results,
+					property->componentIndex);
+
+				if (result != NULL) {
+
+					// Ensure there is a collection available to the property 
+					// item so that it can be freed when the results are freed.
+					if (results->propertyItem.collection == NULL) {
+						results->propertyItem.collection = dataSet->properties;
+					}
+
+					if (result != NULL && EXCEPTION_OKAY) {
+						firstValue = getValuesFromResult(
+							results,
+							result,
+							property,
+							requiredPropertyIndex,
+							exception);
+					}
+				}
+			}
+		}
+
+		if (firstValue == NULL) {
+
+			// There are no values for the property requested. Reset the values 
+			// list to zero count.
+			ListRelease(&results->values);
 		}
 	}
-	return result;
+	return firstValue;
 }
 
-
-ResultHash* getResultForRequiredPropertyIndex(
-	ResultsHash* results,
+bool fiftyoneDegreesResultsHashGetValuesFromTable(
+	fiftyoneDegreesResultsHash *results,
 	int requiredPropertyIndex,
-	Exception *exception) {
-	DataSetHash *dataSet;
-	ResultHash *result = NULL;
+	const char * const **values,
+	uint32_t *count) {
+	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
+	const HashValueTable *table = dataSet->valueTable;
+	const HashValueCell *cell;
+	ResultHash *result;
+	uint32_t i, row, profileOffset;
+	byte componentIndex;
+
+	*values = NULL;
+	*count = 0;
+	if (table == NULL ||
+		requiredPropertyIndex < 0 ||
+		(uint32_t)requiredPropertyIndex >= table->propertiesCount) {
+		return false;
+	}
 
-	dataSet = (DataSetHash*)results->b.b.dataSet;
+	// Overridden values are only available from the overrides.
+	if (results->b.overrides != NULL) {
+		for (i = 0; i < results->b.overrides->count; i++) {
+			if ((int)results->b.overrides->items[i].requiredPropertyIndex ==
+				requiredPropertyIndex) {
+				return false;
+			}
+		}
+	}
 
-	// Work out the property index from the required property index.
-	uint32_t propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
-		dataSet->b.b.available,
-		requiredPropertyIndex);
+	// Find the cell for the profile of the result in the same way as
+	// fiftyoneDegreesResultsHashGetValues finds the result.
+	componentIndex = table->propertyComponents[requiredPropertyIndex];
+	result = getResultFromResultsForComponentIndex(
+		dataSet,
+		results,
+		componentIndex);
+	if (result != NULL) {
+		profileOffset = result->profileOffsets[componentIndex];
+		if (profileOffset != NULL_PROFILE_OFFSET &&
+			getValueTableRow(table, profileOffset, &row)) {
+			cell = &table->cells[
+				table->propertyCells[requiredPropertyIndex] + row];
+			if (cell->count > 0) {
+				*values = &table->values[cell->first];
+				*count = cell->count;
+			}
+		}
+	}
+	return true;
+}
 
-	if (requiredPropertyIndex >= 0 &&
-		requiredPropertyIndex < (int)dataSet->b.b.available->count) {
-		result = getResultForPropertyIndex(results, propertyIndex, exception);
+/**
+ * Walks the profiles collection calling the method with the offset and value
+ * indexes of each profile. Returns false if a profile could not be read.
+ */
+static bool iterateProfileValues(
+	DataSetHash *dataSet,
+	HashProfileValueIndex *index,
+	void (*method)(HashProfileValueIndex*, uint32_t, const Profile*),
+	Exception *exception) {
+	Item item;
+	Profile *profile;
+	uint32_t i, profileOffset = 0;
+	DataReset(&item.data);
+	for (i = 0; i < dataSet->header.profiles.count; i++) {
+		const CollectionKey profileKey = {
+			{profileOffset},
+			CollectionKeyType_Profile,
+		};
+		profile = (Profile*)dataSet->profiles->get(
+			dataSet->profiles,
+			&profileKey,
+			&item,
+			exception);
+		if (profile == NULL || EXCEPTION_FAILED) {
+			return false;
+		}
+		method(index, profileOffset, profile);
+		profileOffset += (uint32_t)(sizeof(Profile) +
+			(sizeof(uint32_t) * profile->valueCount));
+		COLLECTION_RELEASE(dataSet->profiles, &item);
 	}
-	return result;
+	return true;
 }
 
-bool fiftyoneDegreesResultsHashGetHasValues(
-	fiftyoneDegreesResultsHash* results,
-	int requiredPropertyIndex,
-	fiftyoneDegreesException *exception) {
-	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
-	// Ensure any previous uses of the results to get values are released.
-	resultsHashRelease(results);
+/**
+ * Counts the profile against each of its values. The count for a value index
+ * is held in the entry after it.
+ */
+static void countProfileValues(
+	HashProfileValueIndex *index,
+	uint32_t profileOffset,
+	const Profile *profile) {
+	uint32_t i;
+	const uint32_t *valueIndexes = (const uint32_t*)(profile + 1);
+	(void)profileOffset;
+	for (i = 0; i < profile->valueCount; i++) {
+		if (valueIndexes[i] < index->valuesCount) {
+			index->firstOffsets[valueIndexes[i] + 1]++;
+		}
+	}
+}
 
-	if (requiredPropertyIndex < 0 ||
-		requiredPropertyIndex >= (int)dataSet->b.b.available->count) {
-		// The property index is not valid.
-		return false;
+/**
+ * Adds the profile offset to the profiles of each of its values. The entry
+ * after each value index holds the position of the next profile for the value.
+ */
+static void addProfileValues(
+	HashProfileValueIndex *index,
+	uint32_t profileOffset,
+	const Profile *profile) {
+	uint32_t i;
+	const uint32_t *valueIndexes = (const uint32_t*)(profile + 1);
+	for (i = 0; i < profile->valueCount; i++) {
+		if (valueIndexes[i] < index->valuesCount) {
+			index->offsets[index->firstOffsets[valueIndexes[i] + 1]++] =
+				profileOffset;
+		}
 	}
-	if (OverrideHasValueForRequiredPropertyIndex(
-		results->b.overrides,
-		requiredPropertyIndex)) {
-		// There is an override value for the property.
-		return true;
+}
+
+/**
+ * Builds the index from each value to the profiles which have it. The
+ * profiles are walked twice, first to count the profiles for each value, and
+ * then to add the profile offsets, which are added in ascending order as the
+ * profiles are walked in the order of their offsets.
+ */
+static HashProfileValueIndex* createProfileValueIndex(
+	DataSetHash *dataSet,
+	Exception *exception) {
+	uint32_t i, count, total = 0;
+	HashProfileValueIndex *index = (HashProfileValueIndex*)Malloc(
+		sizeof(HashProfileValueIndex));
+	if (index == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		return NULL;
+	}
+	index->valuesCount = dataSet->header.values.count;
+	index->offsets = NULL;
+	index->firstOffsets = (uint32_t*)Malloc(
+		sizeof(uint32_t) * (index->valuesCount + 1));
+	if (index->firstOffsets == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		freeProfileValueIndex(index);
+		return NULL;
+	}
+	memset(
+		index->firstOffsets,
+		0,
+		sizeof(uint32_t) * (index->valuesCount + 1));
+	if (iterateProfileValues(
+		dataSet,
+		index,
+		countProfileValues,
+		exception) == false) {
+		freeProfileValueIndex(index);
+		return NULL;
+	}
+
+	// Turn the counts into the position of the first profile for each value,
+	// held in the entry after the value until the offsets have been added.
+	for (i = 0; i < index->valuesCount; i++) {
+		count = index->firstOffsets[i + 1];
+		index->firstOffsets[i + 1] = total;
+		total += count;
+	}
+	index->offsets = (uint32_t*)Malloc(sizeof(uint32_t) * (total + 1));
+	if (index->offsets == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		freeProfileValueIndex(index);
+		return NULL;
+	}
+	if (iterateProfileValues(
+		dataSet,
+		index,
+		addProfileValues,
+		exception) == false) {
+		freeProfileValueIndex(index);
+		return NULL;
 	}
+	return index;
+}
 
-	// Work out the property index from the required property index.
-	uint32_t propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
-		dataSet->b.b.available,
-		requiredPropertyIndex);
+/**
+ * Gets the profile value index for the data set, building it if this is the
+ * first time it has been needed. If two threads build the index at the same
+ * time then the one which is set first is used and the other freed. Returns
+ * NULL if the profileValueIndex option is not enabled or the index could not
+ * be built.
+ */
+static HashProfileValueIndex* getProfileValueIndex(
+	DataSetHash *dataSet,
+	Exception *exception) {
+	HashProfileValueIndex *index, *existing;
+	if (dataSet->config.profileValueIndex == false) {
+		return NULL;
+	}
+	index = dataSet->profileValueIndex;
+	if (index == NULL) {
+		index = createProfileValueIndex(dataSet, exception);
+		if (index != NULL) {
+			existing = (HashProfileValueIndex*)INTERLOCK_EXCHANGE_PTR(
+				dataSet->profileValueIndex,
+				index,
+				NULL);
+			if (existing != NULL && existing != index) {
+				freeProfileValueIndex(index);
+				index = existing;
+			}
+		}
+	}
+	return index;
+}
 
-	// Set the property that will be available in the results structure. 
-	// This may also be needed to work out which of a selection of results 
-	// are used to obtain the values.
-	Property *property = PropertyGet(
+/**
+ * Gets the index of the value with the name for the property with the name,
+ * and the index of the component the property belongs to. Returns false if
+ * there is no such property or value.
+ */
+static bool getValueIndexForPropertyAndValue(
+	DataSetHash *dataSet,
+	const char *propertyName,
+	const char *valueName,
+	uint32_t *valueIndex,
+	byte *componentIndex,
+	Exception *exception) {
+	uint32_t i;
+	bool found = false;
+	Property *property;
+	Value *value;
+	String *name;
+	Item propertyItem, valueItem, nameItem;
+	int propertyIndex = findPropertyIndexByName(
+		dataSet->properties,
+		dataSet->strings,
+		(char*)propertyName,
+		exception);
+	if (propertyIndex < 0 || EXCEPTION_FAILED) {
+		return false;
+	}
+	DataReset(&propertyItem.data);
+	DataReset(&valueItem.data);
+	DataReset(&nameItem.data);
+	property = (Property*)PropertyGet(
 		dataSet->properties,
 		propertyIndex,
-		&results->propertyItem,
+		&propertyItem,
 		exception);
+	if (property == NULL || EXCEPTION_FAILED) {
+		return false;
+	}
+	*componentIndex = property->componentIndex;
+	for (i = property->firstValueIndex;
+		i <= property->lastValueIndex && found == false && EXCEPTION_OKAY;
+		i++) {
+		value = (Value*)ValueGet(dataSet->values, i, &valueItem, exception);
+		if (value != NULL && EXCEPTION_OKAY) {
+			name = (String*)StringGet(
+				dataSet->strings,
+				value->nameOffset,
+				&nameItem,
+				exception);
+			if (name != NULL && EXCEPTION_OKAY) {
+				if (StringCompare(valueName, &name->value) == 0) {
+					*valueIndex = i;
+					found = true;
+				}
+				COLLECTION_RELEASE(dataSet->strings, &nameItem);
+			}
+			COLLECTION_RELEASE(dataSet->values, &valueItem);
+		}
+	}
+	COLLECTION_RELEASE(dataSet->properties, &propertyItem);
+	return found;
+}
 
-	ResultHash *result = getResultFromResultsForComponentIndex(
-		dataSet,
-		results,
-		property->componentIndex);
+/**
+ * Returns true if the items, which are in ascending order, contain the value.
+ */
+static bool containsValue(
+	const uint32_t *items,
+	uint32_t count,
+	uint32_t value) {
+	uint32_t middle, lower = 0, upper = count;
+	while (lower < upper) {
+		middle = lower + (upper - lower) / 2;
+		if (items[middle] < value) {
+			lower = middle + 1;
+		}
+		else {
+			upper = middle;
+		}
+	}
+	return lower < count && items[lower] == value;
+}
 
-	if (result == NULL) {
-		// There is no result which contains values for the property.
+/**
+ * Returns true if the profile has all of the value indexes. The value indexes
+ * of a profile are held in ascending order.
+ */
+static bool profileHasValues(
+	const Profile *profile,
+	const uint32_t *valueIndexes,
+	uint32_t count) {
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		if (containsValue(
+			(const uint32_t*)(profile + 1),
+			profile->valueCount,
+			valueIndexes[i]) == false) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Calls the callback with the profile at the offset. Returns the result of
+ * the callback, or false if the profile could not be read.
+ */
+static bool callbackProfile(
+	DataSetHash *dataSet,
+	uint32_t profileOffset,
+	void *state,
+	ProfileIterateMethod callback,
+	Exception *exception) {
+	bool result;
+	Item item;
+	const CollectionKey profileKey = {
+		{profileOffset},
+		CollectionKeyType_Profile,
+	};
+	DataReset(&item.data);
+	if (dataSet->profiles->get(
+		dataSet->profiles,
+		&profileKey,
+		&item,
+		exception) == NULL || EXCEPTION_FAILED) {
 		return false;
 	}
-
-	if (result->profileOffsets[property->componentIndex] == NULL_PROFILE_OFFSET) {
-		// There is a null profile.
-		return false;
+	result = callback(state, &item);
+	COLLECTION_RELEASE(dataSet->profiles, &item);
+	return result;
+}
+
+/**
+ * Calls the callback for each profile which has all of the value indexes,
+ * found by checking the profiles for the value with the fewest profiles
+ * against the profiles for each of the other values.
+ */
+static uint32_t iterateProfilesFromIndex(
+	DataSetHash *dataSet,
+	const HashProfileValueIndex *index,
+	const uint32_t *valueIndexes,
+	uint32_t count,
+	void *state,
+	ProfileIterateMethod callback,
+	Exception *exception) {
+	uint32_t i, v, first, fewest = 0, matched = 0;
+	bool match;
+	for (v = 1; v < count; v++) {
+		if (index->firstOffsets[valueIndexes[v] + 1] -
+			index->firstOffsets[valueIndexes[v]] <
+			index->firstOffsets[valueIndexes[fewest] + 1] -
+			index->firstOffsets[valueIndexes[fewest]]) {
+			fewest = v;
+		}
+	}
+	for (i = index->firstOffsets[valueIndexes[fewest]];
+		i < index->firstOffsets[valueIndexes[fewest] + 1];
+		i++) {
+		match = true;
+		for (v = 0; v < count && match; v++) {
+			if (v != fewest) {
+				first = index->firstOffsets[valueIndexes[v]];
+				match = containsValue(
+					index->offsets + first,
+					index->firstOffsets[valueIndexes[v] + 1] - first,
+					index->offsets[i]);
+			}
+		}
+		if (match) {
+			matched++;
+			if (callbackProfile(
+				dataSet,
+				index->offsets[i],
+				state,
+				callback,
+				exception) == false) {
+				break;
+			}
+		}
 	}
+	return matched;
+}
 
-	if (result->profileIsOverriden[property->componentIndex] == false) {
-		if (ISUNMATCHED(dataSet, result)) {
-			// The evidence could not be matched.
-			return false;
+/**
+ * Calls the callback for each profile which has all of the value indexes,
+ * found by checking every profile in the profiles collection.
+ */
+static uint32_t iterateProfilesFromCollection(
+	DataSetHash *dataSet,
+	const uint32_t *valueIndexes,
+	uint32_t count,
+	void *state,
+	ProfileIterateMethod callback,
+	Exception *exception) {
+	Item item;
+	Profile *profile;
+	uint32_t i, profileOffset = 0, matched = 0;
+	bool next = true;
+	DataReset(&item.data);
+	for (i = 0; i < dataSet->header.profiles.count && next; i++) {
+		const CollectionKey profileKey = {
+			{profileOffset},
+			CollectionKeyType_Profile,
+		};
+		profile = (Profile*)dataSet->profiles->get(
+			dataSet->profiles,
+			&profileKey,
+			&item,
+			exception);
+		if (profile == NULL || EXCEPTION_FAILED) {
+			break;
+		}
+		profileOffset += (uint32_t)(sizeof(Profile) +
+			(sizeof(uint32_t) * profile->valueCount));
+		if (profileHasValues(profile, valueIndexes, count)) {
+			matched++;
+			next = callback(state, &item);
 		}
+		COLLECTION_RELEASE(dataSet->profiles, &item);
 	}
-
-	// None of the checks have returned false, so there must be valid values.
-	return true;
+	return matched;
 }
 
-fiftyoneDegreesResultsNoValueReason fiftyoneDegreesResultsHashGetNoValueReason(
-	fiftyoneDegreesResultsHash *results,
-	int requiredPropertyIndex,
+uint32_t fiftyoneDegreesHashIterateProfilesForPropertyAndValue(
+	fiftyoneDegreesResourceManager *manager,
+	const char *propertyName,
+	const char *valueName,
+	void *state,
+	fiftyoneDegreesProfileIterateMethod callback,
 	fiftyoneDegreesException *exception) {
-	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
-	// Ensure any previous uses of the results to get values are released.
-	resultsHashRelease(results);
-
-	if (requiredPropertyIndex < 0 ||
-		requiredPropertyIndex >= (int)dataSet->b.b.available->count) {
-		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_INVALID_PROPERTY;
+	uint32_t valueIndex, count = 0;
+	byte componentIndex;
+	DataSetHash *dataSet = DataSetHashGet(manager);
+	const HashProfileValueIndex *index = getProfileValueIndex(
+		dataSet,
+		exception);
+	if (index != NULL) {
+		if (getValueIndexForPropertyAndValue(
+			dataSet,
+			propertyName,
+			valueName,
+			&valueIndex,
+			&componentIndex,
+			exception)) {
+			count = iterateProfilesFromIndex(
+				dataSet,
+				index,
+				&valueIndex,
+				1,
+				state,
+				callback,
+				exception);
+		}
 	}
-
-	if (results->count == 0) {
-		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_RESULTS;
+	else if (EXCEPTION_OKAY) {
+		count = ProfileIterateProfilesForPropertyAndValue(
+			dataSet->strings,
+			dataSet->properties,
+			dataSet->values,
+			dataSet->profiles,
+			dataSet->profileOffsets,
+			propertyName,
+			valueName,
+			state,
+			callback,
+			exception);
 	}
+	DataSetHashRelease(dataSet);
+	return count;
+}
 
-	ResultHash *result = getResultForRequiredPropertyIndex(
-		results,
-		requiredPropertyIndex,
+/**
+ * Calls the callback for each profile which has all of the value indexes,
+ * using the profile value index if there is one.
+ */
+static uint32_t iterateProfilesForValues(
+	DataSetHash *dataSet,
+	const HashProfileValueIndex *index,
+	const uint32_t *valueIndexes,
+	uint32_t count,
+	void *state,
+	ProfileIterateMethod callback,
+	Exception *exception) {
+	if (index != NULL) {
+		return iterateProfilesFromIndex(
+			dataSet,
+			index,
+			valueIndexes,
+			count,
+			state,
+			callback,
+			exception);
+	}
+	return iterateProfilesFromCollection(
+		dataSet,
+		valueIndexes,
+		count,
+		state,
+		callback,
 		exception);
+}
 
-	// Work out the property index from the required property index.
-	uint32_t propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
-		dataSet->b.b.available,
-		requiredPropertyIndex);
+/**
+ * Passes the profiles of each component to the callback, recording when the
+ * callback returns false so the profiles of later components are not
+ * iterated.
+ */
+typedef struct component_profiles_state_t {
+	void *state; /* State passed to the callback */
+	ProfileIterateMethod callback; /* Method called for each profile */
+	bool next; /* False once the callback has returned false */
+} componentProfilesState;
+
+static bool callbackComponentProfile(void *state, Item *item) {
+	componentProfilesState *componentState = (componentProfilesState*)state;
+	componentState->next = componentState->callback(
+		componentState->state,
+		item);
+	return componentState->next;
+}
 
-	// Set the property that will be available in the results structure. 
-	// This may also be needed to work out which of a selection of results 
-	// are used to obtain the values.
-	Property *property = PropertyGet(
-		dataSet->properties,
-		propertyIndex,
-		&results->propertyItem,
-		exception);
+/**
+ * Stops at the first profile found, so that the iteration only checks that
+ * there is a matching profile.
+ */
+static bool stopAtFirstProfile(void *state, Item *item) {
+	(void)state;
+	(void)item;
+	return false;
+}
 
-	if (result == NULL) {
-		// In the unified result shape (issue #362) value selection returns no
-		// result for the property's component when none of the result items
-		// carries a matched profile for it and unmatched results are disabled
-		// (allowUnmatched == false). A result item still exists for the
-		// component (count > 0 is guaranteed by the NO_RESULTS check above) - it
-		// simply has a null profile - so report NULL_PROFILE, whose message
-		// points the caller at lenient matching, rather than the generic
-		// NO_RESULT_FOR_PROPERTY. Before #362 removed the single User-Agent fast
-		// path, this same case produced one coalesced result and correctly
-		// reported NULL_PROFILE.
-		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NULL_PROFILE;
-	}
-	else if (result->profileOffsets[property->componentIndex] == NULL_PROFILE_OFFSET) {
-		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NULL_PROFILE;
-	}
-	else if (ISUNMATCHED(dataSet, result)) {
-		return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_MATCHED_NODES;
+/**
+ * Orders the value indexes by the component of their property, keeping the
+ * order of the values within each component, so that the values for each
+ * component are next to each other.
+ */
+static void sortValueIndexesByComponent(
+	uint32_t *valueIndexes,
+	byte *componentIndexes,
+	uint32_t count) {
+	uint32_t i, j, valueIndex;
+	byte componentIndex;
+	for (i = 1; i < count; i++) {
+		valueIndex = valueIndexes[i];
+		componentIndex = componentIndexes[i];
+		for (j = i; j > 0 && componentIndexes[j - 1] > componentIndex; j--) {
+			valueIndexes[j] = valueIndexes[j - 1];
+			componentIndexes[j] = componentIndexes[j - 1];
+		}
+		valueIndexes[j] = valueIndex;
+		componentIndexes[j] = componentIndex;
 	}
-	return FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_UNKNOWN;
 }
 
-const char* fiftyoneDegreesResultsHashGetNoValueReasonMessage(
-	fiftyoneDegreesResultsNoValueReason reason) {
-	switch (reason) {
-	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_INVALID_PROPERTY:
-		return "The property index provided is invalid, either the property "
-			"does not exist, or the data set has been initialized without it.";
-	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_RESULTS:
-		return "The evidence required to determine this property was not "
-		    "supplied. The most common evidence passed to this engine is "
-		    "'header.user-agent'.";
-	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_RESULT_FOR_PROPERTY:
-		return "None of the results contain a value for the requested property.";
-	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_DIFFERENCE:
-		return "There were no values because the difference limit was "
-			"exceeded so the results are invalid.";
-	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NO_MATCHED_NODES:
-		return "There were no values because no hash nodes were matched in "
-			"the evidence.";
-	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_NULL_PROFILE:
-	    return "No matching profiles could be found for the supplied evidence. "
-	        "A 'best guess' can be returned by configuring more lenient "
-	        "matching rules. See https://51degrees.com/documentation/_device_detection__features__false_positive_control.html?utm_source=code&utm_medium=comment&utm_campaign=device-detection-cxx&utm_content=hash.c&utm_term=fiftyone_degrees_results_no_value_reason_null_profile";
-	case FIFTYONE_DEGREES_RESULTS_NO_VALUE_REASON_UNKNOWN:
-	default:
-		return "The reason for missing values is unknown.";
-	}
+/**
+ * Returns the number of value indexes from the first which relate to the
+ * same component.
+ */
+static uint32_t getComponentValuesCount(
+	const byte *componentIndexes,
+	uint32_t first,
+	uint32_t count) {
+	uint32_t i = first + 1;
+	while (i < count && componentIndexes[i] == componentIndexes[first]) {
+		i++;
+	}
+	return i - first;
 }
 
-fiftyoneDegreesCollectionItem* fiftyoneDegreesResultsHashGetValues(
-	fiftyoneDegreesResultsHash* results,
-	int requiredPropertyIndex,
+uint32_t fiftyoneDegreesHashIterateProfilesForPropertiesAndValues(
+	fiftyoneDegreesResourceManager *manager,
+	const char **propertyNames,
+	const char **valueNames,
+	uint32_t count,
+	void *state,
+	fiftyoneDegreesProfileIterateMethod callback,
 	fiftyoneDegreesException *exception) {
-	ResultHash *result;
-	Property *property;
+	uint32_t i, componentCount, matched = 0;
+	uint32_t *valueIndexes;
+	byte *componentIndexes;
+	const HashProfileValueIndex *index;
 	DataSetHash *dataSet;
-	Item *firstValue = NULL;
-	
-	// Ensure any previous uses of the results to get values are released.
-	resultsHashRelease(results);
-
-	// Check the overrides first.
-	firstValue = getValuesFromOverrides(results, requiredPropertyIndex);
-
-	if (firstValue == NULL) {
-
-		dataSet = (DataSetHash*)results->b.b.dataSet;
-
-		// Work out the property index from the required property index.
-		uint32_t propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
-			dataSet->b.b.available,
-			requiredPropertyIndex);
-
-		if (((int32_t)propertyIndex) < 0) {
-			EXCEPTION_SET(COLLECTION_INDEX_OUT_OF_RANGE);
-		}
-
-		if (EXCEPTION_OKAY) {
-			// Set the property that will be available in the results structure. 
-			// This may also be needed to work out which of a selection of 
-			// results are used to obtain the values.
-			property = PropertyGet(
-				dataSet->properties,
-				propertyIndex,
-				&results->propertyItem,
-				exception);
-
-			if (property != NULL && EXCEPTION_OKAY) {
-				result = getResultFromResultsForComponentIndex(
+	componentProfilesState componentState = { state, callback, true };
+	bool found = true;
+	if (count == 0) {
+		return 0;
+	}
+	valueIndexes = (uint32_t*)Malloc(
+		(sizeof(uint32_t) + sizeof(byte)) * count);
+	if (valueIndexes == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		return 0;
+	}
+	componentIndexes = (byte*)(valueIndexes + count);
+	dataSet = DataSetHashGet(manager);
+	for (i = 0; i < count && found && EXCEPTION_OKAY; i++) {
+		found = getValueIndexForPropertyAndValue(
+			dataSet,
+			propertyNames[i],
+			valueNames[i],
+			&valueIndexes[i],
+			&componentIndexes[i],
+			exception);
+	}
+	if (found && EXCEPTION_OKAY) {
+		index = getProfileValueIndex(dataSet, exception);
+		sortValueIndexesByComponent(valueIndexes, componentIndexes, count);
+
+		// A profile relates to a single component, so the values of each
+		// component are matched against that component's profiles. Every
+		// component must have a matching profile before any are iterated.
+		if (componentIndexes[0] != componentIndexes[count - 1]) {
+			for (i = 0; i < count && found && EXCEPTION_OKAY;
+				i += componentCount) {
+				componentCount = getComponentValuesCount(
+					componentIndexes,
+					i,
+					count);
+				found = iterateProfilesForValues(
 					dataSet,
-					results,
-					property->componentIndex);
-
-				if (result != NULL) {
-
-					// Ensure there is a collection available to the property 
-					// item so that it can be freed when the results are freed.
-					if (results->propertyItem.collection == NULL) {
-						results->propertyItem.collection = dataSet->properties;
-					}
-
-					if (result != NULL && EXCEPTION_OKAY) {
-						firstValue = getValuesFromResult(
-							results,
-							result,
-							property,
-							requiredPropertyIndex,
-							exception);
-					}
-				}
+					index,
+					valueIndexes + i,
+					componentCount,
+					NULL,
+					stopAtFirstProfile,
+					exception) > 0;
 			}
 		}
+		for (i = 0;
+			i < count && found && componentState.next && EXCEPTION_OKAY;
+			i += componentCount) {
+			componentCount = getComponentValuesCount(
+				componentIndexes,
+				i,
+				count);
+			matched += iterateProfilesForValues(
+				dataSet,
+				index,
+				valueIndexes + i,
+				componentCount,
+				&componentState,
+				callbackComponentProfile,
+				exception);
+		}
+	}
+	DataSetHashRelease(dataSet);
+	Free(valueIndexes);
+	return matched;
+}
 
-		if (firstValue == NULL) {
-
-			// There are no values for the property requested. Reset the values 
-			// list to zero count.
-			ListRelease(&results->values);
+/**
+ * Gets the profile id of the profile at the offset from the profile id table
+ * if there is one, otherwise from the profiles collection. Returns zero if
+ * there is no profile at the offset.
+ */
+static uint32_t getProfileIdFromOffset(
+	DataSetHash *dataSet,
+	uint32_t profileOffset,
+	Exception *exception) {
+	Item item;
+	Profile *profile;
+	uint32_t slot, profileId = 0;
+	const HashProfileIdTable *table = dataSet->profileIdTable;
+	if (table != NULL) {
+		slot = getProfileIdSlot(table, profileOffset);
+		while (table->slotOffsets[slot] != 0) {
+			if (table->slotOffsets[slot] == profileOffset + 1) {
+				return table->slotProfileIds[slot];
+			}
+			slot = (slot + 1) & table->slotsMask;
 		}
+		return 0;
 	}
-	return firstValue;
+	DataReset(&item.data);
+	const CollectionKey profileKey = {
+		{profileOffset},
+		CollectionKeyType_Profile,
+	};
+	profile = (Profile*)dataSet->profiles->get(
+		dataSet->profiles,
+		&profileKey,
+		&item,
+		exception);
+	if (profile != NULL) {
+		profileId = profile->profileId;
+		COLLECTION_RELEASE(dataSet->profiles, &item);
+	}
+	return profileId;
 }
 
-uint32_t fiftyoneDegreesHashIterateProfilesForPropertyAndValue(
-	fiftyoneDegreesResourceManager *manager,
-	const char *propertyName,
-	const char *valueName,
-	void *state,
-	fiftyoneDegreesProfileIterateMethod callback,
-	fiftyoneDegreesException *exception) {
-	uint32_t count = 0;
-	DataSetHash *dataSet = DataSetHashGet(manager);
-	count = ProfileIterateProfilesForPropertyAndValue(
-		dataSet->strings,
-		dataSet->properties,
-		dataSet->values,
-		dataSet->profiles,
-		dataSet->profileOffsets,
-		propertyName,
-		valueName,
-		state,
-		callback,
+/**
+ * Gets the profile id for the component to use in the device id of the
+ * result. This is zero if there is no profile, or if the profile is the
+ * default for a result which did not match and was not overridden.
+ */
+static uint32_t getDeviceIdProfileId(
+	DataSetHash *dataSet,
+	ResultHash *result,
+	byte componentIndex,
+	Exception *exception) {
+	const uint32_t profileOffset = result->profileOffsets[componentIndex];
+	if (profileOffset == NULL_PROFILE_OFFSET ||
+		(result->profileIsOverriden[componentIndex] == false &&
+		ISUNMATCHED(dataSet, result))) {
+		return 0;
+	}
+	return getProfileIdFromOffset(dataSet, profileOffset, exception);
+}
+
+/**
+ * Gets the profile id for the component to use in the device id of the
+ * results. Where there are multiple results the best result for the
+ * component is used.
+ */
+static uint32_t getDeviceIdProfileIdFromResults(
+	DataSetHash *dataSet,
+	ResultsHash *results,
+	byte componentIndex,
+	Exception *exception) {
+	ResultHash *result = NULL;
+	if (results->count > 1) {
+		result = getResultFromResultsForComponentIndex(
+			dataSet,
+			results,
+			componentIndex);
+	}
+	else if (results->count == 1) {
+		result = results->items;
+	}
+	return result == NULL ? 0 : getDeviceIdProfileId(
+		dataSet,
+		result,
+		componentIndex,
 		exception);
-	DataSetHashRelease(dataSet);
-	return count;
+}
+
+/**
+ * Adds the decimal digits of the profile id to the builder without the
+ * formatting of the standard library.
+ */
+static void addProfileId(StringBuilder *builder, uint32_t profileId) {
+	char digits[10];
+	size_t i = sizeof(digits);
+	do {
+		digits[--i] = (char)('0' + (profileId % 10));
+		profileId /= 10;
+	} while (profileId != 0);
+	StringBuilderAddChars(builder, digits + i, sizeof(digits) - i);
 }
 
 char* fiftyoneDegreesHashGetDeviceIdFromResult(
@@ -3868,232 +8007,432 @@ char* fiftyoneDegreesHashGetDeviceIdFromResult(
 	char* const buffer, 
 	size_t const length,
 	fiftyoneDegreesException *exception) {
-	uint32_t i, profileOffset;
-	Item item;
-	Profile *profile;
+	uint32_t i;
 	StringBuilder builder = { buffer, length };
 	StringBuilderInit(&builder);
-	DataReset(&item.data);
 	for (i = 0; i < dataSet->componentsList.count; i++) {
 		if (i != 0) {
 			StringBuilderAddChar(&builder, '-');
 		}
-		profileOffset = result->profileOffsets[i];
-		if (profileOffset == NULL_PROFILE_OFFSET) {
-			StringBuilderAddChar(&builder, '0');
-		}
-		else {
-			const CollectionKey profileKey = {
-				{profileOffset},
-				CollectionKeyType_Profile,
-			};
-			profile = (Profile*)dataSet->profiles->get(
-				dataSet->profiles,
-				&profileKey,
-				&item,
-				exception);
-			if (profile == NULL) {
-				StringBuilderAddChar(&builder, '0');
-			}
-			else if (
-				result->profileIsOverriden[i] == false &&
-				ISUNMATCHED(dataSet, result)) {
-				StringBuilderAddChar(&builder, '0');
-			}
-			else {
-				StringBuilderAddInteger(&builder, profile->profileId);
-			}
-			COLLECTION_RELEASE(dataSet->profiles, &item);
-		}
+		addProfileId(
+			&builder,
+			getDeviceIdProfileId(dataSet, result, (byte)i, exception));
 	}
 	StringBuilderComplete(&builder);
 	return builder.full ? NULL : buffer;
 }
 
-char *getNullDeviceId(DataSetHash *dataSet, char *buffer, size_t length) {
+char* fiftyoneDegreesHashGetDeviceIdFromResults(
+	fiftyoneDegreesResultsHash *results,
+	char* const buffer,
+	size_t const length,
+	fiftyoneDegreesException *exception) {
 	uint32_t i;
 	StringBuilder builder = { buffer, length };
+	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
 	StringBuilderInit(&builder);
 	for (i = 0; i < dataSet->componentsList.count; i++) {
 		if (i != 0) {
 			StringBuilderAddChar(&builder, '-');
 		}
-		StringBuilderAddChar(&builder, '0');
+		addProfileId(
+			&builder,
+			getDeviceIdProfileIdFromResults(
+				dataSet,
+				results,
+				(byte)i,
+				exception));
 	}
 	StringBuilderComplete(&builder);
 	return builder.full ? NULL : buffer;
 }
 
-char* fiftyoneDegreesHashGetDeviceIdFromResults(
+uint32_t fiftyoneDegreesHashGetDeviceIdBinaryFromResults(
 	fiftyoneDegreesResultsHash *results,
-	char* const buffer,
-	size_t const length,
+	uint32_t *profileIds,
+	uint32_t count,
 	fiftyoneDegreesException *exception) {
-	byte i;
+	uint32_t i;
+	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
+	if (count < dataSet->componentsList.count) {
+		return 0;
+	}
+	for (i = 0; i < dataSet->componentsList.count; i++) {
+		profileIds[i] = getDeviceIdProfileIdFromResults(
+			dataSet,
+			results,
+			(byte)i,
+			exception);
+	}
+	return dataSet->componentsList.count;
+}
+
+/**
+ * Increases the capacity of the list to at least the capacity provided,
+ * keeping the items already in the list.
+ */
+static bool ensureListCapacity(List *list, uint32_t capacity) {
+	Item *items;
+	if (capacity <= list->capacity) {
+		return true;
+	}
+	items = (Item*)Malloc(sizeof(Item) * capacity);
+	if (items == NULL) {
+		return false;
+	}
+	if (list->count > 0) {
+		memcpy(items, list->items, sizeof(Item) * list->count);
+	}
+	if (list->items != NULL) {
+		Free(list->items);
+	}
+	list->items = items;
+	list->capacity = capacity;
+	return true;
+}
+
+/**
+ * Adds the value strings of the profile to the results values in a single
+ * pass over the profile's values. The values of a property are contiguous in
+ * the profile, so the position and number of the values are recorded against
+ * the property's required property index.
+ */
+static void addProfileValuesForJson(
+	DataSetHash *dataSet,
+	ResultsHash *results,
+	const Profile *profile,
+	Exception *exception) {
+	uint32_t i;
+	int requiredPropertyIndex;
+	Item valueItem, stringItem;
+	Value *value;
+	HashPropertyValues *propertyValues;
+	const uint32_t *valueIndexes = (const uint32_t*)(profile + 1);
+	DataReset(&valueItem.data);
+	for (i = 0; i < profile->valueCount && EXCEPTION_OKAY; i++) {
+		value = ValueGet(
+			dataSet->values,
+			valueIndexes[i],
+			&valueItem,
+			exception);
+		if (value == NULL || EXCEPTION_FAILED) {
+			break;
+		}
+		requiredPropertyIndex = value->propertyIndex >= 0 &&
+			(uint32_t)value->propertyIndex < dataSet->header.properties.count ?
+			dataSet->requiredPropertyIndexes[value->propertyIndex] :
+			-1;
+		if (requiredPropertyIndex >= 0) {
+			DataReset(&stringItem.data);
+			if (StringGet(
+					dataSet->strings,
+					value->nameOffset,
+					&stringItem,
+					exception) != NULL && EXCEPTION_OKAY) {
+				propertyValues = &results->propertyValues[requiredPropertyIndex];
+				if (propertyValues->count == 0) {
+					propertyValues->first = results->values.count;
+				}
+				propertyValues->count++;
+				ListAdd(&results->values, &stringItem);
+			}
+		}
+		COLLECTION_RELEASE(dataSet->values, &valueItem);
+	}
+}
+
+/**
+ * Sets the values list of the results to the values of every required
+ * property, reading each matched profile once. Overridden properties are
+ * then pointed at their override values, which are added after the profile
+ * values, so they take precedence as they do in ResultsHashGetValues.
+ */
+static void addValuesForJson(
+	DataSetHash *dataSet,
+	ResultsHash *results,
+	Exception *exception) {
+	uint32_t i, first, count, profileOffset;
 	ResultHash *result;
 	Profile *profile;
 	Item profileItem;
-	uint32_t profileOffset;
-	StringBuilder builder = { buffer, length };
-	StringBuilderInit(&builder);
-	DataReset(&profileItem.data);
-	DataSetHash *dataSet = (DataSetHash*)results->b.b.dataSet;
-	if (results->count > 1) {
+	const uint32_t requiredCount = dataSet->b.b.available->count;
 
-		// There are multiple results, so the overall device id must be
-		// determined by finding the best profile id for each component.
-		for (i = 0; i < dataSet->componentsList.count; i++) {
+	for (i = 0; i < requiredCount; i++) {
+		results->propertyValues[i].first = 0;
+		results->propertyValues[i].count = 0;
+	}
 
-			if (i != 0) {
-				StringBuilderAddChar(&builder, '-');
+	// Add the values of the profile matched for each component.
+	for (i = 0; i < dataSet->componentsList.count && EXCEPTION_OKAY; i++) {
+		result = getResultFromResultsForComponentIndex(
+			dataSet,
+			results,
+			(byte)i);
+		if (result == NULL) {
+			continue;
+		}
+		profileOffset = result->profileOffsets[i];
+		if (profileOffset == NULL_PROFILE_OFFSET) {
+			continue;
+		}
+		const CollectionKey profileKey = {
+			{profileOffset},
+			CollectionKeyType_Profile,
+		};
+		DataReset(&profileItem.data);
+		profile = (Profile*)dataSet->profiles->get(
+			dataSet->profiles,
+			&profileKey,
+			&profileItem,
+			exception);
+		if (profile == NULL || EXCEPTION_FAILED) {
+			break;
+		}
+		if (ensureListCapacity(
+				&results->values,
+				results->values.count + profile->valueCount)) {
+			addProfileValuesForJson(dataSet, results, profile, exception);
+		}
+		else {
+			EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		}
+		COLLECTION_RELEASE(dataSet->profiles, &profileItem);
+	}
+
+	// Replace the values of any overridden properties.
+	if (results->b.overrides != NULL &&
+		results->b.overrides->count > 0 &&
+		EXCEPTION_OKAY) {
+		if (ensureListCapacity(
+				&results->values,
+				results->values.count + results->b.overrides->count)) {
+			for (i = 0; i < requiredCount; i++) {
+				first = results->values.count;
+				count = OverrideValuesAdd(
+					results->b.overrides,
+					i,
+					&results->values);
+				if (count > 0) {
+					results->propertyValues[i].first = first;
+					results->propertyValues[i].count = count;
+				}
 			}
+		}
+		else {
+			EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		}
+	}
+}
 
-			// Get the result for the component.
-			result = getResultFromResultsForComponentIndex(
-				dataSet,
-				results,
-				i);
+/**
+ * Characters of JSON output waiting to be passed to the write method.
+ */
+typedef struct json_sink_t {
+	char buffer[1024]; /* Characters not yet written */
+	size_t used; /* Number of characters in the buffer */
+	size_t added; /* Number of characters passed to the write method */
+	void *state; /* State for the write method */
+	HashJsonWriteMethod write; /* Method to write the characters */
+	bool stopped; /* True if the write method returned false */
+} jsonSink;
 
-			// If there is no profile then add the 0 id, otherwise get the 
-			// profile from the offset and use the profile id.
-			if (result == NULL ||
-				result->profileOffsets[i] == NULL_PROFILE_OFFSET) {
-				StringBuilderAddChar(&builder, '0');
-
-			} else {
-				profileOffset = result->profileOffsets[i];
-				if (profileOffset != NULL_PROFILE_OFFSET) {
-
-					// Get the profile for the result.
-					const CollectionKey profileKey = {
-						{profileOffset},
-						CollectionKeyType_Profile,
-					};
-					profile = dataSet->profiles->get(
-						dataSet->profiles,
-						&profileKey,
-						&profileItem,
-						exception);
+/**
+ * Method which adds part of the JSON document to the builder of the state.
+ */
+typedef void(*jsonAddMethod)(Json *s);
 
-					// If there is no profile then print the null profile id.
-					if (profile == NULL) {
-						StringBuilderAddChar(&builder, '0');
-					}
+static void jsonSinkWrite(jsonSink *sink, const char *chars, size_t length) {
+	if (length > 0 && sink->stopped == false) {
+		sink->stopped = !sink->write(sink->state, chars, length);
+		sink->added += length;
+	}
+}
 
-					// If there is a profile but it's the unmatched value then 
-					// print the null profile id.
-					else if (
-						result->profileIsOverriden[i] == false &&
-						ISUNMATCHED(dataSet, result)) {
-						COLLECTION_RELEASE(dataSet->profiles, &profileItem);
-						StringBuilderAddChar(&builder, '0');
-					}
+static void jsonSinkFlush(jsonSink *sink) {
+	jsonSinkWrite(sink, sink->buffer, sink->used);
+	sink->used = 0;
+}
 
-					// Otherwise print the actual profile id.
-					else {
-						StringBuilderAddInteger(&builder, profile->profileId);
-						COLLECTION_RELEASE(dataSet->profiles, &profileItem);
-					}
-				}
-			}
+static void setJsonBuilder(Json *s, char *buffer, size_t length) {
+	s->builder.ptr = buffer;
+	s->builder.length = length;
+	StringBuilderInit(&s->builder);
+}
+
+/**
+ * Returns the number of characters added to the builder, excluding the null
+ * terminator counted when the end of the document completes the builder.
+ */
+static size_t getJsonAdded(Json *s) {
+	size_t added = s->builder.added;
+	if (added > 0 &&
+		added < s->builder.length &&
+		s->builder.ptr[added - 1] == '\0') {
+		added--;
+	}
+	return added;
+}
+
+/**
+ * Calls the method to add characters to the unused part of the buffer. If
+ * they do not fit then the buffer is flushed and the method called again,
+ * with memory allocated for the purpose if the characters are longer than
+ * the buffer. The builder always leaves space for a null terminator.
+ */
+static void jsonSinkAdd(jsonSink *sink, Json *s, jsonAddMethod add) {
+	char *chars;
+	size_t length;
+	Exception *exception = s->exception;
+	setJsonBuilder(
+		s,
+		sink->buffer + sink->used,
+		sizeof(sink->buffer) - sink->used);
+	add(s);
+	if (s->builder.added < s->builder.length) {
+		sink->used += getJsonAdded(s);
+		return;
+	}
+	length = s->builder.added + 1;
+	jsonSinkFlush(sink);
+	if (length <= sizeof(sink->buffer)) {
+		setJsonBuilder(s, sink->buffer, sizeof(sink->buffer));
+		add(s);
+		sink->used = getJsonAdded(s);
+	}
+	else {
+		chars = (char*)Malloc(length);
+		if (chars == NULL) {
+			EXCEPTION_SET(INSUFFICIENT_MEMORY);
+			return;
 		}
-		StringBuilderComplete(&builder);
-		return builder.full ? NULL : buffer;
+		setJsonBuilder(s, chars, length);
+		add(s);
+		jsonSinkWrite(sink, chars, getJsonAdded(s));
+		Free(chars);
 	}
-	else if (results->count == 1) {
+}
 
-		// There is only one result, so just get the device id for that.
-		return HashGetDeviceIdFromResult(
-			results->b.b.dataSet,
-			results->items,
-			buffer,
-			length,
-			exception);
+/**
+ * Adds characters which have already been formatted to the characters
+ * waiting to be written, flushing the buffer first if they do not fit, or
+ * writing them directly if they are longer than the buffer.
+ */
+static void jsonSinkAddChars(
+	jsonSink *sink,
+	const char *chars,
+	size_t length) {
+	if (length > sizeof(sink->buffer) - sink->used) {
+		jsonSinkFlush(sink);
+	}
+	if (length > sizeof(sink->buffer)) {
+		jsonSinkWrite(sink, chars, length);
 	}
 	else {
-		return getNullDeviceId(
-			results->b.b.dataSet,
-			buffer,
-			length);
+		memcpy(sink->buffer + sink->used, chars, length);
+		sink->used += length;
 	}
 }
 
-size_t fiftyoneDegreesResultsHashGetValuesJson(
+/**
+ * Adds the values and end of the property, whose key has already been added.
+ */
+static void addPropertyValuesJson(Json *s) {
+	JsonPropertyValues(s);
+	JsonPropertyEnd(s);
+}
+
+size_t fiftyoneDegreesResultsHashWriteValuesJson(
 	fiftyoneDegreesResultsHash* results,
-	char* const buffer,
-	size_t const length,
+	void *state,
+	fiftyoneDegreesHashJsonWriteMethod write,
 	fiftyoneDegreesException* exception) {
-
-	int propertyIndex;
-	Item propertyItem;
+	uint32_t i;
+	bool firstProperty = true;
+	List values;
+	jsonSink sink;
+	HashJsonProperty *jsonProperty;
 	DataSetHash* dataSet = (DataSetHash*)results->b.b.dataSet;
-	DataReset(&propertyItem.data);
-
-	// Set the state used with the JSON methods.
-	Json s = { buffer, length };
+	sink.used = 0;
+	sink.added = 0;
+	sink.state = state;
+	sink.write = write;
+	sink.stopped = false;
+
+	// Set the state used with the JSON methods. The builder is set to the
+	// sink's buffer each time characters are added.
+	Json s = { NULL, 0 };
 	s.exception = exception;
 	s.strings = dataSet->strings;
 	s.property = NULL;
-	s.values = NULL;
+	s.values = &values;
 	s.storedPropertyType = FIFTYONE_DEGREES_PROPERTY_VALUE_TYPE_STRING; // only strings in device-detection
 
 	// Ensure any previous uses of the results to get values are released.
 	resultsHashRelease(results);
 
-	// Add the start character.
-	JsonDocumentStart(&s);
+	if (results->propertyValues == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		return 0;
+	}
 
-    bool firstProperty = true;
-    
-	// For each of the available properties and values.
-	for (uint32_t i = 0; i < dataSet->b.b.available->count; i++) {
-		// Get the data set property index.
-		propertyIndex = PropertiesGetPropertyIndexFromRequiredIndex(
-			dataSet->b.b.available, 
-			i);
-		if (propertyIndex >= 0) {
-            // Write the property and values only if we have them
-            // Otherwise we could have ended up with {"key1":,"key2":} invalid json
-            if (ResultsHashGetValues(results, i, exception) != NULL &&
-                EXCEPTION_OKAY) {
-                // Get the property.
-            	const CollectionKey propertyKey = {
-					{propertyIndex},
-					CollectionKeyType_Property,
-				};
-                s.property = (Property*)dataSet->properties->get(
-                    dataSet->properties,
-					&propertyKey,
-                    &propertyItem,
-                    exception);
-
-                if (s.property != NULL && EXCEPTION_OKAY){
-                    // Write the property separator if not the first property.
-                    if (!firstProperty) {
-                        JsonPropertySeparator(&s);
-                    }
-                    
-                    // Write the start of the property.
-                    JsonPropertyStart(&s);
-                    
-                    // Write values
-                    s.values = &results->values;
-                    JsonPropertyValues(&s);
-
-                    // Write the end of the property.
-                    JsonPropertyEnd(&s);
-                    
-                    // Release the property.
-                    COLLECTION_RELEASE(dataSet->properties, &propertyItem);
-                    
-                    firstProperty = false;
-                }
-            }
+	// Read the values of all the required properties from the matched
+	// profiles and overrides.
+	addValuesForJson(dataSet, results, exception);
+
+	// Add the start character.
+	jsonSinkAdd(&sink, &s, JsonDocumentStart);
+
+	// Write each of the available properties which has values in the order
+	// of the required property indexes, starting with the key formatted
+	// when the data set was loaded.
+	for (i = 0;
+		i < dataSet->b.b.available->count &&
+		sink.stopped == false &&
+		EXCEPTION_OKAY;
+		i++) {
+		if (results->propertyValues[i].count == 0) {
+			continue;
 		}
+		jsonProperty = &dataSet->jsonProperties[i];
+		s.property = &jsonProperty->property;
+		values.items = results->values.items +
+			results->propertyValues[i].first;
+		values.count = results->propertyValues[i].count;
+		values.capacity = values.count;
+
+		// Write the property separator if not the first property.
+		if (firstProperty == false) {
+			jsonSinkAdd(&sink, &s, JsonPropertySeparator);
+		}
+		jsonSinkAddChars(&sink, jsonProperty->key, jsonProperty->keyLength);
+		jsonSinkAdd(&sink, &s, addPropertyValuesJson);
+		firstProperty = false;
 	}
+	resultsHashRelease(results);
 
 	// Add the end character.
-	JsonDocumentEnd(&s);
+	jsonSinkAdd(&sink, &s, JsonDocumentEnd);
+	jsonSinkFlush(&sink);
+	return sink.added;
+}
+
+static bool writeJsonToBuilder(void *state, const char *chars, size_t length) {
+	StringBuilderAddChars((StringBuilder*)state, chars, length);
+	return true;
+}
 
-	return s.builder.added;
+size_t fiftyoneDegreesResultsHashGetValuesJson(
+	fiftyoneDegreesResultsHash* results,
+	char* const buffer,
+	size_t const length,
+	fiftyoneDegreesException* exception) {
+	StringBuilder builder = { buffer, length };
+	StringBuilderInit(&builder);
+	ResultsHashWriteValuesJson(
+		results,
+		&builder,
+		writeJsonToBuilder,
+		exception);
+	StringBuilderComplete(&builder);
+	return builder.added;
 }
@@ -79,6 +79,10 @@
 #include "../dataset-dd.h"
 #include "../results-dd.h"
 #include "graph.h"
+#include "resultcache.h"
+#include "mappedfile.h"
+#include "hugepages.h"
+#include "numa.h"
 
 /** Default value for the cache concurrency used in the default configuration. */
 #ifndef FIFTYONE_DEGREES_CACHE_CONCURRENCY
@@ -89,6 +93,24 @@
 #endif
 #endif
 
+/**
+ * Number of inputs from a batch which are prepared and evaluated together by
+ * #fiftyoneDegreesResultsHashFromEvidenceBatch.
+ */
+#ifndef FIFTYONE_DEGREES_HASH_BATCH_SIZE
+#define FIFTYONE_DEGREES_HASH_BATCH_SIZE 32
+#endif
+
+/**
+ * Number of nodes from the root of a graph which are recorded when evaluating
+ * the graph without difference or drift. Retries with difference or drift
+ * resume from the recorded node at the depth where the tolerances are first
+ * applied rather than evaluating the graph again from the root.
+ */
+#ifndef FIFTYONE_DEGREES_HASH_RESUME_DEPTH
+#define FIFTYONE_DEGREES_HASH_RESUME_DEPTH 64
+#endif
+
 /**
  * Evidence key for GetHighEntropyValues base 64 encoded JSON data.
  */
@@ -214,6 +236,115 @@ typedef struct fiftyone_degrees_config_hash_t {
                      during processing. The trace can then be printed to debug
                      the matching after the fact. Note that this option is only
                      considered when compiled in debug mode. */
+	bool flatGraph; /**< True if the nodes should be compiled when the data
+					set is loaded into a flat graph, which is walked without
+					getting each node from the nodes collection. This uses
+					memory in addition to the nodes collection, which is
+					included in the size returned from
+					fiftyoneDegreesHashSizeManagerFromFile. See
+					#fiftyoneDegreesGraphFlat. */
+	bool optimiseNodeLayout; /**< True if the nodes should be placed in the
+							 flat graph in breadth first order from the root
+							 nodes, so that the nodes evaluated for most
+							 detections share cache lines and pages. Implies
+							 flatGraph. */
+	bool optimiseNodeSearch; /**< True if the hash codes of nodes whose
+							 records are an ordered list should be copied
+							 into the flat graph in a layout which is faster
+							 to search than the records. Nodes with few
+							 records are scanned a SIMD lane at a time, and
+							 larger ones searched in Eytzinger order. Implies
+							 flatGraph. See
+							 #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH. */
+	bool optimiseNodeModulo; /**< True if the constant needed to find the
+							 slot of a hash in a hash table node with a
+							 multiplication, rather than an integer
+							 division, should be appended to each hash table
+							 node in the flat graph. Implies flatGraph. See
+							 #FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO. */
+	uint32_t resultCacheCapacity; /**< Number of detection results to cache
+								  keyed on the evidence used to produce them,
+								  or 0 if results should not be cached. The
+								  capacity is rounded up to a power of two.
+								  The cache belongs to the data set, so is
+								  discarded when the data set is reloaded. It
+								  is not used if traceRoute is enabled. See
+								  #fiftyoneDegreesResultCache. */
+	bool valueTable; /**< True if the values of every required property for
+					 every profile should be resolved when the data set is
+					 loaded, so they can be returned by
+					 fiftyoneDegreesResultsHashGetValuesFromTable without
+					 getting any items from collections. The memory used
+					 grows with the number of profiles and required
+					 properties, so this is intended for use with a small
+					 set of required properties. See
+					 #fiftyoneDegreesHashValueTable. */
+	bool mappedFile; /**< True if the data file should be mapped into memory
+					 read only rather than read into allocated memory when
+					 all the data is in memory. The collections point into
+					 the mapping, so the file is not copied and its pages
+					 are shared with other processes mapping the same file.
+					 Only used when b.b.allInMemory is true. See
+					 #fiftyoneDegreesMappedFile. */
+	bool prefaultMappedFile; /**< True if every page of a mapped data file
+							 should be read when the data set is loaded,
+							 rather than when each page is first used.
+							 Only used when mappedFile is true. */
+	const char *sharedGraphFile; /**< Path to a file written by
+								 fiftyoneDegreesHashSaveSharedGraph in
+								 another process, or NULL. When the file
+								 was saved from the same data file with the
+								 same node options the flat graph is mapped
+								 from it read only rather than built, so
+								 every process shares the same pages.
+								 Only the flat graph is shared, not the
+								 rest of the data set. Implies flatGraph.
+								 The string must remain valid for the life
+								 of the data set. See
+								 #fiftyoneDegreesGraphFlatSegment. */
+	bool hugePages; /**< True if the memory the data file is read into, and
+					the flat graph, should be backed by huge pages to reduce
+					TLB misses. Reserved huge pages are used if available,
+					otherwise transparent huge pages are requested. The data
+					file is only read into huge pages when b.b.allInMemory is
+					true. See #fiftyoneDegreesHugePages. */
+	int32_t numaNode; /**< NUMA node the memory the data file is read into,
+					  and the flat graph, should be bound to, or -1 to leave
+					  the memory wherever it was allocated. The data file is
+					  read into memory which is bound before it is written.
+					  Only used when b.b.allInMemory is true and mappedFile
+					  is false. The data set fails to load with
+					  #FIFTYONE_DEGREES_STATUS_INVALID_CONFIG if the memory
+					  can't be bound. Set for each replica by
+					  fiftyoneDegreesHashReplicasInit */
+	bool pruneGraph; /**< True if the flat graph should only include the
+					 nodes which can be reached from the roots of the graphs
+					 and components used for the required properties. The
+					 nodes collection is then freed as detection only uses
+					 the flat graph, and when the data file is in memory the
+					 pages holding the nodes are released. Only the nodes
+					 are pruned. The profiles, values and strings of
+					 properties which are not required are kept. Implies
+					 flatGraph. */
+	bool profileIdTable; /**< True if tables between profile ids and the
+						 offsets and components of their profiles should be
+						 built when the data set is loaded, so that device
+						 ids are created, and device ids and profile id
+						 overrides are resolved, without searching the
+						 profile offsets collection or getting the profile.
+						 Profiles are not found from profile ids with the
+						 table if the profile ids are too sparse. Disabled
+						 in the preset configurations as the tables use
+						 memory for every profile. See
+						 #fiftyoneDegreesHashProfileIdTable. */
+	bool profileValueIndex; /**< True if an index from each value to the
+							profiles which have it should be built the first
+							time profiles are found for a property and value,
+							so that the profiles are found without checking
+							every profile in the data set. Disabled in the
+							preset configurations as the index uses memory
+							in proportion to the profile values. See
+							#fiftyoneDegreesHashProfileValueIndex. */
 } fiftyoneDegreesConfigHash;
 
 /**
@@ -227,6 +358,148 @@ typedef struct fiftyone_degrees_hash_rootnodes_t {
                                    root node for the predictive graph. */
 } fiftyoneDegreesHashRootNodes;
 
+/**
+ * Values for a single profile and required property in the value table.
+ */
+typedef struct fiftyone_degrees_hash_value_cell_t {
+	uint32_t first; /**< Index of the first value in the values array */
+	uint32_t count; /**< Number of values */
+} fiftyoneDegreesHashValueCell;
+
+/**
+ * Values of every required property for every profile resolved when the data
+ * set is loaded. Profiles are found from their offset using a hash table of
+ * slots, which gives the row of the profile within its component. Each
+ * required property has a cell for every row of its component, and each cell
+ * refers to a run of value strings copied from the strings collection.
+ */
+typedef struct fiftyone_degrees_hash_value_table_t {
+	uint32_t *slotOffsets; /**< Profile offset plus one for each slot, or zero
+						   if the slot is empty */
+	uint32_t *slotRows; /**< Row within its component of the profile in each
+						slot */
+	uint32_t slotsMask; /**< Number of slots minus one */
+	uint32_t *propertyCells; /**< Index of the cell for row zero for each
+							 required property */
+	byte *propertyComponents; /**< Component index for each required
+							  property */
+	uint32_t propertiesCount; /**< Number of required properties */
+	fiftyoneDegreesHashValueCell *cells; /**< Cells for all the required
+										 properties */
+	const char **values; /**< Pointers to the value strings for the cells */
+	char *strings; /**< Memory holding the unique value strings */
+} fiftyoneDegreesHashValueTable;
+
+/**
+ * Mappings between profile ids and profiles built when the data set is
+ * loaded. The offset and component index of the profile for every profile id
+ * up to the highest in the data set are held in arrays indexed directly by
+ * the profile id, if the profile ids are dense enough. The profile id of each
+ * profile is found from its offset using a hash table of slots.
+ */
+typedef struct fiftyone_degrees_hash_profile_id_table_t {
+	uint32_t *offsets; /**< Offset of the profile for each profile id, or
+					   UINT32_MAX if there is no profile with the id. NULL if
+					   the profile ids are too sparse */
+	byte *componentIndexes; /**< Component index of the profile for each
+							profile id */
+	uint32_t count; /**< Number of entries, one more than the highest profile
+					id */
+	uint32_t *slotOffsets; /**< Profile offset plus one for each slot, or zero
+						   if the slot is empty */
+	uint32_t *slotProfileIds; /**< Profile id of the profile in each slot */
+	uint32_t slotsMask; /**< Number of slots minus one */
+} fiftyoneDegreesHashProfileIdTable;
+
+/**
+ * Inverted index from each value to the profiles which have it, built from
+ * the profiles collection the first time it is needed. The offsets of the
+ * profiles for each value are held in ascending order so that the profiles
+ * for several values can be intersected.
+ */
+typedef struct fiftyone_degrees_hash_profile_value_index_t {
+	uint32_t *firstOffsets; /**< Position in offsets of the first profile for
+							each value index, with an extra entry for the end
+							of the last value */
+	uint32_t *offsets; /**< Offsets of the profiles for each value in
+					   ascending order */
+	uint32_t valuesCount; /**< Number of values in the index */
+} fiftyoneDegreesHashProfileValueIndex;
+
+/**
+ * Position and number of the values of a required property in the values
+ * list of the results. Used to write all the values of the results as JSON
+ * after reading each matched profile once.
+ */
+typedef struct fiftyone_degrees_hash_property_values_t {
+	uint32_t first; /**< Index in the values list of the first value */
+	uint32_t count; /**< Number of values, or 0 if there are none */
+} fiftyoneDegreesHashPropertyValues;
+
+/**
+ * JSON key for a required property, formatted with the common Json methods
+ * when the data set is loaded so that it can be written without getting the
+ * property or escaping its name again.
+ */
+typedef struct fiftyone_degrees_hash_json_property_t {
+	fiftyoneDegreesProperty property; /**< Copy of the property used by the
+									  Json methods to write the values */
+	const char *key; /**< Quoted and escaped name followed by a colon, and an
+					 opening bracket if the property is a list */
+	uint32_t keyLength; /**< Number of characters in the key */
+} fiftyoneDegreesHashJsonProperty;
+
+/**
+ * Method used to write characters of JSON output to a destination supplied by
+ * the caller. See #fiftyoneDegreesResultsHashWriteValuesJson.
+ * @param state pointer provided by the caller
+ * @param chars characters to write, not null terminated
+ * @param length number of characters to write
+ * @return true if writing should continue, otherwise false
+ */
+typedef bool(*fiftyoneDegreesHashJsonWriteMethod)(
+	void *state,
+	const char *chars,
+	size_t length);
+
+/**
+ * The type of pages backing each collection of a data set, so that it can be
+ * reported which collections benefit from the hugePages option. Collections
+ * read from the file rather than held in memory are always
+ * #FIFTYONE_DEGREES_HUGE_PAGES_NONE. Collections in memory advised to use
+ * transparent huge pages are #FIFTYONE_DEGREES_HUGE_PAGES_ADVISED whether or
+ * not the operating system has backed them with huge pages.
+ */
+typedef struct fiftyone_degrees_hash_huge_pages_t {
+	fiftyoneDegreesHugePagesType strings; /**< Strings collection */
+	fiftyoneDegreesHugePagesType components; /**< Components collection */
+	fiftyoneDegreesHugePagesType maps; /**< Maps collection */
+	fiftyoneDegreesHugePagesType properties; /**< Properties collection */
+	fiftyoneDegreesHugePagesType values; /**< Values collection */
+	fiftyoneDegreesHugePagesType profiles; /**< Profiles collection */
+	fiftyoneDegreesHugePagesType rootNodes; /**< Root nodes collection */
+	fiftyoneDegreesHugePagesType nodes; /**< Nodes collection */
+	fiftyoneDegreesHugePagesType profileOffsets; /**< Profile offsets
+												 collection */
+	fiftyoneDegreesHugePagesType flatGraph; /**< Nodes of the flat graph */
+} fiftyoneDegreesHashHugePages;
+
+/**
+ * A resource manager for each NUMA node, each with a copy of the data set in
+ * memory bound to its node, so that detections can read the copy which is
+ * local to the CPU they run on. See #fiftyoneDegreesHashReplicasInit.
+ */
+typedef struct fiftyone_degrees_hash_replicas_t {
+	fiftyoneDegreesResourceManager *managers; /**< Resource manager for each
+											  online NUMA node */
+	uint32_t count; /**< Number of resource managers */
+	/**
+	 * Index in managers of the replica for each NUMA node number. Nodes
+	 * without a replica use the first.
+	 */
+	uint32_t nodeReplicas[FIFTYONE_DEGREES_NUMA_MAX_NODES];
+} fiftyoneDegreesHashReplicas;
+
 /**
  * Data set structure containing all the components used for detections.
  * This should predominantly be used through a #fiftyoneDegreesResourceManager
@@ -246,6 +519,13 @@ typedef struct fiftyone_degrees_dataset_hash_t {
 										components collection */
 	fiftyoneDegreesHeaderPtrs** componentHeaders; /**< Array of headers for 
 												  each component index */
+	fiftyoneDegreesHashRootNodes *componentRootNodes; /**< Root nodes for each
+													  component index and
+													  unique header index,
+													  with offsets of
+													  UINT32_MAX where the
+													  component has no graph
+													  for the header */
 	bool *componentsAvailable; /**< Array of flags indicating if there are
 							   any properties available for the component with
 							   the matching index in componentsList */
@@ -256,12 +536,73 @@ typedef struct fiftyone_degrees_dataset_hash_t {
 	fiftyoneDegreesCollection *values; /**< Collection of all values */
 	fiftyoneDegreesCollection *profiles; /**< Collection of all profiles */
 	fiftyoneDegreesCollection *rootNodes; /**< Collection of all root nodes */
-	fiftyoneDegreesCollection *nodes; /**< Collection of all hash nodes */
+	fiftyoneDegreesCollection *nodes; /**< Collection of all hash nodes, or
+									  NULL if the pruneGraph option is
+									  enabled */
+	fiftyoneDegreesGraphFlat *flatGraph; /**< Nodes compiled into a flat
+										 graph, or NULL if the flatGraph
+										 option is not enabled */
+	uint32_t sharedGraphGeneration; /**< Generation of the shared graph file
+									when the data set was loaded, whether
+									or not the flat graph was attached from
+									it, or 0 if there was no file */
+	fiftyoneDegreesResultCache *resultCache; /**< Cache of detection results,
+											 or NULL if the
+											 resultCacheCapacity option is
+											 0 */
+	fiftyoneDegreesHashValueTable *valueTable; /**< Values resolved for each
+											   profile and required
+											   property, or NULL if the
+											   valueTable option is not
+											   enabled */
+	fiftyoneDegreesHashProfileIdTable *profileIdTable; /**< Mappings between
+													   profile ids and
+													   profiles, or NULL if
+													   the profileIdTable
+													   option is not
+													   enabled */
+	fiftyoneDegreesHashProfileValueIndex *profileValueIndex; /**< Profiles for
+															 each value, or
+															 NULL until first
+															 used or if the
+															 profileValueIndex
+															 option is not
+															 enabled */
+	int *requiredPropertyIndexes; /**< Required property index for each
+								  property in the properties collection, or
+								  -1 if the property is not required */
+	fiftyoneDegreesHashJsonProperty *jsonProperties; /**< JSON key for each
+													 required property */
 	fiftyoneDegreesCollection *profileOffsets; /**< Collection of all offsets
 											   to profiles in the profiles
 											   collection */
+	fiftyoneDegreesMappedFile mappedFile; /**< Mapping of the data file which
+										  the collections point into if the
+										  mappedFile option is enabled */
+	fiftyoneDegreesHugePages hugePagesMemory; /**< Memory the data file is
+											  read into if the hugePages
+											  option is enabled */
+	fiftyoneDegreesHashHugePages hugePages; /**< Type of pages backing each
+											collection */
+	byte *fileStartByte; /**< First byte of the data file when it has been
+						 read into memory, or mapped, by the data set, or NULL
+						 if the data set does not own the memory */
 } fiftyoneDegreesDataSetHash;
 
+/**
+ * Rabin-Karp hash codes of every prefix of an evidence value. The hash code of
+ * the window of length L starting at index i is then
+ * hashes[i + L] - hashes[i] * p^L which needs no iteration over the
+ * characters of the window.
+ */
+typedef struct fiftyone_degrees_hash_prefix_hashes_t {
+	const char *value; /**< Evidence value the hash codes relate to, or NULL
+					   if there are none for the current evidence */
+	size_t length; /**< Number of characters in the value */
+	uint32_t *hashes; /**< Hash code of the first i characters at index i */
+	size_t capacity; /**< Number of hash codes the memory can hold */
+} fiftyoneDegreesHashPrefixHashes;
+
 /** @cond FORWARD_DECLARATIONS */
 typedef struct fiftyone_degrees_result_hash_t fiftyoneDegreesResultHash;
 /** @endcond */
@@ -303,7 +644,20 @@ typedef struct fiftyone_degrees_result_hash_t {
 	fiftyoneDegreesCollectionItem propertyItem; /**< Property for the current
 												request */ \
 	fiftyoneDegreesList values; /**< List of value items when results are
-								fetched */
+								fetched */ \
+	byte *resultCacheData; /**< Working memory used to copy results to and
+						   from the data set's result cache, or NULL if
+						   there is no cache */ \
+	fiftyoneDegreesHashPropertyValues *propertyValues; /**< Values of each
+													   required property in
+													   the values list when
+													   writing JSON */ \
+	fiftyoneDegreesHashPrefixHashes *prefixHashes; /**< Prefix hash codes for
+												   the evidence value of each
+												   unique header, shared by
+												   all the components, graphs
+												   and retries which evaluate
+												   the value */
 
 FIFTYONE_DEGREES_ARRAY_TYPE(
 	fiftyoneDegreesResultHash,
@@ -440,6 +794,166 @@ fiftyoneDegreesHashInitManagerFromFile(
 	const char *fileName,
 	fiftyoneDegreesException *exception);
 
+/**
+ * Initialises the resource manager with a Hash data set resource whose
+ * collections point into a read only memory mapping of the Hash data file
+ * referred to by fileName, rather than into a copy of the file read into
+ * memory. The configuration is used with the b.b.allInMemory and mappedFile
+ * options enabled. Reloading the manager from a file maps the new file.
+ * @param manager the resource manager to manager the share data set resource
+ * @param config configuration for the operation of the data set, or NULL if
+ * the in memory configuration is required
+ * @param properties the properties that will be consumed from the data set, or
+ * NULL if all available properties in the Hash data file should be available
+ * for consumption
+ * @param fileName the full path to a file with read permission that contains
+ * the Hash data set. The file must not be modified while it is mapped
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return the status associated with the data set resource assign to the
+ * resource manager. Any value other than #FIFTYONE_DEGREES_STATUS_SUCCESS
+ * means the data set was not created and the resource manager can not be used.
+ */
+EXTERNAL fiftyoneDegreesStatusCode
+fiftyoneDegreesHashInitManagerFromMappedFile(
+	fiftyoneDegreesResourceManager *manager,
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	const char *fileName,
+	fiftyoneDegreesException *exception);
+
+/**
+ * Saves the flat graph of the data set held by the resource manager to the
+ * file so that other processes using the same data file and node options can
+ * map it with the sharedGraphFile configuration option rather than building
+ * their own. Only the flat graph is shared. Each process still loads its own
+ * data set with every other collection, the result cache and the tables, so
+ * the memory saved is that of the graph alone. The file is replaced atomically and its generation is
+ * incremented, so processes already using an earlier version can detect the
+ * change with #fiftyoneDegreesHashSharedGraphChanged and reload.
+ * @param manager the resource manager with a flat graph to save
+ * @param fileName the full path of the file to write
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return #FIFTYONE_DEGREES_STATUS_SUCCESS if the file was written, or
+ * #FIFTYONE_DEGREES_STATUS_INVALID_CONFIG if the data set does not have a
+ * flat graph
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesHashSaveSharedGraph(
+	fiftyoneDegreesResourceManager *manager,
+	const char *fileName,
+	fiftyoneDegreesException *exception);
+
+/**
+ * Determines if the shared graph file of the data set held by the resource
+ * manager has been saved again since the data set was loaded. If it has then
+ * the manager should be reloaded to use the new version. A data set which
+ * built its own graph because the file was missing or did not match is only
+ * reported as changed once the file is saved again.
+ * @param manager the resource manager to check
+ * @return true if the generation of the file differs from the one seen when
+ * the data set was loaded, otherwise false including when there is no shared
+ * graph file
+ */
+EXTERNAL bool fiftyoneDegreesHashSharedGraphChanged(
+	fiftyoneDegreesResourceManager *manager);
+
+/**
+ * Initialises a resource manager for each online NUMA node with a copy of the
+ * Hash data set held in memory bound to that node. Each replica uses the
+ * configuration with b.b.allInMemory enabled, mappedFile disabled and
+ * numaNode set to its node. On a machine with a single NUMA node there is
+ * one replica using the configuration as it is.
+ * @param replicas to initialise
+ * @param config configuration for the operation of the data set, or NULL if
+ * the in memory configuration is required
+ * @param properties the properties that will be consumed from the data set, or
+ * NULL if all available properties in the Hash data file should be available
+ * for consumption
+ * @param fileName the full path to a file with read permission that contains
+ * the Hash data set
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return the status associated with the data set resources. Any value other
+ * than #FIFTYONE_DEGREES_STATUS_SUCCESS means the replicas were not created
+ * and can not be used
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesHashReplicasInit(
+	fiftyoneDegreesHashReplicas *replicas,
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	const char *fileName,
+	fiftyoneDegreesException *exception);
+
+/**
+ * Gets the resource manager of the replica local to the CPU the calling
+ * thread is running on. Results should be created from this manager.
+ * @param replicas to get the local manager from
+ * @return the resource manager for the current NUMA node
+ */
+EXTERNAL fiftyoneDegreesResourceManager* fiftyoneDegreesHashReplicasGet(
+	fiftyoneDegreesHashReplicas *replicas);
+
+/**
+ * Reloads every replica from the data file location which was used when the
+ * replicas were created. Replicas reloaded before a failure keep the new data
+ * set.
+ * @param replicas to reload
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return the status associated with the reload. Any value other than
+ * #FIFTYONE_DEGREES_STATUS_SUCCESS means at least one replica was not
+ * reloaded
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesHashReplicasReload(
+	fiftyoneDegreesHashReplicas *replicas,
+	fiftyoneDegreesException *exception);
+
+/**
+ * Frees every replica. Data sets remain in memory until the last results
+ * which reference them are released.
+ * @param replicas to free
+ */
+EXTERNAL void fiftyoneDegreesHashReplicasFree(
+	fiftyoneDegreesHashReplicas *replicas);
+
+/**
+ * Writes a new Hash data file containing only the nodes of the graphs which
+ * are evaluated for the required properties. Only the nodes are trimmed. The
+ * strings, properties, values and profiles sections are copied unchanged, so
+ * the new data file still holds the values of every property. The new data
+ * file can be used in place of the source data file with the same required
+ * properties, or any subset of them, and the same graphs, returning the same
+ * results. The root nodes of components which have no required properties,
+ * and of graphs which are not retained, reference a node for the component
+ * which never matches. The nodes start with a marker, see
+ * #fiftyoneDegreesGraphTrim, so only data sets created from a trimmed file
+ * check the root nodes. Creating a data set from the new data file fails with
+ * #FIFTYONE_DEGREES_STATUS_REQ_PROP_NOT_PRESENT if a required property
+ * belongs to a component which was not retained, or with
+ * #FIFTYONE_DEGREES_STATUS_INVALID_CONFIG if a graph in use was not
+ * retained.
+ * @param config configuration with usePerformanceGraph and usePredictiveGraph
+ * set for the graphs to retain, or NULL if both graphs should be retained.
+ * The other options are not used.
+ * @param properties the properties that will be consumed from the new data
+ * file, or NULL if all available properties in the Hash data file should be
+ * retained
+ * @param sourceFileName the full path to a file with read permission that
+ * contains the Hash data set to trim
+ * @param destinationFileName the full path of the file to write
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return #FIFTYONE_DEGREES_STATUS_SUCCESS if the file was written, otherwise
+ * the status of the failure
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesHashTrimNodes(
+	fiftyoneDegreesConfigHash *config,
+	fiftyoneDegreesPropertiesRequired *properties,
+	const char *sourceFileName,
+	const char *destinationFileName,
+	fiftyoneDegreesException *exception);
+
 /**
  * Gets the total size in bytes which will be allocated when intialising a
  * Hash resource and associated manager with the same parameters. If any of
@@ -525,6 +1039,34 @@ EXTERNAL void fiftyoneDegreesResultsHashFromEvidence(
 	fiftyoneDegreesEvidenceKeyValuePairArray *evidence,
 	fiftyoneDegreesException *exception);
 
+/**
+ * Processes an array of evidence collections populating the corresponding
+ * results structure for each. The outcome for each evidence collection is
+ * identical to calling #fiftyoneDegreesResultsHashFromEvidence for it.
+ *
+ * The per data set work is shared across the batch and, for each component,
+ * the graphs are evaluated for every input in turn before moving to the next
+ * component. This keeps the nodes used by many inputs in the cache. Inputs are
+ * evaluated together in blocks of #FIFTYONE_DEGREES_HASH_BATCH_SIZE.
+ *
+ * Results which do not share the data set of the first results structure are
+ * processed individually.
+ *
+ * The arrays are validated before any input is processed. If any results or
+ * evidence entry is NULL then a NULL_POINTER exception is set and none of the
+ * results are modified.
+ * @param results array of count preallocated results structures to populate
+ * @param evidence array of count evidence collections to process
+ * @param count number of items in the results and evidence arrays
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ */
+EXTERNAL void fiftyoneDegreesResultsHashFromEvidenceBatch(
+	fiftyoneDegreesResultsHash **results,
+	fiftyoneDegreesEvidenceKeyValuePairArray **evidence,
+	uint32_t count,
+	fiftyoneDegreesException *exception);
+
 /**
  * Process a single User-Agent and populate the device offsets in the results
  * structure.
@@ -563,6 +1105,23 @@ EXTERNAL int fiftyoneDegreesResultsHashFromDeviceId(
 	size_t deviceIdLength,
 	fiftyoneDegreesException *exception);
 
+/**
+ * Process a single Device Id in the binary form returned by
+ * #fiftyoneDegreesHashGetDeviceIdBinaryFromResults and populate the device
+ * offsets in the results structure. Profile ids of zero are ignored.
+ * @param results preallocated results structure to populate
+ * @param profileIds profile ids of the device id
+ * @param count number of profile ids
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return number of profiles that were valid in the device id provided.
+ */
+EXTERNAL int fiftyoneDegreesResultsHashFromDeviceIdBinary(
+	fiftyoneDegreesResultsHash *results,
+	const uint32_t *profileIds,
+	uint32_t count,
+	fiftyoneDegreesException *exception);
+
 /**
  * Allocates a results structure containing a reference to the Hash data set
  * managed by the resource manager provided. The referenced data set will be
@@ -651,6 +1210,26 @@ EXTERNAL fiftyoneDegreesCollectionItem* fiftyoneDegreesResultsHashGetValues(
 	int requiredPropertyIndex,
 	fiftyoneDegreesException *exception);
 
+/**
+ * Gets the values associated in the results for the required property index
+ * from the value table without getting any items from collections. The value
+ * table must be enabled with the valueTable configuration option. The strings
+ * returned belong to the data set and remain valid for as long as the results
+ * hold a reference to it. Values which have been overridden in the results
+ * are not available from the table, so false is returned and
+ * fiftyoneDegreesResultsHashGetValues should be used instead.
+ * @param results pointer to the results to get the values for
+ * @param requiredPropertyIndex required property index of the values
+ * @param values pointer set to the first of the value strings
+ * @param count pointer set to the number of value strings
+ * @return true if the values were available from the table, otherwise false
+ */
+EXTERNAL bool fiftyoneDegreesResultsHashGetValuesFromTable(
+	fiftyoneDegreesResultsHash *results,
+	int requiredPropertyIndex,
+	const char * const **values,
+	uint32_t *count);
+
 /**
  * Sets the buffer the values associated in the results for the property name.
  * @param results pointer to the results structure to release
@@ -688,6 +1267,27 @@ EXTERNAL size_t fiftyoneDegreesResultsHashGetValuesJson(
 	size_t const length,
 	fiftyoneDegreesException* exception);
 
+/**
+ * Writes a JSON object that represents all the available properties and
+ * values in the results using the write method provided. Properties are
+ * written in the order of their required property indexes, each with the
+ * same values as fiftyoneDegreesResultsHashGetValues, and properties without
+ * values are omitted. Characters are buffered and passed to the write method
+ * in chunks, so the destination can grow as needed and the results never need
+ * to be written twice.
+ * @param results pointer to the results to write
+ * @param state pointer passed to the write method
+ * @param write method called with each chunk of characters
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return the number of characters passed to the write method
+ */
+EXTERNAL size_t fiftyoneDegreesResultsHashWriteValuesJson(
+	fiftyoneDegreesResultsHash* results,
+	void *state,
+	fiftyoneDegreesHashJsonWriteMethod write,
+	fiftyoneDegreesException* exception);
+
 /**
  * Sets the buffer the values associated in the results for the property name.
  * @param results pointer to the results structure to release
@@ -827,7 +1427,9 @@ EXTERNAL void fiftyoneDegreesDataSetHashRelease(
 
 /**
  * Iterates over the profiles in the data set calling the callback method for
- * any profiles that contain the property and value provided.
+ * any profiles that contain the property and value provided. If the
+ * profileValueIndex option is enabled then the profiles are found from the
+ * #fiftyoneDegreesHashProfileValueIndex, which is built on the first call.
  * @param manager the resource manager containing a hash data set initialised
  * by one of the Hash data set init methods
  * @param propertyName name of the property which the value relates to
@@ -846,6 +1448,39 @@ EXTERNAL uint32_t fiftyoneDegreesHashIterateProfilesForPropertyAndValue(
 	fiftyoneDegreesProfileIterateMethod callback,
 	fiftyoneDegreesException *exception);
 
+/**
+ * Iterates over the profiles in the data set calling the callback method for
+ * any profiles that contain all of the properties and values provided. As
+ * each profile relates to a single component, when the properties belong to
+ * different components the profiles of each component which contain all the
+ * values of that component's properties are iterated, one component after
+ * another in component order. If any of the components has no such profile
+ * then no profiles are iterated. Within a component the profiles are
+ * iterated in the order of their offsets. If the
+ * profileValueIndex option is enabled then the profiles are found by
+ * intersecting the profiles for each value from the
+ * #fiftyoneDegreesHashProfileValueIndex, otherwise every profile is checked.
+ * @param manager the resource manager containing a hash data set initialised
+ * by one of the Hash data set init methods
+ * @param propertyNames names of the properties which the values relate to
+ * @param valueNames names of the property values which the profiles must
+ * contain, in the same order as the property names
+ * @param count number of properties and values
+ * @param state pointer passed to the callback method
+ * @param callback method called when a matching profile is found
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h
+ * @return the number of matching profiles iterated over
+ */
+EXTERNAL uint32_t fiftyoneDegreesHashIterateProfilesForPropertiesAndValues(
+	fiftyoneDegreesResourceManager *manager,
+	const char **propertyNames,
+	const char **valueNames,
+	uint32_t count,
+	void *state,
+	fiftyoneDegreesProfileIterateMethod callback,
+	fiftyoneDegreesException *exception);
+
 /**
  * Get the device id string from the single result provided. This contains
  * profile ids for all components, concatenated with the separator character
@@ -881,6 +1516,26 @@ EXTERNAL char* fiftyoneDegreesHashGetDeviceIdFromResults(
 	size_t const length,
 	fiftyoneDegreesException *exception);
 
+/**
+ * Get the device id from the results provided in binary form. This is the
+ * profile id for each component in component index order, with zero where
+ * there is no profile, so it has the same profile ids as the device id
+ * string without needing to be formatted or parsed.
+ * @param results pointer to the results to get the device id of
+ * @param profileIds pointer to the memory to write the profile ids to
+ * @param count number of profile ids the memory can hold, which must be at
+ * least the number of components in the data set
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h
+ * @return the number of profile ids written, or zero if count is less than
+ * the number of components
+ */
+EXTERNAL uint32_t fiftyoneDegreesHashGetDeviceIdBinaryFromResults(
+	fiftyoneDegreesResultsHash *results,
+	uint32_t *profileIds,
+	uint32_t count,
+	fiftyoneDegreesException *exception);
+
 /**
  * @}
  */
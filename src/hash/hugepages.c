@@ -0,0 +1,250 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is the subject of the following patents and patent
+ * applications, owned by 51 Degrees Mobile Experts Limited of 5 Charlotte
+ * Close, Caversham, Reading, Berkshire, United Kingdom RG4 7BY:
+ * European Patent No. 3438848; and
+ * United States Patent No. 10,482,175.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#include "hugepages.h"
+#include "fiftyone.h"
+#ifndef _MSC_VER
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+/**
+ * Rounds the value up to a multiple of the size, which must be a power of
+ * two.
+ */
+static uintptr_t roundUp(uintptr_t value, uintptr_t size) {
+	return (value + size - 1) & ~(size - 1);
+}
+
+void fiftyoneDegreesHugePagesReset(fiftyoneDegreesHugePages *pages) {
+	pages->startByte = NULL;
+	pages->length = 0;
+	pages->allocated = 0;
+	pages->type = HUGE_PAGES_NONE;
+}
+
+fiftyoneDegreesHugePagesType fiftyoneDegreesHugePagesGetType(
+	fiftyoneDegreesHugePagesType type,
+	const byte *startByte,
+	size_t length) {
+	uintptr_t first, last;
+	switch (type) {
+	case HUGE_PAGES_EXPLICIT:
+		return length > 0 ? HUGE_PAGES_EXPLICIT : HUGE_PAGES_NONE;
+	case HUGE_PAGES_ADVISED:
+		first = roundUp((uintptr_t)startByte, HUGE_PAGE_SIZE);
+		last = ((uintptr_t)startByte + length) &
+			~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+		return last > first ? HUGE_PAGES_ADVISED : HUGE_PAGES_NONE;
+	default:
+		return HUGE_PAGES_NONE;
+	}
+}
+
+#ifdef _MSC_VER
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHugePagesAlloc(
+	fiftyoneDegreesHugePages *pages,
+	size_t length) {
+	SIZE_T minimum = GetLargePageMinimum();
+	HugePagesReset(pages);
+	if (length == 0) {
+		return INVALID_INPUT;
+	}
+
+	// Large pages need the lock pages in memory privilege, so will often not
+	// be available.
+	if (minimum > 0 && roundUp(length, minimum) >= length) {
+		pages->allocated = roundUp(length, minimum);
+		pages->startByte = (byte*)VirtualAlloc(
+			NULL,
+			pages->allocated,
+			MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+			PAGE_READWRITE);
+		pages->type = HUGE_PAGES_EXPLICIT;
+	}
+
+	// Windows does not have transparent huge pages, so use normal pages.
+	if (pages->startByte == NULL) {
+		return HugePagesAllocNormal(pages, length);
+	}
+	pages->length = length;
+	return SUCCESS;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHugePagesAllocNormal(
+	fiftyoneDegreesHugePages *pages,
+	size_t length) {
+	HugePagesReset(pages);
+	if (length == 0) {
+		return INVALID_INPUT;
+	}
+	pages->startByte = (byte*)VirtualAlloc(
+		NULL,
+		length,
+		MEM_RESERVE | MEM_COMMIT,
+		PAGE_READWRITE);
+	if (pages->startByte == NULL) {
+		return INSUFFICIENT_MEMORY;
+	}
+	pages->length = length;
+	pages->allocated = length;
+	return SUCCESS;
+}
+
+fiftyoneDegreesHugePagesType fiftyoneDegreesHugePagesAdvise(
+	byte *startByte,
+	size_t length) {
+	// There is no equivalent of transparent huge pages to advise.
+	(void)startByte;
+	(void)length;
+	return HUGE_PAGES_NONE;
+}
+
+void fiftyoneDegreesHugePagesFree(fiftyoneDegreesHugePages *pages) {
+	if (pages->startByte != NULL) {
+		VirtualFree(pages->startByte, 0, MEM_RELEASE);
+	}
+	HugePagesReset(pages);
+}
+
+#else
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHugePagesAlloc(
+	fiftyoneDegreesHugePages *pages,
+	size_t length) {
+	byte *startByte, *aligned;
+	size_t allocated = (size_t)roundUp(length, HUGE_PAGE_SIZE);
+	HugePagesReset(pages);
+	if (length == 0) {
+		return INVALID_INPUT;
+	}
+	if (allocated < length || allocated + HUGE_PAGE_SIZE < allocated) {
+		return INSUFFICIENT_MEMORY;
+	}
+
+#ifdef MAP_HUGETLB
+	// Use the huge pages reserved by the operating system if there are
+	// enough available.
+	startByte = (byte*)mmap(
+		NULL,
+		allocated,
+		PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+		-1,
+		0);
+	if (startByte != (byte*)MAP_FAILED) {
+		pages->startByte = startByte;
+		pages->length = length;
+		pages->allocated = allocated;
+		pages->type = HUGE_PAGES_EXPLICIT;
+		return SUCCESS;
+	}
+#endif
+
+	// Otherwise map an extra huge page of normal memory so the start can be
+	// aligned to a huge page, and unmap the unused memory either side.
+	startByte = (byte*)mmap(
+		NULL,
+		allocated + HUGE_PAGE_SIZE,
+		PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS,
+		-1,
+		0);
+	if (startByte == (byte*)MAP_FAILED) {
+		return INSUFFICIENT_MEMORY;
+	}
+	aligned = (byte*)roundUp((uintptr_t)startByte, HUGE_PAGE_SIZE);
+	if (aligned > startByte) {
+		munmap(startByte, (size_t)(aligned - startByte));
+	}
+	if (aligned < startByte + HUGE_PAGE_SIZE) {
+		munmap(
+			aligned + allocated,
+			(size_t)(startByte + HUGE_PAGE_SIZE - aligned));
+	}
+	pages->startByte = aligned;
+	pages->length = length;
+	pages->allocated = allocated;
+	pages->type = HugePagesAdvise(aligned, allocated);
+	return SUCCESS;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesHugePagesAllocNormal(
+	fiftyoneDegreesHugePages *pages,
+	size_t length) {
+	byte *startByte;
+	HugePagesReset(pages);
+	if (length == 0) {
+		return INVALID_INPUT;
+	}
+	startByte = (byte*)mmap(
+		NULL,
+		length,
+		PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS,
+		-1,
+		0);
+	if (startByte == (byte*)MAP_FAILED) {
+		return INSUFFICIENT_MEMORY;
+	}
+	pages->startByte = startByte;
+	pages->length = length;
+	pages->allocated = length;
+	return SUCCESS;
+}
+
+fiftyoneDegreesHugePagesType fiftyoneDegreesHugePagesAdvise(
+	byte *startByte,
+	size_t length) {
+#ifdef MADV_HUGEPAGE
+	// Only whole huge pages can be advised.
+	uintptr_t first = roundUp((uintptr_t)startByte, HUGE_PAGE_SIZE);
+	uintptr_t last = ((uintptr_t)startByte + length) &
+		~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+	if (last > first &&
+		madvise((void*)first, (size_t)(last - first), MADV_HUGEPAGE) == 0) {
+		return HUGE_PAGES_ADVISED;
+	}
+#else
+	(void)startByte;
+	(void)length;
+#endif
+	return HUGE_PAGES_NONE;
+}
+
+void fiftyoneDegreesHugePagesFree(fiftyoneDegreesHugePages *pages) {
+	if (pages->startByte != NULL) {
+		munmap(pages->startByte, pages->allocated);
+	}
+	HugePagesReset(pages);
+}
+
+#endif
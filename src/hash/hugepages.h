@@ -0,0 +1,183 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is the subject of the following patents and patent
+ * applications, owned by 51 Degrees Mobile Experts Limited of 5 Charlotte
+ * Close, Caversham, Reading, Berkshire, United Kingdom RG4 7BY:
+ * European Patent No. 3438848; and
+ * United States Patent No. 10,482,175.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#ifndef FIFTYONE_DEGREES_HUGE_PAGES_INCLUDED
+#define FIFTYONE_DEGREES_HUGE_PAGES_INCLUDED
+
+/**
+ * @ingroup FiftyOneDegreesHash
+ * @defgroup FiftyOneDegreesHugePages Huge Pages
+ *
+ * Memory backed by huge pages to reduce TLB misses.
+ *
+ * Detection reads from random positions in collections which are hundreds of
+ * megabytes in size. With normal 4KB pages almost every read needs a page
+ * table walk as the TLB can only describe a few megabytes of memory. A 2MB
+ * huge page needs a single TLB entry for 512 times as much memory.
+ *
+ * Memory is first requested from the huge pages reserved by the operating
+ * system (MAP_HUGETLB on Linux, or large pages on Windows). If there are none
+ * available then on Linux normal memory aligned to huge pages is advised to
+ * use transparent huge pages. The type of pages obtained is recorded so it
+ * can be reported. Advised memory is only backed by huge pages when the
+ * operating system has them free, so it is reported as advised rather than
+ * as backed by huge pages.
+ *
+ * For example:
+ * ```
+ * fiftyoneDegreesHugePages pages;
+ * if (fiftyoneDegreesHugePagesAlloc(&pages, length) ==
+ *     FIFTYONE_DEGREES_STATUS_SUCCESS) {
+ *     // Use up to length bytes from pages.startByte. pages.type indicates
+ *     // if the memory is backed by huge pages.
+ *     ...
+ *     fiftyoneDegreesHugePagesFree(&pages);
+ * }
+ * ```
+ *
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#include <windows.h>
+#pragma warning(pop)
+#endif
+#include "../common-cxx/common.h"
+#include "../common-cxx/data.h"
+#include "../common-cxx/status.h"
+
+/**
+ * Size of a huge page. Memory advised to use transparent huge pages is
+ * aligned to this size.
+ */
+#define FIFTYONE_DEGREES_HUGE_PAGE_SIZE 0x200000
+
+/**
+ * The type of pages which back an area of memory.
+ */
+typedef enum e_fiftyone_degrees_huge_pages_type {
+	FIFTYONE_DEGREES_HUGE_PAGES_NONE = 0, /**< Normal pages only */
+	FIFTYONE_DEGREES_HUGE_PAGES_ADVISED = 1, /**< Advised to use transparent
+											 huge pages, which the operating
+											 system uses when it can. The
+											 memory may still be backed by
+											 normal pages */
+	FIFTYONE_DEGREES_HUGE_PAGES_EXPLICIT = 2 /**< Huge pages reserved by the
+											 operating system */
+} fiftyoneDegreesHugePagesType;
+
+/**
+ * Memory allocated on huge pages where possible.
+ */
+typedef struct fiftyone_degrees_huge_pages_t {
+	byte *startByte; /**< First byte of the memory, or NULL if nothing is
+					 allocated */
+	size_t length; /**< Number of bytes requested */
+	size_t allocated; /**< Number of bytes allocated, which is rounded up to
+					  a whole number of pages */
+	fiftyoneDegreesHugePagesType type; /**< Type of pages obtained */
+} fiftyoneDegreesHugePages;
+
+/**
+ * Resets the pages so that they can be safely passed to
+ * fiftyoneDegreesHugePagesFree whether or not memory is later allocated.
+ * @param pages to reset
+ */
+EXTERNAL void fiftyoneDegreesHugePagesReset(fiftyoneDegreesHugePages *pages);
+
+/**
+ * Allocates readable and writable memory, using huge pages if the operating
+ * system can provide them. The memory is not tracked by the memory allocation
+ * functions in memory.h.
+ * @param pages to set the memory of
+ * @param length number of bytes needed
+ * @return the status of the allocation. Any value other than
+ * #FIFTYONE_DEGREES_STATUS_SUCCESS means no memory was allocated
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesHugePagesAlloc(
+	fiftyoneDegreesHugePages *pages,
+	size_t length);
+
+/**
+ * Allocates readable and writable memory on normal pages from the operating
+ * system rather than the heap. The memory starts on a page boundary and its
+ * pages are not allocated until they are first written, so it can be bound to
+ * a NUMA node before then. The memory is not tracked by the memory allocation
+ * functions in memory.h.
+ * @param pages to set the memory of
+ * @param length number of bytes needed
+ * @return the status of the allocation. Any value other than
+ * #FIFTYONE_DEGREES_STATUS_SUCCESS means no memory was allocated
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesHugePagesAllocNormal(
+	fiftyoneDegreesHugePages *pages,
+	size_t length);
+
+/**
+ * Advises the operating system to use transparent huge pages for memory that
+ * has already been allocated or mapped. Only whole huge pages within the
+ * memory can be affected.
+ * @param startByte first byte of the memory
+ * @param length number of bytes in the memory
+ * @return #FIFTYONE_DEGREES_HUGE_PAGES_ADVISED if the advice was accepted,
+ * otherwise #FIFTYONE_DEGREES_HUGE_PAGES_NONE
+ */
+EXTERNAL fiftyoneDegreesHugePagesType fiftyoneDegreesHugePagesAdvise(
+	byte *startByte,
+	size_t length);
+
+/**
+ * Gets the type of pages which back part of an area of memory. Advice to use
+ * transparent huge pages only applies to the part if it contains at least
+ * one whole huge page.
+ * @param type of pages backing the whole area of memory
+ * @param startByte first byte of the part
+ * @param length number of bytes in the part
+ * @return the type of pages backing at least some of the part
+ */
+EXTERNAL fiftyoneDegreesHugePagesType fiftyoneDegreesHugePagesGetType(
+	fiftyoneDegreesHugePagesType type,
+	const byte *startByte,
+	size_t length);
+
+/**
+ * Frees the memory if there is any.
+ * @param pages to free
+ */
+EXTERNAL void fiftyoneDegreesHugePagesFree(fiftyoneDegreesHugePages *pages);
+
+/**
+ * @}
+ */
+
+#endif
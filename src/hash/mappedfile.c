@@ -0,0 +1,252 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is the subject of the following patents and patent
+ * applications, owned by 51 Degrees Mobile Experts Limited of 5 Charlotte
+ * Close, Caversham, Reading, Berkshire, United Kingdom RG4 7BY:
+ * European Patent No. 3438848; and
+ * United States Patent No. 10,482,175.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#include "mappedfile.h"
+#include "fiftyone.h"
+#ifndef _MSC_VER
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(_MSC_VER) || !defined(MAP_POPULATE)
+
+/**
+ * Size of the smallest page the operating system might use. Reading a byte
+ * at this interval reads every page of the mapping.
+ */
+#define MAPPED_FILE_PAGE 4096
+
+/**
+ * Reads a byte from every page of the mapping so that the operating system
+ * reads the pages from the file now rather than when they are first used.
+ * The sum is returned so the reads are not removed by the compiler.
+ */
+static byte touchPages(const volatile byte *startByte, size_t length) {
+	size_t i;
+	byte sum = 0;
+	for (i = 0; i < length; i += MAPPED_FILE_PAGE) {
+		sum = (byte)(sum + startByte[i]);
+	}
+	return sum;
+}
+
+#endif
+
+#ifdef _MSC_VER
+
+size_t fiftyoneDegreesMappedFileDiscard(byte *startByte, size_t length) {
+	// Mapped views of files can't be discarded without unmapping them.
+	(void)startByte;
+	(void)length;
+	return 0;
+}
+
+static StatusCode getStatusFromError(DWORD error) {
+	switch (error) {
+	case ERROR_FILE_NOT_FOUND:
+	case ERROR_PATH_NOT_FOUND:
+		return FILE_NOT_FOUND;
+	case ERROR_ACCESS_DENIED:
+		return FILE_PERMISSION_DENIED;
+	case ERROR_NOT_ENOUGH_MEMORY:
+	case ERROR_OUTOFMEMORY:
+		return INSUFFICIENT_MEMORY;
+	default:
+		return FILE_FAILURE;
+	}
+}
+
+void fiftyoneDegreesMappedFileReset(fiftyoneDegreesMappedFile *mapped) {
+	mapped->startByte = NULL;
+	mapped->length = 0;
+	mapped->file = INVALID_HANDLE_VALUE;
+	mapped->mapping = NULL;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesMappedFileOpen(
+	fiftyoneDegreesMappedFile *mapped,
+	const char *fileName,
+	bool prefault) {
+	LARGE_INTEGER size;
+	StatusCode status = SUCCESS;
+	MappedFileReset(mapped);
+	mapped->file = CreateFileA(
+		fileName,
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_DELETE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL);
+	if (mapped->file == INVALID_HANDLE_VALUE) {
+		return getStatusFromError(GetLastError());
+	}
+	if (GetFileSizeEx(mapped->file, &size) == FALSE) {
+		status = getStatusFromError(GetLastError());
+	}
+	else if (size.QuadPart <= 0 || (uint64_t)size.QuadPart > SIZE_MAX) {
+		// An empty file can't be mapped, and is not a valid data file.
+		status = CORRUPT_DATA;
+	}
+	if (status == SUCCESS) {
+		mapped->mapping = CreateFileMappingA(
+			mapped->file,
+			NULL,
+			PAGE_READONLY,
+			0,
+			0,
+			NULL);
+		if (mapped->mapping == NULL) {
+			status = getStatusFromError(GetLastError());
+		}
+	}
+	if (status == SUCCESS) {
+		mapped->startByte = (byte*)MapViewOfFile(
+			mapped->mapping,
+			FILE_MAP_READ,
+			0,
+			0,
+			0);
+		if (mapped->startByte == NULL) {
+			status = getStatusFromError(GetLastError());
+		}
+	}
+	if (status != SUCCESS) {
+		MappedFileClose(mapped);
+		return status;
+	}
+	mapped->length = (size_t)size.QuadPart;
+	if (prefault) {
+		touchPages(mapped->startByte, mapped->length);
+	}
+	return status;
+}
+
+void fiftyoneDegreesMappedFileClose(fiftyoneDegreesMappedFile *mapped) {
+	if (mapped->startByte != NULL) {
+		UnmapViewOfFile(mapped->startByte);
+	}
+	if (mapped->mapping != NULL) {
+		CloseHandle(mapped->mapping);
+	}
+	if (mapped->file != INVALID_HANDLE_VALUE) {
+		CloseHandle(mapped->file);
+	}
+	MappedFileReset(mapped);
+}
+
+#else
+
+size_t fiftyoneDegreesMappedFileDiscard(byte *startByte, size_t length) {
+	uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t first = ((uintptr_t)startByte + page - 1) & ~(page - 1);
+	uintptr_t last = ((uintptr_t)startByte + length) & ~(page - 1);
+	if (last <= first ||
+		madvise((void*)first, (size_t)(last - first), MADV_DONTNEED) != 0) {
+		return 0;
+	}
+	return (size_t)(last - first);
+}
+
+static StatusCode getStatusFromError(int error) {
+	switch (error) {
+	case ENOENT:
+	case ENOTDIR:
+		return FILE_NOT_FOUND;
+	case EACCES:
+	case EPERM:
+		return FILE_PERMISSION_DENIED;
+	case ENOMEM:
+		return INSUFFICIENT_MEMORY;
+	default:
+		return FILE_FAILURE;
+	}
+}
+
+void fiftyoneDegreesMappedFileReset(fiftyoneDegreesMappedFile *mapped) {
+	mapped->startByte = NULL;
+	mapped->length = 0;
+}
+
+fiftyoneDegreesStatusCode fiftyoneDegreesMappedFileOpen(
+	fiftyoneDegreesMappedFile *mapped,
+	const char *fileName,
+	bool prefault) {
+	struct stat info;
+	void *startByte;
+	int flags = MAP_SHARED;
+	int file;
+	MappedFileReset(mapped);
+	file = open(fileName, O_RDONLY);
+	if (file < 0) {
+		return getStatusFromError(errno);
+	}
+	if (fstat(file, &info) != 0) {
+		close(file);
+		return getStatusFromError(errno);
+	}
+	if (info.st_size <= 0 || (uint64_t)info.st_size > SIZE_MAX) {
+		// An empty file can't be mapped, and is not a valid data file.
+		close(file);
+		return CORRUPT_DATA;
+	}
+#ifdef MAP_POPULATE
+	if (prefault) {
+		flags |= MAP_POPULATE;
+	}
+#endif
+	startByte = mmap(NULL, (size_t)info.st_size, PROT_READ, flags, file, 0);
+	// The mapping holds its own reference to the file.
+	close(file);
+	if (startByte == MAP_FAILED) {
+		return getStatusFromError(errno);
+	}
+	mapped->startByte = (byte*)startByte;
+	mapped->length = (size_t)info.st_size;
+#ifndef MAP_POPULATE
+	if (prefault) {
+		// Without MAP_POPULATE ask for the pages to be read ahead, and then
+		// wait for them by reading each one.
+		madvise(startByte, mapped->length, MADV_WILLNEED);
+		touchPages(mapped->startByte, mapped->length);
+	}
+#endif
+	return SUCCESS;
+}
+
+void fiftyoneDegreesMappedFileClose(fiftyoneDegreesMappedFile *mapped) {
+	if (mapped->startByte != NULL) {
+		munmap(mapped->startByte, mapped->length);
+	}
+	MappedFileReset(mapped);
+}
+
+#endif
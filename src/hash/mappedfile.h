@@ -0,0 +1,136 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is the subject of the following patents and patent
+ * applications, owned by 51 Degrees Mobile Experts Limited of 5 Charlotte
+ * Close, Caversham, Reading, Berkshire, United Kingdom RG4 7BY:
+ * European Patent No. 3438848; and
+ * United States Patent No. 10,482,175.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#ifndef FIFTYONE_DEGREES_MAPPED_FILE_INCLUDED
+#define FIFTYONE_DEGREES_MAPPED_FILE_INCLUDED
+
+/**
+ * @ingroup FiftyOneDegreesHash
+ * @defgroup FiftyOneDegreesMappedFile Mapped File
+ *
+ * Read only memory mapping of a data file.
+ *
+ * A data set initialised from a mapped file has collections which point into
+ * the mapping rather than into a copy of the file read into memory. The pages
+ * are read from the file by the operating system as they are first used, so
+ * initialisation does not wait for the whole file to be read, and the pages
+ * are shared with every other process which maps the same file.
+ *
+ * The pages can optionally be prefaulted when the file is mapped, so that the
+ * first detections do not wait for pages to be read from disk.
+ *
+ * For example:
+ * ```
+ * fiftyoneDegreesMappedFile mapped;
+ * fiftyoneDegreesMappedFileReset(&mapped);
+ * if (fiftyoneDegreesMappedFileOpen(&mapped, fileName, false) ==
+ *     FIFTYONE_DEGREES_STATUS_SUCCESS) {
+ *     // Read from mapped.startByte up to mapped.length bytes.
+ *     ...
+ *     fiftyoneDegreesMappedFileClose(&mapped);
+ * }
+ * ```
+ *
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#include <windows.h>
+#pragma warning(pop)
+#endif
+#include "../common-cxx/common.h"
+#include "../common-cxx/data.h"
+#include "../common-cxx/status.h"
+
+/**
+ * A read only mapping of the whole of a file.
+ */
+typedef struct fiftyone_degrees_mapped_file_t {
+	byte *startByte; /**< First byte of the mapping, or NULL if the file is
+					 not mapped */
+	size_t length; /**< Number of bytes in the mapping */
+#ifdef _MSC_VER
+	HANDLE file; /**< Handle to the file which is mapped */
+	HANDLE mapping; /**< Handle to the file mapping object */
+#endif
+} fiftyoneDegreesMappedFile;
+
+/**
+ * Resets the mapped file so that it can be safely passed to
+ * fiftyoneDegreesMappedFileClose whether or not it is later opened.
+ * @param mapped file to reset
+ */
+EXTERNAL void fiftyoneDegreesMappedFileReset(
+	fiftyoneDegreesMappedFile *mapped);
+
+/**
+ * Maps the whole of the file into memory read only.
+ * @param mapped file to set the mapping of
+ * @param fileName path to the file to map
+ * @param prefault true if every page of the file should be read before
+ * returning, rather than as each page is first used
+ * @return the status of the mapping. Any value other than
+ * #FIFTYONE_DEGREES_STATUS_SUCCESS means the file is not mapped
+ */
+EXTERNAL fiftyoneDegreesStatusCode fiftyoneDegreesMappedFileOpen(
+	fiftyoneDegreesMappedFile *mapped,
+	const char *fileName,
+	bool prefault);
+
+/**
+ * Removes the mapping of the file if there is one. Nothing can be read from
+ * the mapping once this has returned.
+ * @param mapped file to remove the mapping of
+ */
+EXTERNAL void fiftyoneDegreesMappedFileClose(
+	fiftyoneDegreesMappedFile *mapped);
+
+/**
+ * Releases the physical memory used by the whole pages within the memory
+ * provided, which must not be read again while it is mapped. Pages of a
+ * mapped file are read from the file again if they are used. Pages of other
+ * memory read as zero.
+ * @param startByte first byte of the memory
+ * @param length number of bytes in the memory
+ * @return number of bytes released, which is zero if the operating system
+ * does not support releasing memory this way
+ */
+EXTERNAL size_t fiftyoneDegreesMappedFileDiscard(
+	byte *startByte,
+	size_t length);
+
+/**
+ * @}
+ */
+
+#endif
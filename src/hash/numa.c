@@ -0,0 +1,202 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is the subject of the following patents and patent
+ * applications, owned by 51 Degrees Mobile Experts Limited of 5 Charlotte
+ * Close, Caversham, Reading, Berkshire, United Kingdom RG4 7BY:
+ * European Patent No. 3438848; and
+ * United States Patent No. 10,482,175.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// Needed for getcpu.
+#define _GNU_SOURCE
+#endif
+#include "numa.h"
+#include "fiftyone.h"
+#include <stdio.h>
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#include <windows.h>
+#pragma warning(pop)
+#elif defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+uint32_t fiftyoneDegreesNumaGetNodeCount() {
+	uint32_t nodes[NUMA_MAX_NODES];
+	return NumaGetNodes(nodes);
+}
+
+#ifdef _MSC_VER
+
+uint32_t fiftyoneDegreesNumaGetNodes(uint32_t *nodes) {
+	// Memory can't be bound to the other nodes, so only report one.
+	nodes[0] = 0;
+	return 1;
+}
+
+uint32_t fiftyoneDegreesNumaGetCurrentNode() {
+	PROCESSOR_NUMBER processor;
+	USHORT node;
+	GetCurrentProcessorNumberEx(&processor);
+	if (GetNumaProcessorNodeEx(&processor, &node) == FALSE ||
+		node >= NUMA_MAX_NODES) {
+		return 0;
+	}
+	return (uint32_t)node;
+}
+
+bool fiftyoneDegreesNumaBind(
+	byte *startByte,
+	size_t length,
+	uint32_t node) {
+	// Memory can only be placed on a node when it is allocated with
+	// VirtualAllocExNuma.
+	(void)startByte;
+	(void)length;
+	(void)node;
+	return false;
+}
+
+#elif defined(__linux__)
+
+/**
+ * File listing the online NUMA nodes.
+ */
+#define NUMA_ONLINE_FILE "/sys/devices/system/node/online"
+
+#ifndef MPOL_BIND
+#define MPOL_BIND 2 /**< Memory policy which only uses the nodes in the mask */
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1) /**< Move pages already on other nodes */
+#endif
+
+/**
+ * Number of bits in each element of a node mask.
+ */
+#define NUMA_MASK_BITS (8 * sizeof(unsigned long))
+
+uint32_t fiftyoneDegreesNumaGetNodes(uint32_t *nodes) {
+	unsigned int first, last, node;
+	uint32_t count = 0;
+	int read;
+	FILE *file = fopen(NUMA_ONLINE_FILE, "r");
+	if (file != NULL) {
+		// The file contains the ranges of online nodes, such as "0-1" or
+		// "0,2-3".
+		while ((read = fscanf(file, "%u-%u", &first, &last)) > 0) {
+			if (read == 1) {
+				last = first;
+			}
+			for (node = first;
+				node <= last &&
+				node < NUMA_MAX_NODES &&
+				count < NUMA_MAX_NODES;
+				node++) {
+				nodes[count++] = (uint32_t)node;
+			}
+			if (fgetc(file) != ',') {
+				break;
+			}
+		}
+		fclose(file);
+	}
+	if (count == 0) {
+		nodes[count++] = 0;
+	}
+	return count;
+}
+
+uint32_t fiftyoneDegreesNumaGetCurrentNode() {
+	unsigned int cpu, node;
+#if defined(__GLIBC__) && \
+	(__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+	// The glibc wrapper uses the vDSO so does not enter the kernel.
+	if (getcpu(&cpu, &node) != 0) {
+		return 0;
+	}
+#else
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+		return 0;
+	}
+#endif
+	return node < NUMA_MAX_NODES ? (uint32_t)node : 0;
+}
+
+bool fiftyoneDegreesNumaBind(
+	byte *startByte,
+	size_t length,
+	uint32_t node) {
+#ifdef SYS_mbind
+	unsigned long mask[NUMA_MAX_NODES / NUMA_MASK_BITS] = { 0 };
+	uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t first = ((uintptr_t)startByte + page - 1) & ~(page - 1);
+	uintptr_t last = ((uintptr_t)startByte + length) & ~(page - 1);
+	if (node >= NUMA_MAX_NODES) {
+		return false;
+	}
+	if (last <= first) {
+		return true;
+	}
+	mask[node / NUMA_MASK_BITS] = 1UL << (node % NUMA_MASK_BITS);
+	return syscall(
+		SYS_mbind,
+		first,
+		(unsigned long)(last - first),
+		MPOL_BIND,
+		mask,
+		(unsigned long)NUMA_MAX_NODES + 1,
+		MPOL_MF_MOVE) == 0;
+#else
+	(void)startByte;
+	(void)length;
+	(void)node;
+	return false;
+#endif
+}
+
+#else
+
+uint32_t fiftyoneDegreesNumaGetNodes(uint32_t *nodes) {
+	nodes[0] = 0;
+	return 1;
+}
+
+uint32_t fiftyoneDegreesNumaGetCurrentNode() {
+	return 0;
+}
+
+bool fiftyoneDegreesNumaBind(
+	byte *startByte,
+	size_t length,
+	uint32_t node) {
+	(void)startByte;
+	(void)length;
+	(void)node;
+	return false;
+}
+
+#endif
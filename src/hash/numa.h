@@ -0,0 +1,105 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is the subject of the following patents and patent
+ * applications, owned by 51 Degrees Mobile Experts Limited of 5 Charlotte
+ * Close, Caversham, Reading, Berkshire, United Kingdom RG4 7BY:
+ * European Patent No. 3438848; and
+ * United States Patent No. 10,482,175.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#ifndef FIFTYONE_DEGREES_NUMA_INCLUDED
+#define FIFTYONE_DEGREES_NUMA_INCLUDED
+
+/**
+ * @ingroup FiftyOneDegreesHash
+ * @defgroup FiftyOneDegreesNuma NUMA
+ *
+ * Placement of memory on NUMA nodes.
+ *
+ * On a machine with more than one NUMA node, memory is local to one node and
+ * reading it from a CPU on another node takes longer. Memory which is read on
+ * every detection can be copied once per node and bound to it, so that each
+ * thread reads the copy local to the CPU it is running on.
+ *
+ * Binding is implemented with the mbind system call directly, so libnuma is
+ * not needed. On other platforms, and on machines with a single node, there
+ * is one node and binding has no effect.
+ *
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../common-cxx/common.h"
+#include "../common-cxx/data.h"
+
+/**
+ * Maximum number of NUMA nodes which memory can be bound to.
+ */
+#define FIFTYONE_DEGREES_NUMA_MAX_NODES 64
+
+/**
+ * Gets the number of NUMA nodes which are online. Node numbers are not always
+ * contiguous, see #fiftyoneDegreesNumaGetNodes.
+ * @return number of NUMA nodes, which is at least 1
+ */
+EXTERNAL uint32_t fiftyoneDegreesNumaGetNodeCount();
+
+/**
+ * Gets the numbers of the NUMA nodes which are online in ascending order.
+ * Nodes can be offline, so the numbers may have gaps such as 0 and 2. On
+ * Windows memory can't be bound to a node after it is allocated, so a single
+ * node 0 is returned.
+ * @param nodes array of #FIFTYONE_DEGREES_NUMA_MAX_NODES elements to set the
+ * node numbers in
+ * @return number of node numbers set, which is at least 1
+ */
+EXTERNAL uint32_t fiftyoneDegreesNumaGetNodes(uint32_t *nodes);
+
+/**
+ * Gets the NUMA node of the CPU the calling thread is running on. The thread
+ * may move to another CPU at any time, so this is only a hint.
+ * @return the node number, or 0 if it can't be determined
+ */
+EXTERNAL uint32_t fiftyoneDegreesNumaGetCurrentNode();
+
+/**
+ * Binds the memory to the NUMA node, moving any pages which are already on
+ * another node. Only whole pages within the memory are bound, so memory which
+ * does not contain a whole page has nothing to bind.
+ * @param startByte first byte of the memory
+ * @param length number of bytes in the memory
+ * @param node to bind the memory to
+ * @return true if the memory was bound or has nothing to bind, otherwise
+ * false and the memory is unchanged
+ */
+EXTERNAL bool fiftyoneDegreesNumaBind(
+	byte *startByte,
+	size_t length,
+	uint32_t node);
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,274 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is the subject of the following patents and patent
+ * applications, owned by 51 Degrees Mobile Experts Limited of 5 Charlotte
+ * Close, Caversham, Reading, Berkshire, United Kingdom RG4 7BY:
+ * European Patent No. 3438848; and
+ * United States Patent No. 10,482,175.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#include "resultcache.h"
+#include "fiftyone.h"
+#include <limits.h>
+#include <string.h>
+
+/**
+ * Values used to initialise and mix the two hashes of a fingerprint. The
+ * first hash uses the FNV-1a offset basis and prime applied to 64 bit words,
+ * and the second uses the golden ratio constants so that the two are
+ * independent.
+ */
+#define FIRST_BASIS 0xcbf29ce484222325ULL
+#define FIRST_PRIME 0x00000100000001b3ULL
+#define SECOND_BASIS 0x9e3779b97f4a7c15ULL
+#define SECOND_PRIME 0xbf58476d1ce4e5b9ULL
+
+/**
+ * Full memory barrier used to order the reads and writes of an entry with the
+ * reads and writes of its version.
+ */
+#ifndef FIFTYONE_DEGREES_NO_THREADING
+#ifdef _MSC_VER
+#define RESULT_CACHE_BARRIER() MemoryBarrier()
+#else
+#define RESULT_CACHE_BARRIER() __sync_synchronize()
+#endif
+#else
+#define RESULT_CACHE_BARRIER()
+#endif
+
+/**
+ * Header of each entry in the table. The data for the entry immediately
+ * follows the header.
+ */
+typedef struct result_cache_entry_t {
+	volatile long version; /* Odd while the entry is being written */
+	uint64_t first; /* First hash of the fingerprint */
+	uint64_t second; /* Second hash of the fingerprint */
+	uint64_t length; /* Length of the fingerprint */
+} resultCacheEntry;
+
+static void mixWord(ResultCacheFingerprint *fingerprint, uint64_t word) {
+	fingerprint->first = (fingerprint->first ^ word) * FIRST_PRIME;
+	fingerprint->first ^= fingerprint->first >> 29;
+	fingerprint->second = (fingerprint->second + word) * SECOND_PRIME;
+	fingerprint->second ^= fingerprint->second >> 31;
+}
+
+static uint32_t getIndex(
+	const ResultCache *cache,
+	const ResultCacheFingerprint *fingerprint) {
+	return (uint32_t)(fingerprint->first ^
+		(fingerprint->first >> 32)) & (cache->capacity - 1);
+}
+
+static resultCacheEntry* getEntry(ResultCache *cache, uint32_t index) {
+	return (resultCacheEntry*)(cache->entries +
+		((size_t)index * cache->entrySize));
+}
+
+/**
+ * Returns the value which follows the one provided. The value wraps to zero
+ * rather than overflowing and so always remains positive.
+ */
+static long getNext(long value) {
+	return (long)(((unsigned long)value + 1) & LONG_MAX);
+}
+
+fiftyoneDegreesResultCache* fiftyoneDegreesResultCacheCreate(
+	uint32_t capacity,
+	uint32_t dataSize,
+	fiftyoneDegreesException *exception) {
+	ResultCache *cache;
+	uint32_t entries = 1;
+
+	// Round the capacity up to a power of two so the position of an entry can
+	// be found from the fingerprint with a mask.
+	while (entries < capacity && entries <= (UINT32_MAX >> 1)) {
+		entries <<= 1;
+	}
+
+	cache = (ResultCache*)Malloc(sizeof(ResultCache));
+	if (cache == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		return NULL;
+	}
+	cache->capacity = entries;
+	cache->dataSize = dataSize;
+	cache->entrySize = (uint32_t)(
+		(sizeof(resultCacheEntry) + dataSize + 7) & ~((size_t)7));
+	cache->counters = (ResultCacheCounter*)MallocAligned(
+		64,
+		sizeof(ResultCacheCounter) * FIFTYONE_DEGREES_RESULT_CACHE_COUNTERS);
+	if (cache->counters == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		Free(cache);
+		return NULL;
+	}
+	memset(
+		cache->counters,
+		0,
+		sizeof(ResultCacheCounter) * FIFTYONE_DEGREES_RESULT_CACHE_COUNTERS);
+	cache->entries = (byte*)MallocAligned(
+		64,
+		(size_t)cache->capacity * cache->entrySize);
+	if (cache->entries == NULL) {
+		EXCEPTION_SET(INSUFFICIENT_MEMORY);
+		FreeAligned(cache->counters);
+		Free(cache);
+		return NULL;
+	}
+
+	// An entry with a version and fingerprint of zero is empty as no
+	// fingerprint has a length of zero once initialised and added to.
+	memset(cache->entries, 0, (size_t)cache->capacity * cache->entrySize);
+	return cache;
+}
+
+void fiftyoneDegreesResultCacheFree(fiftyoneDegreesResultCache *cache) {
+	FreeAligned(cache->entries);
+	FreeAligned(cache->counters);
+	Free(cache);
+}
+
+void fiftyoneDegreesResultCacheFingerprintInit(
+	fiftyoneDegreesResultCacheFingerprint *fingerprint) {
+	fingerprint->first = FIRST_BASIS;
+	fingerprint->second = SECOND_BASIS;
+	fingerprint->length = 0;
+}
+
+void fiftyoneDegreesResultCacheFingerprintAdd(
+	fiftyoneDegreesResultCacheFingerprint *fingerprint,
+	const void *bytes,
+	size_t length) {
+	uint64_t word;
+	const byte *current = (const byte*)bytes;
+	const byte *end = current + length;
+	while (current + sizeof(word) <= end) {
+		memcpy(&word, current, sizeof(word));
+		mixWord(fingerprint, word);
+		current += sizeof(word);
+	}
+	if (current < end) {
+		word = 0;
+		memcpy(&word, current, (size_t)(end - current));
+		mixWord(fingerprint, word);
+	}
+	fingerprint->length += length;
+}
+
+bool fiftyoneDegreesResultCacheGet(
+	fiftyoneDegreesResultCache *cache,
+	const fiftyoneDegreesResultCacheFingerprint *fingerprint,
+	void *data) {
+	bool found = false;
+	const uint32_t index = getIndex(cache, fingerprint);
+	resultCacheEntry *entry = getEntry(cache, index);
+	ResultCacheCounter *counter = &cache->counters[
+		index & (FIFTYONE_DEGREES_RESULT_CACHE_COUNTERS - 1)];
+	long version = entry->version;
+	RESULT_CACHE_BARRIER();
+	if ((version & 1) == 0 &&
+		entry->first == fingerprint->first &&
+		entry->second == fingerprint->second &&
+		entry->length == fingerprint->length) {
+
+		// A writer might change the entry while it is being copied. The
+		// version will then have changed and the copy is discarded.
+		memcpy(data, entry + 1, cache->dataSize);
+		RESULT_CACHE_BARRIER();
+		found = entry->version == version;
+	}
+#ifndef FIFTYONE_DEGREES_NO_THREADING
+	if (found) {
+		FIFTYONE_DEGREES_INTERLOCK_INC(&counter->hits);
+	}
+	else {
+		FIFTYONE_DEGREES_INTERLOCK_INC(&counter->misses);
+	}
+#else
+	if (found) {
+		counter->hits = getNext(counter->hits);
+	}
+	else {
+		counter->misses = getNext(counter->misses);
+	}
+#endif
+	return found;
+}
+
+void fiftyoneDegreesResultCachePut(
+	fiftyoneDegreesResultCache *cache,
+	const fiftyoneDegreesResultCacheFingerprint *fingerprint,
+	const void *data) {
+	resultCacheEntry *entry = getEntry(cache, getIndex(cache, fingerprint));
+	long version = entry->version;
+	long writing = getNext(version);
+	if ((version & 1) != 0) {
+		// Another thread is writing the entry.
+		return;
+	}
+#ifndef FIFTYONE_DEGREES_NO_THREADING
+	if (FIFTYONE_DEGREES_INTERLOCK_EXCHANGE(
+		entry->version,
+		writing,
+		version) != version) {
+		// Another thread started writing the entry first.
+		return;
+	}
+#else
+	entry->version = writing;
+#endif
+	entry->first = fingerprint->first;
+	entry->second = fingerprint->second;
+	entry->length = fingerprint->length;
+	memcpy(entry + 1, data, cache->dataSize);
+#ifndef FIFTYONE_DEGREES_NO_THREADING
+	FIFTYONE_DEGREES_INTERLOCK_EXCHANGE(
+		entry->version,
+		getNext(writing),
+		writing);
+#else
+	entry->version = getNext(writing);
+#endif
+}
+
+long fiftyoneDegreesResultCacheGetHits(
+	const fiftyoneDegreesResultCache *cache) {
+	uint32_t i;
+	unsigned long hits = 0;
+	for (i = 0; i < FIFTYONE_DEGREES_RESULT_CACHE_COUNTERS; i++) {
+		hits += (unsigned long)cache->counters[i].hits;
+	}
+	return (long)(hits & LONG_MAX);
+}
+
+long fiftyoneDegreesResultCacheGetMisses(
+	const fiftyoneDegreesResultCache *cache) {
+	uint32_t i;
+	unsigned long misses = 0;
+	for (i = 0; i < FIFTYONE_DEGREES_RESULT_CACHE_COUNTERS; i++) {
+		misses += (unsigned long)cache->counters[i].misses;
+	}
+	return (long)(misses & LONG_MAX);
+}
@@ -0,0 +1,230 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is the subject of the following patents and patent
+ * applications, owned by 51 Degrees Mobile Experts Limited of 5 Charlotte
+ * Close, Caversham, Reading, Berkshire, United Kingdom RG4 7BY:
+ * European Patent No. 3438848; and
+ * United States Patent No. 10,482,175.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#ifndef FIFTYONE_DEGREES_RESULT_CACHE_INCLUDED
+#define FIFTYONE_DEGREES_RESULT_CACHE_INCLUDED
+
+/**
+ * @ingroup FiftyOneDegreesHash
+ * @defgroup FiftyOneDegreesResultCache Result Cache
+ *
+ * Bounded cache of detection results keyed on a fingerprint of the evidence
+ * used to produce them.
+ *
+ * The cache is a table of fixed size entries shared by all threads. The
+ * position of an entry in the table is taken from its fingerprint, and a new
+ * entry replaces whatever entry was previously at that position. Each entry
+ * holds a version which is odd while the entry is being written. Readers copy
+ * the entry and then check the version has not changed, so never wait for a
+ * writer or for each other. A writer which finds the entry already being
+ * written leaves it alone rather than waiting.
+ *
+ * The hit and miss counts are spread over
+ * #FIFTYONE_DEGREES_RESULT_CACHE_COUNTERS counters, each on its own cache
+ * line, chosen from the position of the entry. Threads looking up different
+ * entries therefore rarely update the same cache line. The counts are summed
+ * when they are read.
+ *
+ * A fingerprint is made of two independent 64 bit hashes so that the chance
+ * of two different sets of evidence sharing a fingerprint is negligible. The
+ * evidence itself is not stored.
+ *
+ * For example:
+ * ```
+ * // Declarations (not set in this example block).
+ * fiftyoneDegreesResultCache *cache;
+ * const char *value;
+ * size_t valueLength;
+ * byte data[DATA_SIZE];
+ *
+ * // Get the fingerprint for the value.
+ * fiftyoneDegreesResultCacheFingerprint fingerprint;
+ * fiftyoneDegreesResultCacheFingerprintInit(&fingerprint);
+ * fiftyoneDegreesResultCacheFingerprintAdd(&fingerprint, value, valueLength);
+ *
+ * if (fiftyoneDegreesResultCacheGet(cache, &fingerprint, data) == false) {
+ *     // Not in the cache, so work out the data and add it.
+ *     ...
+ *     fiftyoneDegreesResultCachePut(cache, &fingerprint, data);
+ * }
+ * ```
+ *
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#include <windows.h>
+#pragma warning(pop)
+#endif
+#include "../common-cxx/common.h"
+#include "../common-cxx/data.h"
+#include "../common-cxx/exceptions.h"
+#include "../common-cxx/threading.h"
+
+/**
+ * Number of hit and miss counters. Must be a power of two.
+ */
+#ifndef FIFTYONE_DEGREES_RESULT_CACHE_COUNTERS
+#define FIFTYONE_DEGREES_RESULT_CACHE_COUNTERS 16
+#endif
+
+/**
+ * Fingerprint of the evidence used as the key for an entry in the cache.
+ */
+typedef struct fiftyone_degrees_result_cache_fingerprint_t {
+	uint64_t first; /**< First hash of the evidence */
+	uint64_t second; /**< Second hash of the evidence, independent of the
+					 first */
+	uint64_t length; /**< Total number of bytes added */
+} fiftyoneDegreesResultCacheFingerprint;
+
+/**
+ * Hit and miss counts for the entries whose position selects the counter.
+ * Padded to the size of a cache line so that each counter is updated without
+ * contention from threads using the other counters.
+ */
+typedef struct fiftyone_degrees_result_cache_counter_t {
+	volatile long hits; /**< Number of times data was returned from the
+						cache. Wraps at the maximum value of long */
+	volatile long misses; /**< Number of times data was not found in the
+						  cache. Wraps at the maximum value of long */
+	byte padding[64 - (2 * sizeof(long))]; /**< Fills the cache line */
+} fiftyoneDegreesResultCacheCounter;
+
+/**
+ * Table of cached results. The table is allocated as a single block of memory
+ * containing capacity entries each of entrySize bytes.
+ */
+typedef struct fiftyone_degrees_result_cache_t {
+	byte *entries; /**< Pointer to the first entry in the table */
+	uint32_t capacity; /**< Number of entries in the table. Always a power of
+					   two */
+	uint32_t dataSize; /**< Number of bytes of data held in each entry */
+	uint32_t entrySize; /**< Number of bytes used by each entry including the
+						version and fingerprint */
+	fiftyoneDegreesResultCacheCounter *counters; /**< Hit and miss counters
+												 aligned to cache lines */
+} fiftyoneDegreesResultCache;
+
+/**
+ * Creates a new cache able to hold at least capacity entries of dataSize
+ * bytes. The capacity is rounded up to the next power of two.
+ * @param capacity minimum number of entries the cache should hold
+ * @param dataSize number of bytes of data in each entry
+ * @param exception pointer to an exception data structure to be used if an
+ * exception occurs. See exceptions.h.
+ * @return a new cache to be freed with fiftyoneDegreesResultCacheFree, or NULL
+ * if the cache could not be created
+ */
+EXTERNAL fiftyoneDegreesResultCache* fiftyoneDegreesResultCacheCreate(
+	uint32_t capacity,
+	uint32_t dataSize,
+	fiftyoneDegreesException *exception);
+
+/**
+ * Frees the cache and all the entries in it.
+ * @param cache to free
+ */
+EXTERNAL void fiftyoneDegreesResultCacheFree(
+	fiftyoneDegreesResultCache *cache);
+
+/**
+ * Initialises the fingerprint ready for bytes to be added.
+ * @param fingerprint to initialise
+ */
+EXTERNAL void fiftyoneDegreesResultCacheFingerprintInit(
+	fiftyoneDegreesResultCacheFingerprint *fingerprint);
+
+/**
+ * Adds the bytes to the fingerprint. The same bytes added by the same
+ * sequence of calls always result in the same fingerprint.
+ * @param fingerprint to add the bytes to
+ * @param bytes pointer to the first byte to add
+ * @param length number of bytes to add
+ */
+EXTERNAL void fiftyoneDegreesResultCacheFingerprintAdd(
+	fiftyoneDegreesResultCacheFingerprint *fingerprint,
+	const void *bytes,
+	size_t length);
+
+/**
+ * Copies the data for the fingerprint from the cache if present, and updates
+ * the hit or miss count.
+ * @param cache to get the data from
+ * @param fingerprint of the evidence the data relates to
+ * @param data memory of at least dataSize bytes to copy the data into. The
+ * content is undefined if false is returned
+ * @return true if the data was found and copied, otherwise false
+ */
+EXTERNAL bool fiftyoneDegreesResultCacheGet(
+	fiftyoneDegreesResultCache *cache,
+	const fiftyoneDegreesResultCacheFingerprint *fingerprint,
+	void *data);
+
+/**
+ * Adds the data for the fingerprint to the cache, replacing any entry already
+ * at the same position. If another thread is writing to the same position the
+ * data is not added.
+ * @param cache to add the data to
+ * @param fingerprint of the evidence the data relates to
+ * @param data pointer to dataSize bytes to add
+ */
+EXTERNAL void fiftyoneDegreesResultCachePut(
+	fiftyoneDegreesResultCache *cache,
+	const fiftyoneDegreesResultCacheFingerprint *fingerprint,
+	const void *data);
+
+/**
+ * Gets the number of times data was found in the cache. The counters are
+ * read without synchronisation so the value may not include lookups in
+ * progress on other threads.
+ * @param cache to get the count from
+ * @return number of hits
+ */
+EXTERNAL long fiftyoneDegreesResultCacheGetHits(
+	const fiftyoneDegreesResultCache *cache);
+
+/**
+ * Gets the number of times data was not found in the cache. The counters are
+ * read without synchronisation so the value may not include lookups in
+ * progress on other threads.
+ * @param cache to get the count from
+ * @return number of misses
+ */
+EXTERNAL long fiftyoneDegreesResultCacheGetMisses(
+	const fiftyoneDegreesResultCache *cache);
+
+/**
+ * @}
+ */
+
+#endif
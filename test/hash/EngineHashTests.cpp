@@ -222,7 +222,92 @@ public:
 		verifyPerformanceGraph();
 		verifyPredictiveGraph();
 		verifyMatchForLowerPrecedence();
+		verifyProcessBatch();
+		verifyValueView();
 	}
+
+	/**
+	 * Check that processing evidence as a batch returns results which are the
+	 * same as processing each evidence instance individually, including when
+	 * the batch is larger than the number of inputs evaluated together.
+	 */
+	void verifyProcessBatch() {
+		size_t i;
+		vector<EvidenceDeviceDetection*> evidence;
+		const char *fixed[] = {
+			mobileUserAgent,
+			desktopUserAgent,
+			mediaHubUserAgent,
+			operaUserAgent,
+			badUserAgent };
+		for (i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++) {
+			evidence.push_back(new EvidenceDeviceDetection());
+			(*evidence.back())["header.user-agent"] = fixed[i];
+		}
+		evidence.push_back(new EvidenceDeviceDetection());
+		(*evidence.back())["query.51D_deviceId"] =
+			getDeviceId(mediaHubUserAgent);
+		for (i = 0; 
+			i < userAgents.size() && 
+			evidence.size() < 3 * FIFTYONE_DEGREES_HASH_BATCH_SIZE; 
+			i++) {
+			evidence.push_back(new EvidenceDeviceDetection());
+			(*evidence.back())["header.user-agent"] = userAgents[i];
+		}
+
+		vector<ResultsHash*> batch = engine->processBatch(evidence);
+		ASSERT_EQ(evidence.size(), batch.size());
+		for (i = 0; i < evidence.size(); i++) {
+			std::unique_ptr<ResultsHash> const single(
+				engine->process(evidence[i]));
+			EXPECT_EQ(single->getDeviceId(), batch[i]->getDeviceId()) <<
+				"Batch result '" << i << "' differs from the single result.";
+			EXPECT_EQ(single->getDifference(), batch[i]->getDifference());
+			EXPECT_EQ(single->getDrift(), batch[i]->getDrift());
+			EXPECT_EQ(single->getIterations(), batch[i]->getIterations());
+			EXPECT_EQ(single->getMethod(), batch[i]->getMethod());
+			delete batch[i];
+			delete evidence[i];
+		}
+	}
+	/**
+	 * Check that the value views returned for each property are the same as
+	 * the values copied into strings.
+	 */
+	void verifyValueView() {
+		size_t i, v;
+		int p;
+		vector<std::string_view> views;
+		const char *fixed[] = {
+			mobileUserAgent,
+			desktopUserAgent,
+			mediaHubUserAgent,
+			badUserAgent };
+		for (i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++) {
+			std::unique_ptr<ResultsHash> const results(
+				engine->process(fixed[i]));
+			for (p = 0; p < results->getAvailableProperties(); p++) {
+				if (p == results->_jsHardwareProfileRequiredIndex) {
+					continue;
+				}
+				bool hasViews = results->getValueView(p, views);
+				Value<vector<string>> values = results->getValues(p);
+				ASSERT_EQ(values.hasValue() && (*values).empty() == false,
+					hasViews) << "Property '" <<
+					results->getPropertyName(p) << "' differs.";
+				if (hasViews) {
+					vector<string> copied = *values;
+					ASSERT_EQ(copied.size(), views.size());
+					for (v = 0; v < views.size(); v++) {
+						EXPECT_EQ(copied[v], string(views[v]));
+					}
+				}
+			}
+			EXPECT_FALSE(results->getValueView(-1, views));
+			EXPECT_TRUE(views.empty());
+		}
+	}
+
 	void verifyNoMatchedNodes() {
 		int i;
 		vector<string>::iterator it;
@@ -0,0 +1,63 @@
+/* *********************************************************************
+ * This Original Work is copyright of 51 Degrees Mobile Experts Limited.
+ * Copyright 2026 51 Degrees Mobile Experts Limited, Davidson House,
+ * Forbury Square, Reading, Berkshire, United Kingdom RG1 3EU.
+ *
+ * This Original Work is licensed under the European Union Public Licence
+ * (EUPL) v.1.2 and is subject to its terms as set out below.
+ *
+ * If a copy of the EUPL was not distributed with this file, You can obtain
+ * one at https://opensource.org/licenses/EUPL-1.2.
+ *
+ * The 'Compatible Licences' set out in the Appendix to the EUPL (as may be
+ * amended by the European Commission) shall be deemed incompatible for
+ * the purposes of the Work and the provisions of the compatibility
+ * clause in Article 5 of the EUPL shall not apply.
+ *
+ * If using the Work as, or as part of, a network application, by
+ * including the attribution notice(s) required under Article 5 of the EUPL
+ * in the end user terms of the application under an appropriate heading,
+ * such notice(s) shall fulfill the requirements of that article.
+ * ********************************************************************* */
+
+#include "ExampleHashTests.hpp"
+#include "../../examples/C/Hash/TrimDataFile.c"
+
+
+class ExampleTestHashTrimDataFile : public ExampleHashTest {
+public:
+	void run(fiftyoneDegreesConfigHash config) {
+		EXCEPTION_CREATE;
+		ResourceManager manager;
+		PropertiesRequired properties = PropertiesDefault;
+		properties.string = "IsMobile";
+		string trimmedFilePath = dataFilePath + ".trimmed";
+
+		// Capture stdout for the test.
+		testing::internal::CaptureStdout();
+
+		// Write the trimmed data file.
+		StatusCode status = fiftyoneDegreesTrimDataFileRun(
+			dataFilePath.c_str(),
+			trimmedFilePath.c_str(),
+			"IsMobile",
+			&config);
+		testing::internal::GetCapturedStdout();
+		ASSERT_EQ(SUCCESS, status) << "Trimmed data file was not written";
+
+		// Check the trimmed data file can be used with the same properties.
+		status = HashInitManagerFromFile(
+			&manager,
+			&config,
+			&properties,
+			trimmedFilePath.c_str(),
+			exception);
+		EXPECT_EQ(SUCCESS, status) << "Trimmed data file could not be loaded";
+		if (status == SUCCESS) {
+			ResourceManagerFree(&manager);
+		}
+		remove(trimmedFilePath.c_str());
+	}
+};
+
+EXAMPLE_HASH_TESTS(ExampleTestHashTrimDataFile)
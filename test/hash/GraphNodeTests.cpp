@@ -364,3 +364,348 @@ TEST(GraphNode, BinaryNode_MatchesZeroHash)
 		node.hash(0),
 		fiftyoneDegreesGraphGetMatchingHashFromNode(node.get(), 0));
 }
+
+namespace {
+
+	/**
+	 * Rolls the hash over the window of length characters starting at index in
+	 * the same way as detection does when it does not use a kernel.
+	 */
+	uint32_t rollingHash(const char *target, uint32_t index, byte length) {
+		uint32_t hash = 0;
+		for (uint32_t i = index; i < index + length; i++) {
+			hash *= 997;
+			hash += target[i];
+		}
+		return hash;
+	}
+
+	/**
+	 * Characters covering the whole range of byte values, including those
+	 * which are negative when sign extended.
+	 */
+	vector<char> windowTarget() {
+		vector<char> target(400);
+		for (size_t i = 0; i < target.size(); i++) {
+			target[i] = (char)((i * 37 + 11) % 256);
+		}
+		return target;
+	}
+}
+
+/*
+ * Every kernel supported by the processor gives the same hash codes as the
+ * rolling hash, for every window length a node can have.
+ */
+TEST(GraphNode, HashWindows_MatchesRollingHash)
+{
+	vector<char> target = windowTarget();
+	uint32_t hashes[FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS];
+	int best = (int)fiftyoneDegreesGraphHashKernelGetBest();
+	for (int kernel = 0; kernel <= best; kernel++) {
+		for (int length = 1; length <= 128; length++) {
+			for (uint32_t first = 0; first < 20; first += 7) {
+				uint32_t count = fiftyoneDegreesGraphHashWindows(
+					(fiftyoneDegreesGraphHashKernel)kernel,
+					&target[0],
+					first,
+					(uint32_t)length % 19 + 1,
+					(byte)length,
+					hashes);
+				ASSERT_EQ((uint32_t)length % 19 + 1, count);
+				for (uint32_t i = 0; i < count; i++) {
+					ASSERT_EQ(
+						rollingHash(&target[0], first + i, (byte)length),
+						hashes[i]) <<
+						"Kernel " << kernel << ", length " << length <<
+						", window " << first + i;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * No more than a block of hash codes is calculated in a single call.
+ */
+TEST(GraphNode, HashWindows_LimitedToBlock)
+{
+	vector<char> target = windowTarget();
+	uint32_t hashes[FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS];
+	EXPECT_EQ(
+		(uint32_t)FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS,
+		fiftyoneDegreesGraphHashWindows(
+			fiftyoneDegreesGraphHashKernelGetBest(),
+			&target[0],
+			0,
+			FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS * 2,
+			10,
+			hashes));
+}
+
+/*
+ * The first of several equal hash codes is found in any lane, and a hash code
+ * which is not present is not found.
+ */
+TEST(GraphNode, HashFind_FindsFirstMatch)
+{
+	uint32_t hashes[FIFTYONE_DEGREES_GRAPH_HASH_WINDOWS];
+	int best = (int)fiftyoneDegreesGraphHashKernelGetBest();
+	for (int kernel = 0; kernel <= best; kernel++) {
+		for (uint32_t count = 1; count <= 21; count++) {
+			for (uint32_t i = 0; i < count; i++) {
+				hashes[i] = 1000 + i;
+			}
+			for (uint32_t i = 0; i < count; i++) {
+				hashes[count - 1] = hashes[i];
+				EXPECT_EQ(
+					(int32_t)i,
+					fiftyoneDegreesGraphHashFind(
+						(fiftyoneDegreesGraphHashKernel)kernel,
+						hashes,
+						count,
+						1000 + i));
+				hashes[count - 1] = 1000 + count - 1;
+			}
+			EXPECT_EQ(
+				-1,
+				fiftyoneDegreesGraphHashFind(
+					(fiftyoneDegreesGraphHashKernel)kernel,
+					hashes,
+					count,
+					999));
+		}
+	}
+}
+
+/**
+ * Searches for each hash code within the difference of the hash in turn,
+ * trying the hash code above before the one below, as the difference option
+ * does for a node with multiple hash records.
+ */
+static const fiftyoneDegreesGraphNodeHash* getWithinDifference(
+	fiftyoneDegreesGraphNode *node,
+	uint32_t hash,
+	uint32_t maxDifference,
+	uint32_t *difference) {
+	fiftyoneDegreesGraphNodeHash *found = NULL;
+	for (uint32_t d = 0; d <= maxDifference && found == NULL; d++) {
+		found = fiftyoneDegreesGraphGetMatchingHashFromListNode(
+			node,
+			hash + d);
+		if (found == NULL) {
+			found = fiftyoneDegreesGraphGetMatchingHashFromListNode(
+				node,
+				hash - d);
+		}
+		*difference = d;
+	}
+	return found;
+}
+
+/*
+ * The nearest hash record found with a single search of the ordered records
+ * must be the same as the one found by searching for each hash code within the
+ * difference in turn, including where the hash codes above and below are the
+ * same distance away, and where adding to or subtracting from the hash wraps.
+ */
+TEST(GraphNode, NearestHash_MatchesSearchWithinDifference)
+{
+	vector<fiftyoneDegreesGraphNodeHash> hashes;
+	hashes.push_back(record(2, -1));
+	hashes.push_back(record(20, -2));
+	hashes.push_back(record(30, -3));
+	hashes.push_back(record(UINT32_MAX - 3, -4));
+	TestGraphNode node(0, hashes);
+	const uint32_t probes[] = {
+		0, 1, 2, 3, 11, 24, 25, 26, 40, UINT32_MAX - 10, UINT32_MAX };
+	for (uint32_t probe : probes) {
+		for (uint32_t maxDifference = 0; maxDifference <= 12; maxDifference++) {
+			uint32_t expectedDifference = 0, actualDifference = 0;
+			const fiftyoneDegreesGraphNodeHash *expected = getWithinDifference(
+				node.get(),
+				probe,
+				maxDifference,
+				&expectedDifference);
+			const fiftyoneDegreesGraphNodeHash *actual =
+				fiftyoneDegreesGraphGetNearestHashFromOrdered(
+					(fiftyoneDegreesGraphNodeHash*)(node.get() + 1),
+					(uint32_t)hashes.size(),
+					probe,
+					maxDifference,
+					&actualDifference);
+			EXPECT_EQ(expected, actual) << "Hash " << probe <<
+				" with difference " << maxDifference;
+			if (expected != NULL) {
+				EXPECT_EQ(expectedDifference, actualDifference);
+			}
+		}
+	}
+}
+
+/*
+ * No record is found when there are no records to search.
+ */
+TEST(GraphNode, NearestHash_NoRecords)
+{
+	uint32_t difference = 0;
+	fiftyoneDegreesGraphNodeHash hash = record(1, -1);
+	EXPECT_EQ(
+		nullptr,
+		fiftyoneDegreesGraphGetNearestHashFromOrdered(
+			&hash,
+			0,
+			1,
+			10,
+			&difference));
+}
+
+/**
+ * Copies the hash codes of the ordered records to the Eytzinger positions of
+ * the subtree at index k, recording the index of the record each came from.
+ */
+static uint32_t setEytzinger(
+	const vector<fiftyoneDegreesGraphNodeHash> &hashes,
+	uint32_t *codes,
+	uint32_t *indexes,
+	uint32_t next,
+	uint32_t k) {
+	if (k <= hashes.size()) {
+		next = setEytzinger(hashes, codes, indexes, next, 2 * k);
+		codes[k] = hashes[next].hashCode;
+		indexes[k] = next;
+		next = setEytzinger(hashes, codes, indexes, next + 1, 2 * k + 1);
+	}
+	return next;
+}
+
+/**
+ * Appends the hash codes of the records of an ordered list node in the layout
+ * used by a flat graph with the optimised node search, and sets the flag.
+ */
+static vector<unsigned char> createSearchNode(
+	const vector<fiftyoneDegreesGraphNodeHash> &hashes,
+	bool eytzinger) {
+	const uint32_t count = (uint32_t)hashes.size();
+	vector<unsigned char> buffer(
+		sizeof(fiftyoneDegreesGraphNode) +
+		(count * sizeof(fiftyoneDegreesGraphNodeHash)) +
+		sizeof(fiftyoneDegreesGraphNodeSearch) +
+		(2 * (count + 1) * sizeof(uint32_t)),
+		0);
+	fiftyoneDegreesGraphNode *node = (fiftyoneDegreesGraphNode*)&buffer[0];
+	node->unmatchedNodeOffset = -99;
+	node->flags = FIFTYONE_DEGREES_GRAPH_NODE_FLAG_SEARCH;
+	node->length = 1;
+	node->hashesCount = (int32_t)count;
+	node->modulo = 0;
+	memcpy(node + 1, &hashes[0], count * sizeof(fiftyoneDegreesGraphNodeHash));
+	fiftyoneDegreesGraphNodeSearch *search =
+		FIFTYONE_DEGREES_GRAPH_NODE_SEARCH(node);
+	uint32_t *codes = (uint32_t*)(search + 1);
+	search->count = count;
+	search->eytzinger = eytzinger ? 1 : 0;
+	if (eytzinger) {
+		setEytzinger(hashes, codes, codes + count + 1, 0, 1);
+	}
+	else {
+		for (uint32_t i = 0; i < count; i++) {
+			codes[i] = hashes[i].hashCode;
+		}
+	}
+	return buffer;
+}
+
+/*
+ * Searching the hash codes laid out after the records of an ordered list node
+ * must find the same record as the binary search of the records, whether the
+ * hash codes are in order or in Eytzinger order, for hashes which are below,
+ * between, equal to and above the hash codes of the records.
+ */
+TEST(GraphNode, ListNodeLayout_MatchesBinarySearch)
+{
+	const uint32_t counts[] = { 2, 3, 7, 8, 16, 17, 40, 100 };
+	for (uint32_t count : counts) {
+		vector<fiftyoneDegreesGraphNodeHash> hashes;
+		for (uint32_t i = 0; i < count; i++) {
+			hashes.push_back(record((i * 3) + 1, -(int32_t)(i + 1)));
+		}
+		for (int eytzinger = 0; eytzinger <= 1; eytzinger++) {
+			vector<unsigned char> buffer = createSearchNode(
+				hashes,
+				eytzinger != 0);
+			fiftyoneDegreesGraphNode *node =
+				(fiftyoneDegreesGraphNode*)&buffer[0];
+			for (uint32_t probe = 0; probe <= (count * 3) + 2; probe++) {
+				EXPECT_EQ(
+					fiftyoneDegreesGraphGetMatchingHashFromListNodeSearch(
+						node,
+						probe),
+					fiftyoneDegreesGraphGetMatchingHashFromListNodeLayout(
+						node,
+						probe)) << "Hash " << probe << " with " << count <<
+					" records" << (eytzinger ? " in Eytzinger order" : "");
+			}
+			EXPECT_EQ(
+				nullptr,
+				fiftyoneDegreesGraphGetMatchingHashFromListNodeLayout(
+					node,
+					UINT32_MAX));
+		}
+	}
+}
+
+/**
+ * Copies the hash table node and appends the modulo constant used by a flat
+ * graph with the optimised node modulo, setting the flag.
+ */
+static vector<unsigned char> createModuloNode(TestGraphNode &source) {
+	fiftyoneDegreesGraphNode *sourceNode = source.get();
+	const size_t size = sizeof(fiftyoneDegreesGraphNode) +
+		(sourceNode->hashesCount * sizeof(fiftyoneDegreesGraphNodeHash));
+	vector<unsigned char> buffer(
+		size + sizeof(fiftyoneDegreesGraphNodeModulo),
+		0);
+	memcpy(&buffer[0], sourceNode, size);
+	fiftyoneDegreesGraphNode *node = (fiftyoneDegreesGraphNode*)&buffer[0];
+	node->flags = FIFTYONE_DEGREES_GRAPH_NODE_FLAG_MODULO;
+	FIFTYONE_DEGREES_GRAPH_NODE_MODULO(node)->multiplier =
+		(UINT64_MAX / (uint32_t)node->modulo) + 1;
+	return buffer;
+}
+
+/*
+ * Finding the slot of a hash table node with the modulo constant must find
+ * the same record as dividing by the modulo, for records in slots, in
+ * collision buckets, for absent hashes, and for a hash of zero which must
+ * still not match a marker.
+ */
+TEST(GraphNode, TableModulo_MatchesTable)
+{
+	TestGraphNode sources[] = { tableWithBucket(), tableWithEmptySlot() };
+	for (TestGraphNode &source : sources) {
+		vector<unsigned char> buffer = createModuloNode(source);
+		fiftyoneDegreesGraphNode *node = (fiftyoneDegreesGraphNode*)&buffer[0];
+		const fiftyoneDegreesGraphNodeHash *first =
+			(const fiftyoneDegreesGraphNodeHash*)(node + 1);
+		for (uint32_t probe = 0; probe <= 200; probe++) {
+			const fiftyoneDegreesGraphNodeHash *expected =
+				fiftyoneDegreesGraphGetMatchingHashFromListNodeTable(
+					source.get(),
+					probe);
+			const fiftyoneDegreesGraphNodeHash *actual =
+				fiftyoneDegreesGraphGetMatchingHashFromListNodeTableModulo(
+					node,
+					probe);
+			// Compare the positions as the records are in different buffers.
+			EXPECT_EQ(
+				expected == NULL ? -1 : expected - source.hash(0),
+				actual == NULL ? -1 : actual - first) << "Hash " << probe;
+		}
+		EXPECT_EQ(
+			nullptr,
+			fiftyoneDegreesGraphGetMatchingHashFromListNodeTableModulo(
+				node,
+				0));
+	}
+}
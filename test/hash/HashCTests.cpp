@@ -22,6 +22,8 @@
 
 #include "../../src/common-cxx/tests/pch.h"
 #include <string>
+#include <algorithm>
+#include <functional>
 #include "../Constants.hpp"
 #include "../../src/common-cxx/tests/Base.hpp"
 #include "../../src/hash/fiftyone.h"
@@ -38,6 +40,15 @@ const char* commonProperties =
 
 using namespace std;
 
+// Changes the configuration of a data set created for a test.
+typedef function<void(ConfigHash&)> ConfigMutator;
+
+// Checks the data set created with a changed configuration against the data
+// set created without the change.
+typedef function<void(DataSetHash*, DataSetHash*)> DataSetCheck;
+
+static vector<string> getUserAgents(int limit = 200);
+
 class HashCTests : public Base {
 public:
 	HashCTests() {
@@ -89,6 +100,18 @@ protected:
 		ResourceManagerFree(&manager);
 	}
 
+	void initManager(
+		ResourceManager* target,
+		const ConfigMutator& mutate,
+		const char* fileName = NULL);
+
+	void verifyConfigMatches(
+		const ConfigMutator& mutate,
+		const DataSetCheck& check = nullptr,
+		const ConfigMutator& common = nullptr,
+		const vector<string>& userAgents = getUserAgents(),
+		bool reload = false);
+
 	string dataFilePath;
 	PropertiesRequired properties = PropertiesDefault;
 	ConfigHash configHash = HashDefaultConfig;
@@ -704,3 +727,1680 @@ TEST_F(HashCTests, HashResultsGetValuesNoProfileValues) {
 	EXPECT_FALSE(EXCEPTION_OKAY);
 	EXPECT_TRUE(EXCEPTION_CHECK(COLLECTION_INDEX_OUT_OF_RANGE));
 }
+
+static void addUserAgent(const char* userAgent, void* state) {
+	((vector<string>*)state)->push_back(string(userAgent));
+}
+
+/**
+ * Returns the first limit User-Agents from the User-Agents file, followed by
+ * the mobile User-Agent and an empty User-Agent.
+ */
+static vector<string> getUserAgents(int limit) {
+	vector<string> userAgents;
+	char userAgent[500] = "";
+	TextFileIterateWithLimit(
+		GetFilePath(_dataFolderName, _userAgentsFileName).c_str(),
+		userAgent,
+		sizeof(userAgent),
+		limit,
+		&userAgents,
+		addUserAgent);
+	userAgents.push_back(mobileUserAgent);
+	userAgents.push_back("");
+	return userAgents;
+}
+
+/**
+ * Initialises the manager from the data file, or the file name if provided,
+ * with the configuration from SetUp changed by the mutator. Route tracing is
+ * always disabled so that the same graph walks are used as in production.
+ * Tests which need a different configuration use their own manager rather
+ * than changing the data set of the manager from SetUp.
+ */
+void HashCTests::initManager(
+	ResourceManager* target,
+	const ConfigMutator& mutate,
+	const char* fileName) {
+	ConfigHash config = configHash;
+	if (mutate) {
+		mutate(config);
+	}
+	config.traceRoute = false;
+	EXCEPTION_CREATE;
+	HashInitManagerFromFile(
+		target,
+		&config,
+		&properties,
+		fileName == NULL ? dataFilePath.c_str() : fileName,
+		exception);
+	EXCEPTION_THROW;
+}
+
+// Enables difference and drift so that retries are needed.
+static void setDifferenceAndDrift(ConfigHash& config) {
+	config.difference = 10;
+	config.drift = 5;
+}
+
+/**
+ * Processes the User-Agents singly and as a batch, checking that every result
+ * item is identical. The batch uses the interleaved graph walk, so this checks
+ * that the interleaved walk produces the same results as evaluating each node
+ * of each User-Agent in turn. If a query User-Agent is provided then it is
+ * added to the evidence for every User-Agent, and is evaluated first.
+ */
+static void verifyBatchMatchesSingle(
+	ResourceManager* manager,
+	vector<string>& userAgents,
+	const char* queryUserAgent = NULL) {
+	uint32_t i, j, c;
+	EXCEPTION_CREATE;
+	vector<EvidenceKeyValuePairArray*> evidence;
+	vector<ResultsHash*> batch;
+	for (i = 0; i < userAgents.size(); i++) {
+		evidence.push_back(EvidenceCreate(2));
+		if (queryUserAgent != NULL) {
+			EvidenceAddString(
+				evidence.back(),
+				FIFTYONE_DEGREES_EVIDENCE_QUERY,
+				"User-Agent",
+				queryUserAgent);
+		}
+		EvidenceAddString(
+			evidence.back(),
+			FIFTYONE_DEGREES_EVIDENCE_HTTP_HEADER_STRING,
+			"User-Agent",
+			userAgents[i].c_str());
+		batch.push_back(ResultsHashCreate(manager, 0));
+	}
+	ResultsHashFromEvidenceBatch(
+		batch.data(),
+		evidence.data(),
+		(uint32_t)evidence.size(),
+		exception);
+	EXCEPTION_THROW;
+
+	for (i = 0; i < userAgents.size(); i++) {
+		ResultsHash* single = ResultsHashCreate(manager, 0);
+		ResultsHashFromEvidence(single, evidence[i], exception);
+		EXCEPTION_THROW;
+		DataSetHash* dataSet = (DataSetHash*)single->b.b.dataSet;
+		EXPECT_EQ(single->count, batch[i]->count) << 
+			"Result count differs for '" << userAgents[i] << "'.\n";
+		for (j = 0; j < single->count && j < batch[i]->count; j++) {
+			ResultHash* s = &single->items[j];
+			ResultHash* b = &batch[i]->items[j];
+			EXPECT_EQ(s->iterations, b->iterations);
+			EXPECT_EQ(s->difference, b->difference);
+			EXPECT_EQ(s->drift, b->drift);
+			EXPECT_EQ(s->matchedNodes, b->matchedNodes);
+			EXPECT_EQ(s->method, b->method);
+			EXPECT_EQ(s->b.uniqueHttpHeaderIndex, b->b.uniqueHttpHeaderIndex);
+			for (c = 0; c < dataSet->componentsList.count; c++) {
+				EXPECT_EQ(s->profileOffsets[c], b->profileOffsets[c]) <<
+					"Profile differs for '" << userAgents[i] << "'.\n";
+			}
+		}
+		ResultsHashFree(single);
+	}
+
+	for (i = 0; i < userAgents.size(); i++) {
+		ResultsHashFree(batch[i]);
+		EvidenceFree(evidence[i]);
+	}
+}
+
+/**
+ * Check that processing a batch of User-Agents produces the same results as
+ * processing each User-Agent singly. The number of User-Agents is not a
+ * multiple of the block size so that a partial block is also processed.
+ */
+TEST_F(HashCTests, ResultsHashFromEvidenceBatchMatchesSingle) {
+	vector<string> userAgents = getUserAgents(
+		5 * FIFTYONE_DEGREES_HASH_BATCH_SIZE + 3);
+	userAgents.push_back("!a^&$^(*!$&()!*)$!_");
+
+	// Route tracing is only supported when evaluating evidence singly, so
+	// use a manager without it.
+	ResourceManager batchManager;
+	initManager(&batchManager, nullptr);
+	verifyBatchMatchesSingle(&batchManager, userAgents);
+	ResourceManagerFree(&batchManager);
+}
+
+/**
+ * Check that the interleaved graph walk used by the batch produces the same
+ * results as processing each User-Agent singly when difference and drift are
+ * enabled. Characters in the User-Agents are altered so that the retries are
+ * needed.
+ */
+TEST_F(HashCTests, ResultsHashFromEvidenceBatchMatchesSingleWithRetries) {
+	vector<string> userAgents = getUserAgents(
+		2 * FIFTYONE_DEGREES_HASH_BATCH_SIZE);
+	for (size_t i = 0; i < userAgents.size(); i++) {
+		for (size_t j = i % 7; j < userAgents[i].size(); j += 11) {
+			userAgents[i][j] = userAgents[i][j] == 'x' ? 'y' : 'x';
+		}
+	}
+
+	ResourceManager batchManager;
+	initManager(&batchManager, setDifferenceAndDrift);
+	verifyBatchMatchesSingle(&batchManager, userAgents);
+	ResourceManagerFree(&batchManager);
+}
+
+/**
+ * Check that where the first evidence for a component does not match in the
+ * interleaved graph walk, the batch continues with the next evidence and
+ * produces the same results as processing each input singly. The query
+ * User-Agent is evaluated first and matches nothing, so the header is then
+ * evaluated. Difference and drift are enabled so that the unmatched evidence
+ * is also retried.
+ */
+TEST_F(HashCTests, ResultsHashFromEvidenceBatchMatchesSingleWithUnmatched) {
+	vector<string> userAgents = getUserAgents(
+		2 * FIFTYONE_DEGREES_HASH_BATCH_SIZE + 1);
+
+	ResourceManager batchManager;
+	initManager(&batchManager, setDifferenceAndDrift);
+	verifyBatchMatchesSingle(
+		&batchManager,
+		userAgents,
+		"!a^&$^(*!$&()!*)$!_");
+	ResourceManagerFree(&batchManager);
+}
+
+/**
+ * Check that a batch containing a NULL evidence entry fails before any of the
+ * inputs are processed, leaving the results of the valid entries untouched.
+ */
+TEST_F(HashCTests, ResultsHashFromEvidenceBatchNullEvidence) {
+	uint32_t i;
+	EXCEPTION_CREATE;
+	EvidenceKeyValuePairArray* evidence[3];
+	ResultsHash* batch[3];
+	for (i = 0; i < 3; i++) {
+		evidence[i] = EvidenceCreate(1);
+		EvidenceAddString(
+			evidence[i],
+			FIFTYONE_DEGREES_EVIDENCE_HTTP_HEADER_STRING,
+			"User-Agent",
+			mobileUserAgent);
+		batch[i] = ResultsHashCreate(&manager, 0);
+	}
+	EvidenceKeyValuePairArray* valid = evidence[2];
+	evidence[2] = NULL;
+	ResultsHashFromEvidenceBatch(batch, evidence, 3, exception);
+	EXPECT_TRUE(EXCEPTION_CHECK(NULL_POINTER));
+	for (i = 0; i < 3; i++) {
+		EXPECT_EQ(0U, batch[i]->count);
+	}
+	evidence[2] = valid;
+	for (i = 0; i < 3; i++) {
+		ResultsHashFree(batch[i]);
+		EvidenceFree(evidence[i]);
+	}
+}
+
+/**
+ * Checks that every result item is identical, including the evidence each
+ * result was found from.
+ */
+static void verifyResultsMatch(
+	ResultsHash* expected,
+	ResultsHash* actual,
+	const string& evidence) {
+	uint32_t j, c;
+	DataSetHash* dataSet = (DataSetHash*)expected->b.b.dataSet;
+	EXPECT_EQ(expected->count, actual->count) <<
+		"Result count differs for '" << evidence << "'.\n";
+	for (j = 0; j < expected->count && j < actual->count; j++) {
+		ResultHash* e = &expected->items[j];
+		ResultHash* a = &actual->items[j];
+		EXPECT_EQ(e->iterations, a->iterations);
+		EXPECT_EQ(e->difference, a->difference);
+		EXPECT_EQ(e->drift, a->drift);
+		EXPECT_EQ(e->matchedNodes, a->matchedNodes);
+		EXPECT_EQ(e->method, a->method);
+		EXPECT_STREQ(e->b.matchedUserAgent, a->b.matchedUserAgent);
+		EXPECT_EQ(e->b.uniqueHttpHeaderIndex, a->b.uniqueHttpHeaderIndex);
+		EXPECT_EQ(e->b.targetUserAgentLength, a->b.targetUserAgentLength);
+		EXPECT_EQ(
+			e->b.targetUserAgent == NULL,
+			a->b.targetUserAgent == NULL) <<
+			"Target differs for '" << evidence << "'.\n";
+		if (e->b.targetUserAgent != NULL && a->b.targetUserAgent != NULL) {
+			EXPECT_EQ(
+				string(e->b.targetUserAgent, e->b.targetUserAgentLength),
+				string(a->b.targetUserAgent, a->b.targetUserAgentLength));
+		}
+		for (c = 0; c < dataSet->componentsList.count; c++) {
+			EXPECT_EQ(e->profileOffsets[c], a->profileOffsets[c]) <<
+				"Profile differs for '" << evidence << "'.\n";
+		}
+	}
+}
+
+/**
+ * Processes the User-Agents with both managers, checking that every result
+ * item is identical.
+ */
+static void verifyManagersMatch(
+	ResourceManager* expectedManager,
+	ResourceManager* actualManager,
+	const vector<string>& userAgents) {
+	uint32_t i;
+	EXCEPTION_CREATE;
+	for (i = 0; i < userAgents.size(); i++) {
+		ResultsHash* expected = ResultsHashCreate(expectedManager, 0);
+		ResultsHash* actual = ResultsHashCreate(actualManager, 0);
+		ResultsHashFromUserAgent(
+			expected,
+			userAgents[i].c_str(),
+			userAgents[i].size(),
+			exception);
+		EXCEPTION_THROW;
+		ResultsHashFromUserAgent(
+			actual,
+			userAgents[i].c_str(),
+			userAgents[i].size(),
+			exception);
+		EXCEPTION_THROW;
+		verifyResultsMatch(expected, actual, userAgents[i]);
+		ResultsHashFree(expected);
+		ResultsHashFree(actual);
+	}
+}
+
+/**
+ * Checks that a data set created with the configuration changed by the
+ * mutator gives the same results for the User-Agents as one created without
+ * the change. The common mutator changes both configurations, and the check
+ * is called with both data sets before the results are compared. If reload is
+ * true then the changed data set is reloaded and checked again.
+ */
+void HashCTests::verifyConfigMatches(
+	const ConfigMutator& mutate,
+	const DataSetCheck& check,
+	const ConfigMutator& common,
+	const vector<string>& userAgents,
+	bool reload) {
+	int pass;
+	ResourceManager expectedManager;
+	ResourceManager actualManager;
+	initManager(&expectedManager, common);
+	initManager(&actualManager, [&](ConfigHash& config) {
+		if (common) {
+			common(config);
+		}
+		mutate(config);
+	});
+	for (pass = 0; pass < (reload ? 2 : 1); pass++) {
+		if (pass == 1) {
+			EXCEPTION_CREATE;
+			StatusCode status = HashReloadManagerFromOriginalFile(
+				&actualManager,
+				exception);
+			EXCEPTION_THROW;
+			EXPECT_EQ(SUCCESS, status);
+		}
+		if (check) {
+			DataSetHash* expected =
+				(DataSetHash*)DataSetGet(&expectedManager);
+			DataSetHash* actual = (DataSetHash*)DataSetGet(&actualManager);
+			check(expected, actual);
+			DataSetHashRelease(actual);
+			DataSetHashRelease(expected);
+		}
+		verifyManagersMatch(&expectedManager, &actualManager, userAgents);
+	}
+	ResourceManagerFree(&actualManager);
+	ResourceManagerFree(&expectedManager);
+}
+
+static void setFlatGraph(ConfigHash& config) {
+	config.flatGraph = true;
+}
+
+static void setPredictiveGraph(ConfigHash& config) {
+	config.usePerformanceGraph = false;
+	config.usePredictiveGraph = true;
+}
+
+static void checkFlatGraph(DataSetHash* expected, DataSetHash* actual) {
+	(void)expected;
+	ASSERT_NE((GraphFlat*)NULL, actual->flatGraph);
+}
+
+/**
+ * Check that walking the nodes compiled into a flat graph produces the same
+ * results as getting each node from the nodes collection, both with and
+ * without difference and drift.
+ */
+TEST_F(HashCTests, FlatGraphMatchesCollection) {
+	vector<string> userAgents = getUserAgents();
+	userAgents.push_back("!a^&$^(*!$&()!*)$!_");
+	verifyConfigMatches(setFlatGraph, checkFlatGraph, nullptr, userAgents);
+
+	// Alter characters in the User-Agents so that difference and drift are
+	// needed, and enable them in both data sets. The flat graph is compiled
+	// with the ordered copy of the records of hash table nodes as difference
+	// is enabled.
+	for (size_t i = 0; i < userAgents.size(); i++) {
+		for (size_t j = i % 7; j < userAgents[i].size(); j += 11) {
+			userAgents[i][j] = userAgents[i][j] == 'x' ? 'y' : 'x';
+		}
+	}
+	verifyConfigMatches(
+		setFlatGraph,
+		checkFlatGraph,
+		setDifferenceAndDrift,
+		userAgents);
+}
+
+/**
+ * Check that placing the nodes breadth first from the root nodes produces the
+ * same results as the layout of the data file.
+ */
+TEST_F(HashCTests, OptimisedNodeLayoutMatchesCollection) {
+	verifyConfigMatches(
+		[](ConfigHash& config) { config.optimiseNodeLayout = true; },
+		checkFlatGraph);
+}
+
+/**
+ * Check that laying out the hash codes of ordered list nodes to be searched
+ * gives the same results as searching the records in the nodes collection.
+ */
+TEST_F(HashCTests, OptimisedNodeSearchMatchesCollection) {
+	verifyConfigMatches(
+		[](ConfigHash& config) { config.optimiseNodeSearch = true; },
+		checkFlatGraph);
+}
+
+/**
+ * Check that finding the slot of a hash in hash table nodes with the modulo
+ * constant gives the same results as dividing by the modulo of the nodes in
+ * the nodes collection.
+ */
+TEST_F(HashCTests, OptimisedNodeModuloMatchesCollection) {
+	verifyConfigMatches(
+		[](ConfigHash& config) { config.optimiseNodeModulo = true; },
+		checkFlatGraph);
+}
+
+/**
+ * Check that results returned from the result cache are the same as those
+ * from evaluating the graphs, that repeated evidence is found in the cache,
+ * and that reloading the data set starts with an empty cache.
+ */
+TEST_F(HashCTests, ResultCacheMatchesUncached) {
+	vector<string> userAgents;
+	char userAgent[500] = "";
+	TextFileIterateWithLimit(
+		GetFilePath(_dataFolderName, _userAgentsFileName).c_str(),
+		userAgent,
+		sizeof(userAgent),
+		200,
+		&userAgents,
+		addUserAgent);
+	userAgents.push_back(mobileUserAgent);
+	userAgents.push_back("");
+
+	// Route tracing disables the result cache, so must be disabled.
+	ResourceManager cachedManager;
+	ConfigHash cachedConfig = configHash;
+	cachedConfig.traceRoute = false;
+	cachedConfig.resultCacheCapacity = 1000;
+	EXCEPTION_CREATE;
+	HashInitManagerFromFile(
+		&cachedManager,
+		&cachedConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	DataSetHash* cachedDataSet = (DataSetHash*)DataSetGet(&cachedManager);
+	ASSERT_NE((ResultCache*)NULL, cachedDataSet->resultCache);
+	ResultCache* cache = cachedDataSet->resultCache;
+
+	// The first evaluation of each User-Agent is looked up in the cache once,
+	// missing unless the User-Agent has been seen before, and the second is
+	// always served from the cache. Both must match the uncached results.
+	for (const string& ua : userAgents) {
+		const long hits = ResultCacheGetHits(cache);
+		const long misses = ResultCacheGetMisses(cache);
+		ResultsHash* expected = ResultsHashCreate(&manager, 0);
+		ResultsHash* first = ResultsHashCreate(&cachedManager, 0);
+		ResultsHash* second = ResultsHashCreate(&cachedManager, 0);
+		ResultsHashFromUserAgent(expected, ua.c_str(), ua.size(), exception);
+		EXCEPTION_THROW;
+		ResultsHashFromUserAgent(first, ua.c_str(), ua.size(), exception);
+		EXCEPTION_THROW;
+		const long lookups = ResultCacheGetHits(cache) +
+			ResultCacheGetMisses(cache) - hits - misses;
+		EXPECT_LE(lookups, 1);
+		const long firstHits = ResultCacheGetHits(cache);
+		const long firstMisses = ResultCacheGetMisses(cache);
+		ResultsHashFromUserAgent(second, ua.c_str(), ua.size(), exception);
+		EXCEPTION_THROW;
+		EXPECT_EQ(firstHits + lookups, ResultCacheGetHits(cache)) << ua;
+		EXPECT_EQ(firstMisses, ResultCacheGetMisses(cache)) << ua;
+		verifyResultsMatch(expected, first, ua);
+		verifyResultsMatch(expected, second, ua);
+		ResultsHashFree(second);
+		ResultsHashFree(first);
+		ResultsHashFree(expected);
+	}
+	EXPECT_GT(ResultCacheGetMisses(cache), 0);
+	EXPECT_GT(ResultCacheGetHits(cache), 0);
+
+	// Results from the cache for evidence which includes User-Agent Client
+	// Hints must have the same targets, including any pseudo headers, as the
+	// results from evaluating the graphs.
+	EvidenceKeyValuePairArray* evidence = EvidenceCreate(4);
+	EvidenceAddString(
+		evidence,
+		FIFTYONE_DEGREES_EVIDENCE_HTTP_HEADER_STRING,
+		"User-Agent",
+		mobileUserAgent);
+	EvidenceAddString(
+		evidence,
+		FIFTYONE_DEGREES_EVIDENCE_HTTP_HEADER_STRING,
+		"Sec-CH-UA",
+		"\"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\"");
+	EvidenceAddString(
+		evidence,
+		FIFTYONE_DEGREES_EVIDENCE_HTTP_HEADER_STRING,
+		"Sec-CH-UA-Mobile",
+		"?1");
+	EvidenceAddString(
+		evidence,
+		FIFTYONE_DEGREES_EVIDENCE_HTTP_HEADER_STRING,
+		"Sec-CH-UA-Platform",
+		"\"Android\"");
+	ResultsHash* expected = ResultsHashCreate(&manager, 0);
+	ResultsHash* first = ResultsHashCreate(&cachedManager, 0);
+	ResultsHash* second = ResultsHashCreate(&cachedManager, 0);
+	ResultsHashFromEvidence(expected, evidence, exception);
+	EXCEPTION_THROW;
+	ResultsHashFromEvidence(first, evidence, exception);
+	EXCEPTION_THROW;
+	const long hits = ResultCacheGetHits(cache);
+	ResultsHashFromEvidence(second, evidence, exception);
+	EXCEPTION_THROW;
+	EXPECT_EQ(hits + 1, ResultCacheGetHits(cache));
+	verifyResultsMatch(expected, first, "Client Hints");
+	verifyResultsMatch(expected, second, "Client Hints");
+	ResultsHashFree(second);
+	ResultsHashFree(first);
+	ResultsHashFree(expected);
+	EvidenceFree(evidence);
+	DataSetHashRelease(cachedDataSet);
+
+	// The reloaded data set must not return results from the previous one.
+	StatusCode status = HashReloadManagerFromOriginalFile(
+		&cachedManager,
+		exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+	cachedDataSet = (DataSetHash*)DataSetGet(&cachedManager);
+	ASSERT_NE((ResultCache*)NULL, cachedDataSet->resultCache);
+	EXPECT_EQ(0, ResultCacheGetHits(cachedDataSet->resultCache));
+	EXPECT_EQ(0, ResultCacheGetMisses(cachedDataSet->resultCache));
+	verifyManagersMatch(&manager, &cachedManager, userAgents);
+	EXPECT_GT(ResultCacheGetMisses(cachedDataSet->resultCache), 0);
+	DataSetHashRelease(cachedDataSet);
+
+	ResourceManagerFree(&cachedManager);
+}
+
+/**
+ * Check that the values returned from the value table match the values
+ * returned from the collections for every required property.
+ */
+TEST_F(HashCTests, ValueTableMatchesValues) {
+	vector<string> userAgents;
+	char userAgent[500] = "";
+	char expected[2000] = "";
+	TextFileIterateWithLimit(
+		GetFilePath(_dataFolderName, _userAgentsFileName).c_str(),
+		userAgent,
+		sizeof(userAgent),
+		200,
+		&userAgents,
+		addUserAgent);
+	userAgents.push_back(mobileUserAgent);
+
+	ResourceManager tableManager;
+	ConfigHash tableConfig = configHash;
+	tableConfig.valueTable = true;
+	EXCEPTION_CREATE;
+	HashInitManagerFromFile(
+		&tableManager,
+		&tableConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+
+	for (uint32_t i = 0; i < userAgents.size(); i++) {
+		ResultsHash* results = ResultsHashCreate(&tableManager, 0);
+		ResultsHashFromUserAgent(
+			results,
+			userAgents[i].c_str(),
+			userAgents[i].size(),
+			exception);
+		EXCEPTION_THROW;
+		DataSetHash* dataSet = (DataSetHash*)results->b.b.dataSet;
+		ASSERT_NE((HashValueTable*)NULL, dataSet->valueTable);
+		for (int p = 0; p < (int)dataSet->b.b.available->count; p++) {
+			const char* const* values;
+			uint32_t count;
+			ASSERT_TRUE(ResultsHashGetValuesFromTable(
+				results,
+				p,
+				&values,
+				&count));
+			string actual;
+			for (uint32_t v = 0; v < count; v++) {
+				if (v != 0) {
+					actual.append("|");
+				}
+				actual.append(values[v]);
+			}
+			ResultsHashGetValuesStringByRequiredPropertyIndex(
+				results,
+				p,
+				expected,
+				sizeof(expected),
+				(char* const)"|",
+				exception);
+			EXCEPTION_THROW;
+			EXPECT_STREQ(expected, actual.c_str()) <<
+				"Values differ for '" << userAgents[i] << "'.\n";
+		}
+		ResultsHashFree(results);
+	}
+
+	ResourceManagerFree(&tableManager);
+}
+
+static bool appendJson(void* state, const char* chars, size_t length) {
+	((string*)state)->append(chars, length);
+	return true;
+}
+
+/**
+ * Check that the JSON streamed to a write method is the same as the JSON
+ * written to a buffer, and that each property with values is included in the
+ * order of the required property indexes.
+ */
+TEST_F(HashCTests, ResultsHashWriteValuesJson) {
+	EXCEPTION_CREATE;
+	ResultsHash* results = ResultsHashCreate(&manager, 0);
+	ResultsHashFromUserAgent(
+		results,
+		mobileUserAgent,
+		strlen(mobileUserAgent),
+		exception);
+	EXCEPTION_THROW;
+
+	string json;
+	size_t written = ResultsHashWriteValuesJson(
+		results,
+		&json,
+		appendJson,
+		exception);
+	EXCEPTION_THROW;
+	EXPECT_EQ(json.size(), written);
+	EXPECT_EQ('{', json.front());
+	EXPECT_EQ('}', json.back());
+
+	// The buffer contains the same characters with a null terminator, and a
+	// buffer that is too small still returns the length needed.
+	vector<char> buffer(json.size() + 1);
+	written = ResultsHashGetValuesJson(
+		results,
+		buffer.data(),
+		buffer.size(),
+		exception);
+	EXCEPTION_THROW;
+	EXPECT_EQ(json.size() + 1, written);
+	EXPECT_STREQ(json.c_str(), buffer.data());
+	char small[5];
+	written = ResultsHashGetValuesJson(
+		results,
+		small,
+		sizeof(small),
+		exception);
+	EXCEPTION_THROW;
+	EXPECT_EQ(json.size() + 1, written);
+
+	// Each property with values has a key in the JSON after the key of the
+	// previous property.
+	DataSetHash* dataSet = (DataSetHash*)results->b.b.dataSet;
+	size_t previous = 0;
+	for (uint32_t i = 0; i < dataSet->b.b.available->count; i++) {
+		if (ResultsHashGetValues(results, (int)i, exception) != NULL &&
+			results->values.count > 0) {
+			string key = "\"";
+			key.append(STRING(fiftyoneDegreesPropertiesGetNameFromRequiredIndex(
+				dataSet->b.b.available,
+				(int)i)));
+			key.append("\":");
+			size_t position = json.find(key);
+			EXPECT_NE(string::npos, position) <<
+				"Property '" << key << "' missing from '" << json << "'.\n";
+			EXPECT_LT(previous, position) <<
+				"Property '" << key << "' out of order in '" << json <<
+				"'.\n";
+			previous = position;
+
+			// The first value follows the key unless it needs escaping.
+			String* value = (String*)results->values.items[0].data.ptr;
+			if (value != NULL && strpbrk(&value->value, "\"\\") == NULL) {
+				EXPECT_NE(string::npos, json.find(&value->value, position)) <<
+					"Value '" << &value->value << "' missing from '" <<
+					json << "'.\n";
+			}
+		}
+		EXCEPTION_THROW;
+	}
+	ResultsHashFree(results);
+}
+
+/**
+ * Check that the memory used by the flat graph is included in the size
+ * returned by HashSizeManagerFromFile.
+ */
+TEST_F(HashCTests, FlatGraphIncludedInSize) {
+	// Free the resources from SetUp for the same reason as
+	// HashSizeManagerFromFileException.
+	internalTearDown();
+
+	EXCEPTION_CREATE;
+	ConfigHash flatConfig = configHash;
+	flatConfig.flatGraph = true;
+	size_t collectionSize = fiftyoneDegreesHashSizeManagerFromFile(
+		&configHash,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	size_t flatSize = fiftyoneDegreesHashSizeManagerFromFile(
+		&flatConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	EXPECT_GT(flatSize, collectionSize);
+
+	internalSetUp();
+}
+
+/**
+ * Check that a data set initialised from a mapped data file gives the same
+ * results as one read from the data file, before and after it is reloaded.
+ */
+TEST_F(HashCTests, MappedFileMatchesCollection) {
+	verifyConfigMatches(
+		[](ConfigHash& config) {
+			config.b.b.allInMemory = true;
+			config.mappedFile = true;
+			config.prefaultMappedFile = true;
+		},
+		[](DataSetHash* expected, DataSetHash* actual) {
+			(void)expected;
+			ASSERT_NE((::byte*)NULL, actual->mappedFile.startByte);
+			EXPECT_TRUE(actual->config.b.b.allInMemory);
+		},
+		nullptr,
+		getUserAgents(),
+		true);
+}
+
+/**
+ * Check that mapping the data file allocates less memory than reading the
+ * whole data file into memory, as the data file is not copied.
+ */
+TEST_F(HashCTests, MappedFileNotIncludedInSize) {
+	// Free the resources from SetUp for the same reason as
+	// HashSizeManagerFromFileException.
+	internalTearDown();
+
+	EXCEPTION_CREATE;
+	ConfigHash inMemoryConfig = HashInMemoryConfig;
+	ConfigHash mappedConfig = HashInMemoryConfig;
+	mappedConfig.mappedFile = true;
+	size_t inMemorySize = fiftyoneDegreesHashSizeManagerFromFile(
+		&inMemoryConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	size_t mappedSize = fiftyoneDegreesHashSizeManagerFromFile(
+		&mappedConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	EXPECT_LT(mappedSize, inMemorySize);
+
+	internalSetUp();
+}
+
+/**
+ * Check that a data set which maps the flat graph saved by another manager
+ * gives the same results, that saving again increments the generation so the
+ * change is detected, and that a graph saved with different options is not
+ * used or reported as a change until it is saved again.
+ */
+TEST_F(HashCTests, SharedGraphMatchesCollection) {
+	const char *sharedGraphFile = "HashCTests.graph";
+	vector<string> userAgents = getUserAgents();
+	remove(sharedGraphFile);
+	ResourceManager expectedManager;
+	initManager(&expectedManager, nullptr);
+
+	// Build the flat graph in one manager and save it.
+	ResourceManager masterManager;
+	initManager(&masterManager, [](ConfigHash& config) {
+		config.optimiseNodeSearch = true;
+	});
+	EXCEPTION_CREATE;
+	StatusCode status = HashSaveSharedGraph(
+		&masterManager,
+		sharedGraphFile,
+		exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+
+	// Map the saved flat graph in another manager.
+	ResourceManager workerManager;
+	initManager(&workerManager, [&](ConfigHash& config) {
+		config.optimiseNodeSearch = true;
+		config.sharedGraphFile = sharedGraphFile;
+	});
+	DataSetHash* workerDataSet = (DataSetHash*)DataSetGet(&workerManager);
+	ASSERT_NE((GraphFlat*)NULL, workerDataSet->flatGraph);
+	EXPECT_NE((::byte*)NULL, workerDataSet->flatGraph->segment.startByte);
+	EXPECT_EQ(1U, workerDataSet->flatGraph->generation);
+	DataSetHashRelease(workerDataSet);
+	EXPECT_FALSE(HashSharedGraphChanged(&workerManager));
+
+	verifyManagersMatch(&expectedManager, &workerManager, userAgents);
+
+	// Saving again is detected, and reloading maps the new version.
+	status = HashSaveSharedGraph(&masterManager, sharedGraphFile, exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+	EXPECT_TRUE(HashSharedGraphChanged(&workerManager));
+	status = HashReloadManagerFromOriginalFile(&workerManager, exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+	workerDataSet = (DataSetHash*)DataSetGet(&workerManager);
+	EXPECT_EQ(2U, workerDataSet->flatGraph->generation);
+	DataSetHashRelease(workerDataSet);
+	EXPECT_FALSE(HashSharedGraphChanged(&workerManager));
+
+	verifyManagersMatch(&expectedManager, &workerManager, userAgents);
+
+	// A graph saved with other options is built rather than mapped.
+	ResourceManager otherManager;
+	initManager(&otherManager, [&](ConfigHash& config) {
+		config.sharedGraphFile = sharedGraphFile;
+	});
+	DataSetHash* otherDataSet = (DataSetHash*)DataSetGet(&otherManager);
+	ASSERT_NE((GraphFlat*)NULL, otherDataSet->flatGraph);
+	EXPECT_EQ((::byte*)NULL, otherDataSet->flatGraph->segment.startByte);
+	DataSetHashRelease(otherDataSet);
+
+	verifyManagersMatch(&expectedManager, &otherManager, userAgents);
+
+	// The graph it could not use is not a change, but saving again is.
+	EXPECT_FALSE(HashSharedGraphChanged(&otherManager));
+	status = HashSaveSharedGraph(&masterManager, sharedGraphFile, exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+	EXPECT_TRUE(HashSharedGraphChanged(&otherManager));
+
+	ResourceManagerFree(&otherManager);
+	ResourceManagerFree(&workerManager);
+	ResourceManagerFree(&masterManager);
+	ResourceManagerFree(&expectedManager);
+	remove(sharedGraphFile);
+}
+
+/**
+ * Check that a data set read into huge pages gives the same results as one
+ * read into normal memory, and that the collections are only reported as
+ * backed by, or advised to use, huge pages when the memory they are in is.
+ */
+TEST_F(HashCTests, HugePagesMatchesCollection) {
+	verifyConfigMatches(
+		[](ConfigHash& config) {
+			config = HashInMemoryConfig;
+			config.hugePages = true;
+			config.flatGraph = true;
+		},
+		[](DataSetHash* expected, DataSetHash* actual) {
+			(void)expected;
+			ASSERT_NE((::byte*)NULL, actual->hugePagesMemory.startByte);
+			HugePagesType type = actual->hugePagesMemory.type;
+			EXPECT_LE(actual->hugePages.nodes, type);
+			EXPECT_LE(actual->hugePages.profiles, type);
+			if (type == HUGE_PAGES_EXPLICIT) {
+				EXPECT_EQ(HUGE_PAGES_EXPLICIT, actual->hugePages.nodes);
+				EXPECT_EQ(HUGE_PAGES_EXPLICIT, actual->hugePages.profiles);
+			}
+			else if (type == HUGE_PAGES_ADVISED) {
+				EXPECT_NE(HUGE_PAGES_EXPLICIT, actual->hugePages.nodes);
+				EXPECT_NE(HUGE_PAGES_EXPLICIT, actual->hugePages.profiles);
+			}
+		});
+}
+
+/**
+ * Check that there is a replica for each online NUMA node, bound to that node,
+ * that each gives the same results as a data set from a single manager, and
+ * that they can all be reloaded.
+ */
+TEST_F(HashCTests, ReplicasMatchCollection) {
+	uint32_t i;
+	uint32_t nodes[NUMA_MAX_NODES];
+	vector<string> userAgents = getUserAgents();
+	ResourceManager expectedManager;
+	initManager(&expectedManager, nullptr);
+
+	HashReplicas replicas;
+	ConfigHash replicaConfig = configHash;
+	replicaConfig.traceRoute = false;
+	EXCEPTION_CREATE;
+	StatusCode status = HashReplicasInit(
+		&replicas,
+		&replicaConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+	ASSERT_EQ(NumaGetNodes(nodes), replicas.count);
+	ResourceManager *local = HashReplicasGet(&replicas);
+	EXPECT_GE(local, replicas.managers);
+	EXPECT_LT(local, replicas.managers + replicas.count);
+	if (replicas.count > 1) {
+		for (i = 0; i < replicas.count; i++) {
+			DataSetHash *dataSet = DataSetHashGet(
+				&replicas.managers[replicas.nodeReplicas[nodes[i]]]);
+			EXPECT_EQ((int32_t)nodes[i], dataSet->config.numaNode) <<
+				"The replica for node " << nodes[i] << " should be bound to it";
+			DataSetHashRelease(dataSet);
+		}
+	}
+
+	for (i = 0; i < replicas.count; i++) {
+		verifyManagersMatch(
+			&expectedManager,
+			&replicas.managers[i],
+			userAgents);
+	}
+
+	status = HashReplicasReload(&replicas, exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+	for (i = 0; i < replicas.count; i++) {
+		verifyManagersMatch(
+			&expectedManager,
+			&replicas.managers[i],
+			userAgents);
+	}
+
+	HashReplicasFree(&replicas);
+	EXPECT_EQ(0U, replicas.count);
+	ResourceManagerFree(&expectedManager);
+}
+
+/**
+ * Check that a pruned flat graph gives the same results as the whole flat
+ * graph, that it has fewer nodes when the performance graph is not used, and
+ * that the nodes collection is freed once the graph is pruned.
+ */
+TEST_F(HashCTests, PrunedGraphMatchesCollection) {
+	verifyConfigMatches(
+		[](ConfigHash& config) { config.pruneGraph = true; },
+		[](DataSetHash* expected, DataSetHash* actual) {
+			ASSERT_NE((GraphFlat*)NULL, actual->flatGraph);
+			EXPECT_LT(actual->flatGraph->count, expected->flatGraph->count);
+			EXPECT_LT(actual->flatGraph->size, expected->flatGraph->size);
+			EXPECT_EQ((Collection*)NULL, actual->nodes);
+		},
+		[](ConfigHash& config) {
+			setPredictiveGraph(config);
+			setFlatGraph(config);
+		});
+
+	// The nodes are also freed when they are read from the file.
+	verifyConfigMatches(
+		[](ConfigHash& config) {
+			config = HashLowMemoryConfig;
+			config.pruneGraph = true;
+			setPredictiveGraph(config);
+		},
+		[](DataSetHash* expected, DataSetHash* actual) {
+			(void)expected;
+			ASSERT_NE((GraphFlat*)NULL, actual->flatGraph);
+			EXPECT_EQ((Collection*)NULL, actual->nodes);
+		},
+		[](ConfigHash& config) {
+			setPredictiveGraph(config);
+			setFlatGraph(config);
+		});
+}
+
+/**
+ * Check that a data file trimmed for the required properties and the
+ * predictive graph gives the same results as the whole data file, that it
+ * has fewer bytes of nodes, and that only its nodes are marked as trimmed.
+ */
+TEST_F(HashCTests, TrimmedFileMatchesCollection) {
+	vector<string> userAgents = getUserAgents();
+	ResourceManager fullManager;
+	initManager(&fullManager, setPredictiveGraph);
+
+	string trimmedFilePath = dataFilePath + ".trimmed";
+	ConfigHash trimConfig = configHash;
+	setPredictiveGraph(trimConfig);
+	EXCEPTION_CREATE;
+	StatusCode status = HashTrimNodes(
+		&trimConfig,
+		&properties,
+		dataFilePath.c_str(),
+		trimmedFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+
+	ResourceManager trimmedManager;
+	initManager(
+		&trimmedManager,
+		setPredictiveGraph,
+		trimmedFilePath.c_str());
+
+	DataSetHash* fullDataSet = (DataSetHash*)DataSetGet(&fullManager);
+	DataSetHash* trimmedDataSet = (DataSetHash*)DataSetGet(&trimmedManager);
+	EXPECT_LT(
+		trimmedDataSet->header.nodes.length,
+		fullDataSet->header.nodes.length);
+	EXPECT_EQ(
+		fullDataSet->header.rootNodes.count,
+		trimmedDataSet->header.rootNodes.count);
+	EXPECT_EQ(0U, GraphGetTrimmedStart(
+		fullDataSet->nodes,
+		fullDataSet->header.nodes.length,
+		exception));
+	EXPECT_LT(0U, GraphGetTrimmedStart(
+		trimmedDataSet->nodes,
+		trimmedDataSet->header.nodes.length,
+		exception));
+	EXCEPTION_THROW;
+	DataSetHashRelease(trimmedDataSet);
+	DataSetHashRelease(fullDataSet);
+
+	verifyManagersMatch(&fullManager, &trimmedManager, userAgents);
+
+	ResourceManagerFree(&trimmedManager);
+	ResourceManagerFree(&fullManager);
+	remove(trimmedFilePath.c_str());
+}
+
+/**
+ * Check that a data file trimmed for a property of one component can be used
+ * with that property, but not with properties of the components or graphs
+ * which were not retained.
+ */
+TEST_F(HashCTests, TrimmedFileWithMorePropertiesIsRejected) {
+	PropertiesRequired trimProperties = PropertiesDefault;
+	trimProperties.string = "IsMobile";
+	ConfigHash trimConfig = configHash;
+	trimConfig.traceRoute = false;
+	setPredictiveGraph(trimConfig);
+	string trimmedFilePath = dataFilePath + ".trimmed";
+	EXCEPTION_CREATE;
+	StatusCode status = HashTrimNodes(
+		&trimConfig,
+		&trimProperties,
+		dataFilePath.c_str(),
+		trimmedFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	ASSERT_EQ(SUCCESS, status);
+
+	// The properties and graph the file was trimmed for can be used.
+	ResourceManager trimmedManager;
+	status = HashInitManagerFromFile(
+		&trimmedManager,
+		&trimConfig,
+		&trimProperties,
+		trimmedFilePath.c_str(),
+		exception);
+	EXPECT_EQ(SUCCESS, status);
+	if (status == SUCCESS) {
+		ResourceManagerFree(&trimmedManager);
+	}
+
+	// Properties of the components which were not retained can't.
+	PropertiesRequired moreProperties = PropertiesDefault;
+	moreProperties.string = "IsMobile,BrowserName";
+	status = HashInitManagerFromFile(
+		&trimmedManager,
+		&trimConfig,
+		&moreProperties,
+		trimmedFilePath.c_str(),
+		exception);
+	EXPECT_EQ(REQ_PROP_NOT_PRESENT, status);
+	if (status == SUCCESS) {
+		ResourceManagerFree(&trimmedManager);
+	}
+
+	// Nor can the performance graph which was not retained.
+	ConfigHash performanceConfig = trimConfig;
+	performanceConfig.usePerformanceGraph = true;
+	status = HashInitManagerFromFile(
+		&trimmedManager,
+		&performanceConfig,
+		&trimProperties,
+		trimmedFilePath.c_str(),
+		exception);
+	EXPECT_EQ(INVALID_CONFIG, status);
+	if (status == SUCCESS) {
+		ResourceManagerFree(&trimmedManager);
+	}
+
+	remove(trimmedFilePath.c_str());
+}
+
+/**
+ * Check that the device ids of results are resolved to the same profiles with
+ * and without the profile id table, and that device ids which are not valid
+ * resolve to no profiles.
+ */
+TEST_F(HashCTests, ProfileIdTableMatchesCollection) {
+	vector<string> userAgents;
+	char userAgent[500] = "";
+	TextFileIterateWithLimit(
+		GetFilePath(_dataFolderName, _userAgentsFileName).c_str(),
+		userAgent,
+		sizeof(userAgent),
+		200,
+		&userAgents,
+		addUserAgent);
+	userAgents.push_back(mobileUserAgent);
+
+	ResourceManager searchManager;
+	ConfigHash searchConfig = configHash;
+	searchConfig.profileIdTable = false;
+	EXCEPTION_CREATE;
+	HashInitManagerFromFile(
+		&searchManager,
+		&searchConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+
+	ResourceManager tableManager;
+	ConfigHash tableConfig = configHash;
+	tableConfig.profileIdTable = true;
+	HashInitManagerFromFile(
+		&tableManager,
+		&tableConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+
+	DataSetHash* searchDataSet = (DataSetHash*)DataSetGet(&searchManager);
+	EXPECT_EQ((HashProfileIdTable*)NULL, searchDataSet->profileIdTable);
+	DataSetHashRelease(searchDataSet);
+
+	char deviceId[200] = "", searchDeviceId[200] = "", tableDeviceId[200] = "";
+	ResultsHash* results = ResultsHashCreate(&searchManager, 0);
+	for (const string& ua : userAgents) {
+		ResultsHash* searchResults = ResultsHashCreate(&searchManager, 0);
+		ResultsHash* tableResults = ResultsHashCreate(&tableManager, 0);
+		ResultsHashFromUserAgent(results, ua.c_str(), ua.length(), exception);
+		EXCEPTION_THROW;
+		HashGetDeviceIdFromResults(
+			results,
+			deviceId,
+			sizeof(deviceId),
+			exception);
+		EXCEPTION_THROW;
+		int searchCount = ResultsHashFromDeviceId(
+			searchResults,
+			deviceId,
+			strlen(deviceId) + 1,
+			exception);
+		EXCEPTION_THROW;
+		int tableCount = ResultsHashFromDeviceId(
+			tableResults,
+			deviceId,
+			strlen(deviceId) + 1,
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_EQ(searchCount, tableCount) << "Device id: " << deviceId;
+		HashGetDeviceIdFromResults(
+			searchResults,
+			searchDeviceId,
+			sizeof(searchDeviceId),
+			exception);
+		EXCEPTION_THROW;
+		HashGetDeviceIdFromResults(
+			tableResults,
+			tableDeviceId,
+			sizeof(tableDeviceId),
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_STREQ(searchDeviceId, tableDeviceId) << "Device id: " << deviceId;
+		ResultsHashFree(tableResults);
+		ResultsHashFree(searchResults);
+	}
+
+	// Profile ids which are zero, too large, or not numbers never match.
+	const char* invalid[] = {
+		"0-0-0-0",
+		"99999999999999999999-4294967296",
+		"abc-def",
+		"",
+	};
+	ResultsHash* tableResults = ResultsHashCreate(&tableManager, 0);
+	for (const char* id : invalid) {
+		EXPECT_EQ(0, ResultsHashFromDeviceId(
+			tableResults,
+			id,
+			strlen(id) + 1,
+			exception)) << "Device id: " << id;
+		EXCEPTION_THROW;
+	}
+
+	ResultsHashFree(tableResults);
+	ResultsHashFree(results);
+	ResourceManagerFree(&tableManager);
+	ResourceManagerFree(&searchManager);
+}
+
+/**
+ * Check that device ids are the same whether profile ids are found from the
+ * profile id table or the profiles collection, and that the binary form of
+ * the device id has the same profile ids and returns the same device.
+ */
+TEST_F(HashCTests, DeviceIdBinaryMatchesString) {
+	vector<string> userAgents;
+	char userAgent[500] = "";
+	TextFileIterateWithLimit(
+		GetFilePath(_dataFolderName, _userAgentsFileName).c_str(),
+		userAgent,
+		sizeof(userAgent),
+		200,
+		&userAgents,
+		addUserAgent);
+	userAgents.push_back(mobileUserAgent);
+
+	ResourceManager searchManager;
+	ConfigHash searchConfig = configHash;
+	searchConfig.profileIdTable = false;
+	EXCEPTION_CREATE;
+	HashInitManagerFromFile(
+		&searchManager,
+		&searchConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+
+	ResourceManager tableManager;
+	ConfigHash tableConfig = configHash;
+	tableConfig.profileIdTable = true;
+	HashInitManagerFromFile(
+		&tableManager,
+		&tableConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+
+	DataSetHash* dataSet = (DataSetHash*)DataSetGet(&tableManager);
+	uint32_t componentsCount = dataSet->componentsList.count;
+	DataSetHashRelease(dataSet);
+
+	char searchDeviceId[200] = "", tableDeviceId[200] = "",
+		binaryDeviceId[200] = "";
+	vector<uint32_t> profileIds(componentsCount);
+	for (const string& ua : userAgents) {
+		ResultsHash* searchResults = ResultsHashCreate(&searchManager, 0);
+		ResultsHash* tableResults = ResultsHashCreate(&tableManager, 0);
+		ResultsHash* binaryResults = ResultsHashCreate(&tableManager, 0);
+		ResultsHashFromUserAgent(
+			searchResults,
+			ua.c_str(),
+			ua.length(),
+			exception);
+		EXCEPTION_THROW;
+		ResultsHashFromUserAgent(
+			tableResults,
+			ua.c_str(),
+			ua.length(),
+			exception);
+		EXCEPTION_THROW;
+		HashGetDeviceIdFromResults(
+			searchResults,
+			searchDeviceId,
+			sizeof(searchDeviceId),
+			exception);
+		EXCEPTION_THROW;
+		HashGetDeviceIdFromResults(
+			tableResults,
+			tableDeviceId,
+			sizeof(tableDeviceId),
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_STREQ(searchDeviceId, tableDeviceId) << "User-Agent: " << ua;
+
+		// The binary form must hold the same profile ids as the string.
+		EXPECT_EQ(componentsCount, HashGetDeviceIdBinaryFromResults(
+			tableResults,
+			profileIds.data(),
+			componentsCount,
+			exception));
+		EXCEPTION_THROW;
+		string expected;
+		for (uint32_t i = 0; i < componentsCount; i++) {
+			if (i != 0) {
+				expected += '-';
+			}
+			expected += to_string(profileIds[i]);
+		}
+		EXPECT_STREQ(expected.c_str(), tableDeviceId) << "User-Agent: " << ua;
+
+		// Processing the binary form must return the same device.
+		ResultsHashFromDeviceIdBinary(
+			binaryResults,
+			profileIds.data(),
+			componentsCount,
+			exception);
+		EXCEPTION_THROW;
+		HashGetDeviceIdFromResults(
+			binaryResults,
+			binaryDeviceId,
+			sizeof(binaryDeviceId),
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_STREQ(tableDeviceId, binaryDeviceId) << "User-Agent: " << ua;
+
+		ResultsHashFree(binaryResults);
+		ResultsHashFree(tableResults);
+		ResultsHashFree(searchResults);
+	}
+
+	// The binary form needs space for every component.
+	ResultsHash* results = ResultsHashCreate(&tableManager, 0);
+	EXPECT_EQ(0u, HashGetDeviceIdBinaryFromResults(
+		results,
+		profileIds.data(),
+		componentsCount - 1,
+		exception));
+	EXCEPTION_THROW;
+	ResultsHashFree(results);
+
+	ResourceManagerFree(&tableManager);
+	ResourceManagerFree(&searchManager);
+}
+
+static bool addProfileId(void* state, Item* item) {
+	((vector<uint32_t>*)state)->push_back(
+		((Profile*)item->data.ptr)->profileId);
+	return true;
+}
+
+/**
+ * Check that the profiles found for properties and values are the same
+ * whether they are found from the profile value index or by checking every
+ * profile, and that the index is only built when it is first used.
+ */
+TEST_F(HashCTests, ProfileValueIndexMatchesCollection) {
+	ResourceManager searchManager;
+	ConfigHash searchConfig = configHash;
+	searchConfig.profileValueIndex = false;
+	EXCEPTION_CREATE;
+	HashInitManagerFromFile(
+		&searchManager,
+		&searchConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+
+	ResourceManager indexManager;
+	ConfigHash indexConfig = configHash;
+	indexConfig.profileValueIndex = true;
+	HashInitManagerFromFile(
+		&indexManager,
+		&indexConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+
+	DataSetHash* dataSet = (DataSetHash*)DataSetGet(&indexManager);
+	EXPECT_EQ((HashProfileValueIndex*)NULL, dataSet->profileValueIndex);
+	DataSetHashRelease(dataSet);
+
+	const char* values[][2] = {
+		{ "IsMobile", "True" },
+		{ "IsMobile", "False" },
+		{ "DeviceType", "SmartPhone" },
+		{ "IsMobile", "NotAValue" },
+		{ "NotAProperty", "True" },
+	};
+	for (const auto& value : values) {
+		vector<uint32_t> searchIds, indexIds;
+		uint32_t searchCount = HashIterateProfilesForPropertyAndValue(
+			&searchManager,
+			value[0],
+			value[1],
+			&searchIds,
+			addProfileId,
+			exception);
+		EXCEPTION_THROW;
+		uint32_t indexCount = HashIterateProfilesForPropertyAndValue(
+			&indexManager,
+			value[0],
+			value[1],
+			&indexIds,
+			addProfileId,
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_EQ(searchCount, indexCount) << value[0] << "=" << value[1];
+		EXPECT_EQ(searchIds.size(), (size_t)searchCount);
+		sort(searchIds.begin(), searchIds.end());
+		sort(indexIds.begin(), indexIds.end());
+		EXPECT_EQ(searchIds, indexIds) << value[0] << "=" << value[1];
+	}
+
+	dataSet = (DataSetHash*)DataSetGet(&indexManager);
+	EXPECT_NE((HashProfileValueIndex*)NULL, dataSet->profileValueIndex);
+	DataSetHashRelease(dataSet);
+
+	// Intersections must match with and without the index, a repeated value
+	// must match the value alone, and values which no profile has together
+	// must match nothing.
+	const char* propertyNames[][2] = {
+		{ "IsMobile", "DeviceType" },
+		{ "IsMobile", "IsMobile" },
+		{ "IsMobile", "IsMobile" },
+	};
+	const char* valueNames[][2] = {
+		{ "True", "SmartPhone" },
+		{ "True", "True" },
+		{ "True", "False" },
+	};
+	vector<uint32_t> isMobileIds;
+	HashIterateProfilesForPropertyAndValue(
+		&searchManager,
+		"IsMobile",
+		"True",
+		&isMobileIds,
+		addProfileId,
+		exception);
+	EXCEPTION_THROW;
+	for (size_t i = 0; i < sizeof(propertyNames) / sizeof(propertyNames[0]);
+		i++) {
+		vector<uint32_t> searchIds, indexIds;
+		HashIterateProfilesForPropertiesAndValues(
+			&searchManager,
+			propertyNames[i],
+			valueNames[i],
+			2,
+			&searchIds,
+			addProfileId,
+			exception);
+		EXCEPTION_THROW;
+		HashIterateProfilesForPropertiesAndValues(
+			&indexManager,
+			propertyNames[i],
+			valueNames[i],
+			2,
+			&indexIds,
+			addProfileId,
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_EQ(searchIds, indexIds) << "Intersection: " << i;
+		if (i == 1) {
+			EXPECT_EQ(isMobileIds.size(), indexIds.size());
+		}
+		if (i == 2) {
+			EXPECT_EQ((size_t)0, indexIds.size());
+		}
+	}
+
+	// Properties of different components match the profiles of each
+	// component which have that component's values, and match nothing if any
+	// component has no such profile.
+	vector<uint32_t> chromeIds, expectedIds;
+	HashIterateProfilesForPropertyAndValue(
+		&searchManager,
+		"BrowserName",
+		"Chrome",
+		&chromeIds,
+		addProfileId,
+		exception);
+	EXCEPTION_THROW;
+	ASSERT_LT((size_t)0, chromeIds.size());
+	ASSERT_LT((size_t)0, isMobileIds.size());
+	expectedIds = isMobileIds;
+	expectedIds.insert(expectedIds.end(), chromeIds.begin(), chromeIds.end());
+	sort(expectedIds.begin(), expectedIds.end());
+	const char* mixedPropertyNames[] = { "IsMobile", "BrowserName", "IsMobile" };
+	const char* mixedValueNames[] = { "True", "Chrome", "False" };
+	ResourceManager* mixedManagers[] = { &searchManager, &indexManager };
+	for (ResourceManager* mixedManager : mixedManagers) {
+		vector<uint32_t> mixedIds;
+		uint32_t mixedCount = HashIterateProfilesForPropertiesAndValues(
+			mixedManager,
+			mixedPropertyNames,
+			mixedValueNames,
+			2,
+			&mixedIds,
+			addProfileId,
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_EQ(expectedIds.size(), (size_t)mixedCount);
+		sort(mixedIds.begin(), mixedIds.end());
+		EXPECT_EQ(expectedIds, mixedIds);
+
+		mixedIds.clear();
+		mixedCount = HashIterateProfilesForPropertiesAndValues(
+			mixedManager,
+			mixedPropertyNames,
+			mixedValueNames,
+			3,
+			&mixedIds,
+			addProfileId,
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_EQ((uint32_t)0, mixedCount);
+		EXPECT_EQ((size_t)0, mixedIds.size());
+	}
+
+	ResourceManagerFree(&indexManager);
+	ResourceManagerFree(&searchManager);
+}
+
+/**
+ * Check that the root nodes for each component and header are the root nodes
+ * of the component's graph for the header in the data file, and that there
+ * are no root nodes where the component has no graph for the header.
+ */
+TEST_F(HashCTests, ComponentRootNodesMatchDataFile) {
+	ResourceManager memoryManager;
+	ConfigHash memoryConfig = HashInMemoryConfig;
+	EXCEPTION_CREATE;
+	HashInitManagerFromFile(
+		&memoryManager,
+		&memoryConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+
+	DataSetHash* dataSet = (DataSetHash*)DataSetGet(&memoryManager);
+	ASSERT_NE((HashRootNodes*)NULL, dataSet->componentRootNodes);
+	const HashRootNodes* fileRootNodes = (const HashRootNodes*)(
+		dataSet->fileStartByte + dataSet->header.rootNodes.startPosition);
+	const uint32_t headersCount = dataSet->b.b.uniqueHeaders->count;
+	for (uint32_t c = 0; c < dataSet->componentsList.count; c++) {
+		Component* component =
+			(Component*)dataSet->componentsList.items[c].data.ptr;
+		const ComponentKeyValuePair* graphKey = &component->firstKeyValuePair;
+		for (uint32_t h = 0; h < headersCount; h++) {
+			const HashRootNodes* rootNodes =
+				&dataSet->componentRootNodes[c * headersCount + h];
+			const HashRootNodes* expected = NULL;
+			for (int i = 0; i < component->keyValuesCount; i++) {
+				if (graphKey[i].key ==
+					dataSet->b.b.uniqueHeaders->items[h].headerId) {
+					expected = &fileRootNodes[graphKey[i].value];
+					break;
+				}
+			}
+			if (expected == NULL) {
+				EXPECT_EQ(UINT32_MAX, rootNodes->performanceNodeOffset);
+				EXPECT_EQ(UINT32_MAX, rootNodes->predictiveNodeOffset);
+			}
+			else {
+				EXPECT_EQ(
+					expected->performanceNodeOffset,
+					rootNodes->performanceNodeOffset);
+				EXPECT_EQ(
+					expected->predictiveNodeOffset,
+					rootNodes->predictiveNodeOffset);
+			}
+		}
+	}
+	DataSetHashRelease(dataSet);
+	ResourceManagerFree(&memoryManager);
+}
+
+/**
+ * Check that reusing results for different evidence held in the same memory
+ * produces the same results as new results for each User-Agent. The prefix
+ * hash codes of the evidence must be calculated again for each User-Agent
+ * even though the value pointer and length are unchanged. Difference and
+ * drift are enabled so that the retries use the prefix hash codes.
+ */
+TEST_F(HashCTests, PrefixHashesRecalculatedForNewEvidence) {
+	EXCEPTION_CREATE;
+	uint32_t i, j, c;
+	vector<string> userAgents;
+	char userAgent[500] = "";
+	TextFileIterateWithLimit(
+		GetFilePath(_dataFolderName, _userAgentsFileName).c_str(),
+		userAgent,
+		sizeof(userAgent),
+		100,
+		&userAgents,
+		addUserAgent);
+	for (i = 0; i < userAgents.size(); i++) {
+		userAgents[i].resize(200, ' ');
+		for (j = i % 7; j < userAgents[i].size(); j += 13) {
+			userAgents[i][j] = userAgents[i][j] == 'x' ? 'y' : 'x';
+		}
+	}
+
+	ResourceManager retryManager;
+	initManager(&retryManager, setDifferenceAndDrift);
+	DataSetHash* dataSet = (DataSetHash*)DataSetGet(&retryManager);
+
+	ResultsHash* reused = ResultsHashCreate(&retryManager, 0);
+	for (i = 0; i < userAgents.size(); i++) {
+		strcpy(userAgent, userAgents[i].c_str());
+		ResultsHashFromUserAgent(
+			reused,
+			userAgent,
+			userAgents[i].size(),
+			exception);
+		EXCEPTION_THROW;
+		ResultsHash* expected = ResultsHashCreate(&retryManager, 0);
+		ResultsHashFromUserAgent(
+			expected,
+			userAgents[i].c_str(),
+			userAgents[i].size(),
+			exception);
+		EXCEPTION_THROW;
+		EXPECT_EQ(expected->count, reused->count);
+		for (j = 0; j < expected->count && j < reused->count; j++) {
+			ResultHash* e = &expected->items[j];
+			ResultHash* a = &reused->items[j];
+			EXPECT_EQ(e->iterations, a->iterations);
+			EXPECT_EQ(e->difference, a->difference);
+			EXPECT_EQ(e->drift, a->drift);
+			EXPECT_EQ(e->matchedNodes, a->matchedNodes);
+			for (c = 0; c < dataSet->componentsList.count; c++) {
+				EXPECT_EQ(e->profileOffsets[c], a->profileOffsets[c]) <<
+					"Profile differs for '" << userAgents[i] << "'.\n";
+			}
+		}
+		ResultsHashFree(expected);
+	}
+	ResultsHashFree(reused);
+	DataSetHashRelease(dataSet);
+	ResourceManagerFree(&retryManager);
+}
+
+/**
+ * Check that retries with difference and drift which resume from the node at
+ * the break depth produce the same results and metrics as evaluating the
+ * graph again from the root node. Route tracing requires every node to be
+ * evaluated so is used to get the results from the root node.
+ */
+TEST_F(HashCTests, RetriesFromBreakMatchRetriesFromRoot) {
+	uint32_t i, j;
+	vector<string> userAgents;
+	char userAgent[500] = "";
+	TextFileIterateWithLimit(
+		GetFilePath(_dataFolderName, _userAgentsFileName).c_str(),
+		userAgent,
+		sizeof(userAgent),
+		100,
+		&userAgents,
+		addUserAgent);
+	for (i = 0; i < userAgents.size(); i++) {
+		for (j = i % 5; j < userAgents[i].size(); j += 9) {
+			userAgents[i][j] = userAgents[i][j] == 'x' ? 'y' : 'x';
+		}
+	}
+
+	// The manager from the root node traces the route, which initManager
+	// always disables, so is initialised directly.
+	ResourceManager rootManager;
+	ConfigHash rootConfig = configHash;
+	setDifferenceAndDrift(rootConfig);
+	rootConfig.traceRoute = true;
+	EXCEPTION_CREATE;
+	HashInitManagerFromFile(
+		&rootManager,
+		&rootConfig,
+		&properties,
+		dataFilePath.c_str(),
+		exception);
+	EXCEPTION_THROW;
+	ResourceManager breakManager;
+	initManager(&breakManager, setDifferenceAndDrift);
+
+	verifyManagersMatch(&rootManager, &breakManager, userAgents);
+
+	ResourceManagerFree(&breakManager);
+	ResourceManagerFree(&rootManager);
+}